@@ -103,6 +103,17 @@ public:
 			this->_observer.notifyClearRedoEvent();
 		}
 
+		/**
+		 * Issue an expired event to the UndoStackObserver that is associated with this
+		 * UndoStackObserverRecord.
+		 *
+		 * \param log The event log being dropped from the undo stack.
+		 */
+		void issueUndoExpired(Event* log)
+		{
+			this->_observer.notifyUndoExpiredEvent(log);
+		}
+
 	private:
 		UndoStackObserver& _observer;
 	};
@@ -155,6 +166,14 @@ public:
 	virtual void notifyClearUndoEvent();
 	virtual void notifyClearRedoEvent();
 
+	/**
+	 * Notify all registered UndoStackObservers of the oldest event log being dropped
+	 * from the undo stack.
+	 *
+	 * \param log The event log being dropped.
+	 */
+	virtual void notifyUndoExpiredEvent(Event* log);
+
 private:
 	// Remove an observer from a given list
 	bool _remove_one(UndoObserverRecordList& list, UndoStackObserver& rec);
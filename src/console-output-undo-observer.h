@@ -30,6 +30,7 @@ public:
     void notifyUndoCommitEvent(Event* log);
     void notifyClearUndoEvent();
     void notifyClearRedoEvent();
+    void notifyUndoExpiredEvent(Event* log);
 
 };
 }
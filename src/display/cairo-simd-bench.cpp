@@ -0,0 +1,120 @@
+/**
+ * @file
+ * Micro-benchmark of the pixel span kernels used by filter primitives.
+ *
+ * Prints the throughput of every kernel in megapixels per second,
+ * for each instruction set supported by the processor.
+ * Build with "make cairo-simd-bench" in the src directory, or in the
+ * build directory when building with CMake.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <glib.h>
+#include "display/cairo-simd.h"
+
+namespace {
+
+int const WIDTH = 1024;
+int const HEIGHT = 1024;
+int const PIXELS = WIDTH * HEIGHT;
+
+std::vector<guint32> in1(PIXELS), in2(PIXELS), out(PIXELS);
+
+gint32 const arithmetic_k[4] = { 128, -65025, 130050, 4144959 };
+gint32 const matrix_v[20] = {
+    54, 182, 18, 0, 0,
+    -40, 300, 0, 0, 1000,
+    0, 0, 255, 0, 0,
+    0, 0, 0, 255, 0 };
+double const saturate_v[9] = {
+    0.6065, 0.3575, 0.036,
+    0.1065, 0.8575, 0.036,
+    0.1065, 0.3575, 0.536 };
+
+void blend_multiply() { ink_cairo_span_blend_multiply(&out[0], &in1[0], &in2[0], PIXELS); }
+void blend_screen() { ink_cairo_span_blend_screen(&out[0], &in1[0], &in2[0], PIXELS); }
+void blend_darken() { ink_cairo_span_blend_darken(&out[0], &in1[0], &in2[0], PIXELS); }
+void blend_lighten() { ink_cairo_span_blend_lighten(&out[0], &in1[0], &in2[0], PIXELS); }
+void compose_arithmetic() { ink_cairo_span_compose_arithmetic(&out[0], &in1[0], &in2[0], PIXELS, arithmetic_k); }
+void color_matrix() { ink_cairo_span_color_matrix(&out[0], &in1[0], PIXELS, matrix_v); }
+void color_saturate() { ink_cairo_span_color_saturate(&out[0], &in1[0], PIXELS, saturate_v); }
+
+struct Primitive {
+    char const *name;
+    void (*run)();
+};
+
+Primitive const primitives[] = {
+    { "feBlend multiply", blend_multiply },
+    { "feBlend screen", blend_screen },
+    { "feBlend darken", blend_darken },
+    { "feBlend lighten", blend_lighten },
+    { "feComposite arithmetic", compose_arithmetic },
+    { "feColorMatrix matrix", color_matrix },
+    { "feColorMatrix saturate", color_saturate }
+};
+
+double megapixels_per_second(void (*run)())
+{
+    GTimer *timer = g_timer_new();
+    int iterations = 0;
+    // run for at least half a second
+    do {
+        run();
+        ++iterations;
+    } while (g_timer_elapsed(timer, NULL) < 0.5);
+    double elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+    return double(iterations) * PIXELS / elapsed / 1e6;
+}
+
+} // end anonymous namespace
+
+int main()
+{
+    srand(1);
+    for (int i = 0; i < PIXELS; ++i) {
+        guint32 a = rand() % 256;
+        guint32 r = rand() % (a + 1), g = rand() % (a + 1), b = rand() % (a + 1);
+        in1[i] = (a << 24) | (r << 16) | (g << 8) | b;
+        a = rand() % 256;
+        r = rand() % (a + 1); g = rand() % (a + 1); b = rand() % (a + 1);
+        in2[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+
+    printf("%-24s", "Mpx/s");
+    for (int level = INK_CAIRO_SIMD_NONE; level <= ink_cairo_simd_supported(); ++level) {
+        printf("%10s", ink_cairo_simd_level_name(InkCairoSimdLevel(level)));
+    }
+    printf("\n");
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(primitives); ++i) {
+        printf("%-24s", primitives[i].name);
+        for (int level = INK_CAIRO_SIMD_NONE; level <= ink_cairo_simd_supported(); ++level) {
+            ink_cairo_simd_set_level(InkCairoSimdLevel(level));
+            printf("%10.1f", megapixels_per_second(primitives[i].run));
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
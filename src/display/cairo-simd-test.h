@@ -0,0 +1,248 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "display/cairo-simd.h"
+#include "display/nr-filter-functors.h"
+
+class CairoSimdTest : public CxxTest::TestSuite {
+private:
+    static int const N = 4099; // not a multiple of the vector width, to test the tails
+    static int const W = 61;   // surfaces for the functor tests; W * H and (W + 3) * H fit in N
+    static int const H = 64;
+    std::vector<guint32> in1;
+    std::vector<guint32> in2;
+
+    static guint32 randomPixel()
+    {
+        // premultiplied; make fully transparent and fully opaque pixels common
+        guint32 a = rand() % 256;
+        if (rand() % 8 == 0) {
+            a = (rand() % 2) * 255;
+        }
+        guint32 r = rand() % (a + 1), g = rand() % (a + 1), b = rand() % (a + 1);
+        return (a << 24) | (r << 16) | (g << 8) | b;
+    }
+
+    // checks that all supported instruction sets give the same results as the scalar code
+    template <typename Kernel>
+    void checkLevels(Kernel kernel)
+    {
+        InkCairoSimdLevel saved = ink_cairo_simd_level();
+        std::vector<guint32> expected(N), result(N);
+        ink_cairo_simd_set_level(INK_CAIRO_SIMD_NONE);
+        kernel(&expected[0]);
+        for (int level = INK_CAIRO_SIMD_SSE2; level <= ink_cairo_simd_supported(); ++level) {
+            ink_cairo_simd_set_level(InkCairoSimdLevel(level));
+            kernel(&result[0]);
+            TSM_ASSERT(ink_cairo_simd_level_name(InkCairoSimdLevel(level)), expected == result);
+        }
+        ink_cairo_simd_set_level(saved);
+    }
+
+    // hides the span overload of a functor, so that its operator() is used for every pixel
+    template <typename F>
+    struct PerPixel {
+        PerPixel(F const &f) : f(f) {}
+        guint32 operator()(guint32 in) { return f(in); }
+        guint32 operator()(guint32 in1, guint32 in2) { return f(in1, in2); }
+        F f;
+    };
+
+    static cairo_surface_t *createSurface(std::vector<guint32> &data, int stride)
+    {
+        return cairo_image_surface_create_for_data(reinterpret_cast<unsigned char *>(&data[0]),
+                                                   CAIRO_FORMAT_ARGB32, W, H, stride * 4);
+    }
+
+    // checks that the surface template gives the pixels of the filter primitive's functor
+    // at all supported instruction sets, with and without row padding
+    template <typename F>
+    void checkBlendFunctor(F functor)
+    {
+        InkCairoSimdLevel saved = ink_cairo_simd_level();
+        for (int stride = W; stride <= W + 3; stride += 3) {
+            std::vector<guint32> expected(N, 0), result(N, 0);
+            cairo_surface_t *a = createSurface(in1, stride);
+            cairo_surface_t *b = createSurface(in2, stride);
+            cairo_surface_t *e = createSurface(expected, stride);
+            cairo_surface_t *r = createSurface(result, stride);
+            ink_cairo_surface_blend(a, b, e, PerPixel<F>(functor));
+            for (int level = INK_CAIRO_SIMD_NONE; level <= ink_cairo_simd_supported(); ++level) {
+                ink_cairo_simd_set_level(InkCairoSimdLevel(level));
+                std::fill(result.begin(), result.end(), 0);
+                ink_cairo_surface_blend(a, b, r, functor);
+                TSM_ASSERT(ink_cairo_simd_level_name(InkCairoSimdLevel(level)), expected == result);
+            }
+            cairo_surface_destroy(a);
+            cairo_surface_destroy(b);
+            cairo_surface_destroy(e);
+            cairo_surface_destroy(r);
+        }
+        ink_cairo_simd_set_level(saved);
+    }
+
+    template <typename F>
+    void checkFilterFunctor(F functor)
+    {
+        InkCairoSimdLevel saved = ink_cairo_simd_level();
+        for (int stride = W; stride <= W + 3; stride += 3) {
+            std::vector<guint32> expected(N, 0), result(N, 0);
+            cairo_surface_t *a = createSurface(in1, stride);
+            cairo_surface_t *e = createSurface(expected, stride);
+            cairo_surface_t *r = createSurface(result, stride);
+            ink_cairo_surface_filter(a, e, PerPixel<F>(functor));
+            for (int level = INK_CAIRO_SIMD_NONE; level <= ink_cairo_simd_supported(); ++level) {
+                ink_cairo_simd_set_level(InkCairoSimdLevel(level));
+                std::fill(result.begin(), result.end(), 0);
+                ink_cairo_surface_filter(a, r, functor);
+                TSM_ASSERT(ink_cairo_simd_level_name(InkCairoSimdLevel(level)), expected == result);
+
+                // in place
+                std::vector<guint32> inplace(in1);
+                cairo_surface_t *i = createSurface(inplace, stride);
+                ink_cairo_surface_filter(i, i, functor);
+                cairo_surface_destroy(i);
+                for (int y = 0; y < H; ++y) {
+                    TSM_ASSERT(ink_cairo_simd_level_name(InkCairoSimdLevel(level)),
+                               std::equal(&expected[y * stride], &expected[y * stride + W], &inplace[y * stride]));
+                }
+            }
+            cairo_surface_destroy(a);
+            cairo_surface_destroy(e);
+            cairo_surface_destroy(r);
+        }
+        ink_cairo_simd_set_level(saved);
+    }
+
+    struct Blend {
+        Blend(void (*f)(guint32 *, guint32 const *, guint32 const *, int),
+              std::vector<guint32> const &a, std::vector<guint32> const &b)
+            : func(f), in1(a), in2(b) {}
+        void operator()(guint32 *out) { func(out, &in1[0], &in2[0], N); }
+        void (*func)(guint32 *, guint32 const *, guint32 const *, int);
+        std::vector<guint32> const &in1, &in2;
+    };
+
+    struct Compose {
+        Compose(std::vector<guint32> const &a, std::vector<guint32> const &b, gint32 const *k)
+            : in1(a), in2(b), k(k) {}
+        void operator()(guint32 *out) { ink_cairo_span_compose_arithmetic(out, &in1[0], &in2[0], N, k); }
+        std::vector<guint32> const &in1, &in2;
+        gint32 const *k;
+    };
+
+    struct Matrix {
+        Matrix(std::vector<guint32> const &a, gint32 const *v) : in(a), v(v) {}
+        void operator()(guint32 *out) { ink_cairo_span_color_matrix(out, &in[0], N, v); }
+        std::vector<guint32> const &in;
+        gint32 const *v;
+    };
+
+    struct Saturate {
+        Saturate(std::vector<guint32> const &a, double const *v) : in(a), v(v) {}
+        void operator()(guint32 *out) { ink_cairo_span_color_saturate(out, &in[0], N, v); }
+        std::vector<guint32> const &in;
+        double const *v;
+    };
+
+public:
+    CairoSimdTest() : in1(N), in2(N)
+    {
+        srand(1);
+        for (int i = 0; i < N; ++i) {
+            in1[i] = randomPixel();
+            in2[i] = randomPixel();
+        }
+    }
+    virtual ~CairoSimdTest() {}
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static CairoSimdTest *createSuite() { return new CairoSimdTest(); }
+    static void destroySuite( CairoSimdTest *suite ) { delete suite; }
+
+    void testBlend()
+    {
+        checkLevels(Blend(ink_cairo_span_blend_multiply, in1, in2));
+        checkLevels(Blend(ink_cairo_span_blend_screen, in1, in2));
+        checkLevels(Blend(ink_cairo_span_blend_darken, in1, in2));
+        checkLevels(Blend(ink_cairo_span_blend_lighten, in1, in2));
+    }
+
+    void testBlendFunctors()
+    {
+        using namespace Inkscape::Filters;
+        checkBlendFunctor(BlendMultiply());
+        checkBlendFunctor(BlendScreen());
+        checkBlendFunctor(BlendDarken());
+        checkBlendFunctor(BlendLighten());
+    }
+
+    void testComposeArithmetic()
+    {
+        // k1 = 0.5, k2 = -1, k3 = 2, k4 = 0.25 and an out-of-range set
+        gint32 const k_mixed[4] = { 128, -65025, 130050, 4144959 };
+        gint32 const k_large[4] = { 1020, 260100, -195075, -16581375 };
+        checkLevels(Compose(in1, in2, k_mixed));
+        checkLevels(Compose(in1, in2, k_large));
+    }
+
+    void testComposeArithmeticFunctor()
+    {
+        using Inkscape::Filters::ComposeArithmetic;
+        checkBlendFunctor(ComposeArithmetic(0.5, -1, 2, 0.25));
+        checkBlendFunctor(ComposeArithmetic(4, 4, -3, -1));
+    }
+
+    void testColorMatrix()
+    {
+        gint32 v[20];
+        for (int i = 0; i < 20; ++i) {
+            v[i] = (rand() % 1021 - 510) * ((i % 5 == 4) ? 255 : 1);
+        }
+        checkLevels(Matrix(in1, v));
+
+        // the results must also be correct in place
+        std::vector<guint32> expected(N), inplace(in1);
+        ink_cairo_span_color_matrix(&expected[0], &in1[0], N, v);
+        ink_cairo_span_color_matrix(&inplace[0], &inplace[0], N, v);
+        TS_ASSERT(expected == inplace);
+    }
+
+    void testColorMatrixFunctors()
+    {
+        using namespace Inkscape::Filters;
+        std::vector<double> values(20);
+        for (int i = 0; i < 20; ++i) {
+            values[i] = (rand() % 1021 - 510) / 255.0;
+        }
+        checkFilterFunctor(ColorMatrixMatrix(values));
+        for (double s = 0.0; s <= 1.0; s += 0.125) {
+            checkFilterFunctor(ColorMatrixSaturate(s));
+        }
+    }
+
+    void testColorSaturate()
+    {
+        for (double s = 0.0; s <= 1.0; s += 0.125) {
+            double const v[9] = {
+                0.213+0.787*s, 0.715-0.715*s, 0.072-0.072*s,
+                0.213-0.213*s, 0.715+0.285*s, 0.072-0.072*s,
+                0.213-0.213*s, 0.715-0.715*s, 0.072+0.928*s };
+            checkLevels(Saturate(in1, v));
+        }
+    }
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,702 @@
+/**
+ * @file
+ * Vectorized pixel span kernels for the Cairo software blending templates.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <algorithm>
+#include "display/cairo-simd.h"
+
+#if defined(__SSE2__)
+# define INK_SIMD_SSE2 1
+# include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled with a function target attribute, so that the rest
+// of the program does not require AVX2. This needs GCC 4.9 or later.
+#if defined(INK_SIMD_SSE2) && defined(__GNUC__) && !defined(__clang__) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define INK_SIMD_AVX2 1
+# define INK_AVX2_TARGET __attribute__((target("avx2")))
+# include <immintrin.h>
+#endif
+
+namespace {
+
+InkCairoSimdLevel detect_level()
+{
+#ifdef INK_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return INK_CAIRO_SIMD_AVX2;
+    }
+#endif
+#ifdef INK_SIMD_SSE2
+    return INK_CAIRO_SIMD_SSE2;
+#else
+    return INK_CAIRO_SIMD_NONE;
+#endif
+}
+
+int simd_level = -1;
+
+inline gint32 clamp_channel(gint32 v, gint32 low, gint32 high)
+{
+    if (v < low) return low;
+    if (v > high) return high;
+    return v;
+}
+
+inline guint32 div255(guint32 v)
+{
+    return (v + 127) / 255;
+}
+
+inline guint32 premul(guint32 color, guint32 alpha)
+{
+    guint32 temp = alpha * color + 128;
+    return (temp + (temp >> 8)) >> 8;
+}
+
+inline guint32 unpremul(guint32 color, guint32 alpha)
+{
+    return (255 * color + alpha/2) / alpha;
+}
+
+/* Blend modes.
+ * The formulas are applied to all four channels in the same way; for premultiplied
+ * input they give the correct alpha channel as well, and every intermediate value
+ * fits into 16 bits. The result still has to be divided by 255. */
+
+#ifdef INK_SIMD_SSE2
+inline __m128i min_epu16_sse2(__m128i x, __m128i y)
+{
+    return _mm_sub_epi16(x, _mm_subs_epu16(x, y));
+}
+inline __m128i max_epu16_sse2(__m128i x, __m128i y)
+{
+    return _mm_add_epi16(y, _mm_subs_epu16(x, y));
+}
+#endif
+
+// cr = (1-qa)*cb + (1-qb)*ca + ca*cb
+struct BlendMultiplyOp {
+    static guint32 scalar(guint32 a, guint32 b, guint32 aa, guint32 ab) {
+        return (255-aa)*b + (255-ab)*a + a*b;
+    }
+#ifdef INK_SIMD_SSE2
+    static __m128i sse2(__m128i a, __m128i b, __m128i aa, __m128i ab) {
+        __m128i const c255 = _mm_set1_epi16(255);
+        __m128i r = _mm_mullo_epi16(_mm_sub_epi16(c255, aa), b);
+        r = _mm_add_epi16(r, _mm_mullo_epi16(_mm_sub_epi16(c255, ab), a));
+        return _mm_add_epi16(r, _mm_mullo_epi16(a, b));
+    }
+#endif
+#ifdef INK_SIMD_AVX2
+    static INK_AVX2_TARGET __m256i avx2(__m256i a, __m256i b, __m256i aa, __m256i ab) {
+        __m256i const c255 = _mm256_set1_epi16(255);
+        __m256i r = _mm256_mullo_epi16(_mm256_sub_epi16(c255, aa), b);
+        r = _mm256_add_epi16(r, _mm256_mullo_epi16(_mm256_sub_epi16(c255, ab), a));
+        return _mm256_add_epi16(r, _mm256_mullo_epi16(a, b));
+    }
+#endif
+};
+
+// cr = cb + ca - ca * cb
+// 255*(a+b) can overflow 16 bits, but the final result does not, so wrapping is harmless
+struct BlendScreenOp {
+    static guint32 scalar(guint32 a, guint32 b, guint32 /*aa*/, guint32 /*ab*/) {
+        return 255*(a + b) - a*b;
+    }
+#ifdef INK_SIMD_SSE2
+    static __m128i sse2(__m128i a, __m128i b, __m128i /*aa*/, __m128i /*ab*/) {
+        __m128i const c255 = _mm_set1_epi16(255);
+        return _mm_sub_epi16(_mm_mullo_epi16(_mm_add_epi16(a, b), c255), _mm_mullo_epi16(a, b));
+    }
+#endif
+#ifdef INK_SIMD_AVX2
+    static INK_AVX2_TARGET __m256i avx2(__m256i a, __m256i b, __m256i /*aa*/, __m256i /*ab*/) {
+        __m256i const c255 = _mm256_set1_epi16(255);
+        return _mm256_sub_epi16(_mm256_mullo_epi16(_mm256_add_epi16(a, b), c255), _mm256_mullo_epi16(a, b));
+    }
+#endif
+};
+
+// cr = Min ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+struct BlendDarkenOp {
+    static guint32 scalar(guint32 a, guint32 b, guint32 aa, guint32 ab) {
+        return std::min((255-aa)*b + 255*a, (255-ab)*a + 255*b);
+    }
+#ifdef INK_SIMD_SSE2
+    static __m128i sse2(__m128i a, __m128i b, __m128i aa, __m128i ab) {
+        __m128i const c255 = _mm_set1_epi16(255);
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255, aa), b), _mm_mullo_epi16(a, c255));
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255, ab), a), _mm_mullo_epi16(b, c255));
+        return min_epu16_sse2(x, y);
+    }
+#endif
+#ifdef INK_SIMD_AVX2
+    static INK_AVX2_TARGET __m256i avx2(__m256i a, __m256i b, __m256i aa, __m256i ab) {
+        __m256i const c255 = _mm256_set1_epi16(255);
+        __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, aa), b), _mm256_mullo_epi16(a, c255));
+        __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, ab), a), _mm256_mullo_epi16(b, c255));
+        return _mm256_min_epu16(x, y);
+    }
+#endif
+};
+
+// cr = Max ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+struct BlendLightenOp {
+    static guint32 scalar(guint32 a, guint32 b, guint32 aa, guint32 ab) {
+        return std::max((255-aa)*b + 255*a, (255-ab)*a + 255*b);
+    }
+#ifdef INK_SIMD_SSE2
+    static __m128i sse2(__m128i a, __m128i b, __m128i aa, __m128i ab) {
+        __m128i const c255 = _mm_set1_epi16(255);
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255, aa), b), _mm_mullo_epi16(a, c255));
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255, ab), a), _mm_mullo_epi16(b, c255));
+        return max_epu16_sse2(x, y);
+    }
+#endif
+#ifdef INK_SIMD_AVX2
+    static INK_AVX2_TARGET __m256i avx2(__m256i a, __m256i b, __m256i aa, __m256i ab) {
+        __m256i const c255 = _mm256_set1_epi16(255);
+        __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, aa), b), _mm256_mullo_epi16(a, c255));
+        __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, ab), a), _mm256_mullo_epi16(b, c255));
+        return _mm256_max_epu16(x, y);
+    }
+#endif
+};
+
+template <typename Op>
+void blend_scalar(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        guint32 px1 = in1[i], px2 = in2[i];
+        guint32 aa = px1 >> 24, ab = px2 >> 24;
+        guint32 pxout = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            guint32 c = Op::scalar((px1 >> shift) & 0xff, (px2 >> shift) & 0xff, aa, ab);
+            pxout |= div255(c) << shift;
+        }
+        out[i] = pxout;
+    }
+}
+
+#ifdef INK_SIMD_SSE2
+// (v + 127) / 255, exact for all 16-bit results of the blend formulas
+inline __m128i div255_sse2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_set1_epi16(127));
+    return _mm_srli_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16(short(0x8081))), 7);
+}
+
+// broadcast the alpha channel of each of the two pixels to all its channels
+inline __m128i alpha_sse2(__m128i v)
+{
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// processes 4 pixels per iteration, returns the number of pixels done
+template <typename Op>
+int blend_sse2(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    __m128i const zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in1 + i));
+        __m128i px2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in2 + i));
+        __m128i a = _mm_unpacklo_epi8(px1, zero);
+        __m128i b = _mm_unpacklo_epi8(px2, zero);
+        __m128i lo = div255_sse2(Op::sse2(a, b, alpha_sse2(a), alpha_sse2(b)));
+        a = _mm_unpackhi_epi8(px1, zero);
+        b = _mm_unpackhi_epi8(px2, zero);
+        __m128i hi = div255_sse2(Op::sse2(a, b, alpha_sse2(a), alpha_sse2(b)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+#endif
+
+#ifdef INK_SIMD_AVX2
+INK_AVX2_TARGET inline __m256i div255_avx2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(127));
+    return _mm256_srli_epi16(_mm256_mulhi_epu16(v, _mm256_set1_epi16(short(0x8081))), 7);
+}
+
+INK_AVX2_TARGET inline __m256i alpha_avx2(__m256i v)
+{
+    v = _mm256_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// processes 8 pixels per iteration; unpacking and packing work within 128-bit lanes,
+// so the pixel order is preserved
+template <typename Op>
+INK_AVX2_TARGET int blend_avx2(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in1 + i));
+        __m256i px2 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in2 + i));
+        __m256i a = _mm256_unpacklo_epi8(px1, zero);
+        __m256i b = _mm256_unpacklo_epi8(px2, zero);
+        __m256i lo = div255_avx2(Op::avx2(a, b, alpha_avx2(a), alpha_avx2(b)));
+        a = _mm256_unpackhi_epi8(px1, zero);
+        b = _mm256_unpackhi_epi8(px2, zero);
+        __m256i hi = div255_avx2(Op::avx2(a, b, alpha_avx2(a), alpha_avx2(b)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_packus_epi16(lo, hi));
+    }
+    return i + blend_sse2<Op>(out + i, in1 + i, in2 + i, n - i);
+}
+#endif
+
+template <typename Op>
+void blend_span(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    int done = 0;
+    switch (ink_cairo_simd_level()) {
+#ifdef INK_SIMD_AVX2
+    case INK_CAIRO_SIMD_AVX2:
+        done = blend_avx2<Op>(out, in1, in2, n);
+        break;
+#endif
+#ifdef INK_SIMD_SSE2
+    case INK_CAIRO_SIMD_SSE2:
+        done = blend_sse2<Op>(out, in1, in2, n);
+        break;
+#endif
+    default:
+        break;
+    }
+    blend_scalar<Op>(out + done, in1 + done, in2 + done, n - done);
+}
+
+/* Kernels with 32-bit intermediate values.
+ * These are computed in double precision, one pixel per vector. All intermediate
+ * values are integers well below 2^53, so the results are exact; divisions with
+ * rounding are done by adding a half and truncating, which cannot be off by one,
+ * because the quotients are never closer than 1/65025 to an integer. */
+
+void compose_arithmetic_scalar(guint32 *out, guint32 const *in1, guint32 const *in2, int n,
+                               gint32 const k[4])
+{
+    for (int i = 0; i < n; ++i) {
+        guint32 px1 = in1[i], px2 = in2[i];
+        gint32 v[4];
+        for (int c = 0; c < 4; ++c) {
+            gint32 a = (px1 >> (8*c)) & 0xff;
+            gint32 b = (px2 >> (8*c)) & 0xff;
+            v[c] = k[0]*a*b + k[1]*a + k[2]*b + k[3];
+        }
+        // r, g and b are premultiplied, so should be clamped to the alpha channel
+        gint32 ao = clamp_channel(v[3], 0, 255*255*255);
+        guint32 pxout = guint32((ao + (255*255/2)) / (255*255)) << 24;
+        for (int c = 0; c < 3; ++c) {
+            pxout |= guint32((clamp_channel(v[c], 0, ao) + (255*255/2)) / (255*255)) << (8*c);
+        }
+        out[i] = pxout;
+    }
+}
+
+void color_matrix_scalar(guint32 *out, guint32 const *in, int n, gint32 const v[20])
+{
+    for (int i = 0; i < n; ++i) {
+        guint32 px = in[i];
+        guint32 a = px >> 24, r = (px >> 16) & 0xff, g = (px >> 8) & 0xff, b = px & 0xff;
+        if (a != 0) {
+            r = unpremul(r, a);
+            g = unpremul(g, a);
+            b = unpremul(b, a);
+        }
+
+        gint32 ro = r*v[0]  + g*v[1]  + b*v[2]  + a*v[3]  + v[4];
+        gint32 go = r*v[5]  + g*v[6]  + b*v[7]  + a*v[8]  + v[9];
+        gint32 bo = r*v[10] + g*v[11] + b*v[12] + a*v[13] + v[14];
+        gint32 ao = r*v[15] + g*v[16] + b*v[17] + a*v[18] + v[19];
+        ro = (clamp_channel(ro, 0, 255*255) + 127) / 255;
+        go = (clamp_channel(go, 0, 255*255) + 127) / 255;
+        bo = (clamp_channel(bo, 0, 255*255) + 127) / 255;
+        ao = (clamp_channel(ao, 0, 255*255) + 127) / 255;
+
+        out[i] = (ao << 24) | (premul(ro, ao) << 16) | (premul(go, ao) << 8) | premul(bo, ao);
+    }
+}
+
+void color_saturate_scalar(guint32 *out, guint32 const *in, int n, double const v[9])
+{
+    for (int i = 0; i < n; ++i) {
+        guint32 px = in[i];
+        guint32 r = (px >> 16) & 0xff, g = (px >> 8) & 0xff, b = px & 0xff;
+        guint32 ro = r*v[0] + g*v[1] + b*v[2] + 0.5;
+        guint32 go = r*v[3] + g*v[4] + b*v[5] + 0.5;
+        guint32 bo = r*v[6] + g*v[7] + b*v[8] + 0.5;
+        out[i] = (px & 0xff000000) | (ro << 16) | (go << 8) | bo;
+    }
+}
+
+#ifdef INK_SIMD_SSE2
+// channels of a pixel as doubles: bg = (b, g), ra = (r, a)
+inline void channels_sse2(guint32 px, __m128d &bg, __m128d &ra)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero);
+    bg = _mm_cvtepi32_pd(v);
+    ra = _mm_cvtepi32_pd(_mm_srli_si128(v, 8));
+}
+
+// truncate non-negative doubles to integers; SSE2 has no floor instruction
+inline __m128d trunc_sse2(__m128d v)
+{
+    return _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+}
+
+// packs four 32-bit channels (b, g, r, a) with values in [0, 255] into a pixel
+inline guint32 pack_pixel_sse2(__m128i v)
+{
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    return _mm_cvtsi128_si32(v);
+}
+
+// premultiplies four 32-bit channels (b, g, r, a) with values in [0, 255] and packs them
+inline guint32 premul_pixel_sse2(__m128i v)
+{
+    v = _mm_packs_epi32(v, v);
+    __m128i alpha = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, alpha), _mm_set1_epi16(128));
+    t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    // the alpha channel itself is kept
+    __m128i const amask = _mm_set_epi16(0, 0, 0, 0, -1, 0, 0, 0);
+    v = _mm_or_si128(_mm_and_si128(amask, v), _mm_andnot_si128(amask, t));
+    v = _mm_packus_epi16(v, v);
+    return _mm_cvtsi128_si32(v);
+}
+
+int compose_arithmetic_sse2(guint32 *out, guint32 const *in1, guint32 const *in2, int n,
+                            gint32 const k[4])
+{
+    __m128d const k1 = _mm_set1_pd(k[0]), k2 = _mm_set1_pd(k[1]);
+    __m128d const k3 = _mm_set1_pd(k[2]), k4 = _mm_set1_pd(k[3]);
+    __m128d const zero = _mm_setzero_pd();
+    __m128d const amax = _mm_set1_pd(255.0*255*255);
+    __m128d const half = _mm_set1_pd(255*255/2 + 0.5);
+    __m128d const scale = _mm_set1_pd(1.0 / (255*255));
+
+    for (int i = 0; i < n; ++i) {
+        __m128d a_bg, a_ra, b_bg, b_ra;
+        channels_sse2(in1[i], a_bg, a_ra);
+        channels_sse2(in2[i], b_bg, b_ra);
+        __m128d bg = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(k1, a_bg), b_bg), _mm_mul_pd(k2, a_bg)),
+                                _mm_add_pd(_mm_mul_pd(k3, b_bg), k4));
+        __m128d ra = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(k1, a_ra), b_ra), _mm_mul_pd(k2, a_ra)),
+                                _mm_add_pd(_mm_mul_pd(k3, b_ra), k4));
+        __m128d alpha = _mm_min_pd(_mm_max_pd(_mm_unpackhi_pd(ra, ra), zero), amax);
+        bg = _mm_min_pd(_mm_max_pd(bg, zero), alpha);
+        ra = _mm_min_pd(_mm_max_pd(ra, zero), alpha);
+        bg = _mm_mul_pd(_mm_add_pd(bg, half), scale);
+        ra = _mm_mul_pd(_mm_add_pd(ra, half), scale);
+        out[i] = pack_pixel_sse2(_mm_unpacklo_epi64(_mm_cvttpd_epi32(bg), _mm_cvttpd_epi32(ra)));
+    }
+    return n;
+}
+
+int color_matrix_sse2(guint32 *out, guint32 const *in, int n, gint32 const v[20])
+{
+    // column c of the matrix, split into the rows of the (b, g) and (r, a) channels
+    __m128d col_bg[5], col_ra[5];
+    for (int c = 0; c < 5; ++c) {
+        col_bg[c] = _mm_set_pd(v[5+c], v[10+c]);
+        col_ra[c] = _mm_set_pd(v[15+c], v[c]);
+    }
+    __m128d const c255 = _mm_set1_pd(255);
+    __m128d const zero = _mm_setzero_pd();
+    __m128d const cmax = _mm_set1_pd(255*255);
+    __m128d const half = _mm_set1_pd(127.5);
+    __m128d const scale = _mm_set1_pd(1.0 / 255);
+
+    for (int i = 0; i < n; ++i) {
+        guint32 a = in[i] >> 24;
+        __m128d bg, ra;
+        channels_sse2(in[i], bg, ra);
+        if (a != 0) {
+            // unpremultiply color values
+            __m128d div = _mm_set1_pd(a);
+            __m128d round = _mm_set1_pd(a / 2);
+            bg = trunc_sse2(_mm_div_pd(_mm_add_pd(_mm_mul_pd(bg, c255), round), div));
+            __m128d r = trunc_sse2(_mm_div_pd(_mm_add_pd(_mm_mul_pd(ra, c255), round), div));
+            ra = _mm_move_sd(ra, r);
+        }
+        __m128d cr = _mm_unpacklo_pd(ra, ra), cg = _mm_unpackhi_pd(bg, bg);
+        __m128d cb = _mm_unpacklo_pd(bg, bg), ca = _mm_unpackhi_pd(ra, ra);
+
+        __m128d obg = _mm_add_pd(_mm_add_pd(_mm_mul_pd(cr, col_bg[0]), _mm_mul_pd(cg, col_bg[1])),
+                                 _mm_add_pd(_mm_add_pd(_mm_mul_pd(cb, col_bg[2]), _mm_mul_pd(ca, col_bg[3])),
+                                            col_bg[4]));
+        __m128d ora = _mm_add_pd(_mm_add_pd(_mm_mul_pd(cr, col_ra[0]), _mm_mul_pd(cg, col_ra[1])),
+                                 _mm_add_pd(_mm_add_pd(_mm_mul_pd(cb, col_ra[2]), _mm_mul_pd(ca, col_ra[3])),
+                                            col_ra[4]));
+        obg = _mm_mul_pd(_mm_add_pd(_mm_min_pd(_mm_max_pd(obg, zero), cmax), half), scale);
+        ora = _mm_mul_pd(_mm_add_pd(_mm_min_pd(_mm_max_pd(ora, zero), cmax), half), scale);
+        out[i] = premul_pixel_sse2(_mm_unpacklo_epi64(_mm_cvttpd_epi32(obg), _mm_cvttpd_epi32(ora)));
+    }
+    return n;
+}
+
+int color_saturate_sse2(guint32 *out, guint32 const *in, int n, double const v[9])
+{
+    // the alpha channel is replaced afterwards
+    __m128d const col_r_bg = _mm_set_pd(v[3], v[6]), col_r_ra = _mm_set_pd(0, v[0]);
+    __m128d const col_g_bg = _mm_set_pd(v[4], v[7]), col_g_ra = _mm_set_pd(0, v[1]);
+    __m128d const col_b_bg = _mm_set_pd(v[5], v[8]), col_b_ra = _mm_set_pd(0, v[2]);
+    __m128d const half = _mm_set1_pd(0.5);
+
+    for (int i = 0; i < n; ++i) {
+        __m128d bg, ra;
+        channels_sse2(in[i], bg, ra);
+        __m128d cr = _mm_unpacklo_pd(ra, ra), cg = _mm_unpackhi_pd(bg, bg), cb = _mm_unpacklo_pd(bg, bg);
+        // same order of operations as the scalar code, so the results are identical
+        __m128d obg = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(cr, col_r_bg), _mm_mul_pd(cg, col_g_bg)),
+                                            _mm_mul_pd(cb, col_b_bg)), half);
+        __m128d ora = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(cr, col_r_ra), _mm_mul_pd(cg, col_g_ra)),
+                                            _mm_mul_pd(cb, col_b_ra)), half);
+        guint32 px = pack_pixel_sse2(_mm_unpacklo_epi64(_mm_cvttpd_epi32(obg), _mm_cvttpd_epi32(ora)));
+        out[i] = (px & 0x00ffffff) | (in[i] & 0xff000000);
+    }
+    return n;
+}
+#endif
+
+#ifdef INK_SIMD_AVX2
+// channels of a pixel as doubles, in (b, g, r, a) order
+INK_AVX2_TARGET inline __m256d channels_avx2(guint32 px)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero);
+    return _mm256_cvtepi32_pd(v);
+}
+
+INK_AVX2_TARGET int compose_arithmetic_avx2(guint32 *out, guint32 const *in1, guint32 const *in2, int n,
+                                            gint32 const k[4])
+{
+    __m256d const k1 = _mm256_set1_pd(k[0]), k2 = _mm256_set1_pd(k[1]);
+    __m256d const k3 = _mm256_set1_pd(k[2]), k4 = _mm256_set1_pd(k[3]);
+    __m256d const zero = _mm256_setzero_pd();
+    __m256d const amax = _mm256_set1_pd(255.0*255*255);
+    __m256d const half = _mm256_set1_pd(255*255/2 + 0.5);
+    __m256d const scale = _mm256_set1_pd(1.0 / (255*255));
+
+    for (int i = 0; i < n; ++i) {
+        __m256d a = channels_avx2(in1[i]);
+        __m256d b = channels_avx2(in2[i]);
+        __m256d v = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(k1, a), b), _mm256_mul_pd(k2, a)),
+                                  _mm256_add_pd(_mm256_mul_pd(k3, b), k4));
+        __m256d alpha = _mm256_min_pd(_mm256_max_pd(_mm256_permute4x64_pd(v, 0xff), zero), amax);
+        v = _mm256_min_pd(_mm256_max_pd(v, zero), alpha);
+        v = _mm256_mul_pd(_mm256_add_pd(v, half), scale);
+        out[i] = pack_pixel_sse2(_mm256_cvttpd_epi32(v));
+    }
+    return n;
+}
+
+INK_AVX2_TARGET int color_matrix_avx2(guint32 *out, guint32 const *in, int n, gint32 const v[20])
+{
+    __m256d col[5];
+    for (int c = 0; c < 5; ++c) {
+        col[c] = _mm256_set_pd(v[15+c], v[c], v[5+c], v[10+c]);
+    }
+    __m256d const c255 = _mm256_set1_pd(255);
+    __m256d const zero = _mm256_setzero_pd();
+    __m256d const cmax = _mm256_set1_pd(255*255);
+    __m256d const half = _mm256_set1_pd(127.5);
+    __m256d const scale = _mm256_set1_pd(1.0 / 255);
+
+    for (int i = 0; i < n; ++i) {
+        guint32 a = in[i] >> 24;
+        __m256d c = channels_avx2(in[i]);
+        if (a != 0) {
+            // unpremultiply color values, keep alpha
+            __m256d u = _mm256_add_pd(_mm256_mul_pd(c, c255), _mm256_set1_pd(a / 2));
+            u = _mm256_floor_pd(_mm256_div_pd(u, _mm256_set1_pd(a)));
+            c = _mm256_blend_pd(u, c, 0x8);
+        }
+        __m256d o = _mm256_add_pd(
+            _mm256_add_pd(_mm256_mul_pd(_mm256_permute4x64_pd(c, 0xaa), col[0]),
+                          _mm256_mul_pd(_mm256_permute4x64_pd(c, 0x55), col[1])),
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_permute4x64_pd(c, 0x00), col[2]),
+                                        _mm256_mul_pd(_mm256_permute4x64_pd(c, 0xff), col[3])),
+                          col[4]));
+        o = _mm256_mul_pd(_mm256_add_pd(_mm256_min_pd(_mm256_max_pd(o, zero), cmax), half), scale);
+        out[i] = premul_pixel_sse2(_mm256_cvttpd_epi32(o));
+    }
+    return n;
+}
+
+INK_AVX2_TARGET int color_saturate_avx2(guint32 *out, guint32 const *in, int n, double const v[9])
+{
+    // the alpha channel is replaced afterwards
+    __m256d const col_r = _mm256_set_pd(0, v[0], v[3], v[6]);
+    __m256d const col_g = _mm256_set_pd(0, v[1], v[4], v[7]);
+    __m256d const col_b = _mm256_set_pd(0, v[2], v[5], v[8]);
+    __m256d const half = _mm256_set1_pd(0.5);
+
+    for (int i = 0; i < n; ++i) {
+        __m256d c = channels_avx2(in[i]);
+        // same order of operations as the scalar code, so the results are identical
+        __m256d o = _mm256_add_pd(
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_permute4x64_pd(c, 0xaa), col_r),
+                                        _mm256_mul_pd(_mm256_permute4x64_pd(c, 0x55), col_g)),
+                          _mm256_mul_pd(_mm256_permute4x64_pd(c, 0x00), col_b)),
+            half);
+        guint32 px = pack_pixel_sse2(_mm256_cvttpd_epi32(o));
+        out[i] = (px & 0x00ffffff) | (in[i] & 0xff000000);
+    }
+    return n;
+}
+#endif
+
+} // end anonymous namespace
+
+InkCairoSimdLevel
+ink_cairo_simd_supported()
+{
+    static InkCairoSimdLevel const level = detect_level();
+    return level;
+}
+
+InkCairoSimdLevel
+ink_cairo_simd_level()
+{
+    if (simd_level < 0) {
+        simd_level = ink_cairo_simd_supported();
+    }
+    return InkCairoSimdLevel(simd_level);
+}
+
+/**
+ * Select the instruction set used by the kernels.
+ * Levels not supported by the processor are lowered to the best supported one.
+ */
+void
+ink_cairo_simd_set_level(InkCairoSimdLevel level)
+{
+    simd_level = std::min(level, ink_cairo_simd_supported());
+}
+
+char const *
+ink_cairo_simd_level_name(InkCairoSimdLevel level)
+{
+    switch (level) {
+    case INK_CAIRO_SIMD_SSE2:
+        return "SSE2";
+    case INK_CAIRO_SIMD_AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+void
+ink_cairo_span_blend_multiply(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    blend_span<BlendMultiplyOp>(out, in1, in2, n);
+}
+
+void
+ink_cairo_span_blend_screen(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    blend_span<BlendScreenOp>(out, in1, in2, n);
+}
+
+void
+ink_cairo_span_blend_darken(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    blend_span<BlendDarkenOp>(out, in1, in2, n);
+}
+
+void
+ink_cairo_span_blend_lighten(guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    blend_span<BlendLightenOp>(out, in1, in2, n);
+}
+
+void
+ink_cairo_span_compose_arithmetic(guint32 *out, guint32 const *in1, guint32 const *in2, int n,
+                                  gint32 const k[4])
+{
+    switch (ink_cairo_simd_level()) {
+#ifdef INK_SIMD_AVX2
+    case INK_CAIRO_SIMD_AVX2:
+        compose_arithmetic_avx2(out, in1, in2, n, k);
+        break;
+#endif
+#ifdef INK_SIMD_SSE2
+    case INK_CAIRO_SIMD_SSE2:
+        compose_arithmetic_sse2(out, in1, in2, n, k);
+        break;
+#endif
+    default:
+        compose_arithmetic_scalar(out, in1, in2, n, k);
+        break;
+    }
+}
+
+void
+ink_cairo_span_color_matrix(guint32 *out, guint32 const *in, int n, gint32 const v[20])
+{
+    switch (ink_cairo_simd_level()) {
+#ifdef INK_SIMD_AVX2
+    case INK_CAIRO_SIMD_AVX2:
+        color_matrix_avx2(out, in, n, v);
+        break;
+#endif
+#ifdef INK_SIMD_SSE2
+    case INK_CAIRO_SIMD_SSE2:
+        color_matrix_sse2(out, in, n, v);
+        break;
+#endif
+    default:
+        color_matrix_scalar(out, in, n, v);
+        break;
+    }
+}
+
+void
+ink_cairo_span_color_saturate(guint32 *out, guint32 const *in, int n, double const v[9])
+{
+    switch (ink_cairo_simd_level()) {
+#ifdef INK_SIMD_AVX2
+    case INK_CAIRO_SIMD_AVX2:
+        color_saturate_avx2(out, in, n, v);
+        break;
+#endif
+#ifdef INK_SIMD_SSE2
+    case INK_CAIRO_SIMD_SSE2:
+        color_saturate_sse2(out, in, n, v);
+        break;
+#endif
+    default:
+        color_saturate_scalar(out, in, n, v);
+        break;
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * Vectorized pixel span kernels for the Cairo software blending templates.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+#define SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+#include <glib.h>
+
+/**
+ * Instruction set used by the span kernels.
+ * The best level supported by both the build and the processor is selected
+ * at runtime; lower levels can be forced for testing and benchmarking.
+ */
+enum InkCairoSimdLevel {
+    INK_CAIRO_SIMD_NONE,
+    INK_CAIRO_SIMD_SSE2,
+    INK_CAIRO_SIMD_AVX2
+};
+
+InkCairoSimdLevel ink_cairo_simd_supported();
+InkCairoSimdLevel ink_cairo_simd_level();
+void ink_cairo_simd_set_level(InkCairoSimdLevel level);
+char const *ink_cairo_simd_level_name(InkCairoSimdLevel level);
+
+/* The kernels below process spans of premultiplied ARGB32 pixels.
+ * Each of them gives exactly the same results as the scalar functor
+ * of the corresponding filter primitive. Output may alias input. */
+
+// feBlend
+void ink_cairo_span_blend_multiply(guint32 *out, guint32 const *in1, guint32 const *in2, int n);
+void ink_cairo_span_blend_screen(guint32 *out, guint32 const *in1, guint32 const *in2, int n);
+void ink_cairo_span_blend_darken(guint32 *out, guint32 const *in1, guint32 const *in2, int n);
+void ink_cairo_span_blend_lighten(guint32 *out, guint32 const *in1, guint32 const *in2, int n);
+
+// feComposite operator="arithmetic"; k holds k1*255, k2*255^2, k3*255^2 and k4*255^3
+void ink_cairo_span_compose_arithmetic(guint32 *out, guint32 const *in1, guint32 const *in2, int n,
+                                       gint32 const k[4]);
+
+// feColorMatrix type="matrix"; the offsets are scaled by 255^2, other values by 255
+void ink_cairo_span_color_matrix(guint32 *out, guint32 const *in, int n, gint32 const v[20]);
+// feColorMatrix type="saturate"
+void ink_cairo_span_color_saturate(guint32 *out, guint32 const *in, int n, double const v[9]);
+
+#endif // SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -18,7 +18,7 @@
 
 #ifdef HAVE_OPENMP
 #include <omp.h>
-#include "preferences.h"
+#include "display/render-prefs.h"
 // single-threaded operation if the number of pixels is below this threshold
 static const int OPENMP_THRESHOLD = 2048;
 #endif
@@ -30,6 +30,35 @@ static const int OPENMP_THRESHOLD = 2048;
 #include "display/nr-3dutils.h"
 #include "display/cairo-utils.h"
 
+// number of pixels handed to a span function at once in the fast paths
+static const int SPAN_LENGTH = 4096;
+
+/**
+ * Blend a span of ARGB32 pixels.
+ * Functors which have a vectorized implementation (see display/cairo-simd.h)
+ * provide an overload of this function, usually as a friend, which is found
+ * through argument-dependent lookup.
+ */
+template <typename Blend>
+inline void ink_cairo_blend_span(Blend &blend, guint32 *out, guint32 const *in1, guint32 const *in2, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        out[i] = blend(in1[i], in2[i]);
+    }
+}
+
+/**
+ * Filter a span of ARGB32 pixels.
+ * Overloaded in the same way as ink_cairo_blend_span(). Output may alias input.
+ */
+template <typename Filter>
+inline void ink_cairo_filter_span(Filter &filter, guint32 *out, guint32 const *in, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        out[i] = filter(in[i]);
+    }
+}
+
 /**
  * Blend two surfaces using the supplied functor.
  * This template blends two Cairo image surfaces using a blending functor that takes
@@ -74,8 +103,7 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
     // OpenMP probably doesn't help much here.
     // It would be better to render more than 1 tile at a time.
     #if HAVE_OPENMP
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+    int numOfThreads = Inkscape::RenderPrefs::get().num_threads;
     if (numOfThreads){} // inform compiler we are using it.
     #endif
 
@@ -83,11 +111,14 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
     if (bpp1 == 4) {
         if (bpp2 == 4) {
             if (fast_path) {
+                int spans = (limit + SPAN_LENGTH - 1) / SPAN_LENGTH;
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = blend(*(in1_data + i), *(in2_data + i));
+                for (int i = 0; i < spans; ++i) {
+                    int start = i * SPAN_LENGTH;
+                    ink_cairo_blend_span(blend, out_data + start, in1_data + start, in2_data + start,
+                                         std::min(SPAN_LENGTH, limit - start));
                 }
             } else {
                 #if HAVE_OPENMP
@@ -97,10 +128,7 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     guint32 *in1_p = in1_data + i * stride1/4;
                     guint32 *in2_p = in2_data + i * stride2/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = blend(*in1_p, *in2_p);
-                        ++in1_p; ++in2_p; ++out_p;
-                    }
+                    ink_cairo_blend_span(blend, out_p, in1_p, in2_p, w);
                 }
             }
         } else {
@@ -203,19 +231,31 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
     guint32 *const out_data = (guint32*) cairo_image_surface_get_data(out);
 
     #if HAVE_OPENMP
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+    int numOfThreads = Inkscape::RenderPrefs::get().num_threads;
     if (numOfThreads){} // inform compiler we are using it.
     #endif
 
     // this is provided just in case, to avoid problems with strict aliasing rules
     if (in == out) {
         if (bppin == 4) {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < limit; ++i) {
-                *(in_data + i) = filter(*(in_data + i));
+            if (fast_path) {
+                int spans = (limit + SPAN_LENGTH - 1) / SPAN_LENGTH;
+                #if HAVE_OPENMP
+                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
+                #endif
+                for (int i = 0; i < spans; ++i) {
+                    int start = i * SPAN_LENGTH;
+                    ink_cairo_filter_span(filter, in_data + start, in_data + start,
+                                          std::min(SPAN_LENGTH, limit - start));
+                }
+            } else {
+                #if HAVE_OPENMP
+                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
+                #endif
+                for (int i = 0; i < h; ++i) {
+                    guint32 *in_p = in_data + i * stridein/4;
+                    ink_cairo_filter_span(filter, in_p, in_p, w);
+                }
             }
         } else {
             #if HAVE_OPENMP
@@ -236,11 +276,14 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
         if (bppout == 4) {
             // bppin == 4, bppout == 4
             if (fast_path) {
+                int spans = (limit + SPAN_LENGTH - 1) / SPAN_LENGTH;
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = filter(*(in_data + i));
+                for (int i = 0; i < spans; ++i) {
+                    int start = i * SPAN_LENGTH;
+                    ink_cairo_filter_span(filter, out_data + start, in_data + start,
+                                          std::min(SPAN_LENGTH, limit - start));
                 }
             } else {
                 #if HAVE_OPENMP
@@ -249,10 +292,7 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                 for (int i = 0; i < h; ++i) {
                     guint32 *in_p = in_data + i * stridein/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = filter(*in_p);
-                        ++in_p; ++out_p;
-                    }
+                    ink_cairo_filter_span(filter, out_p, in_p, w);
                 }
             }
         } else {
@@ -330,8 +370,7 @@ void ink_cairo_surface_synthesize(cairo_surface_t *out, cairo_rectangle_t const
 
     #if HAVE_OPENMP
     int limit = w * h;
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+    int numOfThreads = Inkscape::RenderPrefs::get().num_threads;
     if (numOfThreads){} // inform compiler we are using it.
     #endif
 
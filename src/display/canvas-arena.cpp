@@ -111,6 +111,7 @@ sp_canvas_arena_class_init (SPCanvasArenaClass *klass)
     item_class->point = sp_canvas_arena_point;
     item_class->event = sp_canvas_arena_event;
     item_class->viewbox_changed = sp_canvas_arena_viewbox_changed;
+    item_class->concurrent_render = TRUE;
 }
 
 static void
@@ -218,7 +219,11 @@ sp_canvas_arena_render (SPCanvasItem *item, SPCanvasBuf *buf)
 
     Inkscape::DrawingContext ct(buf->ct, r->min());
 
-    arena->drawing.update(Geom::IntRect::infinite(), arena->ctx);
+    {
+        // buffers can be rendered concurrently; after the update phase this is a no-op
+        Inkscape::RenderLock lock;
+        arena->drawing.update(Geom::IntRect::infinite(), arena->ctx);
+    }
     arena->drawing.render(ct, *r);
 }
 
@@ -9,6 +9,8 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <algorithm>
+#include <iterator>
 #include "display/cairo-utils.h"
 #include "display/drawing.h"
 #include "display/drawing-context.h"
@@ -18,6 +20,19 @@
 
 namespace Inkscape {
 
+// Groups with fewer children are searched linearly
+static size_t const CHILD_INDEX_THRESHOLD = 32;
+
+namespace {
+
+struct IsStale {
+    IsStale(std::vector<bool> const &s) : stale(s) {}
+    bool operator()(unsigned pos) const { return stale[pos]; }
+    std::vector<bool> const &stale;
+};
+
+} // anonymous namespace
+
 DrawingGroup::DrawingGroup(Drawing &drawing)
     : DrawingItem(drawing)
     , _style(NULL)
@@ -93,9 +108,108 @@ DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, u
             }
         }
     }
+    _updateChildIndex();
     return beststate;
 }
 
+/**
+ * Bring the spatial index of children up to date.
+ * A child which changed its bounding box is only marked as moved; the tree is
+ * refilled when a child was added, removed or reordered, or when enough children
+ * moved that searching them linearly costs more than rebuilding the tree, which
+ * happens on the next search.
+ */
+void
+DrawingGroup::_updateChildIndex()
+{
+    if (_children.size() < CHILD_INDEX_THRESHOLD) {
+        if (!_child_items.empty()) {
+            _child_items.clear();
+            _child_boxes.clear();
+            _child_stale.clear();
+            _child_moved.clear();
+            _child_index.clear();
+        }
+        return;
+    }
+
+    bool rebuild = _child_items.size() != _children.size();
+    unsigned pos = 0;
+    for (ChildrenList::iterator i = _children.begin(); i != _children.end() && !rebuild; ++i, ++pos) {
+        if (_child_items[pos] != &*i) {
+            rebuild = true;
+            break;
+        }
+        // index both boxes, so that the index serves normal, outline and clip picks
+        Geom::OptIntRect box = i->geometricBounds();
+        box.unionWith(i->visualBounds());
+        if (_child_boxes[pos] != box) {
+            _child_boxes[pos] = box;
+            if (!_child_stale[pos]) {
+                _child_stale[pos] = true;
+                _child_moved.push_back(pos);
+            }
+        }
+    }
+    if (!rebuild && _child_moved.size() <= _child_items.size() / 8 + 64) return;
+
+    _child_items.clear();
+    _child_boxes.clear();
+    _child_moved.clear();
+    _child_index.clear();
+    _child_items.reserve(_children.size());
+    _child_boxes.reserve(_children.size());
+    _child_index.reserve(_children.size());
+    for (ChildrenList::iterator i = _children.begin(); i != _children.end(); ++i) {
+        Geom::OptIntRect box = i->geometricBounds();
+        box.unionWith(i->visualBounds());
+        if (box) {
+            _child_index.insert(*box, _child_items.size());
+        }
+        _child_items.push_back(&*i);
+        _child_boxes.push_back(box);
+    }
+    _child_stale.assign(_child_items.size(), false);
+}
+
+/**
+ * Find the children whose bounding boxes intersect the given area.
+ * The area is in display (pixel) coordinates. Children are returned in z-order,
+ * bottom first. Returns false if the group was modified since its last update,
+ * in which case @a items is not changed.
+ */
+bool
+DrawingGroup::findChildren(Geom::Rect const &area, std::vector<DrawingItem *> &items)
+{
+    if (!(_state & STATE_BBOX)) return false;
+
+    if (_child_items.empty()) {
+        for (ChildrenList::iterator i = _children.begin(); i != _children.end(); ++i) {
+            Geom::OptIntRect box = i->geometricBounds();
+            box.unionWith(i->visualBounds());
+            if (box && Geom::Rect(*box).intersects(area)) {
+                items.push_back(&*i);
+            }
+        }
+        return true;
+    }
+
+    std::vector<unsigned> found;
+    _child_index.query(area, std::back_inserter(found));
+    // the tree entries of moved children hold their old boxes
+    found.erase(std::remove_if(found.begin(), found.end(), IsStale(_child_stale)), found.end());
+    for (std::vector<unsigned>::iterator i = _child_moved.begin(); i != _child_moved.end(); ++i) {
+        if (_child_boxes[*i] && Geom::Rect(*_child_boxes[*i]).intersects(area)) {
+            found.push_back(*i);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    for (std::vector<unsigned>::iterator i = found.begin(); i != found.end(); ++i) {
+        items.push_back(_child_items[*i]);
+    }
+    return true;
+}
+
 unsigned
 DrawingGroup::_renderItem(DrawingContext &ct, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at)
 {
@@ -132,8 +246,23 @@ DrawingGroup::_clipItem(DrawingContext &ct, Geom::IntRect const &area)
 DrawingItem *
 DrawingGroup::_pickItem(Geom::Point const &p, double delta, unsigned flags)
 {
-    for (ChildrenList::iterator i = _children.begin(); i != _children.end(); ++i) {
-        DrawingItem *picked = i->pick(p, delta, flags);
+    if (_child_items.empty()) {
+        for (ChildrenList::iterator i = _children.begin(); i != _children.end(); ++i) {
+            DrawingItem *picked = i->pick(p, delta, flags);
+            if (picked) {
+                return _pick_children ? picked : this;
+            }
+        }
+        return NULL;
+    }
+
+    // large group: only try the children near the point
+    Geom::Rect area(p, p);
+    area.expandBy(delta);
+    std::vector<DrawingItem *> nearby;
+    findChildren(area, nearby);
+    for (std::vector<DrawingItem *>::iterator i = nearby.begin(); i != nearby.end(); ++i) {
+        DrawingItem *picked = (*i)->pick(p, delta, flags);
         if (picked) {
             return _pick_children ? picked : this;
         }
@@ -12,7 +12,9 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_GROUP_H
 #define SEEN_INKSCAPE_DISPLAY_DRAWING_GROUP_H
 
+#include <vector>
 #include "display/drawing-item.h"
+#include "util/rtree.h"
 
 class SPStyle;
 
@@ -31,6 +33,8 @@ public:
     void setStyle(SPStyle *style);
     void setChildTransform(Geom::Affine const &new_trans);
 
+    bool findChildren(Geom::Rect const &area, std::vector<DrawingItem *> &items);
+
 protected:
     virtual unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx,
                                  unsigned flags, unsigned reset);
@@ -39,9 +43,19 @@ protected:
     virtual void _clipItem(DrawingContext &ct, Geom::IntRect const &area);
     virtual DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags);
     virtual bool _canClip();
+    void _updateChildIndex();
 
     SPStyle *_style;
     Geom::Affine *_child_transform;
+
+    // Spatial index of children. Values are positions in _child_items, which lists
+    // the children in z-order. Children whose boxes changed since the tree was built
+    // are listed in _child_moved and searched linearly; their tree entries are stale.
+    std::vector<DrawingItem *> _child_items;
+    std::vector<Geom::OptIntRect> _child_boxes; ///< Current boxes
+    std::vector<bool> _child_stale;             ///< Whether the tree entry is out of date
+    std::vector<unsigned> _child_moved;
+    Util::RTree<unsigned> _child_index;
 };
 
 bool is_drawing_group(DrawingItem *item);
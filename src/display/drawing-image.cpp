@@ -9,15 +9,107 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include "display/cairo-utils.h"
 #include "display/drawing.h"
 #include "display/drawing-context.h"
 #include "display/drawing-image.h"
-#include "preferences.h"
+#include "display/render-prefs.h"
 #include "style.h"
 
 namespace Inkscape {
 
+namespace {
+
+/**
+ * Successively halved copies of a premultiplied ARGB32 pixbuf, kept with the
+ * pixbuf so that all images showing it share them.  Level n is 2^n times
+ * smaller than the pixbuf, rounded up; levels are made when first needed.
+ */
+class ImageMipmap {
+public:
+    static ImageMipmap *get(GdkPixbuf *pb) {
+        static GQuark const quark = g_quark_from_static_string("inkscape-image-mipmap");
+        ImageMipmap *mipmap = static_cast<ImageMipmap *>(g_object_get_qdata(G_OBJECT(pb), quark));
+        if (!mipmap) {
+            mipmap = new ImageMipmap(pb);
+            g_object_set_qdata_full(G_OBJECT(pb), quark, mipmap, &ImageMipmap::destroy);
+        }
+        return mipmap;
+    }
+
+    /// Level n > 0, or the smallest level if there are fewer.
+    cairo_surface_t *level(unsigned n) {
+        while (_levels.size() < n) {
+            unsigned char const *src;
+            int w, h, stride;
+            if (_levels.empty()) {
+                src = gdk_pixbuf_get_pixels(_pixbuf);
+                w = gdk_pixbuf_get_width(_pixbuf);
+                h = gdk_pixbuf_get_height(_pixbuf);
+                stride = gdk_pixbuf_get_rowstride(_pixbuf);
+            } else {
+                cairo_surface_t *last = _levels.back();
+                src = cairo_image_surface_get_data(last);
+                w = cairo_image_surface_get_width(last);
+                h = cairo_image_surface_get_height(last);
+                stride = cairo_image_surface_get_stride(last);
+            }
+            if (w == 1 && h == 1 && !_levels.empty()) break;
+            _levels.push_back(_halve(src, w, h, stride));
+        }
+        return _levels[std::min<size_t>(n, _levels.size()) - 1];
+    }
+
+private:
+    ImageMipmap(GdkPixbuf *pb) : _pixbuf(pb) {}
+    ~ImageMipmap() {
+        for (size_t i = 0; i < _levels.size(); ++i) {
+            cairo_surface_destroy(_levels[i]);
+        }
+    }
+    static void destroy(gpointer data) {
+        delete static_cast<ImageMipmap *>(data);
+    }
+
+    /// Average each 2x2 block of pixels; odd edges repeat the last row or column.
+    static cairo_surface_t *_halve(unsigned char const *src, int w, int h, int stride) {
+        int const hw = (w + 1) / 2;
+        int const hh = (h + 1) / 2;
+        cairo_surface_t *out = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, hw, hh);
+        unsigned char *dst = cairo_image_surface_get_data(out);
+        int const dstride = cairo_image_surface_get_stride(out);
+
+        for (int y = 0; y < hh; ++y) {
+            guint32 const *row0 = reinterpret_cast<guint32 const *>(src + 2 * y * stride);
+            guint32 const *row1 = reinterpret_cast<guint32 const *>(src + std::min(2 * y + 1, h - 1) * stride);
+            guint32 *d = reinterpret_cast<guint32 *>(dst + y * dstride);
+            for (int x = 0; x < hw; ++x) {
+                int const x0 = 2 * x;
+                int const x1 = std::min(2 * x + 1, w - 1);
+                guint32 const p00 = row0[x0], p01 = row0[x1], p10 = row1[x0], p11 = row1[x1];
+                guint32 px = 0;
+                // premultiplied channels stay below alpha when averaged
+                for (int shift = 0; shift < 32; shift += 8) {
+                    guint32 sum = ((p00 >> shift) & 0xff) + ((p01 >> shift) & 0xff)
+                                + ((p10 >> shift) & 0xff) + ((p11 >> shift) & 0xff);
+                    px |= ((sum + 2) / 4) << shift;
+                }
+                d[x] = px;
+            }
+        }
+        cairo_surface_mark_dirty(out);
+        return out;
+    }
+
+    GdkPixbuf *_pixbuf;
+    std::vector<cairo_surface_t *> _levels;
+};
+
+} // anonymous namespace
+
 DrawingImage::DrawingImage(Drawing &drawing)
     : DrawingItem(drawing)
     , _pixbuf(NULL)
@@ -127,13 +219,31 @@ unsigned DrawingImage::_renderItem(DrawingContext &ct, Geom::IntRect const &/*ar
 
         ct.translate(_origin);
         ct.scale(_scale);
-        ct.setSource(_surface, 0, 0);
 
         cairo_matrix_t tt;
         Geom::Affine total;
         cairo_get_matrix(ct.raw(), &tt);
         ink_matrix_to_2geom(total, tt);
 
+        double expansion = std::max(total.expansionX(), total.expansionY());
+        if (expansion > 0.0 && expansion < 0.5) {
+            // Zoomed out: sample the reduced copy which has at least one
+            // pixel per device pixel instead of skipping over the bitmap
+            unsigned n = std::floor(std::log(1.0 / expansion) / std::log(2.0));
+            cairo_surface_t *surface;
+            {   // the copies are shared between tiles that may be rendered concurrently
+                RenderLock lock;
+                surface = ImageMipmap::get(_pixbuf)->level(n);
+            }
+            double pw = gdk_pixbuf_get_width(_pixbuf);
+            double ph = gdk_pixbuf_get_height(_pixbuf);
+            ct.scale(Geom::Scale(pw / cairo_image_surface_get_width(surface),
+                                 ph / cairo_image_surface_get_height(surface)));
+            ct.setSource(surface, 0, 0);
+        } else {
+            ct.setSource(_surface, 0, 0);
+        }
+
         if (total.expansionX() > 1.0 || total.expansionY() > 1.0) {
             cairo_pattern_t *p = cairo_get_source(ct.raw());
             cairo_pattern_set_filter(p, CAIRO_FILTER_NEAREST);
@@ -142,8 +252,7 @@ unsigned DrawingImage::_renderItem(DrawingContext &ct, Geom::IntRect const &/*ar
         ct.paint();
 
     } else { // outline; draw a rect instead
-        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-        guint32 rgba = prefs->getInt("/options/wireframecolors/images", 0xff0000ff);
+        guint32 rgba = RenderPrefs::get().image_color;
 
         {   Inkscape::DrawingContext::Save save(ct);
             ct.transform(_ctm);
@@ -0,0 +1,211 @@
+/**
+ * @file
+ * Display subtree shared between several placements of the same content.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+#include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/drawing-instance.h"
+
+namespace Inkscape {
+
+DrawingPrototype::DrawingPrototype()
+    : _item(NULL)
+    , _linear_valid(false)
+{}
+
+DrawingPrototype::~DrawingPrototype()
+{
+    for (std::vector<DrawingInstance *>::iterator i = _instances.begin(); i != _instances.end(); ++i) {
+        (*i)->_prototype = NULL;
+        (*i)->prototypeChanged();
+    }
+}
+
+/**
+ * Set the item drawn by the instances.
+ * The item must not have a parent. It is not deleted by the prototype.
+ */
+void
+DrawingPrototype::setItem(DrawingItem *item)
+{
+    if (item == _item) return;
+    _item = item;
+    _linear_valid = false;
+    if (_item) {
+        // the item is rendered at a different place for every instance,
+        // so a cache of its pixels would never match
+        _item->setCached(false, true);
+    }
+    changed();
+}
+
+void
+DrawingPrototype::changed()
+{
+    for (std::vector<DrawingInstance *>::iterator i = _instances.begin(); i != _instances.end(); ++i) {
+        (*i)->prototypeChanged();
+    }
+}
+
+void
+DrawingPrototype::_update(Geom::Affine const &linear, unsigned flags)
+{
+    if (!_item) return;
+
+    unsigned reset = 0;
+    if (!_linear_valid || !Geom::are_near(linear, _linear, 1e-18)) {
+        _linear = linear;
+        _linear_valid = true;
+        reset = DrawingItem::STATE_ALL;
+    }
+    UpdateContext ctx;
+    ctx.ctm = linear;
+    _item->update(Geom::IntRect::infinite(), ctx, flags, reset);
+}
+
+DrawingInstance::DrawingInstance(Drawing &drawing)
+    : DrawingGroup(drawing)
+    , _prototype(NULL)
+{}
+
+DrawingInstance::~DrawingInstance()
+{
+    if (_prototype) {
+        std::vector<DrawingInstance *> &instances = _prototype->_instances;
+        instances.erase(std::find(instances.begin(), instances.end(), this));
+    }
+}
+
+/**
+ * Draw the item of @a proto instead of the children of this group.
+ * Passing NULL draws the children again.
+ */
+void
+DrawingInstance::setPrototype(DrawingPrototype *proto)
+{
+    if (proto == _prototype) return;
+
+    _markForRendering();
+    if (_prototype) {
+        std::vector<DrawingInstance *> &instances = _prototype->_instances;
+        instances.erase(std::find(instances.begin(), instances.end(), this));
+    }
+    _prototype = proto;
+    if (_prototype) {
+        _prototype->_instances.push_back(this);
+    }
+    _markForUpdate(STATE_ALL, true);
+}
+
+/**
+ * Schedule an update after the item of the prototype was modified.
+ */
+void
+DrawingInstance::prototypeChanged()
+{
+    _markForRendering();
+    _markForUpdate(STATE_ALL, true);
+}
+
+unsigned
+DrawingInstance::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset)
+{
+    if (!_prototype) {
+        return DrawingGroup::_updateItem(area, ctx, flags, reset);
+    }
+
+    Geom::Affine ctm = ctx.ctm;
+    if (_child_transform) {
+        ctm = *_child_transform * ctm;
+    }
+    _offset = Geom::Translate(ctm.translation());
+    _prototype->_update(ctm.withoutTranslation(), flags);
+
+    // Groups leave redrawing to their members, which the prototype item
+    // is not, so the old and the new area are marked here.
+    if (flags & STATE_RENDER) {
+        _markForRendering();
+    }
+
+    _bbox = Geom::OptIntRect();
+    DrawingItem *item = _prototype->item();
+    if (item && item->visible()) {
+        Geom::OptIntRect box = _drawing.outline() ? item->geometricBounds() : item->visualBounds();
+        if (box) {
+            _bbox = (Geom::Rect(*box) * _offset).roundOutwards();
+        }
+    }
+
+    if (flags & STATE_RENDER) {
+        _drawbox = _bbox; // refined by the caller
+        _markForRendering();
+    }
+    return STATE_ALL;
+}
+
+unsigned
+DrawingInstance::_renderItem(DrawingContext &ct, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at)
+{
+    if (!_prototype) {
+        return DrawingGroup::_renderItem(ct, area, flags, stop_at);
+    }
+
+    DrawingItem *item = _prototype->item();
+    if (!item) return RENDER_OK;
+
+    Geom::IntRect parea = (Geom::Rect(area) * _offset.inverse()).roundOutwards();
+    Inkscape::DrawingContext::Save save(ct);
+    ct.translate(_offset.vector());
+    item->render(ct, parea, flags | RENDER_BYPASS_CACHE, stop_at);
+    return RENDER_OK;
+}
+
+void
+DrawingInstance::_clipItem(DrawingContext &ct, Geom::IntRect const &area)
+{
+    if (!_prototype) {
+        DrawingGroup::_clipItem(ct, area);
+        return;
+    }
+
+    DrawingItem *item = _prototype->item();
+    if (!item) return;
+
+    Geom::IntRect parea = (Geom::Rect(area) * _offset.inverse()).roundOutwards();
+    Inkscape::DrawingContext::Save save(ct);
+    ct.translate(_offset.vector());
+    item->clip(ct, parea);
+}
+
+DrawingItem *
+DrawingInstance::_pickItem(Geom::Point const &p, double delta, unsigned flags)
+{
+    if (!_prototype) {
+        return DrawingGroup::_pickItem(p, delta, flags);
+    }
+
+    // items of the prototype belong to another instance, so never return them
+    DrawingItem *item = _prototype->item();
+    if (item && item->pick(p * _offset.inverse(), delta, flags)) {
+        return this;
+    }
+    return NULL;
+}
+
+} // end namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * Display subtree shared between several placements of the same content.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_INSTANCE_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_INSTANCE_H
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <2geom/transforms.h>
+#include "display/drawing-group.h"
+
+namespace Inkscape {
+
+class DrawingInstance;
+
+/**
+ * Orphan display item which is drawn by any number of DrawingInstances.
+ *
+ * The item is not owned by the prototype. It is updated with the linear part
+ * of the instances' transform only; each instance adds its own translation
+ * when rendering it. All instances of a prototype must therefore share
+ * the linear part of their transform.
+ */
+class DrawingPrototype
+    : boost::noncopyable
+{
+public:
+    DrawingPrototype();
+    virtual ~DrawingPrototype();
+
+    DrawingItem *item() const { return _item; }
+    void setItem(DrawingItem *item);
+    /// Tell the instances that the prototype item has changed.
+    void changed();
+
+    std::vector<DrawingInstance *> const &instances() const { return _instances; }
+
+private:
+    void _update(Geom::Affine const &linear, unsigned flags);
+
+    DrawingItem *_item;
+    Geom::Affine _linear;
+    bool _linear_valid;
+    std::vector<DrawingInstance *> _instances;
+
+    friend class DrawingInstance;
+};
+
+/**
+ * Group which can draw a DrawingPrototype instead of its own children.
+ * Opacity, clipping, masking, filters and the child transform of the group
+ * apply per instance as usual.
+ */
+class DrawingInstance
+    : public DrawingGroup
+{
+public:
+    DrawingInstance(Drawing &drawing);
+    ~DrawingInstance();
+
+    DrawingPrototype *prototype() const { return _prototype; }
+    void setPrototype(DrawingPrototype *proto);
+    void prototypeChanged();
+
+protected:
+    virtual unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx,
+                                 unsigned flags, unsigned reset);
+    virtual unsigned _renderItem(DrawingContext &ct, Geom::IntRect const &area, unsigned flags,
+                                 DrawingItem *stop_at);
+    virtual void _clipItem(DrawingContext &ct, Geom::IntRect const &area);
+    virtual DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags);
+
+    DrawingPrototype *_prototype;
+    Geom::Translate _offset; ///< From prototype display coords to display coords
+
+    friend class DrawingPrototype;
+};
+
+} // end namespace Inkscape
+
+#endif // !SEEN_INKSCAPE_DISPLAY_DRAWING_INSTANCE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -18,7 +18,7 @@
 #include "display/drawing-group.h"
 #include "display/drawing-surface.h"
 #include "nr-filter.h"
-#include "preferences.h"
+#include "display/render-prefs.h"
 #include "style.h"
 
 namespace Inkscape {
@@ -344,7 +344,6 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
         child_ctx.ctm = *_transform * ctx.ctm;
     }
     /* Remember the transformation matrix */
-    Geom::Affine ctm_change = _ctm.inverse() * child_ctx.ctm;
     _ctm = child_ctx.ctm;
 
     // update _bbox and call this function for children
@@ -406,14 +405,13 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
          * e.g. because its filter was removed. This way we avoid tempoerarily
          * using more memory than the cache budget */
         if (_cache) {
-            Geom::OptIntRect cl = _cacheRect();
-            if (_visible && cl) { // never create cache for invisible items
-                // this takes care of invalidation on transform
-                _cache->scheduleTransform(*cl, ctm_change);
+            if (_visible) { // never create cache for invisible items
+                // this selects the cache level matching the new transform
+                _cache->scheduleTransform(_ctm);
             } else {
-                // Destroy cache for this item - outside of canvas or invisible.
-                // The opposite transition (invisible -> visible or object
-                // entering the canvas) is handled during the render phase
+                // Destroy cache for this item - invisible.
+                // The opposite transition (invisible -> visible) is handled
+                // during the render phase
                 delete _cache;
                 _cache = NULL;
             }
@@ -475,11 +473,15 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
     Geom::OptIntRect carea = Geom::intersect(area, _drawbox);
     if (!carea) return RENDER_OK;
 
-    // render from cache if possible
-    if (_cached) {
+    // render from cache if possible; items drawn at several places bypass it
+    bool const use_cache = _cached && !(flags & RENDER_BYPASS_CACHE);
+    if (use_cache) {
+        // the cache is shared between tiles that may be rendered concurrently
+        RenderLock lock;
         if (_cache) {
             _cache->prepare();
-            _cache->paintFromCache(ct, carea);
+            // a cached ancestor would store the approximation, so only render exactly for it
+            _cache->paintFromCache(ct, carea, !(flags & RENDER_NO_APPROXIMATION));
             if (!carea) return RENDER_OK;
         } else {
             // There is no cache. This could be because caching of this item
@@ -488,7 +490,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
             Geom::OptIntRect cl = _drawing.cacheLimit();
             cl.intersectWith(_drawbox);
             if (cl) {
-                _cache = new DrawingCache(*cl);
+                _cache = new DrawingCache(_drawing, _ctm);
             }
         }
     } else {
@@ -506,7 +508,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
     nir |= (_mask != NULL); // 2. it has a mask
     nir |= (_filter != NULL && render_filters); // 3. it has a filter
     nir |= needs_opacity; // 4. it is non-opaque
-    nir |= (_cache != NULL); // 5. it is cached
+    nir |= (use_cache && _cache != NULL); // 5. it is cached
 
     /* How the rendering is done.
      *
@@ -543,6 +545,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
     DrawingSurface intermediate(*iarea);
     DrawingContext ict(intermediate);
     unsigned render_result = RENDER_OK;
+    unsigned child_flags = (use_cache && _cache) ? (flags | RENDER_NO_APPROXIMATION) : flags;
 
     // 1. Render clipping path with alpha = opacity.
     ict.setSource(0,0,0,_opacity);
@@ -561,7 +564,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
     // 2. Render the mask if present and compose it with the clipping path + opacity.
     if (_mask) {
         ict.pushGroup();
-        _mask->render(ict, *carea, flags);
+        _mask->render(ict, *carea, child_flags);
 
         cairo_surface_t *mask_s = ict.rawTarget();
         // Convert mask's luminance to alpha
@@ -574,7 +577,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
 
     // 3. Render object itself
     ict.pushGroup();
-    render_result = _renderItem(ict, *iarea, flags, stop_at);
+    render_result = _renderItem(ict, *iarea, child_flags, stop_at);
 
     // 4. Apply filter.
     if (_filter && render_filters) {
@@ -587,7 +590,7 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
             if (bg_root) {
                 DrawingSurface bg(*iarea);
                 DrawingContext bgct(bg);
-                bg_root->render(bgct, *iarea, flags | RENDER_FILTER_BACKGROUND, this);
+                bg_root->render(bgct, *iarea, child_flags | RENDER_FILTER_BACKGROUND, this);
                 _filter->render(this, ict, &bgct);
                 rendered = true;
             }
@@ -606,13 +609,9 @@ DrawingItem::render(DrawingContext &ct, Geom::IntRect const &area, unsigned flag
     ict.paint();
 
     // 6. Paint the completed rendering onto the base context (or into cache)
-    if (_cached && _cache) {
-        DrawingContext cachect(*_cache);
-        cachect.rectangle(*carea);
-        cachect.setOperator(CAIRO_OPERATOR_SOURCE);
-        cachect.setSource(&intermediate);
-        cachect.fill();
-        _cache->markClean(*carea);
+    if (use_cache && _cache) {
+        RenderLock lock;
+        _cache->storeTiles(intermediate, *carea);
     }
     ct.rectangle(*carea);
     ct.setSource(&intermediate);
@@ -638,14 +637,14 @@ DrawingItem::_renderOutline(DrawingContext &ct, Geom::IntRect const &area, unsig
     // render clip and mask, if any
     guint32 saved_rgba = _drawing.outlinecolor; // save current outline color
     // render clippath as an object, using a different color
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    RenderPrefs const &prefs = RenderPrefs::get();
     if (_clip) {
-        _drawing.outlinecolor = prefs->getInt("/options/wireframecolors/clips", 0x00ff00ff); // green clips
+        _drawing.outlinecolor = prefs.clip_color;
         _clip->render(ct, *carea, flags);
     }
     // render mask as an object, using a different color
     if (_mask) {
-        _drawing.outlinecolor = prefs->getInt("/options/wireframecolors/masks", 0x0000ffff); // blue masks
+        _drawing.outlinecolor = prefs.mask_color;
         _mask->render(ct, *carea, flags);
     }
     _drawing.outlinecolor = saved_rgba; // restore outline color
@@ -67,7 +67,8 @@ public:
         RENDER_DEFAULT = 0,
         RENDER_CACHE_ONLY = 1,
         RENDER_BYPASS_CACHE = 2,
-        RENDER_FILTER_BACKGROUND = 4
+        RENDER_FILTER_BACKGROUND = 4,
+        RENDER_NO_APPROXIMATION = 8
     };
     enum StateFlags {
         STATE_NONE = 0,
@@ -0,0 +1,298 @@
+/**
+ * @file
+ * Display item drawing a few shared items at many places.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+#include <iterator>
+#include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/drawing-stamps.h"
+
+namespace Inkscape {
+
+// With fewer stamps, they are searched linearly
+static size_t const STAMP_INDEX_THRESHOLD = 32;
+
+DrawingStamps::DrawingStamps(Drawing &drawing)
+    : DrawingItem(drawing)
+{}
+
+DrawingStamps::~DrawingStamps()
+{
+    for (std::vector<Item>::iterator i = _items.begin(); i != _items.end(); ++i) {
+        delete i->item;
+    }
+}
+
+/**
+ * Add a shared item and return its slot.
+ * The item must not have a parent. It is deleted together with this item.
+ */
+unsigned
+DrawingStamps::addItem(DrawingItem *item)
+{
+    // stamps draw the item at different places, so a cache of its pixels would never match
+    item->setCached(false, true);
+
+    Item rec;
+    rec.item = item;
+    rec.uses = 0;
+    rec.transform_changed = true;
+
+    unsigned slot = 0;
+    while (slot < _items.size() && _items[slot].item) {
+        ++slot;
+    }
+    if (slot == _items.size()) {
+        _items.push_back(rec);
+    } else {
+        _items[slot] = rec;
+    }
+    return slot;
+}
+
+/**
+ * Delete the shared item in @a slot. Stamps which still draw it are cleared.
+ */
+void
+DrawingStamps::removeItem(unsigned slot)
+{
+    if (slot >= _items.size() || !_items[slot].item) return;
+
+    for (unsigned i = 0; _items[slot].uses && i < _stamps.size(); ++i) {
+        if (_stamps[i].slot == slot) {
+            clearStamp(i);
+        }
+    }
+    delete _items[slot].item;
+    _items[slot].item = NULL;
+    while (!_items.empty() && !_items.back().item) {
+        _items.pop_back();
+    }
+}
+
+/**
+ * Set the transform from the coordinates of the shared item in @a slot
+ * to the coordinates of this item, excluding the translation of the stamps.
+ */
+void
+DrawingStamps::setItemTransform(unsigned slot, Geom::Affine const &transform)
+{
+    if (slot >= _items.size()) return;
+    Item &rec = _items[slot];
+    if (Geom::are_near(rec.transform, transform, 1e-18)) return;
+
+    rec.transform = transform;
+    rec.transform_changed = true;
+    if (rec.uses) {
+        itemsChanged();
+    }
+}
+
+/**
+ * Schedule an update after the shared items were modified.
+ */
+void
+DrawingStamps::itemsChanged()
+{
+    // after the first change, the old area is already marked
+    if (_state & STATE_BBOX) {
+        _markForRendering();
+    }
+    _markForUpdate(STATE_ALL, false);
+}
+
+void
+DrawingStamps::setStampCount(unsigned n)
+{
+    if (n == _stamps.size()) return;
+    for (unsigned i = n; i < _stamps.size(); ++i) {
+        clearStamp(i);
+    }
+
+    Stamp empty;
+    empty.slot = NO_ITEM;
+    _stamps.resize(n, empty);
+    itemsChanged();
+}
+
+/**
+ * Draw the shared item in @a slot translated by @a origin at position @a pos.
+ * Passing NO_ITEM draws nothing there.
+ */
+void
+DrawingStamps::setStamp(unsigned pos, unsigned slot, Geom::Point const &origin)
+{
+    if (pos >= _stamps.size()) return;
+    if (slot >= _items.size() || !_items[slot].item) {
+        slot = NO_ITEM;
+    }
+    Stamp &s = _stamps[pos];
+    if (s.slot == slot && (slot == NO_ITEM || s.origin == origin)) return;
+
+    if (s.slot != NO_ITEM) {
+        --_items[s.slot].uses;
+    }
+    if (slot != NO_ITEM) {
+        ++_items[slot].uses;
+    }
+    s.slot = slot;
+    s.origin = origin;
+    itemsChanged();
+}
+
+unsigned
+DrawingStamps::_updateItem(Geom::IntRect const &/*area*/, UpdateContext const &ctx, unsigned flags, unsigned reset)
+{
+    for (std::vector<Item>::iterator i = _items.begin(); i != _items.end(); ++i) {
+        if (!i->item) continue;
+        UpdateContext item_ctx;
+        item_ctx.ctm = i->transform * ctx.ctm;
+        i->item->update(Geom::IntRect::infinite(), item_ctx, flags,
+                        i->transform_changed ? unsigned(STATE_ALL) : reset);
+        i->transform_changed = false;
+    }
+
+    // The shared items are not our children, so the old and the new area
+    // are marked here.
+    if (flags & STATE_RENDER) {
+        _markForRendering();
+    }
+
+    bool const outline = _drawing.outline();
+    Geom::Affine const linear = ctx.ctm.withoutTranslation();
+    bool const indexed = _stamps.size() >= STAMP_INDEX_THRESHOLD;
+
+    _bbox = Geom::OptIntRect();
+    _stamp_index.clear();
+    for (unsigned pos = 0; pos < _stamps.size(); ++pos) {
+        Stamp &s = _stamps[pos];
+        s.box = Geom::OptIntRect();
+        if (s.slot == NO_ITEM) continue;
+
+        DrawingItem *item = _items[s.slot].item;
+        if (!item->visible()) continue;
+
+        // keep both boxes, so that stamps serve normal, outline and clip requests
+        Geom::OptIntRect box = item->geometricBounds();
+        box.unionWith(item->visualBounds());
+        if (!box) continue;
+
+        s.offset = s.origin * linear;
+        Geom::Rect moved = *box;
+        moved += s.offset;
+        s.box = moved.roundOutwards();
+
+        Geom::OptIntRect shown = outline ? item->geometricBounds() : item->visualBounds();
+        if (shown) {
+            Geom::Rect moved_shown = *shown;
+            moved_shown += s.offset;
+            _bbox.unionWith(moved_shown.roundOutwards());
+        }
+        if (indexed) {
+            _stamp_index.insert(*s.box, pos);
+        }
+    }
+
+    if (flags & STATE_RENDER) {
+        _drawbox = _bbox; // refined by the caller
+        _markForRendering();
+    }
+    return STATE_ALL;
+}
+
+/**
+ * Find the positions of stamps which may draw something in @a area, in ascending order.
+ */
+void
+DrawingStamps::_findStamps(Geom::Rect const &area, std::vector<unsigned> &found) const
+{
+    if (_stamp_index.empty()) {
+        for (unsigned pos = 0; pos < _stamps.size(); ++pos) {
+            if (_stamps[pos].box && Geom::Rect(*_stamps[pos].box).intersects(area)) {
+                found.push_back(pos);
+            }
+        }
+        return;
+    }
+
+    _stamp_index.query(area, std::back_inserter(found));
+    std::sort(found.begin(), found.end());
+}
+
+unsigned
+DrawingStamps::_renderItem(DrawingContext &ct, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at)
+{
+    std::vector<unsigned> found;
+    _findStamps(area, found);
+
+    // stamps are drawn in path order
+    for (std::vector<unsigned>::iterator i = found.begin(); i != found.end(); ++i) {
+        Stamp const &s = _stamps[*i];
+        Geom::Rect sarea = area;
+        sarea -= s.offset;
+
+        Inkscape::DrawingContext::Save save(ct);
+        ct.translate(s.offset);
+        _items[s.slot].item->render(ct, sarea.roundOutwards(), flags | RENDER_BYPASS_CACHE, stop_at);
+    }
+    return RENDER_OK;
+}
+
+void
+DrawingStamps::_clipItem(DrawingContext &ct, Geom::IntRect const &area)
+{
+    std::vector<unsigned> found;
+    _findStamps(area, found);
+
+    for (std::vector<unsigned>::iterator i = found.begin(); i != found.end(); ++i) {
+        Stamp const &s = _stamps[*i];
+        Geom::Rect sarea = area;
+        sarea -= s.offset;
+
+        Inkscape::DrawingContext::Save save(ct);
+        ct.translate(s.offset);
+        _items[s.slot].item->clip(ct, sarea.roundOutwards());
+    }
+}
+
+DrawingItem *
+DrawingStamps::_pickItem(Geom::Point const &p, double delta, unsigned flags)
+{
+    Geom::Rect area(p, p);
+    area.expandBy(delta);
+    std::vector<unsigned> found;
+    _findStamps(area, found);
+
+    // the shared items belong to no stamp in particular, so never return them
+    for (std::vector<unsigned>::reverse_iterator i = found.rbegin(); i != found.rend(); ++i) {
+        Stamp const &s = _stamps[*i];
+        if (_items[s.slot].item->pick(p - s.offset, delta, flags)) {
+            return this;
+        }
+    }
+    return NULL;
+}
+
+bool
+DrawingStamps::_canClip()
+{
+    return true;
+}
+
+} // end namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,95 @@
+/**
+ * @file
+ * Display item drawing a few shared items at many places.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_STAMPS_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_STAMPS_H
+
+#include <vector>
+#include <2geom/affine.h>
+#include "display/drawing-item.h"
+#include "util/rtree.h"
+
+namespace Inkscape {
+
+/**
+ * Item which draws its shared items at a list of places, called stamps.
+ * Used for markers, which repeat the same content at every vertex of a path.
+ *
+ * The shared items are orphans owned by this item. Each one is updated once,
+ * with its own transform followed by the transform of this item, and every stamp
+ * adds a translation when rendering, clipping and picking it. The display memory
+ * therefore grows with the number of distinct shared items, not with the number
+ * of stamps. Pixels of the shared items are not cached, because each stamp
+ * draws them at another position.
+ */
+class DrawingStamps
+    : public DrawingItem
+{
+public:
+    static unsigned const NO_ITEM = ~0u;
+
+    DrawingStamps(Drawing &drawing);
+    ~DrawingStamps();
+
+    unsigned addItem(DrawingItem *item);
+    void removeItem(unsigned slot);
+    DrawingItem *item(unsigned slot) const { return slot < _items.size() ? _items[slot].item : NULL; }
+    unsigned itemSlots() const { return _items.size(); }
+    unsigned itemUses(unsigned slot) const { return slot < _items.size() ? _items[slot].uses : 0; }
+    void setItemTransform(unsigned slot, Geom::Affine const &transform);
+    void itemsChanged();
+
+    unsigned stampCount() const { return _stamps.size(); }
+    void setStampCount(unsigned n);
+    void setStamp(unsigned pos, unsigned slot, Geom::Point const &origin);
+    void clearStamp(unsigned pos) { setStamp(pos, NO_ITEM, Geom::Point()); }
+
+protected:
+    virtual unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx,
+                                 unsigned flags, unsigned reset);
+    virtual unsigned _renderItem(DrawingContext &ct, Geom::IntRect const &area, unsigned flags,
+                                 DrawingItem *stop_at);
+    virtual void _clipItem(DrawingContext &ct, Geom::IntRect const &area);
+    virtual DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags);
+    virtual bool _canClip();
+    void _findStamps(Geom::Rect const &area, std::vector<unsigned> &found) const;
+
+    struct Item {
+        DrawingItem *item;
+        Geom::Affine transform; ///< From the item's coords to the coords of this item
+        unsigned uses;
+        bool transform_changed;
+    };
+    struct Stamp {
+        unsigned slot;
+        Geom::Point origin; ///< Translation in the coords of this item
+        Geom::Point offset; ///< Translation in display coords
+        Geom::OptIntRect box;
+    };
+
+    std::vector<Item> _items;
+    std::vector<Stamp> _stamps;
+
+    // Spatial index of stamps, used when there are many of them
+    Util::RTree<unsigned> _stamp_index;
+};
+
+} // end namespace Inkscape
+
+#endif // !SEEN_INKSCAPE_DISPLAY_DRAWING_STAMPS_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
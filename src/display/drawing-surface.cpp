@@ -10,8 +10,11 @@
  */
 
 //#include <iostream>
+#include <map>
+#include <vector>
 #include "display/drawing-surface.h"
 #include "display/drawing-context.h"
+#include "display/drawing.h"
 #include "display/cairo-utils.h"
 
 namespace Inkscape {
@@ -172,163 +175,410 @@ DrawingSurface::pixelArea() const
 
 //////////////////////////////////////////////////////////////////////////////
 
-DrawingCache::DrawingCache(Geom::IntRect const &area)
-    : DrawingSurface(area)
-    , _clean_region(cairo_region_create())
-    , _pending_area(area)
-{}
+/**
+ * @class DrawingCache
+ * Tiled rendering cache of a drawing item.
+ *
+ * The cache is organized in levels. Each level holds the tiles rendered
+ * with one item-to-pixel transform. Tiles are addressed in the pixel
+ * grid of the level at the time it was created; when the item is only
+ * translated by whole pixels, the level is reused and its grid origin is
+ * shifted. Any other transform change makes a different level current,
+ * so the old tiles can be reused when the transform returns to the
+ * previous one, e.g. when zooming back and forth.
+ *
+ * Clean tiles of other levels are also used to paint an approximate
+ * rendering of the current level immediately. The drawing then schedules
+ * a redraw of that area, which renders it exactly.
+ *
+ * All tiles of a drawing share its cache budget; the least recently used
+ * tiles are discarded first.
+ */
+
+typedef std::pair<int, int> TileCoord;
+typedef std::map<TileCoord, DrawingCacheTile *> TileMap;
+
+struct DrawingCacheLevel {
+    DrawingCacheLevel(DrawingCache *o, Geom::Affine const &c)
+        : owner(o)
+        , ctm(c)
+        , origin(0, 0)
+        , clean(cairo_region_create())
+    {}
+    ~DrawingCacheLevel() {
+        cairo_region_destroy(clean);
+    }
+
+    DrawingCache *owner;
+    Geom::Affine ctm;       ///< item to pixel transform of this level
+    Geom::IntPoint origin;  ///< current pixel position of the tile grid origin
+    cairo_region_t *clean;  ///< clean area in tile grid coordinates
+    TileMap tiles;
+};
+
+struct DrawingCacheTile {
+    DrawingCacheTile(DrawingCacheLevel *l, TileCoord const &c)
+        : level(l)
+        , coord(c)
+        , surface(Geom::IntRect::from_xywh(c.first * DrawingCache::TILE_SIZE,
+                                           c.second * DrawingCache::TILE_SIZE,
+                                           DrawingCache::TILE_SIZE, DrawingCache::TILE_SIZE))
+    {}
+
+    DrawingCacheLevel *level;
+    TileCoord coord;
+    DrawingSurface surface; ///< covers the tile in tile grid coordinates
+    std::list<DrawingCacheTile *>::iterator lru;
+};
+
+static const size_t TILE_BYTES = DrawingCache::TILE_SIZE * DrawingCache::TILE_SIZE * 4;
+
+static inline int tile_floor(int x)
+{
+    return (x >= 0) ? x / DrawingCache::TILE_SIZE
+                    : -((-x + DrawingCache::TILE_SIZE - 1) / DrawingCache::TILE_SIZE);
+}
+
+static Geom::IntRect tile_area(TileCoord const &c)
+{
+    return Geom::IntRect::from_xywh(c.first * DrawingCache::TILE_SIZE,
+                                    c.second * DrawingCache::TILE_SIZE,
+                                    DrawingCache::TILE_SIZE, DrawingCache::TILE_SIZE);
+}
+
+DrawingCache::DrawingCache(Drawing &drawing, Geom::Affine const &ctm)
+    : _drawing(drawing)
+    , _pending_ctm(ctm)
+    , _approximated(cairo_region_create())
+{
+    _levels.push_front(new DrawingCacheLevel(this, ctm));
+}
 
 DrawingCache::~DrawingCache()
 {
-    cairo_region_destroy(_clean_region);
+    while (!_levels.empty()) {
+        _dropLevel(_levels.back());
+    }
+    cairo_region_destroy(_approximated);
 }
 
+/// Marks an area given in the pixel space of the current item transform as dirty
+/// in all levels of the cache.
 void
 DrawingCache::markDirty(Geom::IntRect const &area)
 {
+    if (area == Geom::IntRect::infinite()) {
+        std::list<DrawingCacheLevel *> levels(_levels);
+        for (std::list<DrawingCacheLevel *>::iterator i = levels.begin(); i != levels.end(); ++i) {
+            TileMap tiles((*i)->tiles);
+            for (TileMap::iterator j = tiles.begin(); j != tiles.end(); ++j) {
+                _dropTile(j->second);
+            }
+        }
+        cairo_region_destroy(_approximated);
+        _approximated = cairo_region_create();
+        return;
+    }
+
     cairo_rectangle_int_t dirty = _convertRect(area);
-    cairo_region_subtract_rectangle(_clean_region, &dirty);
-}
-void
-DrawingCache::markClean(Geom::IntRect const &area)
-{
-    Geom::OptIntRect r = Geom::intersect(area, pixelArea());
-    if (!r) return;
-    cairo_rectangle_int_t clean = _convertRect(*r);
-    cairo_region_union_rectangle(_clean_region, &clean);
+    cairo_region_subtract_rectangle(_approximated, &dirty);
+
+    // copy the list, since dirtying can drop levels which became empty
+    std::list<DrawingCacheLevel *> levels(_levels);
+    Geom::Affine to_item = _pending_ctm.inverse();
+    for (std::list<DrawingCacheLevel *>::iterator i = levels.begin(); i != levels.end(); ++i) {
+        Geom::Affine rel = to_item * (*i)->ctm;
+        if (rel.isIdentity()) {
+            _dirtyLevel(*i, area);
+        } else {
+            // content is resampled at a different scale, so include the antialiasing margin
+            Geom::IntRect level_area = (Geom::Rect(area) * rel).roundOutwards();
+            level_area.expandBy(1);
+            _dirtyLevel(*i, level_area);
+        }
+    }
 }
 
 /// Call this during the update phase to schedule a transformation of the cache.
 void
-DrawingCache::scheduleTransform(Geom::IntRect const &new_area, Geom::Affine const &trans)
+DrawingCache::scheduleTransform(Geom::Affine const &ctm)
 {
-    _pending_area = new_area;
-    _pending_transform *= trans;
+    _pending_ctm = ctm;
 }
 
-/// Transforms the cache according to the transform specified during the update phase.
+/// Selects the level corresponding to the transform specified during the update phase.
 /// Call this during render phase, before painting.
 void
 DrawingCache::prepare()
 {
-    Geom::IntRect old_area = pixelArea();
-    bool is_identity = _pending_transform.isIdentity();
-    if (is_identity && _pending_area == old_area) return; // no change
-
-    bool is_integer_translation = false;
-    if (!is_identity && _pending_transform.isTranslation()) {
-        Geom::IntPoint t = _pending_transform.translation().round();
-        if (Geom::are_near(Geom::Point(t), _pending_transform.translation())) {
-            is_integer_translation = true;
-            cairo_region_translate(_clean_region, t[X], t[Y]);
-            if (old_area + t == _pending_area) {
-                // if the areas match, the only thing to do
-                // is to ensure that the clean area is not too large
-                cairo_rectangle_int_t limit = _convertRect(_pending_area);
-                cairo_region_intersect_rectangle(_clean_region, &limit);
-                _origin += t;
-                _pending_transform.setIdentity();
-                return;
-            }
-        }
+    DrawingCacheLevel *current = _levels.front();
+    if (current->ctm == _pending_ctm) return; // no change
+
+    // approximations were done relative to the old level
+    cairo_region_destroy(_approximated);
+    _approximated = cairo_region_create();
+
+    // look for a level that differs from the new transform only by an integer translation
+    for (std::list<DrawingCacheLevel *>::iterator i = _levels.begin(); i != _levels.end(); ++i) {
+        Geom::Affine rel = (*i)->ctm.inverse() * _pending_ctm;
+        if (!rel.isTranslation()) continue;
+        Geom::IntPoint t = rel.translation().round();
+        if (!Geom::are_near(Geom::Point(t), rel.translation())) continue;
+
+        DrawingCacheLevel *level = *i;
+        level->ctm = _pending_ctm;
+        level->origin += t;
+        _levels.erase(i);
+        _levels.push_front(level);
+        return;
     }
-    // otherwise, we need to transform the cache
-    Geom::IntPoint old_origin = old_area.min();
-    cairo_surface_t *old_surface = _surface;
-    _surface = NULL;
-    _pixels = _pending_area.dimensions();
-    _origin = _pending_area.min();
-
-    cairo_t *ct = createRawContext();
-    if (!is_identity) {
-        ink_cairo_transform(ct, _pending_transform);
-    }
-    cairo_set_source_surface(ct, old_surface, old_origin[X], old_origin[Y]);
-    cairo_set_operator(ct, CAIRO_OPERATOR_SOURCE);
-    cairo_paint(ct);
-
-    cairo_surface_destroy(old_surface);
-    cairo_destroy(ct);
 
-    if (!is_identity && !is_integer_translation) {
-        // dirty everything
-        cairo_region_destroy(_clean_region);
-        _clean_region = cairo_region_create();
-    } else {
-        cairo_rectangle_int_t limit = _convertRect(_pending_area);
-        cairo_region_intersect_rectangle(_clean_region, &limit);
+    _levels.push_front(new DrawingCacheLevel(this, _pending_ctm));
+    while (_levels.size() > MAX_LEVELS) {
+        _dropLevel(_levels.back());
     }
-    //std::cout << _pending_transform << old_area << _pending_area << std::endl;
-    _pending_transform.setIdentity();
 }
 
 /**
  * Paints the clean area from cache and modifies the @a area
  * parameter to the bounds of the region that must be repainted.
+ * If @a approximate is true, the area that must be repainted can be
+ * filled from another level of the cache instead; the drawing then
+ * requests an exact redraw of that area.
  */
 void
-DrawingCache::paintFromCache(DrawingContext &ct, Geom::OptIntRect &area)
+DrawingCache::paintFromCache(DrawingContext &ct, Geom::OptIntRect &area, bool approximate)
 {
     if (!area) return;
 
+    DrawingCacheLevel *level = _levels.front();
+
     // We subtract the clean region from the area, then get the bounds
     // of the resulting region. This is the area that needs to be repainted
     // by the item.
     // Then we subtract the area that needs to be repainted from the
     // original area and paint the resulting region from cache.
-    cairo_rectangle_int_t area_c = _convertRect(*area);
+    cairo_rectangle_int_t area_c = _convertRect(*area - level->origin);
     cairo_region_t *dirty_region = cairo_region_create_rectangle(&area_c);
     cairo_region_t *cache_region = cairo_region_copy(dirty_region);
-    cairo_region_subtract(dirty_region, _clean_region);
+    cairo_region_subtract(dirty_region, level->clean);
 
     if (cairo_region_is_empty(dirty_region)) {
         area = Geom::OptIntRect();
     } else {
         cairo_rectangle_int_t to_repaint;
         cairo_region_get_extents(dirty_region, &to_repaint);
-        area = _convertRect(to_repaint);
+        area = _convertRect(to_repaint) + level->origin;
         cairo_region_subtract_rectangle(cache_region, &to_repaint);
     }
     cairo_region_destroy(dirty_region);
 
     if (!cairo_region_is_empty(cache_region)) {
-        int nr = cairo_region_num_rectangles(cache_region);
-        cairo_rectangle_int_t tmp;
-        for (int i = 0; i < nr; ++i) {
-            cairo_region_get_rectangle(cache_region, i, &tmp);
-            ct.rectangle(_convertRect(tmp));
-        }
-        ct.setSource(this);
-        ct.fill();
+        Inkscape::DrawingContext::Save save(ct);
+        ct.translate(level->origin[X], level->origin[Y]);
+        _paintTiles(ct, level, cache_region);
     }
     cairo_region_destroy(cache_region);
+
+    if (area && approximate && _drawing._canvasarena && !_drawing._exact) {
+        if (_paintApproximation(ct, *area)) {
+            area = Geom::OptIntRect();
+        }
+    }
 }
 
-// debugging utility
+/// Stores the given area of a rendering of the item in the current level and marks it clean.
 void
-DrawingCache::_dumpCache(Geom::OptIntRect const &area)
+DrawingCache::storeTiles(DrawingSurface &source, Geom::IntRect const &area)
 {
-    static int dumpnr = 0;
-    cairo_surface_t *surface = ink_cairo_surface_copy(_surface);
-    DrawingContext ct(surface, _origin);
-    if (!cairo_region_is_empty(_clean_region)) {
-        Inkscape::DrawingContext::Save save(ct);
-        int nr = cairo_region_num_rectangles(_clean_region);
-        cairo_rectangle_int_t tmp;
-        for (int i = 0; i < nr; ++i) {
-            cairo_region_get_rectangle(_clean_region, i, &tmp);
-            ct.rectangle(_convertRect(tmp));
+    DrawingCacheLevel *level = _levels.front();
+    Geom::IntRect grid_area = area - level->origin;
+
+    for (int ty = tile_floor(grid_area.top()); ty <= tile_floor(grid_area.bottom() - 1); ++ty) {
+        for (int tx = tile_floor(grid_area.left()); tx <= tile_floor(grid_area.right() - 1); ++tx) {
+            DrawingCacheTile *tile = _getTile(level, tx, ty);
+            Geom::IntRect r = *Geom::intersect(grid_area, tile_area(tile->coord));
+
+            DrawingContext tct(tile->surface);
+            tct.translate(-level->origin[X], -level->origin[Y]);
+            tct.rectangle(r + level->origin);
+            tct.setOperator(CAIRO_OPERATOR_SOURCE);
+            tct.setSource(&source);
+            tct.fill();
+
+            cairo_rectangle_int_t clean = _convertRect(r);
+            cairo_region_union_rectangle(level->clean, &clean);
         }
-        ct.setSource(0,1,0,0.1);
-        ct.fill();
     }
-    ct.rectangle(*area);
-    ct.setSource(1,0,0,0.1);
-    ct.fill();
-    char *fn = g_strdup_printf("dump%d.png", dumpnr++);
-    cairo_surface_write_to_png(surface, fn);
-    cairo_surface_destroy(surface);
-    g_free(fn);
+
+    cairo_rectangle_int_t exact = _convertRect(area);
+    cairo_region_subtract_rectangle(_approximated, &exact);
+
+    _trimTiles();
+}
+
+DrawingCacheTile *
+DrawingCache::_getTile(DrawingCacheLevel *level, int tx, int ty)
+{
+    TileCoord c(tx, ty);
+    TileMap::iterator i = level->tiles.find(c);
+    if (i != level->tiles.end()) {
+        _touchTile(i->second);
+        return i->second;
+    }
+
+    DrawingCacheTile *tile = new DrawingCacheTile(level, c);
+    level->tiles.insert(std::make_pair(c, tile));
+    _drawing._cache_tiles.push_front(tile);
+    _drawing._cache_tiles_size += TILE_BYTES;
+    tile->lru = _drawing._cache_tiles.begin();
+    return tile;
+}
+
+void
+DrawingCache::_touchTile(DrawingCacheTile *tile)
+{
+    _drawing._cache_tiles.splice(_drawing._cache_tiles.begin(), _drawing._cache_tiles, tile->lru);
+}
+
+void
+DrawingCache::_dropTile(DrawingCacheTile *tile)
+{
+    DrawingCacheLevel *level = tile->level;
+    cairo_rectangle_int_t r = _convertRect(tile_area(tile->coord));
+    cairo_region_subtract_rectangle(level->clean, &r);
+    level->tiles.erase(tile->coord);
+    _drawing._cache_tiles.erase(tile->lru);
+    _drawing._cache_tiles_size -= TILE_BYTES;
+    delete tile;
+
+    // levels other than the current one are only useful while they have tiles
+    if (level->tiles.empty() && level != _levels.front()) {
+        _levels.remove(level);
+        delete level;
+    }
+}
+
+void
+DrawingCache::_dropLevel(DrawingCacheLevel *level)
+{
+    for (TileMap::iterator i = level->tiles.begin(); i != level->tiles.end(); ++i) {
+        _drawing._cache_tiles.erase(i->second->lru);
+        _drawing._cache_tiles_size -= TILE_BYTES;
+        delete i->second;
+    }
+    _levels.remove(level);
+    delete level;
+}
+
+/// Marks an area given in the current pixel space of the level as dirty
+/// and releases the tiles which no longer contain anything useful.
+void
+DrawingCache::_dirtyLevel(DrawingCacheLevel *level, Geom::IntRect const &area)
+{
+    Geom::IntRect grid_area = area - level->origin;
+    cairo_rectangle_int_t dirty = _convertRect(grid_area);
+    cairo_region_subtract_rectangle(level->clean, &dirty);
+
+    std::vector<DrawingCacheTile *> to_drop;
+    for (TileMap::iterator i = level->tiles.begin(); i != level->tiles.end(); ++i) {
+        if (grid_area.contains(tile_area(i->first))) {
+            to_drop.push_back(i->second);
+        }
+    }
+    for (unsigned i = 0; i < to_drop.size(); ++i) {
+        _dropTile(to_drop[i]);
+    }
+}
+
+/// Paints the given region of a level. The region and the user space
+/// of @a ct are in the tile grid coordinates of the level.
+void
+DrawingCache::_paintTiles(DrawingContext &ct, DrawingCacheLevel *level, cairo_region_t *region)
+{
+    cairo_rectangle_int_t extents;
+    cairo_region_get_extents(region, &extents);
+    Geom::IntRect bounds = _convertRect(extents);
+
+    for (int ty = tile_floor(bounds.top()); ty <= tile_floor(bounds.bottom() - 1); ++ty) {
+        for (int tx = tile_floor(bounds.left()); tx <= tile_floor(bounds.right() - 1); ++tx) {
+            TileMap::iterator i = level->tiles.find(TileCoord(tx, ty));
+            if (i == level->tiles.end()) continue;
+            DrawingCacheTile *tile = i->second;
+
+            cairo_rectangle_int_t r = _convertRect(tile_area(tile->coord));
+            cairo_region_t *tile_region = cairo_region_copy(region);
+            cairo_region_intersect_rectangle(tile_region, &r);
+            int nr = cairo_region_num_rectangles(tile_region);
+            if (nr > 0) {
+                cairo_rectangle_int_t tmp;
+                for (int k = 0; k < nr; ++k) {
+                    cairo_region_get_rectangle(tile_region, k, &tmp);
+                    ct.rectangle(_convertRect(tmp));
+                }
+                ct.setSource(&tile->surface);
+                ct.fill();
+                _touchTile(tile);
+            }
+            cairo_region_destroy(tile_region);
+        }
+    }
+}
+
+/// Paints an area of the current level from another level which has it entirely clean.
+/// Returns false if no such level exists or the area was already approximated once.
+bool
+DrawingCache::_paintApproximation(DrawingContext &ct, Geom::IntRect const &area)
+{
+    cairo_rectangle_int_t area_c = _convertRect(area);
+    if (cairo_region_contains_rectangle(_approximated, &area_c) != CAIRO_REGION_OVERLAP_OUT) {
+        // this is the exact redraw requested after the approximation
+        return false;
+    }
+
+    DrawingCacheLevel *current = _levels.front();
+    Geom::Affine to_item = current->ctm.inverse();
+    for (std::list<DrawingCacheLevel *>::iterator i = ++_levels.begin(); i != _levels.end(); ++i) {
+        DrawingCacheLevel *level = *i;
+        Geom::Affine rel = to_item * level->ctm;
+        if (rel.isSingular()) continue;
+
+        Geom::IntRect level_area = (Geom::Rect(area) * rel).roundOutwards() - level->origin;
+        cairo_rectangle_int_t level_c = _convertRect(level_area);
+        if (cairo_region_contains_rectangle(level->clean, &level_c) != CAIRO_REGION_OVERLAP_IN) {
+            continue;
+        }
+
+        {
+            Inkscape::DrawingContext::Save save(ct);
+            ct.rectangle(area);
+            ct.clip();
+            ct.transform(rel.inverse());
+            ct.translate(level->origin[X], level->origin[Y]);
+            cairo_region_t *region = cairo_region_create_rectangle(&level_c);
+            _paintTiles(ct, level, region);
+            cairo_region_destroy(region);
+        }
+
+        cairo_region_union_rectangle(_approximated, &area_c);
+        _drawing._requestRefresh(area);
+        return true;
+    }
+    return false;
+}
+
+/// Discards the least recently used tiles until the cache budget is respected.
+/// Tiles of the current level of this cache are kept, since they were just used.
+void
+DrawingCache::_trimTiles()
+{
+    DrawingCacheLevel *current = _levels.front();
+    while (_drawing._cache_tiles_size > _drawing._cache_budget && !_drawing._cache_tiles.empty()) {
+        DrawingCacheTile *tile = _drawing._cache_tiles.back();
+        if (tile->level == current) break;
+        // the tile can belong to a different item; find its owner through the level
+        tile->level->owner->_dropTile(tile);
+    }
 }
 
 cairo_rectangle_int_t
@@ -12,7 +12,9 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_SURFACE_H
 #define SEEN_INKSCAPE_DISPLAY_DRAWING_SURFACE_H
 
+#include <list>
 #include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <2geom/affine.h>
@@ -20,6 +22,7 @@
 #include <2geom/transforms.h>
 
 namespace Inkscape {
+class Drawing;
 class DrawingContext;
 
 class DrawingSurface
@@ -54,25 +57,48 @@ protected:
     friend class DrawingContext;
 };
 
+struct DrawingCacheLevel;
+struct DrawingCacheTile;
+
+/**
+ * Tiled rendering cache of a single drawing item.
+ *
+ * The cache keeps one level of tiles for each item transform it has seen,
+ * so zooming back to a previous zoom level reuses the earlier rendering.
+ * Tiles are evicted in least recently used order once the cache budget
+ * of the drawing is exhausted.
+ */
 class DrawingCache
-    : public DrawingSurface
+    : boost::noncopyable
 {
 public:
-    explicit DrawingCache(Geom::IntRect const &area);
+    DrawingCache(Drawing &drawing, Geom::Affine const &ctm);
     ~DrawingCache();
 
     void markDirty(Geom::IntRect const &area = Geom::IntRect::infinite());
-    void markClean(Geom::IntRect const &area = Geom::IntRect::infinite());
-    void scheduleTransform(Geom::IntRect const &new_area, Geom::Affine const &trans);
+    void scheduleTransform(Geom::Affine const &ctm);
     void prepare();
-    void paintFromCache(DrawingContext &ct, Geom::OptIntRect &area);
+    void paintFromCache(DrawingContext &ct, Geom::OptIntRect &area, bool approximate = false);
+    void storeTiles(DrawingSurface &source, Geom::IntRect const &area);
+
+    static const int TILE_SIZE = 128;
+    static const unsigned MAX_LEVELS = 8;
 
-protected:
-    cairo_region_t *_clean_region;
-    Geom::IntRect _pending_area;
-    Geom::Affine _pending_transform;
 private:
-    void _dumpCache(Geom::OptIntRect const &area);
+    DrawingCacheTile *_getTile(DrawingCacheLevel *level, int tx, int ty);
+    void _touchTile(DrawingCacheTile *tile);
+    void _dropTile(DrawingCacheTile *tile);
+    void _dropLevel(DrawingCacheLevel *level);
+    void _dirtyLevel(DrawingCacheLevel *level, Geom::IntRect const &area);
+    void _paintTiles(DrawingContext &ct, DrawingCacheLevel *level, cairo_region_t *region);
+    bool _paintApproximation(DrawingContext &ct, Geom::IntRect const &area);
+    void _trimTiles();
+
+    Drawing &_drawing;
+    std::list<DrawingCacheLevel *> _levels; ///< most recently used first; the front level is current
+    Geom::Affine _pending_ctm;
+    cairo_region_t *_approximated; ///< areas of the current level painted from other levels
+
     static cairo_rectangle_int_t _convertRect(Geom::IntRect const &r);
     static Geom::IntRect _convertRect(cairo_rectangle_int_t const &r);
 };
@@ -9,13 +9,49 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include <algorithm>
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "display/drawing.h"
+#include "display/render-prefs.h"
 #include "nr-filter-gaussian.h"
 #include "nr-filter-types.h"
 
 namespace Inkscape {
 
+#if HAVE_OPENMP
+namespace {
+
+struct RenderNestLock {
+    RenderNestLock() { omp_init_nest_lock(&lock); }
+    ~RenderNestLock() { omp_destroy_nest_lock(&lock); }
+    omp_nest_lock_t lock;
+};
+
+RenderNestLock render_lock;
+
+} // anonymous namespace
+#endif
+
+RenderLock::RenderLock()
+{
+#if HAVE_OPENMP
+    omp_set_nest_lock(&render_lock.lock);
+#endif
+}
+
+RenderLock::~RenderLock()
+{
+#if HAVE_OPENMP
+    omp_unset_nest_lock(&render_lock.lock);
+#endif
+}
+
 Drawing::Drawing(SPCanvasArena *arena)
     : _root(NULL)
     , outlinecolor(0x000000ff)
@@ -27,13 +63,19 @@ Drawing::Drawing(SPCanvasArena *arena)
     , _filter_quality(Filters::FILTER_QUALITY_BEST)
     , _cache_score_threshold(50000.0)
     , _cache_budget(0)
+    , _cache_tiles_size(0)
+    , _refresh_id(0)
     , _canvasarena(arena)
 {
-
+    // create the preference handles before any rendering thread reads them
+    RenderPrefs::get();
 }
 
 Drawing::~Drawing()
 {
+    if (_refresh_id) {
+        g_source_remove(_refresh_id);
+    }
     delete _root;
 }
 
@@ -162,6 +204,38 @@ Drawing::pick(Geom::Point const &p, double delta, unsigned flags)
     return NULL;
 }
 
+/**
+ * Schedules an exact redraw of an area that was painted from cache tiles
+ * of a different zoom level. Can be called from rendering threads,
+ * so the redraw is requested from the main loop.
+ */
+void
+Drawing::_requestRefresh(Geom::IntRect const &area)
+{
+    RenderLock lock;
+    _refresh_area.unionWith(area);
+    if (!_refresh_id) {
+        _refresh_id = g_idle_add(&Drawing::_refreshApproximated, this);
+    }
+}
+
+gboolean
+Drawing::_refreshApproximated(gpointer data)
+{
+    Drawing *drawing = static_cast<Drawing *>(data);
+    Geom::OptIntRect area;
+    {
+        RenderLock lock;
+        area = drawing->_refresh_area;
+        drawing->_refresh_area = Geom::OptIntRect();
+        drawing->_refresh_id = 0;
+    }
+    if (area) {
+        drawing->signal_request_render.emit(*area);
+    }
+    return FALSE;
+}
+
 void
 Drawing::_pickItemsForCaching()
 {
@@ -12,6 +12,7 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_H
 #define SEEN_INKSCAPE_DISPLAY_DRAWING_H
 
+#include <list>
 #include <set>
 #include <glib.h>
 #include <boost/operators.hpp>
@@ -28,6 +29,7 @@ typedef struct _SPCanvasArena SPCanvasArena;
 namespace Inkscape {
 
 class DrawingItem;
+struct DrawingCacheTile;
 
 class Drawing
     : boost::noncopyable
@@ -75,6 +77,8 @@ public:
 
 private:
     void _pickItemsForCaching();
+    void _requestRefresh(Geom::IntRect const &area);
+    static gboolean _refreshApproximated(gpointer data);
 
     typedef std::list<CacheRecord> CandidateList;
 
@@ -95,12 +99,32 @@ private:
 
     double _cache_score_threshold; ///< do not consider objects for caching below this score
     size_t _cache_budget; ///< maximum allowed size of cache
+    std::list<DrawingCacheTile *> _cache_tiles; ///< all cache tiles, most recently used first
+    size_t _cache_tiles_size; ///< memory used by cache tiles
+
+    Geom::OptIntRect _refresh_area; ///< area painted from approximate cache tiles
+    guint _refresh_id;
 
     OutlineColors _colors;
     SPCanvasArena *_canvasarena; // may be NULL is this arena is not the screen
                                  // but used for export etc.
 
     friend class DrawingItem;
+    friend class DrawingCache;
+};
+
+/**
+ * Scoped lock serializing changes to state that is shared between concurrently
+ * rendered tiles, such as item caches and lazily created paint server patterns.
+ * The lock is recursive, because creating a pattern tile renders a nested drawing.
+ * Without OpenMP this is a no-op.
+ */
+class RenderLock
+    : boost::noncopyable
+{
+public:
+    RenderLock();
+    ~RenderLock();
 };
 
 } // end namespace Inkscape
@@ -21,6 +21,7 @@
 
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
+#include "display/nr-filter-functors.h"
 #include "display/nr-filter-blend.h"
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-slot.h"
@@ -56,74 +57,6 @@ FilterPrimitive * FilterBlend::create() {
 FilterBlend::~FilterBlend()
 {}
 
-// cr = (1-qa)*cb + (1-qb)*ca + ca*cb
-struct BlendMultiply {
-    guint32 operator()(guint32 in1, guint32 in2)
-    {
-        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
-        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
-
-        guint32 ao = 255*255 - (255-aa)*(255-ab);        ao = (ao + 127) / 255;
-        guint32 ro = (255-aa)*rb + (255-ab)*ra + ra*rb;  ro = (ro + 127) / 255;
-        guint32 go = (255-aa)*gb + (255-ab)*ga + ga*gb;  go = (go + 127) / 255;
-        guint32 bo = (255-aa)*bb + (255-ab)*ba + ba*bb;  bo = (bo + 127) / 255;
-
-        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
-        return pxout;
-    }
-};
-
-// cr = cb + ca - ca * cb
-struct BlendScreen {
-    guint32 operator()(guint32 in1, guint32 in2)
-    {
-        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
-        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
-
-        guint32 ao = 255*255 - (255-aa)*(255-ab);    ao = (ao + 127) / 255;
-        guint32 ro = 255*(rb + ra) - ra * rb;        ro = (ro + 127) / 255;
-        guint32 go = 255*(gb + ga) - ga * gb;        go = (go + 127) / 255;
-        guint32 bo = 255*(bb + ba) - ba * bb;        bo = (bo + 127) / 255;
-
-        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
-        return pxout;
-    }
-};
-
-// cr = Min ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
-struct BlendDarken {
-    guint32 operator()(guint32 in1, guint32 in2)
-    {
-        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
-        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
-
-        guint32 ao = 255*255 - (255-aa)*(255-ab);                           ao = (ao + 127) / 255;
-        guint32 ro = std::min((255-aa)*rb + 255*ra, (255-ab)*ra + 255*rb);  ro = (ro + 127) / 255;
-        guint32 go = std::min((255-aa)*gb + 255*ga, (255-ab)*ga + 255*gb);  go = (go + 127) / 255;
-        guint32 bo = std::min((255-aa)*bb + 255*ba, (255-ab)*ba + 255*bb);  bo = (bo + 127) / 255;
-
-        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
-        return pxout;
-    }
-};
-
-// cr = Max ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
-struct BlendLighten {
-    guint32 operator()(guint32 in1, guint32 in2)
-    {
-        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
-        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
-
-        guint32 ao = 255*255 - (255-aa)*(255-ab);                           ao = (ao + 127) / 255;
-        guint32 ro = std::max((255-aa)*rb + 255*ra, (255-ab)*ra + 255*rb);  ro = (ro + 127) / 255;
-        guint32 go = std::max((255-aa)*gb + 255*ga, (255-ab)*ga + 255*gb);  go = (go + 127) / 255;
-        guint32 bo = std::max((255-aa)*bb + 255*ba, (255-ab)*ba + 255*bb);  bo = (bo + 127) / 255;
-
-        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
-        return pxout;
-    }
-};
-
 /*
 struct BlendAlpha
 static inline void blend_alpha(guint32 in1, guint32 in2, guint32 *out)
@@ -0,0 +1,241 @@
+/**
+ * @file
+ * Pixel functors of the filter primitives which have vectorized span kernels.
+ *//*
+ * Authors:
+ *   Niko Kiirala <niko@kiirala.com>
+ *   Jasper van de Gronde <th.v.d.gronde@hccnet.nl>
+ *   Felipe Corrêa da Silva Sanches <juca@members.fsf.org>
+ *
+ * Copyright (C) 2007-2012 authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_NR_FILTER_FUNCTORS_H
+#define SEEN_INKSCAPE_DISPLAY_NR_FILTER_FUNCTORS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "display/cairo-simd.h"
+#include "display/cairo-templates.h"
+#include "display/cairo-utils.h"
+
+namespace Inkscape {
+namespace Filters {
+
+/* The operator() of each functor is the reference implementation; its span
+ * overload hands whole spans to the kernel in display/cairo-simd.h, which must
+ * give the same results. They are kept here so that tests can compare the two. */
+
+// feBlend
+// For the formulas, see the comment in nr-filter-blend.cpp.
+
+// cr = (1-qa)*cb + (1-qb)*ca + ca*cb
+struct BlendMultiply {
+    friend void ink_cairo_blend_span(BlendMultiply &, guint32 *out, guint32 const *in1, guint32 const *in2, int n) {
+        ink_cairo_span_blend_multiply(out, in1, in2, n);
+    }
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+        guint32 ao = 255*255 - (255-aa)*(255-ab);        ao = (ao + 127) / 255;
+        guint32 ro = (255-aa)*rb + (255-ab)*ra + ra*rb;  ro = (ro + 127) / 255;
+        guint32 go = (255-aa)*gb + (255-ab)*ga + ga*gb;  go = (go + 127) / 255;
+        guint32 bo = (255-aa)*bb + (255-ab)*ba + ba*bb;  bo = (bo + 127) / 255;
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+};
+
+// cr = cb + ca - ca * cb
+struct BlendScreen {
+    friend void ink_cairo_blend_span(BlendScreen &, guint32 *out, guint32 const *in1, guint32 const *in2, int n) {
+        ink_cairo_span_blend_screen(out, in1, in2, n);
+    }
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+        guint32 ao = 255*255 - (255-aa)*(255-ab);    ao = (ao + 127) / 255;
+        guint32 ro = 255*(rb + ra) - ra * rb;        ro = (ro + 127) / 255;
+        guint32 go = 255*(gb + ga) - ga * gb;        go = (go + 127) / 255;
+        guint32 bo = 255*(bb + ba) - ba * bb;        bo = (bo + 127) / 255;
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+};
+
+// cr = Min ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+struct BlendDarken {
+    friend void ink_cairo_blend_span(BlendDarken &, guint32 *out, guint32 const *in1, guint32 const *in2, int n) {
+        ink_cairo_span_blend_darken(out, in1, in2, n);
+    }
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+        guint32 ao = 255*255 - (255-aa)*(255-ab);                           ao = (ao + 127) / 255;
+        guint32 ro = std::min((255-aa)*rb + 255*ra, (255-ab)*ra + 255*rb);  ro = (ro + 127) / 255;
+        guint32 go = std::min((255-aa)*gb + 255*ga, (255-ab)*ga + 255*gb);  go = (go + 127) / 255;
+        guint32 bo = std::min((255-aa)*bb + 255*ba, (255-ab)*ba + 255*bb);  bo = (bo + 127) / 255;
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+};
+
+// cr = Max ((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+struct BlendLighten {
+    friend void ink_cairo_blend_span(BlendLighten &, guint32 *out, guint32 const *in1, guint32 const *in2, int n) {
+        ink_cairo_span_blend_lighten(out, in1, in2, n);
+    }
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+        guint32 ao = 255*255 - (255-aa)*(255-ab);                           ao = (ao + 127) / 255;
+        guint32 ro = std::max((255-aa)*rb + 255*ra, (255-ab)*ra + 255*rb);  ro = (ro + 127) / 255;
+        guint32 go = std::max((255-aa)*gb + 255*ga, (255-ab)*ga + 255*gb);  go = (go + 127) / 255;
+        guint32 bo = std::max((255-aa)*bb + 255*ba, (255-ab)*ba + 255*bb);  bo = (bo + 127) / 255;
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+};
+
+// feComposite operator="arithmetic"
+
+struct ComposeArithmetic {
+    ComposeArithmetic(double k1, double k2, double k3, double k4)
+        : _k1(round(k1 * 255))
+        , _k2(round(k2 * 255*255))
+        , _k3(round(k3 * 255*255))
+        , _k4(round(k4 * 255*255*255))
+    {}
+    friend void ink_cairo_blend_span(ComposeArithmetic &c, guint32 *out, guint32 const *in1, guint32 const *in2, int n) {
+        gint32 const k[4] = { c._k1, c._k2, c._k3, c._k4 };
+        ink_cairo_span_compose_arithmetic(out, in1, in2, n, k);
+    }
+    guint32 operator()(guint32 in1, guint32 in2) {
+        EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+        gint32 ao = _k1*aa*ab + _k2*aa + _k3*ab + _k4;
+        gint32 ro = _k1*ra*rb + _k2*ra + _k3*rb + _k4;
+        gint32 go = _k1*ga*gb + _k2*ga + _k3*gb + _k4;
+        gint32 bo = _k1*ba*bb + _k2*ba + _k3*bb + _k4;
+
+        ao = pxclamp(ao, 0, 255*255*255); // r, g and b are premultiplied, so should be clamped to the alpha channel
+        ro = (pxclamp(ro, 0, ao) + (255*255/2)) / (255*255);
+        go = (pxclamp(go, 0, ao) + (255*255/2)) / (255*255);
+        bo = (pxclamp(bo, 0, ao) + (255*255/2)) / (255*255);
+        ao = (ao + (255*255/2)) / (255*255);
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+private:
+    gint32 _k1, _k2, _k3, _k4;
+};
+
+// feColorMatrix
+
+struct ColorMatrixMatrix {
+    ColorMatrixMatrix(std::vector<double> const &values) {
+        unsigned limit = std::min(static_cast<size_t>(20), values.size());
+        for (unsigned i = 0; i < limit; ++i) {
+            if (i % 5 == 4) {
+                _v[i] = round(values[i]*255*255);
+            } else {
+                _v[i] = round(values[i]*255);
+            }
+        }
+        for (unsigned i = limit; i < 20; ++i) {
+            _v[i] = 0;
+        }
+    }
+    friend void ink_cairo_filter_span(ColorMatrixMatrix &m, guint32 *out, guint32 const *in, int n) {
+        ink_cairo_span_color_matrix(out, in, n, m._v);
+    }
+
+    guint32 operator()(guint32 in) {
+        EXTRACT_ARGB32(in, a, r, g, b)
+        // we need to un-premultiply alpha values for this type of matrix
+        // TODO: unpremul can be ignored if there is an identity mapping on the alpha channel
+        if (a != 0) {
+            r = unpremul_alpha(r, a);
+            g = unpremul_alpha(g, a);
+            b = unpremul_alpha(b, a);
+        }
+
+        gint32 ro = r*_v[0]  + g*_v[1]  + b*_v[2]  + a*_v[3]  + _v[4];
+        gint32 go = r*_v[5]  + g*_v[6]  + b*_v[7]  + a*_v[8]  + _v[9];
+        gint32 bo = r*_v[10] + g*_v[11] + b*_v[12] + a*_v[13] + _v[14];
+        gint32 ao = r*_v[15] + g*_v[16] + b*_v[17] + a*_v[18] + _v[19];
+        ro = (pxclamp(ro, 0, 255*255) + 127) / 255;
+        go = (pxclamp(go, 0, 255*255) + 127) / 255;
+        bo = (pxclamp(bo, 0, 255*255) + 127) / 255;
+        ao = (pxclamp(ao, 0, 255*255) + 127) / 255;
+
+        ro = premul_alpha(ro, ao);
+        go = premul_alpha(go, ao);
+        bo = premul_alpha(bo, ao);
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        return pxout;
+    }
+private:
+    gint32 _v[20];
+};
+
+struct ColorMatrixSaturate {
+    ColorMatrixSaturate(double v_in) {
+        // clamp parameter instead of clamping color values
+        double v = CLAMP(v_in, 0.0, 1.0);
+        _v[0] = 0.213+0.787*v; _v[1] = 0.715-0.715*v; _v[2] = 0.072-0.072*v;
+        _v[3] = 0.213-0.213*v; _v[4] = 0.715+0.285*v; _v[5] = 0.072-0.072*v;
+        _v[6] = 0.213-0.213*v; _v[7] = 0.715-0.715*v; _v[8] = 0.072+0.928*v;
+    }
+    friend void ink_cairo_filter_span(ColorMatrixSaturate &m, guint32 *out, guint32 const *in, int n) {
+        ink_cairo_span_color_saturate(out, in, n, m._v);
+    }
+
+    guint32 operator()(guint32 in) {
+        EXTRACT_ARGB32(in, a, r, g, b)
+
+        // Note: this cannot be done in fixed point, because the loss of precision
+        //       causes overflow for some values of v
+        guint32 ro = r*_v[0] + g*_v[1] + b*_v[2] + 0.5;
+        guint32 go = r*_v[3] + g*_v[4] + b*_v[5] + 0.5;
+        guint32 bo = r*_v[6] + g*_v[7] + b*_v[8] + 0.5;
+
+        ASSEMBLE_ARGB32(pxout, a, ro, go, bo)
+        return pxout;
+    }
+private:
+    double _v[9];
+};
+
+} /* namespace Filters */
+} /* namespace Inkscape */
+
+#endif // !SEEN_INKSCAPE_DISPLAY_NR_FILTER_FUNCTORS_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -79,6 +79,10 @@ void FilterImage::render_cairo(FilterSlot &slot)
     if (from_element) {
         if (!SVGElem) return;
 
+        // the document and the display trees of its items are shared with the
+        // tiles rendered on other threads
+        RenderLock lock;
+
         // TODO: do not recreate the rendering tree every time
         // TODO: the entire thing is a hack, we should give filter primitives an "update" method
         //       like the one for DrawingItems
@@ -126,60 +130,65 @@ void FilterImage::render_cairo(FilterSlot &slot)
     }
 
     // External image, like <image>
-    if (!image && !broken_ref) {
-        broken_ref = true;
-        try {
-            /* TODO: If feImageHref is absolute, then use that (preferably handling the
-             * case that it's not a file URI).  Otherwise, go up the tree looking
-             * for an xml:base attribute, and use that as the base URI for resolving
-             * the relative feImageHref URI.  Otherwise, if document->base is valid,
-             * then use that as the base URI.  Otherwise, use feImageHref directly
-             * (i.e. interpreting it as relative to our current working directory).
-             * (See http://www.w3.org/TR/xmlbase/#resolution .) */
-            gchar *fullname = feImageHref;
-            if ( !g_file_test( fullname, G_FILE_TEST_EXISTS ) ) {
-                // Try to load from relative postion combined with document base
-                if( document ) {
-                    fullname = g_build_filename( document->getBase(), feImageHref, NULL );
+    {
+        // tiles rendered concurrently share the loaded image
+        RenderLock lock;
+        if (!image && !broken_ref) {
+            broken_ref = true;
+            try {
+                /* TODO: If feImageHref is absolute, then use that (preferably handling the
+                 * case that it's not a file URI).  Otherwise, go up the tree looking
+                 * for an xml:base attribute, and use that as the base URI for resolving
+                 * the relative feImageHref URI.  Otherwise, if document->base is valid,
+                 * then use that as the base URI.  Otherwise, use feImageHref directly
+                 * (i.e. interpreting it as relative to our current working directory).
+                 * (See http://www.w3.org/TR/xmlbase/#resolution .) */
+                gchar *fullname = feImageHref;
+                if ( !g_file_test( fullname, G_FILE_TEST_EXISTS ) ) {
+                    // Try to load from relative postion combined with document base
+                    if( document ) {
+                        fullname = g_build_filename( document->getBase(), feImageHref, NULL );
+                    }
+                }
+                if ( !g_file_test( fullname, G_FILE_TEST_EXISTS ) ) {
+                    // Should display Broken Image png.
+                    g_warning("FilterImage::render: Can not find: %s", feImageHref  );
+                    return;
                 }
+                image = Gdk::Pixbuf::create_from_file(fullname);
+                if( fullname != feImageHref ) g_free( fullname );
             }
-            if ( !g_file_test( fullname, G_FILE_TEST_EXISTS ) ) {
-                // Should display Broken Image png.
-                g_warning("FilterImage::render: Can not find: %s", feImageHref  );
+            catch (const Glib::FileError & e)
+            {
+                g_warning("caught Glib::FileError in FilterImage::render: %s", e.what().data() );
                 return;
             }
-            image = Gdk::Pixbuf::create_from_file(fullname);
-            if( fullname != feImageHref ) g_free( fullname );
-        }
-        catch (const Glib::FileError & e)
-        {
-            g_warning("caught Glib::FileError in FilterImage::render: %s", e.what().data() );
-            return;
-        }
-        catch (const Gdk::PixbufError & e)
-        {
-            g_warning("Gdk::PixbufError in FilterImage::render: %s", e.what().data() );
-            return;
-        }
-        if ( !image ) return;
+            catch (const Gdk::PixbufError & e)
+            {
+                g_warning("Gdk::PixbufError in FilterImage::render: %s", e.what().data() );
+                return;
+            }
+            if ( !image ) return;
 
-        broken_ref = false;
+            broken_ref = false;
 
-        bool has_alpha = image->get_has_alpha();
-        if (!has_alpha) {
-            image = image->add_alpha(false, 0, 0, 0);
-        }
+            bool has_alpha = image->get_has_alpha();
+            if (!has_alpha) {
+                image = image->add_alpha(false, 0, 0, 0);
+            }
 
-        // Native size of image
-        // width = image->get_width();
-        // height = image->get_height();
-        // rowstride = image->get_rowstride();
+            // Native size of image
+            // width = image->get_width();
+            // height = image->get_height();
+            // rowstride = image->get_rowstride();
 
-        convert_pixbuf_normal_to_argb32(image->gobj());
+            convert_pixbuf_normal_to_argb32(image->gobj());
 
-        image_surface = cairo_image_surface_create_for_data(image->get_pixels(),
-            CAIRO_FORMAT_ARGB32, image->get_width(), image->get_height(), image->get_rowstride());
+            image_surface = cairo_image_surface_create_for_data(image->get_pixels(),
+                CAIRO_FORMAT_ARGB32, image->get_width(), image->get_height(), image->get_rowstride());
+        }
     }
+    if (!image) return;
 
     Geom::Rect sa = slot.get_slot_area();
     cairo_surface_t *out = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
@@ -19,6 +19,7 @@
 
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
+#include "display/drawing.h"
 #include "display/nr-filter.h"
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
@@ -375,12 +376,16 @@ void FilterTurbulence::render_cairo(FilterSlot &slot)
     cairo_surface_t *input = slot.getcairo(_input);
     cairo_surface_t *out = ink_cairo_surface_create_same_size(input, CAIRO_CONTENT_COLOR_ALPHA);
 
-    if (!gen->ready()) {
-        Geom::Point ta(fTileX, fTileY);
-        Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
-        gen->init(seed, Geom::Rect(ta, tb),
-            Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
-            type == TURBULENCE_FRACTALNOISE, numOctaves);
+    {
+        // tiles rendered concurrently share the generator
+        Inkscape::RenderLock lock;
+        if (!gen->ready()) {
+            Geom::Point ta(fTileX, fTileY);
+            Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
+            gen->init(seed, Geom::Rect(ta, tb),
+                Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
+                type == TURBULENCE_FRACTALNOISE, numOctaves);
+        }
     }
 
     Geom::Affine unit_trans = slot.get_units().get_matrix_primitiveunits2pb().inverse();
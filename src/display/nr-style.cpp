@@ -9,10 +9,12 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <glib.h>
 #include "display/nr-style.h"
 #include "style.h"
 #include "sp-paint-server.h"
 #include "display/canvas-bpath.h" // contains SPStrokeJoinType, SPStrokeCapType etc. (WTF!)
+#include "display/drawing.h"
 #include "display/drawing-context.h"
 
 void NRStyle::Paint::clear()
@@ -150,17 +152,25 @@ void NRStyle::set(SPStyle *style)
 bool NRStyle::prepareFill(Inkscape::DrawingContext &ct, Geom::OptRect const &paintbox)
 {
     // update fill pattern
-    if (!fill_pattern) {
-        switch (fill.type) {
-        case PAINT_SERVER: {
-            fill_pattern = sp_paint_server_create_pattern(fill.server, ct.raw(), paintbox, fill.opacity);
-            } break;
-        case PAINT_COLOR: {
-            SPColor const &c = fill.color;
-            fill_pattern = cairo_pattern_create_rgba(
-                c.v.c[0], c.v.c[1], c.v.c[2], fill.opacity);
-            } break;
-        default: break;
+    // Tiles rendered concurrently share the pattern. Once created it stays until update(),
+    // which never runs during rendering, so only its creation needs the lock.
+    if (!g_atomic_pointer_get(&fill_pattern)) {
+        Inkscape::RenderLock lock;
+        if (!fill_pattern) {
+            cairo_pattern_t *pattern = NULL;
+            switch (fill.type) {
+            case PAINT_SERVER: {
+                pattern = sp_paint_server_create_pattern(fill.server, ct.raw(), paintbox, fill.opacity);
+                } break;
+            case PAINT_COLOR: {
+                SPColor const &c = fill.color;
+                pattern = cairo_pattern_create_rgba(
+                    c.v.c[0], c.v.c[1], c.v.c[2], fill.opacity);
+                } break;
+            default: break;
+            }
+            // publish the pattern only once it is complete
+            g_atomic_pointer_set(&fill_pattern, pattern);
         }
     }
     if (!fill_pattern) return false;
@@ -175,17 +185,23 @@ void NRStyle::applyFill(Inkscape::DrawingContext &ct)
 
 bool NRStyle::prepareStroke(Inkscape::DrawingContext &ct, Geom::OptRect const &paintbox)
 {
-    if (!stroke_pattern) {
-        switch (stroke.type) {
-        case PAINT_SERVER: {
-            stroke_pattern = sp_paint_server_create_pattern(stroke.server, ct.raw(), paintbox, stroke.opacity);
-            } break;
-        case PAINT_COLOR: {
-            SPColor const &c = stroke.color;
-            stroke_pattern = cairo_pattern_create_rgba(
-                c.v.c[0], c.v.c[1], c.v.c[2], stroke.opacity);
-            } break;
-        default: break;
+    // created like the fill pattern, see prepareFill()
+    if (!g_atomic_pointer_get(&stroke_pattern)) {
+        Inkscape::RenderLock lock;
+        if (!stroke_pattern) {
+            cairo_pattern_t *pattern = NULL;
+            switch (stroke.type) {
+            case PAINT_SERVER: {
+                pattern = sp_paint_server_create_pattern(stroke.server, ct.raw(), paintbox, stroke.opacity);
+                } break;
+            case PAINT_COLOR: {
+                SPColor const &c = stroke.color;
+                pattern = cairo_pattern_create_rgba(
+                    c.v.c[0], c.v.c[1], c.v.c[2], stroke.opacity);
+                } break;
+            default: break;
+            }
+            g_atomic_pointer_set(&stroke_pattern, pattern);
         }
     }
     if (!stroke_pattern) return false;
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * Preferences read while rendering.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+#include "display/render-prefs.h"
+
+namespace Inkscape {
+
+namespace {
+
+int default_num_threads()
+{
+#if HAVE_OPENMP
+    return omp_get_num_procs();
+#else
+    return 1;
+#endif
+}
+
+} // anonymous namespace
+
+RenderPrefs::RenderPrefs()
+    : num_threads("/options/threading/numthreads", default_num_threads(), 1, 256)
+    , clip_color("/options/wireframecolors/clips", 0x00ff00ff) // green clips
+    , mask_color("/options/wireframecolors/masks", 0x0000ffff) // blue masks
+    , image_color("/options/wireframecolors/images", 0xff0000ff)
+{}
+
+RenderPrefs const &
+RenderPrefs::get()
+{
+    static RenderPrefs const prefs;
+    return prefs;
+}
+
+} // end namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
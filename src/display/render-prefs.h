@@ -0,0 +1,53 @@
+/**
+ * @file
+ * Preferences read while rendering.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_RENDER_PREFS_H
+#define SEEN_INKSCAPE_DISPLAY_RENDER_PREFS_H
+
+#include <boost/utility.hpp>
+#include "preferences.h"
+
+namespace Inkscape {
+
+/**
+ * Handles to the preferences which are read on rendering threads.
+ *
+ * Creating a PrefHandle registers an observer with the preferences, which must
+ * not happen on several threads at once. The handles are therefore created
+ * together, by the first call to get(); every Drawing makes that call from its
+ * constructor, so it happens on the main thread before anything is rendered.
+ */
+class RenderPrefs
+    : boost::noncopyable
+{
+public:
+    static RenderPrefs const &get();
+
+    PrefHandle<int> num_threads;   ///< Threads used by filters and blending
+    PrefHandle<int> clip_color;    ///< Outline color of clipping paths
+    PrefHandle<int> mask_color;    ///< Outline color of masks
+    PrefHandle<int> image_color;   ///< Outline color of images
+
+private:
+    RenderPrefs();
+};
+
+} // end namespace Inkscape
+
+#endif // !SEEN_INKSCAPE_DISPLAY_RENDER_PREFS_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -96,6 +96,12 @@ struct _SPCanvasItemClass {
      *  how to do this).
      */
     void (*destroy)  (SPCanvasItem *object);
+
+    /* TRUE if render() may be called concurrently from several threads,
+     * each with its own buffer. Items that leave this unset are rendered
+     * one at a time.
+     */
+    gboolean concurrent_render;
 };
 
 /**
@@ -19,7 +19,13 @@
 # include <config.h>
 #endif
 
+#include <algorithm>
 #include <cairomm/region.h>
+#include <vector>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include "helper/sp-marshal.h"
 #include <2geom/rect.h>
@@ -51,6 +57,20 @@ static bool const HAS_BROKEN_MOTION_HINTS =
 // If any part of it is dirtied, the entire tile is dirtied (its int is nonzero) and repainted.
 #define TILE_SIZE 16
 
+// The backing store extends this many pixels beyond the visible area on each side,
+// so that short scrolls and scrolling back reuse pixels that were already rendered.
+#define BACKING_STORE_MARGIN (16 * TILE_SIZE)
+
+inline int sp_canvas_tile_floor(int x)
+{
+    return (x & (~(TILE_SIZE - 1))) / TILE_SIZE;
+}
+
+inline int sp_canvas_tile_ceil(int x)
+{
+    return ((x + (TILE_SIZE - 1)) & (~(TILE_SIZE - 1))) / TILE_SIZE;
+}
+
 /**
  * The SPCanvasGroup vtable.
  */
@@ -251,6 +271,11 @@ public:
      */
     static void unrealize(GtkWidget *widget);
 
+    /**
+     * The canvas widget's unmap callback.
+     */
+    static void unmap(GtkWidget *widget);
+
     /**
      * The canvas widget's size request callback.
      */
@@ -319,6 +344,17 @@ public:
      */
     static void sp_canvas_resize_tiles(SPCanvas* canvas, int nl, int nt, int nr, int nb);
 
+    /**
+     * Helper that makes sure the backing store covers the visible area of the given size,
+     * recentering it when the view leaves it. With force, it is recentered unconditionally.
+     */
+    static void sp_canvas_ensure_backing_store(SPCanvas *canvas, int width, int height, bool force);
+
+    /**
+     * Helper that copies a part of the backing store to a context drawing on the canvas window.
+     */
+    static void sp_canvas_blit_backing_store(SPCanvas *canvas, cairo_t *xct, Geom::IntRect const &area);
+
     /**
      * Helper that queues a canvas rectangle for redraw
      */
@@ -336,6 +372,28 @@ public:
 
     static void sp_canvas_paint_single_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect, int sw);
 
+    /**
+     * Paints several buffers at once, rendering them concurrently on worker threads
+     * and blitting the results to the window in order.
+     */
+    static void sp_canvas_paint_buffers(SPCanvas *canvas, std::vector<Geom::IntRect> const &rects, Geom::IntRect const &canvas_rect);
+
+    /**
+     * Returns a new pattern with the widget background color.
+     */
+    static cairo_pattern_t *sp_canvas_create_background(SPCanvas *canvas);
+
+    /**
+     * Renders canvas items into the part of the backing store covered by paint_rect.
+     * Does not touch the widget, so it can be called from worker threads.
+     */
+    static void sp_canvas_render_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect, cairo_pattern_t *background);
+
+    /**
+     * Applies display color correction to a rendered buffer and copies it to the window.
+     */
+    static void sp_canvas_blit_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect);
+
     /**
      * Paint the given rect, recursively subdividing the region until it is the size of a single
      * buffer.
@@ -1048,6 +1106,7 @@ void SPCanvasGroup::classInit(SPCanvasGroupClass *klass)
     item_class->render = SPCanvasGroup::render;
     item_class->point = SPCanvasGroup::point;
     item_class->viewbox_changed = SPCanvasGroup::viewboxChanged;
+    item_class->concurrent_render = TRUE;
 }
 
 void SPCanvasGroup::init(SPCanvasGroup * /*group*/)
@@ -1158,8 +1217,17 @@ void SPCanvasGroup::render(SPCanvasItem *item, SPCanvasBuf *buf)
                 (child->y1 < buf->rect.bottom()) &&
                 (child->x2 > buf->rect.left()) &&
                 (child->y2 > buf->rect.top())) {
-                if (SP_CANVAS_ITEM_GET_CLASS(child)->render) {
-                    SP_CANVAS_ITEM_GET_CLASS(child)->render(child, buf);
+                SPCanvasItemClass *child_class = SP_CANVAS_ITEM_GET_CLASS(child);
+                if (child_class->render) {
+                    if (child_class->concurrent_render) {
+                        child_class->render(child, buf);
+                    } else {
+                        // controls and guides keep lazily built state; draw them one at a time
+                        #if HAVE_OPENMP
+                        #pragma omp critical (sp_canvas_item_render)
+                        #endif
+                        child_class->render(child, buf);
+                    }
                 }
             }
         }
@@ -1256,6 +1324,7 @@ void SPCanvasImpl::classInit(SPCanvasClass *klass)
 
     widget_class->realize = SPCanvasImpl::realize;
     widget_class->unrealize = SPCanvasImpl::unrealize;
+    widget_class->unmap = SPCanvasImpl::unmap;
 
 #if GTK_CHECK_VERSION(3,0,0)
     widget_class->get_preferred_width = SPCanvasImpl::getPreferredWidth;
@@ -1306,6 +1375,7 @@ void SPCanvasImpl::init(SPCanvas *canvas)
     canvas->tiles=NULL;
     canvas->tLeft=canvas->tTop=canvas->tRight=canvas->tBottom=0;
     canvas->tileH=canvas->tileV=0;
+    canvas->backing_store=NULL;
 
     canvas->forced_redraw_count = 0;
     canvas->forced_redraw_limit = -1;
@@ -1336,10 +1406,7 @@ void SPCanvasImpl::shutdown_transients(SPCanvas *canvas)
     if (canvas->need_redraw) {
         canvas->need_redraw = FALSE;
     }
-    if ( canvas->tiles ) g_free(canvas->tiles);
-    canvas->tiles=NULL;
-    canvas->tLeft=canvas->tTop=canvas->tRight=canvas->tBottom=0;
-    canvas->tileH=canvas->tileV=0;
+    sp_canvas_resize_tiles(canvas, 0, 0, 0, 0);
 
     if (canvas->grabbed_item) {
         canvas->grabbed_item = NULL;
@@ -1462,6 +1529,18 @@ void SPCanvasImpl::unrealize(GtkWidget *widget)
         (* GTK_WIDGET_CLASS(parentClass)->unrealize)(widget);
 }
 
+void SPCanvasImpl::unmap(GtkWidget *widget)
+{
+    SPCanvas *canvas = SP_CANVAS (widget);
+
+    // Redraw requests are not recorded while the canvas is hidden,
+    // so the stored pixels cannot be trusted once it is shown again
+    sp_canvas_resize_tiles(canvas, 0, 0, 0, 0);
+
+    if (GTK_WIDGET_CLASS(parentClass)->unmap)
+        (* GTK_WIDGET_CLASS(parentClass)->unmap)(widget);
+}
+
 
 #if GTK_CHECK_VERSION(3,0,0)
 void SPCanvasImpl::getPreferredWidth(GtkWidget *widget, gint *minimum_width, gint *natural_width)
@@ -1501,22 +1580,15 @@ void SPCanvasImpl::sizeAllocate(GtkWidget *widget, GtkAllocation *allocation)
     Geom::IntRect new_area = Geom::IntRect::from_xywh(canvas->x0, canvas->y0,
         allocation->width, allocation->height);
 
-    // Schedule redraw of new region
-    sp_canvas_resize_tiles(canvas,canvas->x0,canvas->y0,canvas->x0+allocation->width,canvas->y0+allocation->height);
+    // Resize the backing store; the newly exposed region is scheduled for redraw
+    bool resized = (allocation->width != widg_allocation.width) ||
+                   (allocation->height != widg_allocation.height);
+    sp_canvas_ensure_backing_store(canvas, allocation->width, allocation->height, resized);
     if (SP_CANVAS_ITEM_GET_CLASS (canvas->root)->viewbox_changed)
         SP_CANVAS_ITEM_GET_CLASS (canvas->root)->viewbox_changed (canvas->root, new_area);
-    
-    if (allocation->width > widg_allocation.width) {
-        canvas->requestRedraw(canvas->x0 + widg_allocation.width,
-                              0,
-                              canvas->x0 + allocation->width,
-                              canvas->y0 + allocation->height);
-    }
-    if (allocation->height > widg_allocation.height) {
-        canvas->requestRedraw(0,
-                              canvas->y0 + widg_allocation.height,
-                              canvas->x0 + allocation->width,
-                              canvas->y0 + allocation->height);
+
+    if (canvas->need_redraw) {
+        add_idle(canvas);
     }
 
     gtk_widget_set_allocation (widget, allocation);
@@ -1886,58 +1958,42 @@ int SPCanvasImpl::handleMotion(GtkWidget *widget, GdkEventMotion *event)
     return status;
 }
 
-void SPCanvasImpl::sp_canvas_paint_single_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect, int /*sw*/)
+cairo_pattern_t *SPCanvasImpl::sp_canvas_create_background(SPCanvas *canvas)
 {
     GtkWidget *widget = GTK_WIDGET (canvas);
 
-    // Mark the region clean
-    sp_canvas_mark_rect(canvas, paint_rect, 0);
-
-    SPCanvasBuf buf;
-    buf.buf = NULL;
-    buf.buf_rowstride = 0;
-    buf.rect = paint_rect;
-    buf.visible_rect = canvas_rect;
-    buf.is_empty = true;
-    //buf.ct = gdk_cairo_create(widget->window);
-
-    /*
-    cairo_t *xctt = gdk_cairo_create(widget->window);
-    cairo_translate(xctt, paint_rect.left() - canvas->x0, paint_rect.top() - canvas->y0);
-    cairo_set_source_rgb(xctt, 1,0,0);
-    cairo_rectangle(xctt, 0, 0, paint_rect.width(), paint_rect.height());
-    cairo_fill(xctt);
-    cairo_destroy(xctt);
-    //
-    */
-
-    // create temporary surface
-    cairo_surface_t *imgs = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, paint_rect.width(), paint_rect.height());
-    buf.ct = cairo_create(imgs);
-    //cairo_translate(buf.ct, -x0, -y0);
-
-    // fix coordinates, clip all drawing to the tile and clear the background
-    //cairo_translate(buf.ct, paint_rect.left() - canvas->x0, paint_rect.top() - canvas->y0);
-    //cairo_rectangle(buf.ct, 0, 0, paint_rect.width(), paint_rect.height());
-    //cairo_set_line_width(buf.ct, 3);
-    //cairo_set_source_rgba(buf.ct, 1.0, 0.0, 0.0, 0.1);
-    //cairo_stroke_preserve(buf.ct);
-    //cairo_clip(buf.ct);
-
 #if GTK_CHECK_VERSION(3,0,0)
     GtkStyleContext *context = gtk_widget_get_style_context(widget);
     GdkRGBA color;
     gtk_style_context_get_background_color(context,
                                            gtk_widget_get_state_flags(widget),
                                            &color);
-    gdk_cairo_set_source_rgba(buf.ct, &color);
+    return cairo_pattern_create_rgba(color.red, color.green, color.blue, color.alpha);
 #else
     GtkStyle *style = gtk_widget_get_style (widget);
-    gdk_cairo_set_source_color(buf.ct, &style->bg[GTK_STATE_NORMAL]);
+    GdkColor const &color = style->bg[GTK_STATE_NORMAL];
+    return cairo_pattern_create_rgb(color.red / 65535.0, color.green / 65535.0, color.blue / 65535.0);
 #endif
+}
 
+void SPCanvasImpl::sp_canvas_render_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect, cairo_pattern_t *background)
+{
+    SPCanvasBuf buf;
+    buf.buf = NULL;
+    buf.buf_rowstride = 0;
+    buf.rect = paint_rect;
+    buf.visible_rect = canvas_rect;
+    buf.is_empty = true;
+
+    // draw straight into the backing store; the subsurface puts the origin at the buffer corner
+    cairo_surface_t *target = cairo_surface_create_for_rectangle(canvas->backing_store,
+        paint_rect.left() - canvas->tLeft * TILE_SIZE, paint_rect.top() - canvas->tTop * TILE_SIZE,
+        paint_rect.width(), paint_rect.height());
+    buf.ct = cairo_create(target);
+
+    // clear the background
+    cairo_set_source(buf.ct, background);
     cairo_set_operator(buf.ct, CAIRO_OPERATOR_SOURCE);
-    //cairo_rectangle(buf.ct, 0, 0, paint_rect.width(), paint_rec.height());
     cairo_paint(buf.ct);
     cairo_set_operator(buf.ct, CAIRO_OPERATOR_OVER);
 
@@ -1945,8 +2001,13 @@ void SPCanvasImpl::sp_canvas_paint_single_buffer(SPCanvas *canvas, Geom::IntRect
         SP_CANVAS_ITEM_GET_CLASS (canvas->root)->render (canvas->root, &buf);
     }
 
-    // output to X
     cairo_destroy(buf.ct);
+    cairo_surface_destroy(target);
+}
+
+void SPCanvasImpl::sp_canvas_blit_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect)
+{
+    GtkWidget *widget = GTK_WIDGET (canvas);
 
 #if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
     if (canvas->enable_cms_display_adj) {
@@ -1960,32 +2021,79 @@ void SPCanvasImpl::sp_canvas_paint_single_buffer(SPCanvas *canvas, Geom::IntRect
         }
         
         if (transf) {
-            cairo_surface_flush(imgs);
-            unsigned char *px = cairo_image_surface_get_data(imgs);
-            int stride = cairo_image_surface_get_stride(imgs);
+            int x = paint_rect.left() - canvas->tLeft * TILE_SIZE;
+            int y = paint_rect.top() - canvas->tTop * TILE_SIZE;
+            cairo_surface_flush(canvas->backing_store);
+            unsigned char *px = cairo_image_surface_get_data(canvas->backing_store);
+            int stride = cairo_image_surface_get_stride(canvas->backing_store);
             for (int i=0; i<paint_rect.height(); ++i) {
-                unsigned char *row = px + i*stride;
+                unsigned char *row = px + (y + i)*stride + x*4;
                 Inkscape::CMSSystem::doTransform(transf, row, row, paint_rect.width());
             }
-            cairo_surface_mark_dirty(imgs);
+            cairo_surface_mark_dirty_rectangle(canvas->backing_store, x, y, paint_rect.width(), paint_rect.height());
         }
     }
 #endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
 
+    // output to X
     cairo_t *xct = gdk_cairo_create(gtk_widget_get_window (widget));
-    cairo_translate(xct, paint_rect.left() - canvas->x0, paint_rect.top() - canvas->y0);
-    cairo_rectangle(xct, 0, 0, paint_rect.width(), paint_rect.height());
+    sp_canvas_blit_backing_store(canvas, xct, paint_rect);
+    cairo_destroy(xct);
+}
+
+void SPCanvasImpl::sp_canvas_blit_backing_store(SPCanvas *canvas, cairo_t *xct, Geom::IntRect const &area)
+{
+    if (!canvas->backing_store) return;
+
+    cairo_save(xct);
+    cairo_rectangle(xct, area.left() - canvas->x0, area.top() - canvas->y0, area.width(), area.height());
     cairo_clip(xct);
-    cairo_set_source_surface(xct, imgs, 0, 0);
+    cairo_set_source_surface(xct, canvas->backing_store,
+                             canvas->tLeft * TILE_SIZE - canvas->x0, canvas->tTop * TILE_SIZE - canvas->y0);
     cairo_set_operator(xct, CAIRO_OPERATOR_SOURCE);
     cairo_paint(xct);
-    cairo_destroy(xct);
-    cairo_surface_destroy(imgs);
+    cairo_restore(xct);
+}
+
+void SPCanvasImpl::sp_canvas_paint_single_buffer(SPCanvas *canvas, Geom::IntRect const &paint_rect, Geom::IntRect const &canvas_rect, int /*sw*/)
+{
+    // Mark the region clean
+    sp_canvas_mark_rect(canvas, paint_rect, 0);
 
-    //cairo_surface_t *cst = cairo_get_target(buf.ct);
-    //cairo_destroy (buf.ct);
-    //cairo_surface_finish (cst);
-    //cairo_surface_destroy (cst);
+    cairo_pattern_t *background = sp_canvas_create_background(canvas);
+    sp_canvas_render_buffer(canvas, paint_rect, canvas_rect, background);
+    cairo_pattern_destroy(background);
+
+    sp_canvas_blit_buffer(canvas, paint_rect);
+}
+
+void SPCanvasImpl::sp_canvas_paint_buffers(SPCanvas *canvas, std::vector<Geom::IntRect> const &rects, Geom::IntRect const &canvas_rect)
+{
+    int const n = rects.size();
+
+    // Mark the regions clean before rendering, so that redraw requests
+    // issued while rendering are not lost
+    for (int i = 0; i < n; ++i) {
+        sp_canvas_mark_rect(canvas, rects[i], 0);
+    }
+
+    // GTK may only be called from the main thread, so read the style here
+    cairo_pattern_t *background = sp_canvas_create_background(canvas);
+
+    // The buffers are disjoint parts of the backing store
+    #if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+    #pragma omp parallel for schedule(dynamic) num_threads(numOfThreads)
+    #endif
+    for (int i = 0; i < n; ++i) {
+        sp_canvas_render_buffer(canvas, rects[i], canvas_rect, background);
+    }
+    cairo_pattern_destroy(background);
+
+    for (int i = 0; i < n; ++i) {
+        sp_canvas_blit_buffer(canvas, rects[i]);
+    }
 }
 
 namespace {
@@ -1995,9 +2103,44 @@ struct PaintRectSetup {
     Geom::IntRect big_rect;
     GTimeVal start_time;
     int max_pixels;
+    int num_threads;
     Geom::Point mouse_loc;
 };
 
+/**
+ * Splits a rectangle into buffers of at most max_pixels, cutting along tile boundaries.
+ */
+void split_into_buffers(Geom::IntRect const &rect, int max_pixels, std::vector<Geom::IntRect> &out)
+{
+    int bw = rect.width();
+    int bh = rect.height();
+    if (bw * bh < max_pixels) {
+        out.push_back(rect);
+        return;
+    }
+
+    if (bw < bh || bh < 2 * TILE_SIZE) {
+        int mid = rect[Geom::X].middle();
+        mid = (mid / TILE_SIZE) * TILE_SIZE;
+        if (mid <= rect.left()) {
+            // too narrow to cut on a tile boundary
+            out.push_back(rect);
+            return;
+        }
+        split_into_buffers(Geom::IntRect(rect.left(), rect.top(), mid, rect.bottom()), max_pixels, out);
+        split_into_buffers(Geom::IntRect(mid, rect.top(), rect.right(), rect.bottom()), max_pixels, out);
+    } else {
+        int mid = rect[Geom::Y].middle();
+        mid = (mid / TILE_SIZE) * TILE_SIZE;
+        if (mid <= rect.top()) {
+            out.push_back(rect);
+            return;
+        }
+        split_into_buffers(Geom::IntRect(rect.left(), rect.top(), rect.right(), mid), max_pixels, out);
+        split_into_buffers(Geom::IntRect(rect.left(), mid, rect.right(), rect.bottom()), max_pixels, out);
+    }
+}
+
 }// namespace
 
 int SPCanvasImpl::sp_canvas_paint_rect_internal(PaintRectSetup const *setup, Geom::IntRect const &this_rect)
@@ -2059,6 +2202,15 @@ int SPCanvasImpl::sp_canvas_paint_rect_internal(PaintRectSetup const *setup, Geo
         return 1;
     }
 
+    if (setup->num_threads > 1 && bw * bh < setup->max_pixels * setup->num_threads) {
+        // Enough work to keep every thread busy with one buffer: render the buffers
+        // concurrently and count the whole batch as a single time slice
+        std::vector<Geom::IntRect> rects;
+        split_into_buffers(this_rect, setup->max_pixels, rects);
+        sp_canvas_paint_buffers(setup->canvas, rects, setup->big_rect);
+        return 1;
+    }
+
     Geom::IntRect lo, hi;
 
 /*
@@ -2159,6 +2311,13 @@ bool SPCanvasImpl::sp_canvas_paint_rect(SPCanvas *canvas, int xx0, int yy0, int
         setup.max_pixels = 262144;
     }
 
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    setup.num_threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    setup.num_threads = 1;
+#endif
+
     // Start the clock
     g_get_current_time(&(setup.start_time));
 
@@ -2189,7 +2348,12 @@ gboolean SPCanvasImpl::handleDraw(GtkWidget *widget, cairo_t *cr) {
                 canvas->x0, canvas->y0,
                 width, height);
 
-	canvas->requestRedraw(r.left(), r.top(), r.right(), r.bottom());
+	// Dirty parts of the backing store are already scheduled for rendering
+	sp_canvas_blit_backing_store(canvas, cr, r);
+	if (canvas->need_redraw || !canvas->backing_store) {
+	    canvas->need_redraw = TRUE;
+	    add_idle(canvas);
+	}
 
 	return FALSE;
 }
@@ -2220,6 +2384,8 @@ gint SPCanvasImpl::handleExpose(GtkWidget *widget, GdkEventExpose *event)
     }
     else
     {
+        // Dirty parts of the backing store are already scheduled for rendering
+        cairo_t *xct = gdk_cairo_create(getWindow(canvas));
         for (int i = 0; i < n_rects; i++) {
 #if GTK_CHECK_VERSION(3,0,0)
 		cairo_rectangle_int_t rectangle;
@@ -2232,7 +2398,13 @@ gint SPCanvasImpl::handleExpose(GtkWidget *widget, GdkEventExpose *event)
                 rectangle.x + canvas->x0, rectangle.y + canvas->y0,
                 rectangle.width, rectangle.height);
             
-            canvas->requestRedraw(r.left(), r.top(), r.right(), r.bottom());
+            sp_canvas_blit_backing_store(canvas, xct, r);
+        }
+        cairo_destroy(xct);
+
+        if (canvas->need_redraw || !canvas->backing_store) {
+            canvas->need_redraw = TRUE;
+            add_idle(canvas);
         }
        
 #if !GTK_CHECK_VERSION(3,0,0)	
@@ -2296,10 +2468,27 @@ int SPCanvasImpl::paint(SPCanvas *canvas)
         return TRUE;
     }
 
+    GtkAllocation allocation;
+    gtk_widget_get_allocation (GTK_WIDGET (canvas), &allocation);
+    if (!canvas->backing_store) {
+        // the backing store is dropped when the canvas is unmapped
+        sp_canvas_ensure_backing_store(canvas, allocation.width, allocation.height, true);
+        if (!canvas->backing_store) {
+            return TRUE;
+        }
+    }
+
+    // Only visible tiles are painted; dirty tiles in the margin of the backing store
+    // are painted once they are scrolled into view
+    int tl = std::max(canvas->tLeft, sp_canvas_tile_floor(canvas->x0));
+    int tt = std::max(canvas->tTop, sp_canvas_tile_floor(canvas->y0));
+    int tr = std::min(canvas->tRight, sp_canvas_tile_ceil(canvas->x0 + allocation.width));
+    int tb = std::min(canvas->tBottom, sp_canvas_tile_ceil(canvas->y0 + allocation.height));
+
     Cairo::RefPtr<Cairo::Region> to_paint = Cairo::Region::create();
 
-    for (int j=canvas->tTop; j<canvas->tBottom; j++) {
-        for (int i=canvas->tLeft; i<canvas->tRight; i++) {
+    for (int j=tt; j<tb; j++) {
+        for (int i=tl; i<tr; i++) {
             int tile_index = (i - canvas->tLeft) + (j - canvas->tTop)*canvas->tileH;
 
             if ( canvas->tiles[tile_index] ) { // if this tile is dirtied (nonzero)
@@ -2416,21 +2605,28 @@ void SPCanvas::scrollTo(double cx, double cy, unsigned int clear, bool is_scroll
 
     gtk_widget_get_allocation(&widget, &allocation);
 
-    SPCanvasImpl::sp_canvas_resize_tiles(this, x0, y0, x0 + allocation.width, y0 + allocation.height);
+    // The backing store only moves when the view leaves it
+    SPCanvasImpl::sp_canvas_ensure_backing_store(this, allocation.width, allocation.height, false);
     if (SP_CANVAS_ITEM_GET_CLASS(root)->viewbox_changed) {
         SP_CANVAS_ITEM_GET_CLASS(root)->viewbox_changed(root, new_area);
     }
 
     if (!clear) {
-        // scrolling without zoom; redraw only the newly exposed areas
+        // scrolling without zoom; the window contents are shifted and the exposed
+        // areas are copied from the backing store, so only its dirty tiles need rendering
         if ((dx != 0) || (dy != 0)) {
             this->is_scrolling = is_scrolling;
             if (gtk_widget_get_realized(GTK_WIDGET(this))) {
                 gdk_window_scroll(getWindow(this), -dx, -dy);
             }
+            need_redraw = TRUE;
+            SPCanvasImpl::add_idle(this);
         }
     } else {
-        // scrolling as part of zoom; do nothing here - the next do_update will perform full redraw
+        // scrolling as part of zoom; the stored pixels are at the old scale
+        Geom::IntRect stored(tLeft * TILE_SIZE, tTop * TILE_SIZE, tRight * TILE_SIZE, tBottom * TILE_SIZE);
+        SPCanvasImpl::sp_canvas_dirty_rect(this, stored);
+        SPCanvasImpl::add_idle(this);
     }
 }
 
@@ -2449,8 +2645,6 @@ void SPCanvasImpl::requestCanvasUpdate(SPCanvas *canvas)
 
 void SPCanvas::requestRedraw(int x0, int y0, int x1, int y1)
 {
-    GtkAllocation allocation;
-
     if (!gtk_widget_is_drawable( GTK_WIDGET(this) )) {
         return;
     }
@@ -2459,12 +2653,11 @@ void SPCanvas::requestRedraw(int x0, int y0, int x1, int y1)
     }
 
     Geom::IntRect bbox(x0, y0, x1, y1);
-    gtk_widget_get_allocation(GTK_WIDGET(this), &allocation);
 
-    Geom::IntRect canvas_rect = Geom::IntRect::from_xywh(this->x0, this->y0,
-                                                         allocation.width, allocation.height);
-    
-    Geom::OptIntRect clip = bbox & canvas_rect;
+    // Pixels in the margin of the backing store are kept as well, so they must be invalidated
+    Geom::IntRect stored_rect(tLeft * TILE_SIZE, tTop * TILE_SIZE, tRight * TILE_SIZE, tBottom * TILE_SIZE);
+
+    Geom::OptIntRect clip = bbox & stored_rect;
     if (clip) {
         SPCanvasImpl::sp_canvas_dirty_rect(this, *clip);
         SPCanvasImpl::add_idle(this);
@@ -2562,23 +2755,15 @@ Geom::IntRect SPCanvas::getViewboxIntegers() const
     return ret;
 }
 
-inline int sp_canvas_tile_floor(int x)
-{
-    return (x & (~(TILE_SIZE - 1))) / TILE_SIZE;
-}
-
-inline int sp_canvas_tile_ceil(int x)
-{
-    return ((x + (TILE_SIZE - 1)) & (~(TILE_SIZE - 1))) / TILE_SIZE;
-}
-
 void SPCanvasImpl::sp_canvas_resize_tiles(SPCanvas* canvas, int nl, int nt, int nr, int nb)
 {
     if ( nl >= nr || nt >= nb ) {
         if ( canvas->tiles ) g_free(canvas->tiles);
+        if ( canvas->backing_store ) cairo_surface_destroy(canvas->backing_store);
         canvas->tLeft=canvas->tTop=canvas->tRight=canvas->tBottom=0;
         canvas->tileH=canvas->tileV=0;
         canvas->tiles=NULL;
+        canvas->backing_store=NULL;
         return;
     }
     int tl=sp_canvas_tile_floor(nl);
@@ -2586,26 +2771,71 @@ void SPCanvasImpl::sp_canvas_resize_tiles(SPCanvas* canvas, int nl, int nt, int
     int tr=sp_canvas_tile_ceil(nr);
     int tb=sp_canvas_tile_ceil(nb);
 
+    if ( canvas->backing_store && tl == canvas->tLeft && tt == canvas->tTop &&
+         tr == canvas->tRight && tb == canvas->tBottom ) {
+        return;
+    }
+
     int nh = tr-tl, nv = tb-tt;
+    bool exposed = false;
     uint8_t* ntiles = (uint8_t*)g_malloc(nh*nv*sizeof(uint8_t));
     for (int i=tl; i<tr; i++) {
         for (int j=tt; j<tb; j++) {
             int ind = (i-tl) + (j-tt)*nh;
-            if ( i >= canvas->tLeft && i < canvas->tRight && j >= canvas->tTop && j < canvas->tBottom ) {
+            if ( canvas->backing_store && i >= canvas->tLeft && i < canvas->tRight && j >= canvas->tTop && j < canvas->tBottom ) {
                 ntiles[ind]=canvas->tiles[(i-canvas->tLeft)+(j-canvas->tTop)*canvas->tileH]; // copy from the old tile
             } else {
-                ntiles[ind]=0; // newly exposed areas get 0
+                ntiles[ind]=1; // newly exposed areas have no pixels in the backing store yet
+                exposed = true;
             }
         }
     }
+
+    // Move the pixels that are still covered over to the new backing store
+    cairo_surface_t *nstore = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, nh*TILE_SIZE, nv*TILE_SIZE);
+    if ( canvas->backing_store ) {
+        cairo_t *ct = cairo_create(nstore);
+        cairo_set_source_surface(ct, canvas->backing_store,
+                                 (canvas->tLeft-tl)*TILE_SIZE, (canvas->tTop-tt)*TILE_SIZE);
+        cairo_set_operator(ct, CAIRO_OPERATOR_SOURCE);
+        cairo_paint(ct);
+        cairo_destroy(ct);
+        cairo_surface_destroy(canvas->backing_store);
+    }
+
     if ( canvas->tiles ) g_free(canvas->tiles);
     canvas->tiles=ntiles;
+    canvas->backing_store=nstore;
     canvas->tLeft=tl;
     canvas->tTop=tt;
     canvas->tRight=tr;
     canvas->tBottom=tb;
     canvas->tileH=nh;
     canvas->tileV=nv;
+
+    if (exposed) {
+        canvas->need_redraw = TRUE;
+    }
+}
+
+void SPCanvasImpl::sp_canvas_ensure_backing_store(SPCanvas *canvas, int width, int height, bool force)
+{
+    if (width <= 0 || height <= 0) {
+        sp_canvas_resize_tiles(canvas, 0, 0, 0, 0);
+        return;
+    }
+
+    Geom::IntRect visible = Geom::IntRect::from_xywh(canvas->x0, canvas->y0, width, height);
+    Geom::IntRect stored(canvas->tLeft * TILE_SIZE, canvas->tTop * TILE_SIZE,
+                         canvas->tRight * TILE_SIZE, canvas->tBottom * TILE_SIZE);
+
+    if (!force && canvas->backing_store && stored.contains(visible)) {
+        return;
+    }
+
+    sp_canvas_resize_tiles(canvas,
+                           visible.left() - BACKING_STORE_MARGIN, visible.top() - BACKING_STORE_MARGIN,
+                           visible.right() + BACKING_STORE_MARGIN, visible.bottom() + BACKING_STORE_MARGIN);
 }
 
 void SPCanvasImpl::sp_canvas_dirty_rect(SPCanvas* canvas, Geom::IntRect const &area) {
@@ -134,6 +134,9 @@ struct SPCanvas {
     int    tileH, tileV;
     uint8_t *tiles;
 
+    /** Rendered pixels of the area covered by the tiles, kept across scrolls. */
+    cairo_surface_t *backing_store;
+
     /** Last known modifier state, for deferred repick when a button is down. */
     int state;
 
@@ -63,6 +63,7 @@ struct SPDocumentPrivate {
 	bool sensitive: true; /* If we save actions to undo stack */
 	Inkscape::XML::Event * partial; /* partial undo log when interrupted */
 	int history_size;
+	gsize history_memory; /* Bytes accounted to the undo and redo stacks */
 	GSList * undo; /* Undo stack of reprs */
 	GSList * redo; /* Redo stack of reprs */
 
@@ -0,0 +1,275 @@
+#ifndef SEEN_DOCUMENT_UNDO_TEST_H
+#define SEEN_DOCUMENT_UNDO_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <gtkmm/main.h>
+
+#include "test-helpers.h"
+
+#include "document-private.h"
+#include "document-undo.h"
+#include "event.h"
+#include "event-log.h"
+#include "preferences.h"
+#include "verbs.h"
+#include "xml/event-fns.h"
+#include "xml/node.h"
+
+class DocumentUndoTest : public CxxTest::TestSuite
+{
+public:
+    SPDocument* _doc;
+    std::vector<std::string> _values;
+
+    DocumentUndoTest() :
+        _doc(0)
+    {
+    }
+
+    virtual ~DocumentUndoTest()
+    {
+        if ( _doc )
+        {
+            _doc->doUnref();
+        }
+    }
+
+    static void createSuiteSubclass( DocumentUndoTest *& dst )
+    {
+        dst = new DocumentUndoTest();
+    }
+
+    static DocumentUndoTest *createSuite()
+    {
+        // The event log keeps its rows in a Gtk::TreeStore
+        Gtk::Main::init_gtkmm_internals();
+        return Inkscape::createSuiteAndDocument<DocumentUndoTest>( createSuiteSubclass );
+    }
+
+    static void destroySuite( DocumentUndoTest *suite ) { delete suite; }
+
+    // Every test starts from a fresh document, so that the accounting starts at zero
+    void setUp()
+    {
+        if ( _doc )
+        {
+            _doc->doUnref();
+        }
+        _doc = SPDocument::createNewDoc( NULL, TRUE, true );
+        _values.clear();
+        setBudget(0, 1 << 20); // no limit, no packing
+    }
+
+    void tearDown()
+    {
+        setBudget(128, 16); // the defaults
+    }
+
+// -------------------------------------------------------------------------
+// -------------------------------------------------------------------------
+
+    void testDropsOldestSteps()
+    {
+        setBudget(1, 1 << 20);
+        int const steps = 20;
+        for ( int i = 0; i < steps; i++ ) {
+            pushStep(100 * 1024);
+        }
+
+        SPDocumentPrivate &priv = *_doc->priv;
+        TS_ASSERT_LESS_THAN( priv.history_size, steps );
+        TS_ASSERT_LESS_THAN( 1, priv.history_size );
+        TS_ASSERT_EQUALS( priv.history_size, static_cast<int>(g_slist_length(priv.undo)) );
+        TS_ASSERT( priv.history_memory <= 1 << 20 );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+
+        // The steps kept are the most recent ones
+        int const kept = priv.history_size;
+        for ( int i = 0; i < kept; i++ ) {
+            TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+        }
+        TS_ASSERT( !Inkscape::DocumentUndo::undo(_doc) );
+        TS_ASSERT_EQUALS( std::string(value()), _values[steps - kept - 1] );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+    }
+
+    void testKeepsNewestStep()
+    {
+        setBudget(1, 1 << 20);
+        pushStep(1024);
+        pushStep(2 << 20); // larger than the budget on its own
+
+        SPDocumentPrivate &priv = *_doc->priv;
+        TS_ASSERT_EQUALS( 1, priv.history_size );
+        TS_ASSERT( priv.history_memory > 1 << 20 );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+
+        TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+        TS_ASSERT_EQUALS( std::string(value()), _values[0] );
+        TS_ASSERT( Inkscape::DocumentUndo::redo(_doc) );
+        TS_ASSERT_EQUALS( std::string(value()), _values[1] );
+    }
+
+    void testAccountingUndoRedo()
+    {
+        SPDocumentPrivate &priv = *_doc->priv;
+        TS_ASSERT_EQUALS( 0u, priv.history_memory );
+
+        for ( int i = 0; i < 4; i++ ) {
+            pushStep(1000 + i);
+        }
+        gsize const pushed = priv.history_memory;
+        TS_ASSERT( pushed > 0 );
+        TS_ASSERT_EQUALS( pushed, accounted() );
+
+        // Undone steps move to the redo stack and are still accounted
+        TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+        TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+        TS_ASSERT_EQUALS( pushed, priv.history_memory );
+        TS_ASSERT( Inkscape::DocumentUndo::redo(_doc) );
+        TS_ASSERT_EQUALS( pushed, priv.history_memory );
+        TS_ASSERT_EQUALS( pushed, accounted() );
+
+        // A new step drops the redo stack
+        pushStep(10);
+        TS_ASSERT( priv.history_memory < pushed );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+
+        Inkscape::DocumentUndo::clearUndo(_doc);
+        TS_ASSERT_EQUALS( 0u, priv.history_memory );
+    }
+
+    void testAccountingPacked()
+    {
+        setBudget(0, 1);
+        for ( int i = 0; i < 6; i++ ) {
+            pushStep(4000 + i);
+        }
+
+        SPDocumentPrivate &priv = *_doc->priv;
+        Inkscape::Event *packed = static_cast<Inkscape::Event *>(g_slist_nth_data(priv.undo, 1));
+        TS_ASSERT( packed && !packed->packed.empty() );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+
+        // Undoing unpacks the steps again
+        for ( int i = 0; i < 6; i++ ) {
+            TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+            TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+        }
+        TS_ASSERT( !value() );
+        for ( int i = 0; i < 6; i++ ) {
+            TS_ASSERT( Inkscape::DocumentUndo::redo(_doc) );
+            TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+        }
+        TS_ASSERT_EQUALS( std::string(value()), _values.back() );
+    }
+
+    void testAccountingCoalesce()
+    {
+        SPDocumentPrivate &priv = *_doc->priv;
+        pushStep(500);
+        gsize const single = priv.history_memory;
+
+        // Steps with the same key are merged into the most recent one
+        pushStep(3000, "undo-test");
+        pushStep(2000, "undo-test");
+        pushStep(100, "undo-test");
+        TS_ASSERT_EQUALS( 2, priv.history_size );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+        TS_ASSERT( priv.history_memory > single );
+
+        TS_ASSERT( Inkscape::DocumentUndo::undo(_doc) );
+        TS_ASSERT_EQUALS( std::string(value()), _values[0] );
+        TS_ASSERT_EQUALS( priv.history_memory, accounted() );
+    }
+
+    void testExpiredEventPromotesBranchChild()
+    {
+        Inkscape::EventLog log(_doc);
+        _doc->addUndoObserver(log);
+        Glib::RefPtr<Gtk::TreeModel> rows = log.getEventListStore();
+        Inkscape::EventLog::EventModelColumns const &columns = log.getColumns();
+
+        // Steps of the same type are grouped under the first one
+        pushStep(500 * 1024);
+        pushStep(1);
+        pushStep(1);
+        TS_ASSERT_EQUALS( 2u, rows->children().size() ); // initial pseudo event and the branch
+        Gtk::TreeModel::iterator branch = ++rows->children().begin();
+        TS_ASSERT_EQUALS( 2u, branch->children().size() );
+        Inkscape::Event *second = (*branch->children().begin())[columns.event];
+        Inkscape::Event *third = (*++branch->children().begin())[columns.event];
+
+        // Only the first step has to go to get back within the budget
+        setBudget(1, 1 << 20);
+        pushStep(40 * 1024, NULL, SP_VERB_DIALOG_XML_EDITOR);
+        TS_ASSERT_EQUALS( 3, _doc->priv->history_size );
+
+        // The first child of the branch took the place of the dropped step
+        TS_ASSERT_EQUALS( 3u, rows->children().size() );
+        branch = ++rows->children().begin();
+        TS_ASSERT_EQUALS( (Inkscape::Event *)(*branch)[columns.event], second );
+        TS_ASSERT_EQUALS( 1u, branch->children().size() );
+        TS_ASSERT_EQUALS( (Inkscape::Event *)(*branch->children().begin())[columns.event], third );
+        TS_ASSERT_EQUALS( 2, (int)(*branch)[columns.child_count] );
+        TS_ASSERT( log.getCurrEvent() == --rows->children().end() );
+
+        _doc->removeUndoObserver(log);
+    }
+
+// -------------------------------------------------------------------------
+// -------------------------------------------------------------------------
+
+private:
+    static void setBudget(int memory, int pack_after)
+    {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        prefs->setInt("/options/undo/memory", memory);
+        prefs->setInt("/options/undo/packafter", pack_after);
+    }
+
+    gchar const *value()
+    {
+        return _doc->getReprRoot()->attribute("inkscape:undo-test");
+    }
+
+    /// Commits a step that sets a test attribute to a new value of the given length
+    void pushStep(std::size_t length, gchar const *key = NULL, unsigned type = SP_VERB_NONE)
+    {
+        std::string value(length, 'a' + _values.size() % 26);
+        _values.push_back(value);
+        _doc->getReprRoot()->setAttribute("inkscape:undo-test", value.c_str());
+        Inkscape::DocumentUndo::maybeDone(_doc, key, type, "undo test");
+    }
+
+    /// Bytes the undo and redo stacks should be accounted for
+    gsize accounted()
+    {
+        gsize total = 0;
+        GSList *stacks[] = { _doc->priv->undo, _doc->priv->redo };
+        for ( unsigned i = 0; i < G_N_ELEMENTS(stacks); i++ ) {
+            for ( GSList *l = stacks[i]; l; l = l->next ) {
+                Inkscape::Event *event = static_cast<Inkscape::Event *>(l->data);
+                total += sp_repr_log_size(event->event) + event->packed.size();
+            }
+        }
+        return total;
+    }
+};
+
+
+#endif // SEEN_DOCUMENT_UNDO_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
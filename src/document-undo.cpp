@@ -64,9 +64,11 @@
 #include "inkscape.h"
 #include "document-undo.h"
 #include "debug/event-tracker.h"
+#include "debug/heap.h"
 #include "debug/simple-event.h"
 #include "debug/timestamp.h"
 #include "event.h"
+#include "preferences.h"
 
 
 /*
@@ -148,6 +150,90 @@ public:
     }
 };
 
+/// Bytes accounted to the undo histories of all documents
+std::size_t undo_history_memory = 0;
+
+class UndoHistoryHeap : public Inkscape::Debug::Heap {
+public:
+    int features() const {
+        return SIZE_AVAILABLE | USED_AVAILABLE;
+    }
+    Inkscape::Util::ptr_shared<char> name() const {
+        return share_static_string("undo history");
+    }
+    Heap::Stats stats() const {
+        Stats stats;
+        stats.size = undo_history_memory;
+        stats.bytes_used = undo_history_memory;
+        return stats;
+    }
+    void force_collect() {}
+};
+
+void register_undo_history_heap()
+{
+    static bool is_registered = false;
+    if (!is_registered) {
+        Inkscape::Debug::register_extra_heap(*new UndoHistoryHeap());
+        is_registered = true;
+    }
+}
+
+void set_event_size(SPDocumentPrivate &priv, Inkscape::Event *event, std::size_t size)
+{
+    // unsigned arithmetic also handles shrinking events
+    priv.history_memory += size - event->size;
+    undo_history_memory += size - event->size;
+    event->size = size;
+}
+
+/// Restores the values of a packed event before it is undone, redone or extended.
+void unpack_event(SPDocumentPrivate &priv, Inkscape::Event *event)
+{
+    if (event->packed.empty()) {
+        return;
+    }
+    sp_repr_unpack_log(event->event, event->packed);
+    std::string().swap(event->packed);
+    set_event_size(priv, event, sp_repr_log_size(event->event));
+}
+
+/**
+ * Keeps the undo history within its memory budget. A step is packed when it is
+ * pushed below the most recent ones, which are likely to be undone soon; once the
+ * budget is exceeded, the oldest steps are dropped, but the most recent one is
+ * always kept.
+ */
+void trim_history(SPDocumentPrivate &priv)
+{
+    static Inkscape::PrefHandle<int> const budget("/options/undo/memory", 128, 0, 4095); // MiB, 0 for no limit
+    static Inkscape::PrefHandle<int> const pack_after("/options/undo/packafter", 16, 1, 1 << 20); // steps
+
+    // each step passes this depth once while new steps are pushed
+    GSList *packable = g_slist_nth(priv.undo, pack_after);
+    if (packable) {
+        Inkscape::Event *event = (Inkscape::Event *)packable->data;
+        if (event->packed.empty() && sp_repr_pack_log(event->event, event->packed)) {
+            set_event_size(priv, event, sp_repr_log_size(event->event) + event->packed.size());
+        }
+    }
+
+    if (budget <= 0) {
+        return;
+    }
+    gsize const limit = gsize(budget) << 20;
+    while (priv.history_memory > limit && priv.undo && priv.undo->next) {
+        GSList *oldest = g_slist_last(priv.undo);
+        Inkscape::Event *event = (Inkscape::Event *)oldest->data;
+        priv.undo = g_slist_delete_link(priv.undo, oldest);
+        priv.history_size--;
+        priv.undoStackObservers.notifyUndoExpiredEvent(event);
+
+        set_event_size(priv, event, 0);
+        delete event;
+    }
+}
+
 }
 
 void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const unsigned int event_type,
@@ -177,15 +263,25 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const
 	}
 
 	if (key && !doc->actionkey.empty() && (doc->actionkey == key) && doc->priv->undo) {
-                ((Inkscape::Event *)doc->priv->undo->data)->event =
-                    sp_repr_coalesce_log (((Inkscape::Event *)doc->priv->undo->data)->event, log);
+                Inkscape::Event *event = (Inkscape::Event *)doc->priv->undo->data;
+                unpack_event(*doc->priv, event);
+
+                // only the most recent action of the step may be merged with the new log
+                Inkscape::XML::Event *rest = event->event ? event->event->next : NULL;
+                std::size_t const replaced = sp_repr_log_size(event->event, rest) + sp_repr_log_size(log);
+                event->event = sp_repr_coalesce_log (event->event, log);
+                set_event_size(*doc->priv, event, event->size - replaced + sp_repr_log_size(event->event, rest));
 	} else {
                 Inkscape::Event *event = new Inkscape::Event(log, event_type, event_description);
                 doc->priv->undo = g_slist_prepend (doc->priv->undo, event);
 		doc->priv->history_size++;
+                register_undo_history_heap();
+                set_event_size(*doc->priv, event, sp_repr_log_size(log));
 		doc->priv->undoStackObservers.notifyUndoCommitEvent(event);
 	}
 
+        trim_history(*doc->priv);
+
         if ( key ) {
             doc->actionkey = key;
         } else {
@@ -226,6 +322,7 @@ static void finish_incomplete_transaction(SPDocument &doc) {
 		sp_repr_debug_print_log(priv.partial);
                 Inkscape::Event *event = new Inkscape::Event(priv.partial);
 		priv.undo = g_slist_prepend(priv.undo, event);
+                set_event_size(priv, event, sp_repr_log_size(event->event));
                 priv.undoStackObservers.notifyUndoCommitEvent(event);
 		priv.partial = NULL;
 	}
@@ -254,6 +351,7 @@ gboolean Inkscape::DocumentUndo::undo(SPDocument *doc)
 	if (doc->priv->undo) {
 		Inkscape::Event *log=(Inkscape::Event *)doc->priv->undo->data;
 		doc->priv->undo = g_slist_remove (doc->priv->undo, log);
+		unpack_event(*doc->priv, log);
 		sp_repr_undo_log (log->event);
 		doc->priv->redo = g_slist_prepend (doc->priv->redo, log);
 
@@ -299,6 +397,7 @@ gboolean Inkscape::DocumentUndo::redo(SPDocument *doc)
 	if (doc->priv->redo) {
 		Inkscape::Event *log=(Inkscape::Event *)doc->priv->redo->data;
 		doc->priv->redo = g_slist_remove (doc->priv->redo, log);
+		unpack_event(*doc->priv, log);
 		sp_repr_replay_log (log->event);
 		doc->priv->undo = g_slist_prepend (doc->priv->undo, log);
 
@@ -333,6 +432,7 @@ void Inkscape::DocumentUndo::clearUndo(SPDocument *doc)
 		doc->priv->undo = current->next;
 		doc->priv->history_size--;
 
+                set_event_size(*doc->priv, (Inkscape::Event *) current->data, 0);
                 delete ((Inkscape::Event *) current->data);
 		g_slist_free_1 (current);
 	}
@@ -350,6 +450,7 @@ void Inkscape::DocumentUndo::clearRedo(SPDocument *doc)
 		doc->priv->redo = current->next;
 		doc->priv->history_size--;
 
+                set_event_size(*doc->priv, (Inkscape::Event *) current->data, 0);
                 delete ((Inkscape::Event *) current->data);
 		g_slist_free_1 (current);
 	}
@@ -46,6 +46,7 @@
 #include "widgets/desktop-widget.h"
 #include "desktop.h"
 #include "dir-util.h"
+#include "display/drawing-group.h"
 #include "display/drawing-item.h"
 #include "document-private.h"
 #include "document-undo.h"
@@ -62,6 +63,7 @@
 #include "sp-namedview.h"
 #include "sp-object-repr.h"
 #include "sp-symbol.h"
+#include "style.h"
 #include "transf_mat_3x4.h"
 #include "unit-constants.h"
 #include "xml/repr.h"
@@ -95,6 +97,7 @@ SPDocument::SPDocument() :
     rroot(0),
     root(0),
     style_cascade(cr_cascade_new(NULL, NULL, NULL)),
+    style_index(NULL),
     uri(0),
     base(0),
     name(0),
@@ -125,6 +128,7 @@ SPDocument::SPDocument() :
     p->sensitive = FALSE;
     p->partial = NULL;
     p->history_size = 0;
+    p->history_memory = 0;
     p->undo = NULL;
     p->redo = NULL;
     p->seeking = false;
@@ -180,6 +184,7 @@ SPDocument::~SPDocument() {
         priv = NULL;
     }
 
+    sp_style_sheet_changed(this);
     cr_cascade_unref(style_cascade);
     style_cascade = NULL;
 
@@ -1085,21 +1090,85 @@ static bool overlaps(Geom::Rect const &area, Geom::Rect const &box)
     return area.intersects(box);
 }
 
+/**
+Puts the children of group whose display bounding boxes intersect area into children,
+in z-order. The area is in display coordinates. Uses the spatial index of the group's
+drawing item; returns false if group is not shown under dkey or its drawing is not up
+to date, in which case the caller has to look at all children.
+ */
+static bool find_children_in_display_area(SPGroup *group, unsigned int dkey, Geom::Rect const &area,
+                                          std::vector<SPItem *> &children)
+{
+    Inkscape::DrawingGroup *arenagroup = dynamic_cast<Inkscape::DrawingGroup *>(group->get_arenaitem(dkey));
+    std::vector<Inkscape::DrawingItem *> found;
+    if (!arenagroup || !arenagroup->findChildren(area, found)) {
+        return false;
+    }
+    for (std::vector<Inkscape::DrawingItem *>::iterator i = found.begin(); i != found.end(); ++i) {
+        SPItem *child = static_cast<SPItem *>((*i)->data());
+        if (child && child->parent == group) {
+            children.push_back(child);
+        }
+    }
+    return true;
+}
+
+/**
+Same as find_children_in_display_area() for an area in desktop coordinates.
+ */
+static bool find_children_in_desktop_area(SPGroup *group, unsigned int dkey, Geom::Rect const &area,
+                                          std::vector<SPItem *> &children)
+{
+    // the desktop to display transform is the same for every item; take it from any shown child
+    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
+        if (!SP_IS_ITEM(o)) {
+            continue;
+        }
+        Inkscape::DrawingItem *arenaitem = SP_ITEM(o)->get_arenaitem(dkey);
+        if (arenaitem) {
+            Geom::Affine i2dt = SP_ITEM(o)->i2dt_affine();
+            if (i2dt.isSingular()) {
+                return false;
+            }
+            Geom::Rect display_area = area * (i2dt.inverse() * arenaitem->ctm());
+            // display bounding boxes are rounded to whole pixels
+            display_area.expandBy(1);
+            return find_children_in_display_area(group, dkey, display_area, children);
+        }
+    }
+    return false;
+}
+
+static void get_item_children(SPGroup *group, std::vector<SPItem *> &children)
+{
+    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
+        if ( SP_IS_ITEM(o) ) {
+            children.push_back(SP_ITEM(o));
+        }
+    }
+}
+
+/**
+Prepends the items in area to s; the result lists them in reverse document order.
+ */
 static GSList *find_items_in_area(GSList *s, SPGroup *group, unsigned int dkey, Geom::Rect const &area,
                                   bool (*test)(Geom::Rect const &, Geom::Rect const &), bool take_insensitive = false)
 {
     g_return_val_if_fail(SP_IS_GROUP(group), s);
 
-    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
-        if ( SP_IS_ITEM(o) ) {
-            if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) == SPGroup::LAYER ) {
-                s = find_items_in_area(s, SP_GROUP(o), dkey, area, test);
-            } else {
-                SPItem *child = SP_ITEM(o);
-                Geom::OptRect box = child->desktopVisualBounds();
-                if ( box && test(area, *box) && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
-                    s = g_slist_append(s, child);
-                }
+    std::vector<SPItem *> children;
+    if (!find_children_in_desktop_area(group, dkey, area, children)) {
+        get_item_children(group, children);
+    }
+
+    for (std::vector<SPItem *>::iterator i = children.begin(); i != children.end(); ++i) {
+        SPItem *child = *i;
+        if (SP_IS_GROUP(child) && SP_GROUP(child)->effectiveLayerMode(dkey) == SPGroup::LAYER ) {
+            s = find_items_in_area(s, SP_GROUP(child), dkey, area, test);
+        } else {
+            Geom::OptRect box = child->desktopVisualBounds();
+            if ( box && test(area, *box) && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
+                s = g_slist_prepend(s, child);
             }
         }
     }
@@ -1168,6 +1237,29 @@ static SPItem *find_item_at_point(unsigned int dkey, SPGroup *group, Geom::Point
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
 
+    Geom::Rect near_p(p, p);
+    near_p.expandBy(delta);
+    std::vector<SPItem *> children;
+    if (!upto && find_children_in_display_area(group, dkey, near_p, children)) {
+        // only the children near the point can be picked; the topmost one wins
+        for (std::vector<SPItem *>::reverse_iterator i = children.rbegin(); i != children.rend(); ++i) {
+            SPItem *child = *i;
+            if (SP_IS_GROUP(child) && (SP_GROUP(child)->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups)) {
+                seen = find_item_at_point(dkey, SP_GROUP(child), p, into_groups, take_insensitive);
+            } else {
+                Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
+                if (arenaitem && arenaitem->pick(p, delta, 1) != NULL
+                    && (take_insensitive || child->isVisibleAndUnlocked(dkey))) {
+                    seen = child;
+                }
+            }
+            if (seen) {
+                return seen;
+            }
+        }
+        return NULL;
+    }
+
     for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
         if (!SP_IS_ITEM(o)) {
             continue;
@@ -1212,18 +1304,22 @@ static SPItem *find_group_at_point(unsigned int dkey, SPGroup *group, Geom::Poin
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
 
-    for ( SPObject *o = group->firstChild() ; o ; o = o->getNext() ) {
-        if (!SP_IS_ITEM(o)) {
-            continue;
-        }
-        if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) == SPGroup::LAYER) {
-            SPItem *newseen = find_group_at_point(dkey, SP_GROUP(o), p);
+    Geom::Rect near_p(p, p);
+    near_p.expandBy(delta);
+    std::vector<SPItem *> children;
+    if (!find_children_in_display_area(group, dkey, near_p, children)) {
+        get_item_children(group, children);
+    }
+
+    for (std::vector<SPItem *>::iterator i = children.begin(); i != children.end(); ++i) {
+        SPItem *child = *i;
+        if (SP_IS_GROUP(child) && SP_GROUP(child)->effectiveLayerMode(dkey) == SPGroup::LAYER) {
+            SPItem *newseen = find_group_at_point(dkey, SP_GROUP(child), p);
             if (newseen) {
                 seen = newseen;
             }
         }
-        if (SP_IS_GROUP(o) && SP_GROUP(o)->effectiveLayerMode(dkey) != SPGroup::LAYER ) {
-            SPItem *child = SP_ITEM(o);
+        if (SP_IS_GROUP(child) && SP_GROUP(child)->effectiveLayerMode(dkey) != SPGroup::LAYER ) {
             Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
 
             // seen remembers the last (topmost) of groups pickable at this point
@@ -1245,7 +1341,7 @@ GSList *SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect const &box) cons
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, is_within);
+    return g_slist_reverse(find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, is_within));
 }
 
 /*
@@ -1259,7 +1355,7 @@ GSList *SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &
 {
     g_return_val_if_fail(this->priv != NULL, NULL);
 
-    return find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, overlaps);
+    return g_slist_reverse(find_items_in_area(NULL, SP_GROUP(this->root), dkey, box, overlaps));
 }
 
 GSList *SPDocument::getItemsAtPoints(unsigned const key, std::vector<Geom::Point> points) const
@@ -55,6 +55,7 @@ class SP3DBox;
 class Persp3D;
 class Persp3DImpl;
 class SPItemCtx;
+struct SPStyleSheetIndex;
 
 namespace Proj {
     class TransfMat3x4;
@@ -92,6 +93,7 @@ private:
     SPRoot *root;             ///< Our SPRoot
 public:
     CRCascade *style_cascade;
+    SPStyleSheetIndex *style_index; ///< Built from style_cascade when needed
 
 protected:
     gchar *uri;   ///< A filename (not a URI yet), or NULL
@@ -231,6 +231,60 @@ EventLog::notifyClearRedoEvent()
     updateUndoVerbs();
 }
 
+void
+EventLog::notifyUndoExpiredEvent(Event* log)
+{
+    // the oldest event is the first one after the initial pseudo event
+    iterator first = _event_list_store->children().begin();
+    iterator oldest = first;
+    ++oldest;
+    g_return_if_fail ( oldest != _event_list_store->children().end() && (*oldest)[_columns.event] == log );
+
+    // the states before the dropped event can no longer be reached
+    if ( _last_saved == first || _last_saved == oldest ) {
+        _last_saved = _event_list_store->children().end();
+    }
+    if ( _curr_event == oldest ) {
+        _curr_event = first;
+    }
+    if ( _last_event == oldest ) {
+        _last_event = first;
+    }
+
+    if ( !oldest->children().empty() ) {
+        // the first child of the branch takes the place of the dropped event
+        iterator promoted = oldest->children().begin();
+        (*oldest)[_columns.event] = (Event *)(*promoted)[_columns.event];
+        (*oldest)[_columns.type] = (unsigned int)(*promoted)[_columns.type];
+        (*oldest)[_columns.description] = (Glib::ustring)(*promoted)[_columns.description];
+
+        if ( _curr_event == promoted ) {
+            _curr_event = oldest;
+            _curr_event_parent = (iterator)NULL;
+        }
+        if ( _last_event == promoted ) {
+            _last_event = oldest;
+        }
+        if ( _last_saved == promoted ) {
+            _last_saved = oldest;
+        }
+
+        _event_list_store->erase(promoted);
+        (*oldest)[_columns.child_count] = oldest->children().size() + 1;
+    } else {
+        _event_list_store->erase(oldest);
+    }
+
+    // update the view
+    if (_connected) {
+        (*_callback_connections)[CALLB_SELECTION_CHANGE].block();
+        _event_list_selection->select(_event_list_store->get_path(_curr_event));
+        (*_callback_connections)[CALLB_SELECTION_CHANGE].block(false);
+    }
+
+    updateUndoVerbs();
+}
+
 void 
 EventLog::connectWithDialog(Gtk::TreeView *event_list_view, CallbackMap *callback_connections)
 {
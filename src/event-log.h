@@ -69,6 +69,7 @@ public:
     void notifyUndoCommitEvent(Event *log);
     void notifyClearUndoEvent();
     void notifyClearRedoEvent();
+    void notifyUndoExpiredEvent(Event *log);
 
     // Accessor functions
 
@@ -14,6 +14,8 @@
  */
 
 
+#include <cstddef>
+#include <string>
 #include <glibmm/ustring.h>
 
 #include "xml/event-fns.h"
@@ -30,13 +32,18 @@ namespace Inkscape {
 struct Event {
      
     Event(XML::Event *_event, unsigned int _type=SP_VERB_NONE, Glib::ustring _description="")
-        : event (_event), type (_type), description (_description)  { }
+        : event (_event), type (_type), description (_description), size (0)  { }
 
     virtual ~Event() { sp_repr_free_log (event); }
 
     XML::Event *event;
     const unsigned int type;
     Glib::ustring description;
+
+    /// Attribute and content values of event, moved out by sp_repr_pack_log()
+    std::string packed;
+    /// Memory accounted to this event in the undo history, in bytes
+    std::size_t size;
 };
 
 } // namespace Inkscape
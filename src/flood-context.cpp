@@ -443,16 +443,15 @@ static void do_trace(bitmap_coords_info bci, guchar *trace_px, SPDesktop *deskto
     double offset = prefs->getDouble("/tools/paintbucket/offset", 0.0);
 
     for (unsigned int i=0 ; i<results.size() ; i++) {
-        Inkscape::Trace::TracingEngineResult result = results[i];
+        Inkscape::Trace::TracingEngineResult const &result = results[i];
         totalNodeCount += result.getNodeCount();
 
         Inkscape::XML::Node *pathRepr = xml_doc->createElement("svg:path");
         /* Set style */
         sp_desktop_apply_style_tool (desktop, pathRepr, "/tools/paintbucket", false);
 
-        Geom::PathVector pathv = sp_svg_read_pathv(result.getPathData().c_str());
         Path *path = new Path;
-        path->LoadPathVector(pathv);
+        path->LoadPathVector(result.getPathVector());
 
         if (offset != 0) {
         
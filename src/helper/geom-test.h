@@ -0,0 +1,209 @@
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <glib.h>
+#include <helper/geom.h>
+#include <livarot/Path.h>
+#include <livarot/LivarotDefs.h>
+#include <2geom/path.h>
+#include <2geom/pathvector.h>
+#include <2geom/bezier-curve.h>
+#include <2geom/transforms.h>
+
+/**
+ * Compares bounds_stroke_transformed() with the bounds of the outline that
+ * livarot builds for the stroke, which is what item_outline() used to give.
+ */
+class GeomTest : public CxxTest::TestSuite {
+public:
+
+    GeomTest()
+    {
+    }
+    virtual ~GeomTest() {}
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static GeomTest *createSuite() { return new GeomTest(); }
+    static void destroySuite( GeomTest *suite ) { delete suite; }
+
+    void testJoins()
+    {
+        // a right angle, an obtuse and an acute corner, open and closed
+        Geom::PathVector pv;
+        pv.push_back(polyline(Geom::Point(0, 0), Geom::Point(100, 0), Geom::Point(100, 100), false));
+        pv.push_back(polyline(Geom::Point(200, 0), Geom::Point(300, 30), Geom::Point(400, 0), false));
+        pv.push_back(polyline(Geom::Point(0, 200), Geom::Point(100, 240), Geom::Point(0, 280), true));
+
+        StrokeJoin const joins[] = { STROKE_JOIN_MITER, STROKE_JOIN_ROUND, STROKE_JOIN_BEVEL };
+        for (unsigned i = 0; i < G_N_ELEMENTS(joins); ++i) {
+            checkStroke(pv, Geom::identity(), 10, joins[i], STROKE_CAP_BUTT, 4);
+        }
+    }
+
+    void testCaps()
+    {
+        Geom::PathVector pv;
+        pv.push_back(polyline(Geom::Point(0, 0), Geom::Point(70, 40), Geom::Point(100, 100), false));
+
+        StrokeCap const caps[] = { STROKE_CAP_BUTT, STROKE_CAP_ROUND, STROKE_CAP_SQUARE };
+        for (unsigned i = 0; i < G_N_ELEMENTS(caps); ++i) {
+            checkStroke(pv, Geom::identity(), 10, STROKE_JOIN_BEVEL, caps[i], 4);
+        }
+    }
+
+    void testMiterLimit()
+    {
+        // The miter of this corner is about 5.8 times the width
+        Geom::PathVector pv;
+        pv.push_back(polyline(Geom::Point(0, 0), Geom::Point(100, 17.6), Geom::Point(0, 35.3), false));
+
+        Geom::OptRect cut = checkStroke(pv, Geom::identity(), 10, STROKE_JOIN_MITER, STROKE_CAP_BUTT, 4);
+        Geom::OptRect kept = checkStroke(pv, Geom::identity(), 10, STROKE_JOIN_MITER, STROKE_CAP_BUTT, 8);
+        TS_ASSERT( cut && kept );
+        if (cut && kept) {
+            TS_ASSERT( (*kept)[Geom::X].max() > (*cut)[Geom::X].max() + 20 );
+            TS_ASSERT_DELTA( (*kept)[Geom::Y].min(), (*cut)[Geom::Y].min(), 1e-6 );
+            TS_ASSERT_DELTA( (*kept)[Geom::Y].max(), (*cut)[Geom::Y].max(), 1e-6 );
+        }
+    }
+
+    void testZeroLengthSubpath()
+    {
+        // Only caps can paint a subpath without length
+        Geom::PathVector pv;
+        Geom::Path dot(Geom::Point(10, 10));
+        dot.appendNew<Geom::LineSegment>(Geom::Point(10, 10));
+        pv.push_back(dot);
+
+        TS_ASSERT( !bounds_stroke_transformed(pv, Geom::identity(), 4, STROKE_JOIN_MITER, STROKE_CAP_BUTT, 4) );
+
+        Geom::OptRect round = bounds_stroke_transformed(pv, Geom::identity(), 4, STROKE_JOIN_MITER, STROKE_CAP_ROUND, 4);
+        TS_ASSERT( round );
+        if (round) {
+            TS_ASSERT( near(*round, Geom::Rect(Geom::Point(8, 8), Geom::Point(12, 12)), 1e-6) );
+        }
+
+        // the direction of a square cap is unknown, so it may be turned any way
+        Geom::OptRect square = bounds_stroke_transformed(pv, Geom::identity(), 4, STROKE_JOIN_MITER, STROKE_CAP_SQUARE, 4);
+        TS_ASSERT( square );
+        if (square) {
+            TS_ASSERT( covers(*square, Geom::Rect(Geom::Point(8, 8), Geom::Point(12, 12)), 1e-6) );
+            TS_ASSERT( covers(Geom::Rect(Geom::Point(10 - 2 * M_SQRT2, 10 - 2 * M_SQRT2),
+                                         Geom::Point(10 + 2 * M_SQRT2, 10 + 2 * M_SQRT2)), *square, 1e-6) );
+        }
+
+        // livarot still outlines a butt cap of the dot as a line without area, which
+        // paints nothing, so next to a real subpath only the latter counts
+        Geom::PathVector corner;
+        corner.push_back(polyline(Geom::Point(50, 50), Geom::Point(60, 50), Geom::Point(60, 60), false));
+        pv.push_back(corner.front());
+        Geom::OptRect alone = checkStroke(corner, Geom::identity(), 4, STROKE_JOIN_ROUND, STROKE_CAP_BUTT, 4);
+        Geom::OptRect with_dot = bounds_stroke_transformed(pv, Geom::identity(), 4, STROKE_JOIN_ROUND, STROKE_CAP_BUTT, 4);
+        TS_ASSERT( alone && with_dot );
+        if (alone && with_dot) {
+            TS_ASSERT( near(*with_dot, *alone, 1e-6) );
+        }
+
+        // with round caps, the dot adds to the bounds
+        Geom::OptRect both = checkStroke(pv, Geom::identity(), 4, STROKE_JOIN_ROUND, STROKE_CAP_ROUND, 4);
+        if (both) {
+            TS_ASSERT_DELTA( (*both)[Geom::X].min(), 8, 1e-6 );
+        }
+    }
+
+    void testNonUniformScale()
+    {
+        Geom::PathVector pv;
+        pv.push_back(polyline(Geom::Point(0, 0), Geom::Point(100, 0), Geom::Point(60, 80), true));
+        Geom::Path curve(Geom::Point(200, 0));
+        curve.appendNew<Geom::CubicBezier>(Geom::Point(260, -60), Geom::Point(340, 60), Geom::Point(400, 0));
+        curve.appendNew<Geom::CubicBezier>(Geom::Point(420, 40), Geom::Point(380, 120), Geom::Point(300, 100));
+        pv.push_back(curve);
+
+        Geom::Affine const t = Geom::Scale(3, 0.5) * Geom::Rotate::from_degrees(30) * Geom::Translate(15, -7);
+        checkStroke(pv, t, 8, STROKE_JOIN_MITER, STROKE_CAP_SQUARE, 4);
+        checkStroke(pv, t, 8, STROKE_JOIN_ROUND, STROKE_CAP_ROUND, 4);
+        checkStroke(pv, t, 8, STROKE_JOIN_BEVEL, STROKE_CAP_BUTT, 4);
+    }
+
+private:
+    static Geom::Path polyline(Geom::Point const &a, Geom::Point const &b, Geom::Point const &c, bool closed)
+    {
+        Geom::Path path(a);
+        path.appendNew<Geom::LineSegment>(b);
+        path.appendNew<Geom::LineSegment>(c);
+        path.close(closed);
+        return path;
+    }
+
+    /// Bounds of the livarot outline of the stroke, as item_outline() computes them for bbox_only.
+    static Geom::OptRect outlineBounds(Geom::PathVector const &pv, Geom::Affine const &t,
+                                       double width, StrokeJoin join, StrokeCap cap, double miter_limit)
+    {
+        JoinType const o_join = join == STROKE_JOIN_MITER ? join_pointy :
+                                join == STROKE_JOIN_ROUND ? join_round : join_straight;
+        ButtType const o_butt = cap == STROKE_CAP_SQUARE ? butt_square :
+                                cap == STROKE_CAP_ROUND ? butt_round : butt_straight;
+
+        Path orig;
+        orig.LoadPathVector(pathv_to_linear_and_cubic_beziers(pv));
+        Path res;
+        res.SetBackData(false);
+        orig.Outline(&res, 0.5 * width, o_join, o_butt, 0.5 * miter_limit * width);
+
+        Geom::OptRect bbox;
+        if (res.descr_cmd.size() > 1) {
+            Geom::PathVector *outline = res.MakePathVector();
+            bbox = bounds_exact_transformed(*outline, t);
+            delete outline;
+        }
+        return bbox;
+    }
+
+    /**
+     * Checks that the stroke bounds contain the outline bounds and exceed them by no
+     * more than 1% of the stroke width, stretched as much as @a t stretches anything,
+     * and returns the stroke bounds.
+     */
+    static Geom::OptRect checkStroke(Geom::PathVector const &pv, Geom::Affine const &t,
+                                     double width, StrokeJoin join, StrokeCap cap, double miter_limit)
+    {
+        Geom::OptRect bbox = bounds_stroke_transformed(pv, t, width, join, cap, miter_limit);
+        Geom::OptRect outline = outlineBounds(pv, t, width, join, cap, miter_limit);
+        TS_ASSERT( bbox );
+        TS_ASSERT( outline );
+        if (bbox && outline) {
+            // livarot approximates round parts and offset curves with cubics, which may
+            // stick out a little
+            double const tolerance = 0.01 * width * std::max(t.expansionX(), t.expansionY());
+            TS_ASSERT( covers(*bbox, *outline, tolerance) );
+            TS_ASSERT( covers(*outline, *bbox, tolerance) );
+        }
+        return bbox;
+    }
+
+    /// Whether @a a grown by @a tolerance on every side contains @a b.
+    static bool covers(Geom::Rect const &a, Geom::Rect const &b, double tolerance)
+    {
+        Geom::Rect grown = a;
+        grown.expandBy(tolerance);
+        return grown.contains(b);
+    }
+
+    static bool near(Geom::Rect const &a, Geom::Rect const &b, double tolerance)
+    {
+        return covers(a, b, tolerance) && covers(b, a, tolerance);
+    }
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
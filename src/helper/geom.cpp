@@ -11,6 +11,7 @@
 
 #include "helper/geom.h"
 #include "helper/geom-curves.h"
+#include <algorithm>
 #include <typeinfo>
 #include <2geom/pathvector.h>
 #include <2geom/path.h>
@@ -196,6 +197,284 @@ bounds_exact_transformed(Geom::PathVector const & pv, Geom::Affine const & t)
     return bbox;
 }
 
+namespace {
+
+/// Collects points whose bounds after a transform are the bounds of a stroke.
+struct StrokeBounds {
+    StrokeBounds(Geom::Affine const &t, Geom::Coord r) : t(t), r(r) {
+        // unit vectors in the directions in which the output X and Y grow fastest
+        for (unsigned d = 0; d < 2; ++d) {
+            Geom::Point a(t[d], t[d + 2]);
+            Geom::Coord len = Geom::L2(a);
+            axis[d] = len > 0 ? a / len : Geom::Point(0, 0);
+        }
+    }
+
+    void add(Geom::Point const &p) {
+        Geom::Point q = p * t;
+        if (bbox) {
+            bbox->expandTo(q);
+        } else {
+            bbox = Geom::Rect(q, q);
+        }
+    }
+    /// The extremes of a disk along output dimension d.
+    void addExtent(Geom::Point const &p, unsigned d, Geom::Coord radius) {
+        add(p + radius * axis[d]);
+        add(p - radius * axis[d]);
+    }
+    void addDisk(Geom::Point const &p, Geom::Coord radius) {
+        addExtent(p, X, radius);
+        addExtent(p, Y, radius);
+    }
+    /// Both ends of the stroke's cross section at p.
+    void addNormal(Geom::Point const &p, Geom::Point const &tangent) {
+        Geom::Point n = Geom::rot90(tangent) * r;
+        add(p + n);
+        add(p - n);
+    }
+
+    Geom::Affine const &t;
+    Geom::Coord const r;
+    Geom::Point axis[2];
+    Geom::OptRect bbox;
+};
+
+/// Unit tangent at the start of a line or cubic, or (0,0) if it is degenerate.
+Geom::Point start_tangent(Geom::Curve const &c)
+{
+    Geom::Point d(0, 0);
+    if (Geom::CubicBezier const *cubic = dynamic_cast<Geom::CubicBezier const *>(&c)) {
+        for (unsigned i = 1; i < 4 && Geom::are_near(Geom::L2(d), 0); ++i) {
+            d = (*cubic)[i] - (*cubic)[0];
+        }
+    } else {
+        d = c.finalPoint() - c.initialPoint();
+    }
+    return Geom::are_near(Geom::L2(d), 0) ? Geom::Point(0, 0) : Geom::unit_vector(d);
+}
+
+/// Unit tangent at the end of a line or cubic, or (0,0) if it is degenerate.
+Geom::Point end_tangent(Geom::Curve const &c)
+{
+    Geom::Point d(0, 0);
+    if (Geom::CubicBezier const *cubic = dynamic_cast<Geom::CubicBezier const *>(&c)) {
+        for (int i = 2; i >= 0 && Geom::are_near(Geom::L2(d), 0); --i) {
+            d = (*cubic)[3] - (*cubic)[i];
+        }
+    } else {
+        d = c.finalPoint() - c.initialPoint();
+    }
+    return Geom::are_near(Geom::L2(d), 0) ? Geom::Point(0, 0) : Geom::unit_vector(d);
+}
+
+/**
+ * Whether the radius of curvature of the cubic might drop below r somewhere.
+ * The offset curves of such a cubic can have cusps which are not found among
+ * the extremes of the cubic itself. The radius is at least m^3 / M, where m
+ * bounds the speed from below and M bounds |p' x p''| from above; both follow
+ * from the control points of the derivatives.
+ */
+bool cubic_is_tight(Geom::CubicBezier const &c, Geom::Coord r)
+{
+    Geom::Point d[3], e[2];
+    for (unsigned i = 0; i < 3; ++i) {
+        d[i] = 3 * (c[i + 1] - c[i]);
+    }
+    for (unsigned i = 0; i < 2; ++i) {
+        e[i] = 2 * (d[i + 1] - d[i]);
+    }
+
+    Geom::Point chord = c[3] - c[0];
+    if (Geom::are_near(Geom::L2(chord), 0)) {
+        return true;
+    }
+    chord = Geom::unit_vector(chord);
+    Geom::Coord m = Geom::dot(chord, d[0]);
+    Geom::Coord M = 0;
+    for (unsigned i = 0; i < 3; ++i) {
+        m = std::min(m, Geom::dot(chord, d[i]));
+        for (unsigned j = 0; j < 2; ++j) {
+            M = std::max(M, fabs(d[i][X] * e[j][Y] - d[i][Y] * e[j][X]));
+        }
+    }
+    return m <= 0 || m * m * m < r * M;
+}
+
+/// Parameters in (0,1) where the cubic with coordinates c0..c3 has an extreme.
+unsigned cubic_extremes(Geom::Coord c0, Geom::Coord c1, Geom::Coord c2, Geom::Coord c3, Geom::Coord *roots)
+{
+    // derivative: a t^2 + b t + c
+    Geom::Coord a = 3 * (-c0 + 3 * c1 - 3 * c2 + c3);
+    Geom::Coord b = 6 * (c0 - 2 * c1 + c2);
+    Geom::Coord c = 3 * (c1 - c0);
+    Geom::Coord found[2];
+    unsigned n = 0;
+
+    if (fabs(a) < Geom::EPSILON) {
+        if (fabs(b) > Geom::EPSILON) {
+            found[n++] = -c / b;
+        }
+    } else {
+        Geom::Coord D = b * b - 4 * a * c;
+        if (D >= 0.0) {
+            Geom::Coord d = sqrt(D);
+            found[n++] = (-b + d) / (2 * a);
+            found[n++] = (-b - d) / (2 * a);
+        }
+    }
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (found[i] > 0.0 && found[i] < 1.0) {
+            roots[count++] = found[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * Adds the cross sections at the ends of the cubic and at its extremes. A cubic which
+ * bends too tightly is split a few times; pieces which are still too tight get round
+ * ends, so their offset cusps are covered.
+ */
+void stroke_cubic(StrokeBounds &sb, Geom::CubicBezier const &c, Geom::Point const &t0, Geom::Point const &t1,
+                  unsigned depth)
+{
+    if (!cubic_is_tight(c, sb.r)) {
+        sb.addNormal(c.initialPoint(), t0);
+        sb.addNormal(c.finalPoint(), t1);
+    } else if (depth > 0) {
+        std::pair<Geom::CubicBezier, Geom::CubicBezier> halves = c.subdivide(0.5);
+        Geom::Point tm = end_tangent(halves.first);
+        stroke_cubic(sb, halves.first, t0, tm, depth - 1);
+        stroke_cubic(sb, halves.second, tm, t1, depth - 1);
+        return;
+    } else {
+        sb.addDisk(c.initialPoint(), sb.r);
+        sb.addDisk(c.finalPoint(), sb.r);
+    }
+
+    // where the cubic is extreme along an output axis, so is its offset
+    for (unsigned d = 0; d < 2; ++d) {
+        Geom::Coord roots[2];
+        unsigned n = cubic_extremes(Geom::dot(c[0], sb.axis[d]), Geom::dot(c[1], sb.axis[d]),
+                                    Geom::dot(c[2], sb.axis[d]), Geom::dot(c[3], sb.axis[d]), roots);
+        for (unsigned i = 0; i < n; ++i) {
+            sb.addExtent(c.pointAt(roots[i]), d, sb.r);
+        }
+    }
+}
+
+void stroke_join(StrokeBounds &sb, Geom::Point const &p, Geom::Point const &t_in, Geom::Point const &t_out,
+                 StrokeJoin join, Geom::Coord miter_limit)
+{
+    switch (join) {
+        case STROKE_JOIN_ROUND:
+            sb.addDisk(p, sb.r);
+            break;
+        case STROKE_JOIN_MITER: {
+            // The miter length relative to the width is 1 / cos(a/2), where a is the
+            // angle between the tangents; beyond the limit the join is beveled.
+            Geom::Coord cos_a = Geom::dot(t_in, t_out);
+            Geom::Coord sin_a = fabs(t_in[X] * t_out[Y] - t_in[Y] * t_out[X]);
+            if (sin_a > Geom::EPSILON && miter_limit * miter_limit * (1 + cos_a) >= 2) {
+                // the tip lies on the outer side, in the direction of t_in - t_out
+                sb.add(p + (t_in - t_out) * (sb.r / sin_a));
+            }
+            break;
+        }
+        default:
+            // a bevel lies within the hull of the cross sections
+            break;
+    }
+}
+
+void stroke_cap(StrokeBounds &sb, Geom::Point const &p, Geom::Point const &outwards, StrokeCap cap)
+{
+    switch (cap) {
+        case STROKE_CAP_ROUND:
+            sb.addDisk(p, sb.r);
+            break;
+        case STROKE_CAP_SQUARE:
+            sb.addNormal(p + outwards * sb.r, outwards);
+            break;
+        default:
+            break;
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Bounds of the area painted by stroking the path vector, after transforming it by t.
+ *
+ * Instead of building the outline of the stroke, this collects the points where
+ * the outline can reach its extremes: the ends of the cross sections at the segment
+ * ends, the points where a segment's offset is furthest along an output axis, the
+ * miter tips and the extremes of round joins and caps. Where a cubic bends more
+ * tightly than half the stroke width, the pieces around the bend get round ends,
+ * which keeps the result conservative.
+ *
+ * @param width Stroke width, in the coordinates of pv.
+ * @param miter_limit Miter limit as a multiple of the width, as in SVG.
+ */
+Geom::OptRect
+bounds_stroke_transformed(Geom::PathVector const &pv, Geom::Affine const &t,
+                          Geom::Coord width, StrokeJoin join, StrokeCap cap, Geom::Coord miter_limit)
+{
+    StrokeBounds sb(t, width / 2);
+    // arcs and quadratics are converted so that only lines and cubics remain
+    Geom::PathVector const pathv = pathv_to_linear_and_cubic_beziers(pv);
+
+    for (Geom::PathVector::const_iterator it = pathv.begin(); it != pathv.end(); ++it) {
+        Geom::Point first_tangent, last_tangent;
+        bool has_segments = false;
+
+        for (Geom::Path::const_iterator cit = it->begin(); cit != it->end_default(); ++cit) {
+            Geom::Curve const &c = *cit;
+            Geom::Point t0 = start_tangent(c);
+            if (t0 == Geom::Point(0, 0)) {
+                continue; // zero length segments add neither sections nor joins
+            }
+            Geom::Point t1 = end_tangent(c);
+
+            if (Geom::CubicBezier const *cubic = dynamic_cast<Geom::CubicBezier const *>(&c)) {
+                stroke_cubic(sb, *cubic, t0, t1, 4);
+            } else {
+                sb.addNormal(c.initialPoint(), t0);
+                sb.addNormal(c.finalPoint(), t1);
+            }
+
+            if (has_segments) {
+                stroke_join(sb, c.initialPoint(), last_tangent, t0, join, miter_limit);
+            } else {
+                first_tangent = t0;
+                has_segments = true;
+            }
+            last_tangent = t1;
+        }
+
+        if (!has_segments) {
+            // a zero length subpath is drawn as a dot if it has a round or square cap
+            if (it->size_default() > 0) {
+                if (cap == STROKE_CAP_ROUND) {
+                    sb.addDisk(it->initialPoint(), sb.r);
+                } else if (cap == STROKE_CAP_SQUARE) {
+                    sb.addDisk(it->initialPoint(), sb.r * M_SQRT2);
+                }
+            }
+        } else if (it->closed()) {
+            stroke_join(sb, it->initialPoint(), last_tangent, first_tangent, join, miter_limit);
+        } else {
+            stroke_cap(sb, it->initialPoint(), -first_tangent, cap);
+            stroke_cap(sb, it->finalPoint(), last_tangent, cap);
+        }
+    }
+
+    return sb.bbox;
+}
+
 
 
 static void
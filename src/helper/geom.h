@@ -21,6 +21,24 @@
 Geom::OptRect bounds_fast_transformed(Geom::PathVector const & pv, Geom::Affine const & t);
 Geom::OptRect bounds_exact_transformed(Geom::PathVector const & pv, Geom::Affine const & t);
 
+/// Line join of a stroke, see bounds_stroke_transformed().
+enum StrokeJoin {
+    STROKE_JOIN_MITER,
+    STROKE_JOIN_ROUND,
+    STROKE_JOIN_BEVEL
+};
+
+/// Line cap of a stroke, see bounds_stroke_transformed().
+enum StrokeCap {
+    STROKE_CAP_BUTT,
+    STROKE_CAP_ROUND,
+    STROKE_CAP_SQUARE
+};
+
+Geom::OptRect bounds_stroke_transformed(Geom::PathVector const &pv, Geom::Affine const &t,
+                                        Geom::Coord width, StrokeJoin join, StrokeCap cap,
+                                        Geom::Coord miter_limit);
+
 void pathv_matrix_point_bbox_wind_distance ( Geom::PathVector const & pathv, Geom::Affine const &m, Geom::Point const &pt,
                                              Geom::Rect *bbox, int *wind, Geom::Coord *dist,
                                              Geom::Coord tolerance, Geom::Rect const *viewbox);
@@ -18,6 +18,10 @@
 #endif
 
 #include <png.h>
+#include <vector>
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "interface.h"
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
@@ -53,7 +57,18 @@ struct SPEBP {
     unsigned long int width, height, sheight;
     guint32 background;
     Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
-    guchar *px;
+    // Rendered strips waiting to be written; strip i goes to slot i % max_strips,
+    // and ready[slot] holds its number once it's there. Guarded by lock; changed is
+    // signalled whenever a strip is stored or taken and when the writer is done.
+    GMutex *lock;
+    GCond *changed;
+    guchar **strips;
+    int *ready;
+    int max_strips, total_strips;
+    int next_strip; // first strip nobody is rendering yet
+    int written; // strips handed to the PNG writer so far
+    bool done; // the writer has finished or given up
+    int num_threads;
     unsigned (*status)(float, void *);
     void *data;
 };
@@ -306,7 +321,87 @@ sp_png_write_rgba_striped(SPDocument *doc,
 
 
 /**
- *
+ * Render rows [row, row + num_rows) of the export area into a new buffer in PNG pixel format.
+ * The drawing must already be updated; this is called concurrently for different strips.
+ */
+static guchar *
+sp_export_render_strip(struct SPEBP const *ebp, int row, int num_rows)
+{
+    /* Set area of interest */
+    // bbox is now set to the entire image to prevent discontinuities
+    // in the image when blur is used (the borders may still be a bit
+    // off, but that's less noticeable).
+    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
+
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
+    unsigned char *px = g_try_new(guchar, num_rows * stride);
+    if (!px) return NULL;
+
+    cairo_surface_t *s = cairo_image_surface_create_for_data(
+        px, CAIRO_FORMAT_ARGB32, ebp->width, num_rows, stride);
+    {
+        Inkscape::DrawingContext ct(s, bbox.min());
+        ct.setSource(ebp->background);
+        ct.setOperator(CAIRO_OPERATOR_SOURCE);
+        ct.paint();
+        ct.setOperator(CAIRO_OPERATOR_OVER);
+
+        /* Render */
+        ebp->drawing->render(ct, bbox);
+    }
+    cairo_surface_destroy(s);
+
+    // PNG stores data as unpremultiplied big-endian RGBA, which means
+    // it's identical to the GdkPixbuf format.
+    convert_pixels_argb32_to_pixbuf(px, ebp->width, num_rows, stride);
+
+    return px;
+}
+
+/**
+ * Store a rendered strip for the writer.
+ */
+static void
+sp_export_put_strip(struct SPEBP *ebp, int strip, guchar *px)
+{
+    int slot = strip % ebp->max_strips;
+    g_mutex_lock(ebp->lock);
+    ebp->strips[slot] = px;
+    ebp->ready[slot] = strip;
+    g_cond_broadcast(ebp->changed);
+    g_mutex_unlock(ebp->lock);
+}
+
+/**
+ * Render strips ahead of the writer until it is done. At most max_strips strips
+ * wait to be written at any time, which bounds the memory used.
+ */
+static void
+sp_export_render_ahead(struct SPEBP *ebp)
+{
+    for (;;) {
+        g_mutex_lock(ebp->lock);
+        // while all slots are taken, wait for the writer to catch up
+        while (!ebp->done && ebp->next_strip < ebp->total_strips
+               && ebp->next_strip >= ebp->written + ebp->max_strips)
+        {
+            g_cond_wait(ebp->changed, ebp->lock);
+        }
+        bool finished = ebp->done || ebp->next_strip >= ebp->total_strips;
+        int strip = finished ? -1 : ebp->next_strip++;
+        g_mutex_unlock(ebp->lock);
+        if (finished) break;
+
+        int row = strip * ebp->sheight;
+        int num_rows = MIN(ebp->sheight, ebp->height - row);
+        sp_export_put_strip(ebp, strip, sp_export_render_strip(ebp, row, num_rows));
+    }
+}
+
+/**
+ * Hand the rendered rows to the PNG writer. The strips are rendered ahead by
+ * sp_export_render_ahead() while earlier ones are compressed and written; when
+ * the next strip hasn't been started yet, the writer renders it itself.
  */
 static int
 sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data)
@@ -320,36 +415,39 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
     num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
 
-    /* Set area of interest */
-    // bbox is now set to the entire image to prevent discontinuities
-    // in the image when blur is used (the borders may still be a bit
-    // off, but that's less noticeable).
-    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
+    // The writer always asks for whole strips, so rows start on strip boundaries
+    int strip = row / ebp->sheight;
+    int slot = strip % ebp->max_strips;
+    unsigned char *px = NULL;
+    g_mutex_lock(ebp->lock);
+    while (ebp->ready[slot] != strip && ebp->next_strip != strip) {
+        g_cond_wait(ebp->changed, ebp->lock);
+    }
+    bool claimed = ebp->ready[slot] != strip;
+    if (claimed) {
+        ebp->next_strip++;
+    } else {
+        px = ebp->strips[slot];
+        ebp->strips[slot] = NULL;
+        ebp->ready[slot] = -1;
+    }
+    g_mutex_unlock(ebp->lock);
 
-    /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    if (claimed) {
+        px = sp_export_render_strip(ebp, row, num_rows);
+    }
 
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
-    unsigned char *px = g_new(guchar, num_rows * stride);
+    // The slot is free for the renderers again
+    g_mutex_lock(ebp->lock);
+    ebp->written = strip + 1;
+    g_cond_broadcast(ebp->changed);
+    g_mutex_unlock(ebp->lock);
 
-    cairo_surface_t *s = cairo_image_surface_create_for_data(
-        px, CAIRO_FORMAT_ARGB32, ebp->width, num_rows, stride);
-    Inkscape::DrawingContext ct(s, bbox.min());
-    ct.setSource(ebp->background);
-    ct.setOperator(CAIRO_OPERATOR_SOURCE);
-    ct.paint();
-    ct.setOperator(CAIRO_OPERATOR_OVER);
-
-    /* Render */
-    ebp->drawing->render(ct, bbox);
-    cairo_surface_destroy(s);
+    if (!px) return 0;
 
     *to_free = px;
 
-    // PNG stores data as unpremultiplied big-endian RGBA, which means
-    // it's identical to the GdkPixbuf format.
-    convert_pixels_argb32_to_pixbuf(px, ebp->width, num_rows, stride);
-
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
     for (int r = 0; r < num_rows; r++) {
         rows[r] = px + r * stride;
     }
@@ -357,10 +455,42 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     return num_rows;
 }
 
+/**
+ * Write the PNG file, then tell the rendering threads to stop.
+ */
+static bool
+sp_export_write_strips(SPDocument *doc, gchar const *filename, double xdpi, double ydpi, struct SPEBP *ebp)
+{
+    bool status = sp_png_write_rgba_striped(doc, filename, ebp->width, ebp->height, xdpi, ydpi, sp_export_get_rows, ebp);
+    g_mutex_lock(ebp->lock);
+    ebp->done = true;
+    g_cond_broadcast(ebp->changed);
+    g_mutex_unlock(ebp->lock);
+    return status;
+}
+
+SPExportDrawing::SPExportDrawing(SPDocument *doc)
+    : _doc(doc)
+    , _drawing(new Inkscape::Drawing())
+    , _dkey(SPItem::display_key_new(1))
+{
+    _drawing->setExact(true); // export with maximum blur rendering quality
+    _drawing->setRoot(doc->getRoot()->invoke_show(*_drawing, _dkey, SP_ITEM_SHOW_DISPLAY));
+}
+
+SPExportDrawing::~SPExportDrawing()
+{
+    // Hide items, this releases arenaitem
+    _doc->getRoot()->invoke_hide(_dkey);
+    delete _drawing;
+}
+
 /**
  * Hide all items that are not listed in list, recursively, skipping groups and defs.
+ * The display items stay in the drawing; those that were hidden are added to hidden,
+ * so that they can be shown again for the next export.
  */
-static void hide_other_items_recursively(SPObject *o, GSList *list, unsigned dkey)
+static void hide_other_items_recursively(SPObject *o, GSList *list, unsigned dkey, std::vector<Inkscape::DrawingItem *> &hidden)
 {
     if ( SP_IS_ITEM(o)
          && !SP_IS_DEFS(o)
@@ -368,13 +498,17 @@ static void hide_other_items_recursively(SPObject *o, GSList *list, unsigned dke
          && !SP_IS_GROUP(o)
          && !g_slist_find(list, o) )
     {
-        SP_ITEM(o)->invoke_hide(dkey);
+        Inkscape::DrawingItem *ai = SP_ITEM(o)->get_arenaitem(dkey);
+        if (ai && ai->visible()) {
+            ai->setVisible(false);
+            hidden.push_back(ai);
+        }
     }
 
     // recurse
     if (!g_slist_find(list, o)) {
         for ( SPObject *child = o->firstChild() ; child; child = child->getNext() ) {
-            hide_other_items_recursively(child, list, dkey);
+            hide_other_items_recursively(child, list, dkey, hidden);
         }
     }
 }
@@ -398,7 +532,7 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 unsigned long bgcolor,
                                 unsigned (*status)(float, void *),
                                 void *data, bool force_overwrite,
-                                GSList *items_only)
+                                GSList *items_only, SPExportDrawing *shown)
 {
     g_return_val_if_fail(doc != NULL, EXPORT_ERROR);
     g_return_val_if_fail(filename != NULL, EXPORT_ERROR);
@@ -444,20 +578,22 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     ebp.height = height;
     ebp.background = bgcolor;
 
-    /* Create new drawing */
-    Inkscape::Drawing drawing;
-    drawing.setExact(true); // export with maximum blur rendering quality
-    unsigned const dkey = SPItem::display_key_new(1);
+    /* Create new drawing, unless the caller keeps one shown */
+    SPExportDrawing *temporary = NULL;
+    if (!shown) {
+        temporary = shown = new SPExportDrawing(doc);
+    }
+    g_return_val_if_fail(shown->document() == doc, EXPORT_ERROR);
 
-    // Create ArenaItems and set transform
-    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+    Inkscape::Drawing &drawing = shown->drawing();
     drawing.root()->setTransform(affine);
     ebp.drawing = &drawing;
 
     // We show all and then hide all items we don't want, instead of showing only requested items,
     // because that would not work if the shown item references something in defs
+    std::vector<Inkscape::DrawingItem *> hidden;
     if (items_only) {
-        hide_other_items_recursively(doc->getRoot(), items_only, dkey);
+        hide_other_items_recursively(doc->getRoot(), items_only, shown->displayKey(), hidden);
     }
 
     ebp.status = status;
@@ -466,15 +602,79 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     bool write_status = false;;
 
     ebp.sheight = 64;
-    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
 
-    if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp);
-        g_free(ebp.px);
+    // Strips are rendered concurrently, so bring the whole drawing
+    // to renderable state up front
+    drawing.update(Geom::IntRect::from_xywh(0, 0, width, height));
+
+    // Every strip in flight holds sheight rows of pixels until it is written
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+#if HAVE_OPENMP
+    ebp.num_threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    ebp.num_threads = 1;
+#endif
+    ebp.max_strips = prefs->getIntLimited("/options/threading/exportstrips", ebp.num_threads, 1, 256);
+    ebp.total_strips = (height + ebp.sheight - 1) / ebp.sheight;
+    ebp.next_strip = 0;
+    ebp.written = 0;
+    ebp.done = false;
+    ebp.strips = g_try_new0(guchar *, ebp.max_strips);
+    ebp.ready = g_try_new(int, ebp.max_strips);
+#if GLIB_CHECK_VERSION(2,32,0)
+    ebp.lock = g_new(GMutex, 1);
+    ebp.changed = g_new(GCond, 1);
+    g_mutex_init(ebp.lock);
+    g_cond_init(ebp.changed);
+#else
+    ebp.lock = g_mutex_new();
+    ebp.changed = g_cond_new();
+#endif
+
+    if (ebp.strips && ebp.ready) {
+        for (int i = 0; i < ebp.max_strips; ++i) {
+            ebp.ready[i] = -1;
+        }
+#if HAVE_OPENMP
+        // The calling thread compresses and writes the strips while the others render
+        // the strips after them. It also reports the progress, which runs the GTK main
+        // loop and so must stay on the main thread; the progress dialog is modal, so
+        // the document does not change meanwhile.
+        #pragma omp parallel num_threads(ebp.num_threads + 1)
+        {
+            if (omp_get_thread_num() == 0) {
+                write_status = sp_export_write_strips(doc, filename, xdpi, ydpi, &ebp);
+            } else {
+                sp_export_render_ahead(&ebp);
+            }
+        }
+#else
+        write_status = sp_export_write_strips(doc, filename, xdpi, ydpi, &ebp);
+#endif
     }
+    if (ebp.strips) {
+        // free strips left over after an abort or error
+        for (int i = 0; i < ebp.max_strips; ++i) {
+            g_free(ebp.strips[i]);
+        }
+        g_free(ebp.strips);
+    }
+    g_free(ebp.ready);
+#if GLIB_CHECK_VERSION(2,32,0)
+    g_mutex_clear(ebp.lock);
+    g_cond_clear(ebp.changed);
+    g_free(ebp.lock);
+    g_free(ebp.changed);
+#else
+    g_mutex_free(ebp.lock);
+    g_cond_free(ebp.changed);
+#endif
 
-    // Hide items, this releases arenaitem
-    doc->getRoot()->invoke_hide(dkey);
+    // Restore the drawing for the next export
+    for (std::vector<Inkscape::DrawingItem *>::iterator i = hidden.begin(); i != hidden.end(); ++i) {
+        (*i)->setVisible(true);
+    }
+    delete temporary;
 
     return write_status ? EXPORT_OK : EXPORT_ERROR;
 }
@@ -18,14 +18,42 @@
 #include <2geom/forward.h>
 struct SPDocument;
 
+namespace Inkscape {
+class Drawing;
+}
+
 enum ExportResult {
     EXPORT_ERROR = 0,
     EXPORT_OK,
     EXPORT_ABORTED
 };
 
+/**
+ * Display of a document that can be kept between several PNG exports,
+ * so that each export only pays for rendering.
+ * The document must outlive it.
+ */
+class SPExportDrawing {
+public:
+    SPExportDrawing(SPDocument *doc);
+    ~SPExportDrawing();
+
+    SPDocument *document() { return _doc; }
+    Inkscape::Drawing &drawing() { return *_drawing; }
+    unsigned displayKey() const { return _dkey; }
+
+private:
+    SPExportDrawing(SPExportDrawing const &); // no copy
+    SPExportDrawing &operator=(SPExportDrawing const &); // no assign
+
+    SPDocument *_doc;
+    Inkscape::Drawing *_drawing;
+    unsigned _dkey;
+};
+
 /**
  * Export the given document as a Portable Network Graphics (PNG) file.
+ * If shown is given, its drawing is used instead of creating a new one; it must display doc.
  *
  * @return EXPORT_OK if succeeded, EXPORT_ABORTED if no action was taken, EXPORT_ERROR (false) if an error occurred.
  */
@@ -39,6 +67,7 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				Geom::Rect const &area,
 				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
 				unsigned long bgcolor,
-				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, GSList *items_only = NULL);
+				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, GSList *items_only = NULL,
+				SPExportDrawing *shown = NULL);
 
 #endif // SEEN_SP_PNG_WRITE_H
@@ -14,7 +14,9 @@
  */
 
 #include "gzipstream.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 
@@ -27,7 +29,8 @@ namespace IO
 //# G Z I P    I N P U T    S T R E A M
 //#########################################################################
 
-#define OUT_SIZE 4000
+#define OUT_SIZE 16384
+#define SRC_SIZE 65536
 
 /**
  *
@@ -35,6 +38,7 @@ namespace IO
 GzipInputStream::GzipInputStream(InputStream &sourceStream)
                     : BasicInputStream(sourceStream),
                       loaded(false),
+                      ended(false),
                       totalIn(0),
                       totalOut(0),
                       outputBuf(NULL),
@@ -42,8 +46,6 @@ GzipInputStream::GzipInputStream(InputStream &sourceStream)
                       crc(0),
                       srcCrc(0),
                       srcSiz(0),
-                      srcConsumed(0),
-                      srcLen(0),
                       outputBufPos(0),
                       outputBufLen(0)
 {
@@ -88,9 +90,11 @@ void GzipInputStream::close()
     if (closed)
         return;
 
-    int zerr = inflateEnd(&d_stream);
-    if (zerr != Z_OK) {
-        printf("inflateEnd: Some kind of problem: %d\n", zerr);
+    if (loaded) {
+        int zerr = inflateEnd(&d_stream);
+        if (zerr != Z_OK) {
+            printf("inflateEnd: Some kind of problem: %d\n", zerr);
+        }
     }
 
     if ( srcBuf ) {
@@ -116,8 +120,6 @@ int GzipInputStream::get()
     else if (!loaded && !load()) {
         closed=true;
     } else {
-        loaded = true;
-
         if ( outputBufPos >= outputBufLen ) {
             // time to read more, if we can
             fetchMore();
@@ -131,37 +133,84 @@ int GzipInputStream::get()
     return ch;
 }
 
+/**
+ * Reads up to len bytes of inflated data into buf.  Large reads
+ * are inflated directly into buf.
+ */ 
+int GzipInputStream::read(unsigned char *buf, int len)
+{
+    if (closed) {
+        return 0;
+    }
+    if (!loaded && !load()) {
+        closed = true;
+        return 0;
+    }
+
+    int got = 0;
+    while (got < len) {
+        if ( outputBufPos < outputBufLen ) {
+            int some = std::min<long>(len - got, outputBufLen - outputBufPos);
+            memcpy(buf + got, outputBuf + outputBufPos, some);
+            outputBufPos += some;
+            got += some;
+        } else if ( len - got >= OUT_SIZE ) {
+            int some = inflateInto(buf + got, len - got);
+            if (some == 0)
+                break;
+            got += some;
+        } else if ( fetchMore() <= 0 ) {
+            break;
+        }
+    }
+    return got;
+}
+
 #define FTEXT 0x01
 #define FHCRC 0x02
 #define FEXTRA 0x04
 #define FNAME 0x08
 #define FCOMMENT 0x10
 
+/**
+ * Reads the next compressed byte from the source.  -1 if EOF
+ */ 
+int GzipInputStream::nextSrcByte()
+{
+    if ( d_stream.avail_in == 0 && !refill() ) {
+        return -1;
+    }
+    d_stream.avail_in--;
+    return *d_stream.next_in++;
+}
+
+/**
+ * Reads the next block of compressed data from the source
+ */ 
+bool GzipInputStream::refill()
+{
+    int got = source.read(srcBuf, SRC_SIZE);
+    if (got <= 0)
+        return false;
+    totalIn += got;
+    d_stream.next_in  = srcBuf;
+    d_stream.avail_in = got;
+    return true;
+}
+
+/**
+ * Reads the gzip header, and prepares inflating the data which follows.
+ * Only the first block of the source is read here; the rest is read
+ * as the inflated data is consumed.
+ */ 
 bool GzipInputStream::load()
 {
     crc = crc32(0L, Z_NULL, 0);
-    
-    std::vector<Byte> inputBuf;
-    while (true)
-        {
-        int ch = source.get();
-        if (ch<0)
-            break;
-        inputBuf.push_back((Byte)(ch & 0xff));
-        }
-    long inputBufLen = inputBuf.size();
-    
-    if (inputBufLen < 19) //header + tail + 1
-        {
-        return false;
-        }
 
-    srcLen = inputBuf.size();
-    srcBuf = (Bytef *)malloc(srcLen * sizeof(Byte));
+    srcBuf = (Bytef *)malloc(SRC_SIZE);
     if (!srcBuf) {
         return false;
     }
-
     outputBuf = (unsigned char *)malloc(OUT_SIZE);
     if ( !outputBuf ) {
         free(srcBuf);
@@ -170,156 +219,181 @@ bool GzipInputStream::load()
     }
     outputBufLen = 0; // Not filled in yet
 
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcBuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-
-    int headerLen = 10;
-
-    //Magic
-    int val = (int)srcBuf[0];
-    //printf("val:%x\n", val);
-    val = (int)srcBuf[1];
-    //printf("val:%x\n", val);
-
-    //Method
-    val = (int)srcBuf[2];
-    //printf("val:%x\n", val);
-
-    //flags
-    int flags = (int)srcBuf[3];
-
-    //time
-    val = (int)srcBuf[4];
-    val = (int)srcBuf[5];
-    val = (int)srcBuf[6];
-    val = (int)srcBuf[7];
-
-    //xflags
-    val = (int)srcBuf[8];
-    //OS
-    val = (int)srcBuf[9];
-
-//     if ( flags & FEXTRA ) {
-//         headerLen += 2;
-//         int xlen = 
-//         TODO deal with optional header parts
-//     }
+    d_stream.next_in  = srcBuf;
+    d_stream.avail_in = 0;
+
+    //Magic, method, flags, time, xflags and OS
+    int header[10];
+    for (int i = 0; i < 10; i++) {
+        header[i] = nextSrcByte();
+        if (header[i] < 0)
+            return false;
+    }
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != Z_DEFLATED) {
+        return false;
+    }
+    int flags = header[3];
+
+    if ( flags & FEXTRA ) {
+        int lo = nextSrcByte();
+        int hi = nextSrcByte();
+        if (lo < 0 || hi < 0)
+            return false;
+        for (int xlen = lo | (hi << 8); xlen > 0; xlen--) {
+            if (nextSrcByte() < 0)
+                return false;
+        }
+    }
     if ( flags & FNAME ) {
-        int cur = 10;
-        while ( srcBuf[cur] )
-        {
-            cur++;
-            headerLen++;
+        int ch;
+        while ( (ch = nextSrcByte()) > 0 ) {
         }
-        headerLen++;
+        if (ch < 0)
+            return false;
+    }
+    if ( flags & FCOMMENT ) {
+        int ch;
+        while ( (ch = nextSrcByte()) > 0 ) {
+        }
+        if (ch < 0)
+            return false;
+    }
+    if ( flags & FHCRC ) {
+        if (nextSrcByte() < 0 || nextSrcByte() < 0)
+            return false;
     }
 
-
-    srcCrc = ((0x0ff & srcBuf[srcLen - 5]) << 24)
-           | ((0x0ff & srcBuf[srcLen - 6]) << 16)
-           | ((0x0ff & srcBuf[srcLen - 7]) <<  8)
-           | ((0x0ff & srcBuf[srcLen - 8]) <<  0);
-    //printf("srcCrc:%lx\n", srcCrc);
-    
-    srcSiz = ((0x0ff & srcBuf[srcLen - 1]) << 24)
-           | ((0x0ff & srcBuf[srcLen - 2]) << 16)
-           | ((0x0ff & srcBuf[srcLen - 3]) <<  8)
-           | ((0x0ff & srcBuf[srcLen - 4]) <<  0);
-    //printf("srcSiz:%lx/%ld\n", srcSiz, srcSiz);
-    
-    //outputBufLen = srcSiz + srcSiz/100 + 14;
-    
-    unsigned char *data = srcBuf + headerLen;
-    unsigned long dataLen = srcLen - (headerLen + 8);
-    //printf("%x %x\n", data[0], data[dataLen-1]);
-    
     d_stream.zalloc    = (alloc_func)0;
     d_stream.zfree     = (free_func)0;
     d_stream.opaque    = (voidpf)0;
-    d_stream.next_in   = data;
-    d_stream.avail_in  = dataLen;
-    d_stream.next_out  = outputBuf;
-    d_stream.avail_out = OUT_SIZE;
     
     int zerr = inflateInit2(&d_stream, -MAX_WBITS);
-    if ( zerr == Z_OK )
-    {
-        zerr = fetchMore();
-    } else {
+    if ( zerr != Z_OK ) {
         printf("inflateInit2: Some kind of problem: %d\n", zerr);
+        return false;
     }
+    loaded = true;
 
-        
-    return (zerr == Z_OK) || (zerr == Z_STREAM_END);
+    return true;
 }
 
 
+/**
+ * Refills outputBuf.  Returns the number of bytes now available,
+ * 0 at the end of the data.
+ */ 
 int GzipInputStream::fetchMore()
 {
-    int zerr = Z_OK;
-
     // TODO assumes we aren't called till the buffer is empty
-    d_stream.next_out  = outputBuf;
-    d_stream.avail_out = OUT_SIZE;
-    outputBufLen = 0;
     outputBufPos = 0;
+    outputBufLen = inflateInto(outputBuf, OUT_SIZE);
+    return outputBufLen;
+}
+
+/**
+ * Inflates up to len bytes into out, reading compressed data from
+ * the source as needed.  Returns the number of bytes produced, which
+ * is 0 at the end of the data or after an error.
+ */ 
+int GzipInputStream::inflateInto(unsigned char *out, int len)
+{
+    if (ended)
+        return 0;
+
+    d_stream.next_out  = out;
+    d_stream.avail_out = len;
 
-    zerr = inflate( &d_stream, Z_SYNC_FLUSH );
-    if ( zerr == Z_OK || zerr == Z_STREAM_END ) {
-        outputBufLen = OUT_SIZE - d_stream.avail_out;
-        if ( outputBufLen ) {
-            crc = crc32(crc, (const Bytef *)outputBuf, outputBufLen);
+    while ( d_stream.avail_out > 0 ) {
+        if ( d_stream.avail_in == 0 && !refill() ) {
+            break; // truncated
+        }
+        int zerr = inflate( &d_stream, Z_NO_FLUSH );
+        if ( zerr == Z_STREAM_END ) {
+            ended = true;
+            break;
+        } else if ( zerr != Z_OK ) {
+            printf("inflate: Some kind of problem: %d\n", zerr);
+            ended = true;
+            break;
         }
-        //printf("crc:%lx\n", crc);
-//     } else if ( zerr != Z_STREAM_END ) {
-//         // TODO check to be sure this won't happen for partial end reads
-//         printf("inflate: Some kind of problem: %d\n", zerr);
     }
 
-    return zerr;
+    int got = len - d_stream.avail_out;
+    if ( got ) {
+        crc = crc32(crc, (const Bytef *)out, got);
+        totalOut += got;
+    }
+
+    if ( ended ) {
+        readTrailer();
+    }
+
+    return got;
+}
+
+/**
+ * Reads the CRC and size following the compressed data, and checks them.
+ */ 
+void GzipInputStream::readTrailer()
+{
+    unsigned char tail[8];
+    for (int i = 0; i < 8; i++) {
+        int ch = nextSrcByte();
+        if (ch < 0) {
+            printf("gzip: truncated input\n");
+            return;
+        }
+        tail[i] = ch;
+    }
+    srcCrc = ((0x0ff & tail[3]) << 24)
+           | ((0x0ff & tail[2]) << 16)
+           | ((0x0ff & tail[1]) <<  8)
+           | ((0x0ff & tail[0]) <<  0);
+    srcSiz = ((0x0ff & tail[7]) << 24)
+           | ((0x0ff & tail[6]) << 16)
+           | ((0x0ff & tail[5]) <<  8)
+           | ((0x0ff & tail[4]) <<  0);
+    if ( srcCrc != crc || srcSiz != ((unsigned long)totalOut & 0xffffffffUL) ) {
+        printf("gzip: CRC or size mismatch\n");
+    }
 }
 
 //#########################################################################
 //# G Z I P   O U T P U T    S T R E A M
 //#########################################################################
 
+#define IN_SIZE 65536
+
 /**
  *
  */ 
 GzipOutputStream::GzipOutputStream(OutputStream &destinationStream)
-                     : BasicOutputStream(destinationStream)
+                     : BasicOutputStream(destinationStream),
+                       outputBuf(OUT_SIZE),
+                       totalIn(0),
+                       totalOut(0),
+                       pending(false)
 {
-
-    totalIn         = 0;
-    totalOut        = 0;
     crc             = crc32(0L, Z_NULL, 0);
+    inputBuf.reserve(IN_SIZE);
 
-    //Gzip header
-    destination.put(0x1f);
-    destination.put(0x8b);
-
-    //Say it is compressed
-    destination.put(Z_DEFLATED);
-
-    //flags
-    destination.put(0);
-
-    //time
-    destination.put(0);
-    destination.put(0);
-    destination.put(0);
-    destination.put(0);
-
-    //xflags
-    destination.put(0);
-
-    //OS code - from zutil.h
-    //destination.put(OS_CODE);
-    //apparently, we should not explicitly include zutil.h
-    destination.put(0);
+    memset( &d_stream, 0, sizeof(d_stream) );
+    // raw deflate data; we write the gzip header and trailer ourselves
+    int zerr = deflateInit2(&d_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (zerr != Z_OK) {
+        printf("deflateInit2: Some kind of problem: %d\n", zerr);
+    }
 
+    char const header[10] = {
+        0x1f, (char)0x8b, //Magic
+        Z_DEFLATED,       //Say it is compressed
+        0,                //flags
+        0, 0, 0, 0,       //time
+        0,                //xflags
+        0                 //OS code - we should not explicitly include zutil.h for OS_CODE
+    };
+    destination.write(header, sizeof(header));
 }
 
 /**
@@ -339,22 +413,25 @@ void GzipOutputStream::close()
     if (closed)
         return;
 
-    flush();
+    deflateSome(inputBuf.empty() ? NULL : &inputBuf[0], inputBuf.size(), Z_FINISH);
+    inputBuf.clear();
+    deflateEnd(&d_stream);
 
-    //# Send the CRC
+    //# Send the CRC, then the file length
+    char trailer[8];
     uLong outlong = crc;
     for (int n = 0; n < 4; n++)
         {
-        destination.put((int)(outlong & 0xff));
+        trailer[n] = (char)(outlong & 0xff);
         outlong >>= 8;
         }
-    //# send the file length
     outlong = totalIn & 0xffffffffL;
-    for (int n = 0; n < 4; n++)
+    for (int n = 4; n < 8; n++)
         {
-        destination.put((int)(outlong & 0xff));
+        trailer[n] = (char)(outlong & 0xff);
         outlong >>= 8;
         }
+    destination.write(trailer, sizeof(trailer));
 
     destination.close();
     closed = true;
@@ -366,52 +443,46 @@ void GzipOutputStream::close()
  */ 
 void GzipOutputStream::flush()
 {
-    if (closed || inputBuf.size()<1)
-        return;
-    
-    uLong srclen = inputBuf.size();
-    Bytef *srcbuf = (Bytef *)malloc(srclen * sizeof(Byte));
-    if (!srcbuf)
-        {
-        return;
-        }
-        
-    uLong destlen = srclen;
-    Bytef *destbuf = (Bytef *)malloc((destlen + (srclen/100) + 13) * sizeof(Byte));
-    if (!destbuf)
-        {
-        free(srcbuf);
+    if (closed || (inputBuf.empty() && !pending))
         return;
-        }
-        
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcbuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-        
-    crc = crc32(crc, (const Bytef *)srcbuf, srclen);
-    
-    int zerr = compress(destbuf, (uLongf *)&destlen, srcbuf, srclen);
-    if (zerr != Z_OK)
-        {
-        printf("Some kind of problem\n");
-        }
 
-    totalOut += destlen;
-    //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
-        {
-        destination.put((int)destbuf[i]);
-        }
-        
+    deflateSome(inputBuf.empty() ? NULL : &inputBuf[0], inputBuf.size(), Z_SYNC_FLUSH);
+    inputBuf.clear();
+    pending = false;
+
     destination.flush();
+}
 
-    inputBuf.clear();
-    free(srcbuf);
-    free(destbuf);
-    
-    //printf("done\n");
-    
+/**
+ * Deflates len bytes from data, and writes the compressed result
+ * to the destination.
+ */ 
+void GzipOutputStream::deflateSome(Bytef const *data, uInt len, int flushMode)
+{
+    if (len) {
+        crc = crc32(crc, data, len);
+        totalIn += len;
+        pending = true;
+    }
+
+    d_stream.next_in  = const_cast<Bytef *>(data);
+    d_stream.avail_in = len;
+    do {
+        d_stream.next_out  = &outputBuf[0];
+        d_stream.avail_out = OUT_SIZE;
+        int zerr = deflate(&d_stream, flushMode);
+        if (zerr == Z_STREAM_ERROR)
+            {
+            printf("Some kind of problem\n");
+            return;
+            }
+        uInt have = OUT_SIZE - d_stream.avail_out;
+        if (have)
+            {
+            destination.write((char const *)&outputBuf[0], have);
+            totalOut += have;
+            }
+    } while (d_stream.avail_out == 0);
 }
 
 
@@ -427,11 +498,35 @@ void GzipOutputStream::put(int ch)
         return;
         }
 
-
     //Add char to buffer
     inputBuf.push_back(ch);
-    totalIn++;
+    if (inputBuf.size() >= IN_SIZE)
+        {
+        deflateSome(&inputBuf[0], inputBuf.size(), Z_NO_FLUSH);
+        inputBuf.clear();
+        }
+}
+
+/**
+ * Writes len bytes to this output stream.  Large blocks are
+ * deflated without being copied to the input buffer first.
+ */ 
+void GzipOutputStream::write(char const *buf, int len)
+{
+    if (closed || len <= 0)
+        return;
 
+    if (inputBuf.size() + len < IN_SIZE)
+        {
+        inputBuf.insert(inputBuf.end(), buf, buf + len);
+        return;
+        }
+    if (!inputBuf.empty())
+        {
+        deflateSome(&inputBuf[0], inputBuf.size(), Z_NO_FLUSH);
+        inputBuf.clear();
+        }
+    deflateSome((Bytef const *)buf, len, Z_NO_FLUSH);
 }
 
 
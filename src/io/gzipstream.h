@@ -49,12 +49,19 @@ public:
     
     virtual int get();
     
+    virtual int read(unsigned char *buf, int len);
+    
 private:
 
     bool load();
     int fetchMore();
+    int inflateInto(unsigned char *out, int len);
+    bool refill();
+    int nextSrcByte();
+    void readTrailer();
 
     bool loaded;
+    bool ended;
     
     long totalIn;
     long totalOut;
@@ -65,8 +72,6 @@ private:
     unsigned long crc;
     unsigned long srcCrc;
     unsigned long srcSiz;
-    unsigned long srcConsumed;
-    unsigned long srcLen;
     long outputBufPos;
     long outputBufLen;
 
@@ -84,6 +89,8 @@ private:
  * This class is for gzip-compressing data going to the
  * destination OutputStream
  *
+ * The data is deflated in blocks as it arrives, so the
+ * compressed output is written while the input is produced.
  */
 class GzipOutputStream : public BasicOutputStream
 {
@@ -100,13 +107,21 @@ public:
     
     virtual void put(int ch);
 
+    virtual void write(char const *buf, int len);
+
 private:
 
+    void deflateSome(Bytef const *data, uInt len, int flushMode);
+
     std::vector<unsigned char> inputBuf;
+    std::vector<unsigned char> outputBuf;
 
     long totalIn;
     long totalOut;
     unsigned long crc;
+    bool pending;
+
+    z_stream d_stream;
 
 }; // class GzipOutputStream
 
@@ -13,6 +13,7 @@
 
 
 #include "inkscapestream.h"
+#include <cstring>
 
 namespace Inkscape
 {
@@ -35,6 +36,26 @@ void pipeStream(InputStream &source, OutputStream &dest)
     dest.flush();
 }
 
+//#########################################################################
+//# I N P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Reads up to len bytes into buf, one get() at a time.
+ */
+int InputStream::read(unsigned char *buf, int len)
+{
+    int got = 0;
+    while (got < len)
+        {
+        int ch = get();
+        if (ch<0)
+            break;
+        buf[got++] = (unsigned char)ch;
+        }
+    return got;
+}
+
 //#########################################################################
 //# B A S I C    I N P U T    S T R E A M
 //#########################################################################
@@ -86,6 +107,19 @@ int BasicInputStream::get()
    
 
 
+//#########################################################################
+//# O U T P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Writes len bytes from buf, one put() at a time.
+ */
+void OutputStream::write(char const *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        put((unsigned char)buf[i]);
+}
+
 //#########################################################################
 //# B A S I C    O U T P U T    S T R E A M
 //#########################################################################
@@ -532,6 +566,17 @@ Writer &BasicWriter::writeChar(char ch)
 }
 
 
+/**
+ * Writes the specified bytes to this output writer.
+ */ 
+Writer &BasicWriter::write(char const *str, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        writeChar(str[i]);
+    return *this;
+}
+
+
 /**
  * Writes the specified unicode string to this output writer.
  */ 
@@ -745,11 +790,22 @@ Writer& operator<< (Writer &writer, double val)
 //#########################################################################
 
 
+#define WRITER_BUFFER_SIZE 65536
+
 OutputStreamWriter::OutputStreamWriter(OutputStream &outputStreamDest)
-                     : outputStream(outputStreamDest)
+                     : outputStream(outputStreamDest),
+                       buffer(WRITER_BUFFER_SIZE),
+                       bufferLen(0)
 {
 }
 
+/**
+ *  Pass on whatever is still buffered
+ */
+OutputStreamWriter::~OutputStreamWriter()
+{
+    drain();
+}
     
 
 /**
@@ -766,6 +822,7 @@ void OutputStreamWriter::close()
  */
 void OutputStreamWriter::flush()
 {
+      drain();
       outputStream.flush();
 }
     
@@ -775,9 +832,46 @@ void OutputStreamWriter::flush()
  */
 void OutputStreamWriter::put(gunichar ch)
 {
-    //Do we need conversions here?
-    int intCh = (int) ch;
-    outputStream.put(intCh);
+    // bytes (including sign-extended chars) are buffered;
+    // anything wider goes to the stream as it did before
+    if (ch < 0x100 || ch >= 0xffffff80) {
+        if (bufferLen == buffer.size())
+            drain();
+        buffer[bufferLen++] = (char)ch;
+    } else {
+        drain();
+        //Do we need conversions here?
+        int intCh = (int) ch;
+        outputStream.put(intCh);
+    }
+}
+
+/**
+ *  Buffer str, or pass it on directly if it is larger than the buffer.
+ */
+Writer &OutputStreamWriter::write(char const *str, size_t len)
+{
+    if (len > buffer.size() - bufferLen) {
+        drain();
+        if (len >= buffer.size()) {
+            outputStream.write(str, (int)len);
+            return *this;
+        }
+    }
+    memcpy(&buffer[bufferLen], str, len);
+    bufferLen += len;
+    return *this;
+}
+
+/**
+ *  Send the buffered bytes to the OutputStream in one write
+ */
+void OutputStreamWriter::drain()
+{
+    if (bufferLen) {
+        outputStream.write(&buffer[0], bufferLen);
+        bufferLen = 0;
+    }
 }
 
 //#########################################################################
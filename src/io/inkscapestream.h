@@ -11,6 +11,7 @@
 
 
 #include <cstdio>
+#include <vector>
 #include <glibmm.h>
 
 namespace Inkscape
@@ -85,6 +86,14 @@ public:
      * This call returns -1 on end-of-file.
      */
     virtual int get() = 0;
+
+    /**
+     * Read up to len bytes into buf.  Returns the number of bytes
+     * read, which is smaller than len only at end-of-file.
+     * The default implementation calls get() for each byte;
+     * endpoints and filters that can do better override it.
+     */
+    virtual int read(unsigned char *buf, int len);
     
 }; // class InputStream
 
@@ -192,6 +201,13 @@ public:
      */
     virtual void put(int ch) = 0;
 
+    /**
+     * Send len bytes to the destination stream.
+     * The default implementation calls put() for each byte;
+     * endpoints and filters that can do better override it.
+     */
+    virtual void write(char const *buf, int len);
+
 
 }; // class OutputStream
 
@@ -478,6 +494,11 @@ public:
 
     virtual Writer& writeChar(char val) = 0;
 
+    /**
+     * Write len bytes, such as UTF-8 text, as they are.
+     */
+    virtual Writer& write(char const *str, size_t len) = 0;
+
     virtual Writer& writeUString(Glib::ustring &val) = 0;
 
     virtual Writer& writeStdString(std::string &val) = 0;
@@ -534,6 +555,8 @@ public:
 
     virtual Writer& writeChar(char val);
 
+    virtual Writer& write(char const *str, size_t len);
+
     virtual Writer& writeUString(Glib::ustring &val);
 
     virtual Writer& writeStdString(std::string &val);
@@ -604,12 +627,17 @@ Writer& operator<< (Writer &writer, double val);
 /**
  * Class for placing a Writer on an open OutputStream
  *
+ * Output is collected in a buffer and passed on in blocks; it
+ * reaches the OutputStream on flush(), on close() and when the
+ * writer is destroyed.
  */
 class OutputStreamWriter : public BasicWriter
 {
 public:
 
     OutputStreamWriter(OutputStream &outputStreamDest);
+
+    virtual ~OutputStreamWriter();
     
     /*Overload these 3 for your implementation*/
     virtual void close();
@@ -618,11 +646,18 @@ public:
     
     virtual void put(gunichar ch);
 
+    virtual Writer& write(char const *str, size_t len);
+
 
 private:
 
+    void drain();
+
     OutputStream &outputStream;
 
+    std::vector<char> buffer;
+    size_t bufferLen;
+
 
 };
 
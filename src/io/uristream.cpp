@@ -227,6 +227,44 @@ int UriInputStream::get() throw(StreamException)
     return retVal;
 }
 
+/**
+ * Reads up to len bytes into buf.  Files are read with a single fread().
+ */
+int UriInputStream::read(unsigned char *buf, int len) throw(StreamException)
+{
+    int retVal = 0;
+    if (!closed && len > 0)
+    {
+        switch (scheme) {
+
+            case SCHEME_FILE:
+                if (inf)
+                {
+                    retVal = fread(buf, 1, len, inf);
+                }
+                break;
+
+            case SCHEME_DATA:
+                retVal = dataLen - dataPos;
+                if (retVal > len)
+                {
+                    retVal = len;
+                }
+                if (retVal > 0)
+                {
+                    memcpy(buf, data + dataPos, retVal);
+                    dataPos += retVal;
+                }
+                else
+                {
+                    retVal = 0;
+                }
+                break;
+        }//switch
+    }
+    return retVal;
+}
+
 
 
 
@@ -432,6 +470,33 @@ void UriOutputStream::put(int ch) throw(StreamException)
 
 }
 
+/**
+ * Writes len bytes; files get them in a single fwrite().
+ */
+void UriOutputStream::write(char const *buf, int len) throw(StreamException)
+{
+    if (closed)
+        return;
+
+    switch (scheme) {
+
+        case SCHEME_FILE:
+            if (!outf)
+                return;
+            if (len > 0 && fwrite(buf, 1, len, outf) != (size_t)len) {
+                Glib::ustring err = "ERROR writing to file ";
+                throw StreamException(err);
+            }
+        break;
+
+        case SCHEME_DATA:
+            OutputStream::write(buf, len);
+        break;
+
+    }//switch
+
+}
+
 
 
 
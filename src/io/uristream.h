@@ -49,6 +49,8 @@ public:
 
     virtual int get() throw(StreamException);
 
+    virtual int read(unsigned char *buf, int len) throw(StreamException);
+
 private:
     Inkscape::URI &uri;
     FILE *inf;           //for file: uris
@@ -117,6 +119,8 @@ public:
 
     virtual void put(int ch) throw(StreamException);
 
+    virtual void write(char const *buf, int len) throw(StreamException);
+
 private:
 
     bool closed;
@@ -234,23 +234,27 @@ class_add_sel_matches_node (CRAdditionalSel * a_add_sel,
 
         klass = a_node_iface->getProp (a_node, "class");
         if (klass) {
-                char const *cur;
-                for (cur = klass; cur && *cur; cur++) {
-                        while (cur && *cur
-                               && cr_utils_is_white_space (*cur) 
+                char const *cur = klass;
+                while (*cur) {
+                        char const *end = NULL;
+
+                        while (*cur
+                               && cr_utils_is_white_space (*cur)
                                == TRUE)
                                 cur++;
-
-                        if (!strncmp (cur, 
-                                      a_add_sel->content.class_name->stryng->str,
-                                      a_add_sel->content.class_name->stryng->len)) {
-                                cur += a_add_sel->content.class_name->stryng->len;
-                                if ((cur && !*cur)
-                                    || cr_utils_is_white_space (*cur) == TRUE)
-                                        result = TRUE;
-                        }
-                        if (cur && !*cur)
+                        for (end = cur;
+                             *end && cr_utils_is_white_space (*end) == FALSE;
+                             end++) ;
+
+                        /*the class names must be equal, not only one a prefix of the other*/
+                        if ((gulong) (end - cur) == a_add_sel->content.class_name->stryng->len
+                            && !strncmp (cur, 
+                                         a_add_sel->content.class_name->stryng->str,
+                                         a_add_sel->content.class_name->stryng->len)) {
+                                result = TRUE;
                                 break ;
+                        }
+                        cur = end;
                 }
                 a_node_iface->freePropVal (klass);
                 klass = NULL;
@@ -284,8 +288,9 @@ id_add_sel_matches_node (CRAdditionalSel * a_add_sel,
 
         id = a_node_iface->getProp (a_node, "id");
         if (id) {
-                if (!strncmp (id, a_add_sel->content.id_name->stryng->str,
-                              a_add_sel->content.id_name->stryng->len)) {
+                if (strlen (id) == a_add_sel->content.id_name->stryng->len
+                    && !strncmp (id, a_add_sel->content.id_name->stryng->str,
+                                 a_add_sel->content.id_name->stryng->len)) {
                         result = TRUE;
                 }
                 a_node_iface->freePropVal (id);
@@ -1475,6 +1480,38 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
         return status;
 }
 
+/**
+ *Computes the cascaded properties from rulesets which are already
+ *known to match a node, as cr_sel_eng_get_matched_properties_from_cascade()
+ *does once it has found them.
+ *@param a_rulesets the matching rulesets, in the order of the cascade.
+ *The specificity of each of them must be set to the specificity of the
+ *selector which matched.
+ *@param a_len the number of rulesets in a_rulesets.
+ *@param a_props out parameter. The properties found are appended to it.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_properties_from_rulesets (CRStatement ** a_rulesets,
+                                         gulong a_len,
+                                         CRPropList ** a_props)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_props && (a_rulesets || !a_len),
+                              CR_BAD_PARAM_ERROR);
+
+        for (i = 0; i < a_len; i++) {
+                CRStatement *stmt = a_rulesets[i];
+
+                if (!stmt || stmt->type != RULESET_STMT
+                    || !stmt->parent_sheet)
+                        continue;
+                put_css_properties_in_props_list (a_props, stmt);
+        }
+        return CR_OK;
+}
+
 enum CRStatus
 cr_sel_eng_get_matched_style (CRSelEng * a_this,
                               CRCascade * a_cascade,
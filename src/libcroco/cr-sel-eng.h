@@ -97,6 +97,11 @@ cr_sel_eng_get_matched_properties_from_cascade  (CRSelEng *a_this,
                                                  CRXMLNodePtr a_node,
                                                  CRPropList **a_props) ;
 
+enum CRStatus
+cr_sel_eng_get_properties_from_rulesets (CRStatement **a_rulesets,
+                                         gulong a_len,
+                                         CRPropList **a_props) ;
+
 enum CRStatus cr_sel_eng_get_matched_style (CRSelEng *a_this,
                                             CRCascade *a_cascade,
                                             CRXMLNodePtr a_node,
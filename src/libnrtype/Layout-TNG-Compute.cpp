@@ -8,12 +8,15 @@
  *
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
+#include <map>
+#include <string>
 #include "Layout-TNG.h"
 #include "style.h"
 #include "font-instance.h"
 #include "svg/svg-length.h"
 #include "sp-object.h"
 #include "Layout-TNG-Scanline-Maker.h"
+#include "livarot/Shape.h"
 
 namespace Inkscape {
 namespace Text {
@@ -34,6 +37,150 @@ static Layout::EnumConversionItem const enum_convert_spstyle_direction_to_my_dir
     {SP_CSS_WRITING_MODE_RL_TB, Layout::RIGHT_TO_LEFT},
     {SP_CSS_WRITING_MODE_TB_LR, Layout::LEFT_TO_RIGHT}};   // this is correct
 
+/** \brief private to Layout. What is kept from one flow to the next.
+
+Editing a text usually changes a single paragraph, yet the owner gives all
+of the text to the Layout again and flows it from scratch. Two things are
+kept to make that cheaper:
+
+The result of pango_itemize() for each paragraph is cached, keyed by
+everything that goes into the itemization (the text, the fonts and where
+they change, the base direction). The glyph strings made by pango_shape()
+for the spans of the paragraph are cached with it, so a paragraph which
+is the same as last time is neither itemized nor shaped again. Entries
+which were not used by the last flow are dropped.
+
+The calculator also records a Checkpoint at the end of each paragraph: a
+signature of all the input that paragraph was made from and the state that
+carries over to the next paragraph. clear() keeps the output together with
+the checkpoints, and if the input is the same as last time up to the end
+of some paragraph, the next flow takes over the output to there and only
+breaks the lines after it.
+*/
+class Layout::ParagraphCache
+{
+public:
+    struct ShapedParagraph {
+        std::vector<PangoItem*> pango_items;
+        std::vector<font_instance*> fonts;          ///< for each of pango_items, referenced
+        std::vector<PangoLogAttr> char_attributes;
+        Direction direction;
+        /// shaped (and reordered, for rtl) glyphs by first byte in the paragraph and length
+        std::map<std::pair<unsigned, unsigned>, PangoGlyphString*> glyph_strings;
+        unsigned generation;                       ///< of the last flow which used this
+
+        ShapedParagraph() : direction(LEFT_TO_RIGHT), generation(0) {}
+        ~ShapedParagraph();
+    };
+    typedef std::map<std::string, ShapedParagraph*> ShapedMap;
+
+    struct Checkpoint {
+        unsigned end_input_index;      ///< the paragraph's last item in Layout::_input_stream, or its size
+        std::string signature;         ///< of the input since the previous checkpoint
+        ShapedParagraph *shaped;
+        // the state of the calculator
+        unsigned shape_index;
+        bool has_scanline_maker;
+        ScanlineMaker::Position scanline_position;
+        double y_offset;
+        LineHeight line_height;
+        // the size of the output
+        size_t paragraphs, lines, chunks, spans, characters, glyphs;
+    };
+
+    ShapedMap shaped;
+    unsigned generation;
+
+    /// for the output of the last flow; see Layout::_keepOutputObjects()
+    std::vector<Checkpoint> checkpoints;
+    std::string wrap_shapes_signature;
+    size_t input_stream_size;
+
+    /// the output kept by clear()
+    bool output_kept;
+    std::vector<Paragraph> paragraphs;
+    std::vector<Line> lines;
+    std::vector<Chunk> chunks;
+    std::vector<Span> spans;
+    std::vector<Character> characters;
+    std::vector<Glyph> glyphs;
+
+    ParagraphCache() : generation(0), input_stream_size(0), output_kept(false) {}
+    ~ParagraphCache();
+
+    void discardOutput();
+    void removeUnused();
+};
+
+Layout::ParagraphCache::ShapedParagraph::~ShapedParagraph()
+{
+    for (unsigned i = 0 ; i < pango_items.size() ; i++) {
+        pango_item_free(pango_items[i]);
+        if (fonts[i])
+            fonts[i]->Unref();
+    }
+    for (std::map<std::pair<unsigned, unsigned>, PangoGlyphString*>::iterator it = glyph_strings.begin() ; it != glyph_strings.end() ; ++it)
+        pango_glyph_string_free(it->second);
+}
+
+Layout::ParagraphCache::~ParagraphCache()
+{
+    discardOutput();
+    for (ShapedMap::iterator it = shaped.begin() ; it != shaped.end() ; ++it)
+        delete it->second;
+}
+
+void Layout::ParagraphCache::discardOutput()
+{
+    for (std::vector<Span>::iterator it_span = spans.begin() ; it_span != spans.end() ; it_span++)
+        if (it_span->font) it_span->font->Unref();
+    paragraphs.clear();
+    lines.clear();
+    chunks.clear();
+    spans.clear();
+    characters.clear();
+    glyphs.clear();
+    output_kept = false;
+}
+
+void Layout::ParagraphCache::removeUnused()
+{
+    for (ShapedMap::iterator it = shaped.begin() ; it != shaped.end() ; ) {
+        if (it->second->generation != generation) {
+            delete it->second;
+            shaped.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Layout::_keepOutputObjects()
+{
+    if (_paragraph_cache == NULL || _paragraphs.empty())
+        return;    // nothing new since the last clear()
+    ParagraphCache &cache = *_paragraph_cache;
+    cache.discardOutput();
+    if (_path_fitted) {
+        // the glyphs have been moved onto the path
+        cache.checkpoints.clear();
+        return;
+    }
+    cache.paragraphs.swap(_paragraphs);
+    cache.lines.swap(_lines);
+    cache.chunks.swap(_chunks);
+    cache.spans.swap(_spans);
+    cache.characters.swap(_characters);
+    cache.glyphs.swap(_glyphs);
+    cache.output_kept = true;
+}
+
+void Layout::_deleteParagraphCache()
+{
+    delete _paragraph_cache;
+    _paragraph_cache = NULL;
+}
+
 /** \brief private to Layout. Does the real work of text flowing.
 
 This class does a standard greedy paragraph wrapping algorithm.
@@ -189,6 +336,7 @@ class Layout::Calculator
         std::vector<PangoItemInfo> pango_items;
         std::vector<PangoLogAttr> char_attributes;    ///< For every character in the paragraph.
         std::vector<UnbrokenSpan> unbroken_spans;
+        ParagraphCache::ShapedParagraph *shaped;      ///< Cache entry for the itemization and glyphs.
 
         template<typename T> static void free_sequence(T &seq);
         void free();
@@ -204,6 +352,14 @@ class Layout::Calculator
 
     void _buildPangoItemizationForPara(ParagraphInfo *para) const;
 
+    std::string _wrapShapesSignature() const;
+
+    void _buildParagraphSignature(unsigned begin, unsigned end, std::string *signature) const;
+
+    unsigned _restoreKeptOutput(LineHeight *line_height);
+
+    void _addCheckpoint(unsigned begin, unsigned end, ParagraphInfo const &para, LineHeight const &line_height);
+
     static void _computeFontLineHeight(font_instance *font, double font_size,
                                        SPStyle const *style, LineHeight *line_height,
                                        double *line_height_multiplier);
@@ -875,16 +1031,18 @@ void Layout::Calculator::ParagraphInfo::free()
 /**
  * Take all the text from \a _para.first_input_index to the end of the
  * paragraph and stitch it together so that pango_itemize() can be called on
- * the whole thing.
+ * the whole thing. If the same text with the same fonts has been itemized
+ * before, the result is copied from the ParagraphCache instead.
  *
  * Input: para.first_input_index.
- * Output: para.direction, para.pango_items, para.char_attributes.
+ * Output: para.direction, para.pango_items, para.char_attributes, para.shaped.
  */
 void Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) const
 {
     Glib::ustring para_text;
     PangoAttrList *attributes_list;
     unsigned input_index;
+    std::string cache_key;    // the fonts and where they change; the text is appended later
 
     para->free_sequence(para->pango_items);
     para->char_attributes.clear();
@@ -903,33 +1061,77 @@ void Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) cons
         } else if (_flow._input_stream[input_index]->Type() == TEXT_SOURCE) {
             Layout::InputStreamTextSource *text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[input_index]);
 
-			// create the font_instance
-			font_instance *font = text_source->styleGetFontInstance();
-			if (font == NULL)
-				continue;  // bad news: we'll have to ignore all this text because we know of no font to render it
+            // create the font_instance
+            font_instance *font = text_source->styleGetFontInstance();
+            if (font == NULL) {
+                // bad news: we'll have to ignore all this text because we know of no font to render it
+                cache_key += '-';
+                cache_key.append(text_source->text_begin.base(), text_source->text_end.base());
+                cache_key += '\0';
+                continue;
+            }
+
+            gchar *font_description_string = pango_font_description_to_string(font->descr);
+            cache_key += font_description_string;
+            cache_key += '\0';
+            g_free(font_description_string);
 
             PangoAttribute *attribute_font_description = pango_attr_font_desc_new(font->descr);
+            font->Unref();
             attribute_font_description->start_index = para_text.bytes();
             para_text.append(&*text_source->text_begin.base(), text_source->text_length);     // build the combined text
             attribute_font_description->end_index = para_text.bytes();
             pango_attr_list_insert(attributes_list, attribute_font_description);
             // ownership of attribute is assumed by the list
+
+            unsigned const end_index = attribute_font_description->end_index;
+            cache_key.append(reinterpret_cast<char const *>(&end_index), sizeof(end_index));
         }
     }
 
     TRACE(("whole para: \"%s\"\n", para_text.data()));
     TRACE(("%d input sources used\n", input_index - para->first_input_index));
 
-    // do the pango_itemize()
-    GList *pango_items_glist = NULL;
+    Layout::InputStreamTextSource const *first_text_source = NULL;
     if (_flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE) {
-        Layout::InputStreamTextSource const *text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
-        if (text_source->style->direction.set) {
-            PangoDirection pango_direction = (PangoDirection)_enum_converter(text_source->style->direction.computed, enum_convert_spstyle_direction_to_pango_direction, sizeof(enum_convert_spstyle_direction_to_pango_direction)/sizeof(enum_convert_spstyle_direction_to_pango_direction[0]));
-            pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para_text.data(), 0, para_text.bytes(), attributes_list, NULL);
-            para->direction = (Layout::Direction)_enum_converter(text_source->style->direction.computed, enum_convert_spstyle_direction_to_my_direction, sizeof(enum_convert_spstyle_direction_to_my_direction)/sizeof(enum_convert_spstyle_direction_to_my_direction[0]));
+        first_text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
+        if (first_text_source->style->direction.set) {
+            cache_key += 'd';
+            cache_key += static_cast<char>(first_text_source->style->direction.computed);
         }
     }
+    cache_key += '\0';
+    cache_key += para_text.raw();
+
+    ParagraphCache &cache = *_flow._paragraph_cache;
+    ParagraphCache::ShapedParagraph *&shaped = cache.shaped[cache_key];
+    if (shaped) {
+        // same as before
+        pango_attr_list_unref(attributes_list);
+        para->direction = shaped->direction;
+        para->pango_items.reserve(shaped->pango_items.size());
+        for (unsigned i = 0 ; i < shaped->pango_items.size() ; i++) {
+            PangoItemInfo new_item;
+            new_item.item = pango_item_copy(shaped->pango_items[i]);
+            new_item.font = shaped->fonts[i];
+            if (new_item.font)
+                new_item.font->Ref();
+            para->pango_items.push_back(new_item);
+        }
+        para->char_attributes = shaped->char_attributes;
+        shaped->generation = cache.generation;
+        para->shaped = shaped;
+        TRACE(("para itemization taken from the cache\n"));
+        return;
+    }
+
+    // do the pango_itemize()
+    GList *pango_items_glist = NULL;
+    if (first_text_source && first_text_source->style->direction.set) {
+        PangoDirection pango_direction = (PangoDirection)_enum_converter(first_text_source->style->direction.computed, enum_convert_spstyle_direction_to_pango_direction, sizeof(enum_convert_spstyle_direction_to_pango_direction)/sizeof(enum_convert_spstyle_direction_to_pango_direction[0]));
+        pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para_text.data(), 0, para_text.bytes(), attributes_list, NULL);
+        para->direction = (Layout::Direction)_enum_converter(first_text_source->style->direction.computed, enum_convert_spstyle_direction_to_my_direction, sizeof(enum_convert_spstyle_direction_to_my_direction)/sizeof(enum_convert_spstyle_direction_to_my_direction[0]));
+    }
     if (pango_items_glist == NULL) {  // no direction specified, guess it
         pango_items_glist = pango_itemize(_pango_context, para_text.data(), 0, para_text.bytes(), attributes_list, NULL);
 
@@ -940,6 +1142,11 @@ void Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) cons
     }
     pango_attr_list_unref(attributes_list);
 
+    shaped = new ParagraphCache::ShapedParagraph;
+    shaped->direction = para->direction;
+    shaped->generation = cache.generation;
+    para->shaped = shaped;
+
     // convert the GList to our vector<> and make the font_instance for each PangoItem at the same time
     para->pango_items.reserve(g_list_length(pango_items_glist));
     TRACE(("para itemizes to %d sections\n", g_list_length(pango_items_glist)));
@@ -950,12 +1157,18 @@ void Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) cons
         new_item.font = (font_factory::Default())->Face(font_description);
         pango_font_description_free(font_description);   // Face() makes a copy
         para->pango_items.push_back(new_item);
+
+        shaped->pango_items.push_back(pango_item_copy(new_item.item));
+        shaped->fonts.push_back(new_item.font);
+        if (new_item.font)
+            new_item.font->Ref();
     }
     g_list_free(pango_items_glist);
 
     // and get the character attributes on everything
     para->char_attributes.resize(para_text.length() + 1);
     pango_get_log_attrs(para_text.data(), para_text.bytes(), -1, NULL, &*para->char_attributes.begin(), para->char_attributes.size());
+    shaped->char_attributes = para->char_attributes;
 
     TRACE(("end para itemize, direction = %d\n", para->direction));
 }
@@ -1116,42 +1329,48 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                 // now we know the length, do some final calculations and add the UnbrokenSpan to the list
                 new_span.font_size = text_source->styleComputeFontSize();
                 if (new_span.text_bytes) {
-                    new_span.glyph_string = pango_glyph_string_new();
-                    /* Some assertions intended to help diagnose bug #1277746. */
-                    g_assert( 0 < new_span.text_bytes );
-                    g_assert( span_start_byte_in_source < text_source->text->bytes() );
-                    g_assert( span_start_byte_in_source + new_span.text_bytes <= text_source->text->bytes() );
-                    g_assert( memchr(text_source->text->data() + span_start_byte_in_source, '\0', static_cast<size_t>(new_span.text_bytes))
-                              == NULL );
-                    pango_shape(text_source->text->data() + span_start_byte_in_source,
-                                new_span.text_bytes,
-                                &para->pango_items[pango_item_index].item->analysis,
-                                new_span.glyph_string);
-
-                    if (para->pango_items[pango_item_index].item->analysis.level & 1) {
-                        // pango_shape() will reorder glyphs in rtl sections into visual order which messes
-                        // us up because the svg spec requires us to draw glyphs in logical order
-                        // let's reverse the glyphstring on a cluster-by-cluster basis
-                        const unsigned nglyphs = new_span.glyph_string->num_glyphs;
-                        std::vector<PangoGlyphInfo> infos(nglyphs);
-                        std::vector<gint> clusters(nglyphs);
-                        unsigned i, cluster_start = 0;
-
-                        for (i = 0 ; i < nglyphs ; ++i) {
-                            if (new_span.glyph_string->glyphs[i].attr.is_cluster_start) {
-                                if (i != cluster_start) {
-                                    std::copy(&new_span.glyph_string->glyphs[cluster_start], &new_span.glyph_string->glyphs[i], infos.end() - i);
-                                    std::copy(&new_span.glyph_string->log_clusters[cluster_start], &new_span.glyph_string->log_clusters[i], clusters.end() - i);
+                    PangoGlyphString *&cached_glyph_string = para->shaped->glyph_strings[std::make_pair(byte_index_in_para, new_span.text_bytes)];
+                    if (cached_glyph_string) {
+                        new_span.glyph_string = pango_glyph_string_copy(cached_glyph_string);
+                    } else {
+                        new_span.glyph_string = pango_glyph_string_new();
+                        /* Some assertions intended to help diagnose bug #1277746. */
+                        g_assert( 0 < new_span.text_bytes );
+                        g_assert( span_start_byte_in_source < text_source->text->bytes() );
+                        g_assert( span_start_byte_in_source + new_span.text_bytes <= text_source->text->bytes() );
+                        g_assert( memchr(text_source->text->data() + span_start_byte_in_source, '\0', static_cast<size_t>(new_span.text_bytes))
+                                  == NULL );
+                        pango_shape(text_source->text->data() + span_start_byte_in_source,
+                                    new_span.text_bytes,
+                                    &para->pango_items[pango_item_index].item->analysis,
+                                    new_span.glyph_string);
+
+                        if (para->pango_items[pango_item_index].item->analysis.level & 1) {
+                            // pango_shape() will reorder glyphs in rtl sections into visual order which messes
+                            // us up because the svg spec requires us to draw glyphs in logical order
+                            // let's reverse the glyphstring on a cluster-by-cluster basis
+                            const unsigned nglyphs = new_span.glyph_string->num_glyphs;
+                            std::vector<PangoGlyphInfo> infos(nglyphs);
+                            std::vector<gint> clusters(nglyphs);
+                            unsigned i, cluster_start = 0;
+
+                            for (i = 0 ; i < nglyphs ; ++i) {
+                                if (new_span.glyph_string->glyphs[i].attr.is_cluster_start) {
+                                    if (i != cluster_start) {
+                                        std::copy(&new_span.glyph_string->glyphs[cluster_start], &new_span.glyph_string->glyphs[i], infos.end() - i);
+                                        std::copy(&new_span.glyph_string->log_clusters[cluster_start], &new_span.glyph_string->log_clusters[i], clusters.end() - i);
+                                    }
+                                    cluster_start = i;
                                 }
-                                cluster_start = i;
                             }
+                            if (i != cluster_start) {
+                                std::copy(&new_span.glyph_string->glyphs[cluster_start], &new_span.glyph_string->glyphs[i], infos.end() - i);
+                                std::copy(&new_span.glyph_string->log_clusters[cluster_start], &new_span.glyph_string->log_clusters[i], clusters.end() - i);
+                            }
+                            std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
+                            std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
                         }
-                        if (i != cluster_start) {
-                            std::copy(&new_span.glyph_string->glyphs[cluster_start], &new_span.glyph_string->glyphs[i], infos.end() - i);
-                            std::copy(&new_span.glyph_string->log_clusters[cluster_start], &new_span.glyph_string->log_clusters[i], clusters.end() - i);
-                        }
-                        std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
-                        std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
+                        cached_glyph_string = pango_glyph_string_copy(new_span.glyph_string);
                     }
                     new_span.pango_item_index = pango_item_index;
                     _computeFontLineHeight(para->pango_items[pango_item_index].font, new_span.font_size, text_source->style, &new_span.line_height, &new_span.line_height_multiplier);
@@ -1198,6 +1417,215 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
     return input_index;
 }
 
+template<typename T> static void append_to_signature(std::string *signature, T const &value)
+{
+    signature->append(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+static void append_to_signature(std::string *signature, std::vector<SVGLength> const &lengths)
+{
+    append_to_signature(signature, lengths.size());
+    for (std::vector<SVGLength>::const_iterator it = lengths.begin() ; it != lengths.end() ; ++it) {
+        append_to_signature(signature, it->_set);
+        append_to_signature(signature, it->unit);
+        append_to_signature(signature, it->value);
+        append_to_signature(signature, it->computed);
+    }
+}
+
+/**
+ * Returns the geometry of all the wrap shapes; the output can only be
+ * taken over from the last flow if this is the same.
+ */
+std::string Layout::Calculator::_wrapShapesSignature() const
+{
+    std::string signature;
+    for (std::vector<InputWrapShape>::const_iterator it = _flow._input_wrap_shapes.begin() ; it != _flow._input_wrap_shapes.end() ; ++it) {
+        Shape const *shape = it->shape;
+        append_to_signature(&signature, shape->numberOfPoints());
+        for (int i = 0 ; i < shape->numberOfPoints() ; i++)
+            append_to_signature(&signature, shape->getPoint(i).x);
+        append_to_signature(&signature, shape->numberOfEdges());
+        for (int i = 0 ; i < shape->numberOfEdges() ; i++) {
+            append_to_signature(&signature, shape->getEdge(i).st);
+            append_to_signature(&signature, shape->getEdge(i).en);
+        }
+    }
+    return signature;
+}
+
+/**
+ * Appends everything about the input items \a begin to \a end (inclusive)
+ * which goes into their layout to \a signature. The output made from two
+ * runs of input items with the same signature is the same, given the same
+ * state of the calculator at their beginning.
+ *
+ * The position of the text in the owner's string is included because
+ * Layout::Span keeps an iterator into it.
+ */
+void Layout::Calculator::_buildParagraphSignature(unsigned begin, unsigned end, std::string *signature) const
+{
+    bool const try_text_align = !_flow._input_wrap_shapes.empty();
+
+    for (unsigned input_index = begin ; input_index <= end && input_index < _flow._input_stream.size() ; input_index++) {
+        if (_flow._input_stream[input_index]->Type() == CONTROL_CODE) {
+            Layout::InputStreamControlCode const *control_code = static_cast<Layout::InputStreamControlCode const *>(_flow._input_stream[input_index]);
+            *signature += 'c';
+            append_to_signature(signature, control_code->code);
+            append_to_signature(signature, control_code->ascent);
+            append_to_signature(signature, control_code->descent);
+            append_to_signature(signature, control_code->width);
+
+        } else if (_flow._input_stream[input_index]->Type() == TEXT_SOURCE) {
+            Layout::InputStreamTextSource const *text_source = static_cast<Layout::InputStreamTextSource const *>(_flow._input_stream[input_index]);
+            std::string const &text = text_source->text->raw();
+            *signature += 't';
+            append_to_signature(signature, text.data());
+            append_to_signature(signature, text_source->text_begin.base() - text.begin());
+            append_to_signature(signature, text_source->text_end.base() - text.begin());
+            append_to_signature(signature, text_source->text_length);
+            signature->append(text_source->text_begin.base(), text_source->text_end.base());
+
+            append_to_signature(signature, text_source->x);
+            append_to_signature(signature, text_source->y);
+            append_to_signature(signature, text_source->dx);
+            append_to_signature(signature, text_source->dy);
+            append_to_signature(signature, text_source->rotate);
+
+            SPStyle const *style = text_source->style;
+            double const font_size = text_source->styleComputeFontSize();
+            append_to_signature(signature, font_size);
+            font_instance *font = text_source->styleGetFontInstance();
+            if (font) {
+                gchar *font_description_string = pango_font_description_to_string(font->descr);
+                *signature += font_description_string;
+                g_free(font_description_string);
+                LineHeight line_height;
+                double line_height_multiplier;
+                _computeFontLineHeight(font, font_size, style, &line_height, &line_height_multiplier);
+                append_to_signature(signature, line_height_multiplier);
+                font->Unref();
+            }
+            *signature += '\0';
+            append_to_signature(signature, style->letter_spacing.computed);
+            append_to_signature(signature, style->word_spacing.computed);
+            append_to_signature(signature, style->baseline_shift.computed);
+            append_to_signature(signature, style->direction.set);
+            append_to_signature(signature, style->direction.computed);
+            append_to_signature(signature, text_source->styleGetBlockProgression());
+            append_to_signature(signature, text_source->styleGetAlignment(LEFT_TO_RIGHT, try_text_align));
+            append_to_signature(signature, text_source->styleGetAlignment(RIGHT_TO_LEFT, try_text_align));
+        }
+    }
+}
+
+/**
+ * If clear() kept the output of the last flow, finds the first paragraph
+ * whose input has changed since then, takes over the output before it and
+ * restores the state of the calculator after the paragraph before it.
+ * Returns the index in _flow._input_stream to continue the flow from.
+ */
+unsigned Layout::Calculator::_restoreKeptOutput(LineHeight *line_height)
+{
+    ParagraphCache &cache = *_flow._paragraph_cache;
+    std::string wrap_shapes_signature = _wrapShapesSignature();
+    unsigned const input_stream_size = _flow._input_stream.size();
+    unsigned reused = 0;
+
+    if (cache.output_kept && wrap_shapes_signature == cache.wrap_shapes_signature) {
+        unsigned begin = 0;
+        for ( ; reused < cache.checkpoints.size() ; reused++) {
+            ParagraphCache::Checkpoint const &checkpoint = cache.checkpoints[reused];
+            unsigned const end = checkpoint.end_input_index;
+            // calculate() also looks at whether anything follows the paragraph
+            bool same_end;
+            if (end == cache.input_stream_size)    // the paragraph went up to the end of the input
+                same_end = end == input_stream_size;
+            else
+                same_end = end < input_stream_size && (end + 1 < cache.input_stream_size) == (end + 1 < input_stream_size);
+            if (!same_end)
+                break;
+            std::string signature;
+            _buildParagraphSignature(begin, end, &signature);
+            if (signature != checkpoint.signature)
+                break;
+            begin = end + 1;
+        }
+    }
+
+    cache.checkpoints.resize(reused);
+    cache.wrap_shapes_signature.swap(wrap_shapes_signature);
+    cache.input_stream_size = input_stream_size;
+    if (reused == 0) {
+        cache.discardOutput();
+        return 0;
+    }
+
+    ParagraphCache::Checkpoint const &checkpoint = cache.checkpoints.back();
+    TRACE(("taking over %d paragraphs from the last flow\n", reused));
+    for (std::vector<Span>::iterator it_span = cache.spans.begin() + checkpoint.spans ; it_span != cache.spans.end() ; it_span++)
+        if (it_span->font) it_span->font->Unref();
+    cache.paragraphs.erase(cache.paragraphs.begin() + checkpoint.paragraphs, cache.paragraphs.end());
+    cache.lines.erase(cache.lines.begin() + checkpoint.lines, cache.lines.end());
+    cache.chunks.erase(cache.chunks.begin() + checkpoint.chunks, cache.chunks.end());
+    cache.spans.erase(cache.spans.begin() + checkpoint.spans, cache.spans.end());
+    cache.characters.erase(cache.characters.begin() + checkpoint.characters, cache.characters.end());
+    cache.glyphs.erase(cache.glyphs.begin() + checkpoint.glyphs, cache.glyphs.end());
+    _flow._paragraphs.swap(cache.paragraphs);
+    _flow._lines.swap(cache.lines);
+    _flow._chunks.swap(cache.chunks);
+    _flow._spans.swap(cache.spans);
+    _flow._characters.swap(cache.characters);
+    _flow._glyphs.swap(cache.glyphs);
+    cache.discardOutput();
+
+    // the scanline maker made by _createFirstScanlineMaker() can be reused if there is no wrapping
+    if (!checkpoint.has_scanline_maker || !_flow._input_wrap_shapes.empty()) {
+        delete _scanline_maker;
+        _scanline_maker = NULL;
+    }
+    _current_shape_index = checkpoint.shape_index;
+    if (checkpoint.has_scanline_maker) {
+        if (_scanline_maker == NULL)
+            _scanline_maker = new ShapeScanlineMaker(_flow._input_wrap_shapes[_current_shape_index].shape, _block_progression);
+        _scanline_maker->restorePosition(checkpoint.scanline_position);
+    }
+    _y_offset = checkpoint.y_offset;
+    *line_height = checkpoint.line_height;
+
+    // keep the shaped paragraphs which weren't needed this time
+    for (std::vector<ParagraphCache::Checkpoint>::iterator it = cache.checkpoints.begin() ; it != cache.checkpoints.end() ; ++it)
+        it->shaped->generation = cache.generation;
+
+    return checkpoint.end_input_index + 1;
+}
+
+/**
+ * Records the state of the calculator at the end of the paragraph made
+ * from the input items \a begin to \a end, see ParagraphCache.
+ */
+void Layout::Calculator::_addCheckpoint(unsigned begin, unsigned end, ParagraphInfo const &para, LineHeight const &line_height)
+{
+    ParagraphCache &cache = *_flow._paragraph_cache;
+    cache.checkpoints.push_back(ParagraphCache::Checkpoint());
+    ParagraphCache::Checkpoint &checkpoint = cache.checkpoints.back();
+    checkpoint.end_input_index = end;
+    _buildParagraphSignature(begin, end, &checkpoint.signature);
+    checkpoint.shaped = para.shaped;
+    checkpoint.shape_index = _current_shape_index;
+    checkpoint.has_scanline_maker = _scanline_maker != NULL;
+    if (_scanline_maker)
+        checkpoint.scanline_position = _scanline_maker->position();
+    checkpoint.y_offset = _y_offset;
+    checkpoint.line_height = line_height;
+    checkpoint.paragraphs = _flow._paragraphs.size();
+    checkpoint.lines = _flow._lines.size();
+    checkpoint.chunks = _flow._chunks.size();
+    checkpoint.spans = _flow._spans.size();
+    checkpoint.characters = _flow._characters.size();
+    checkpoint.glyphs = _flow._glyphs.size();
+}
+
 /**
  * Reinitialises the variables required on completion of one shape and
  * moving on to the next. Returns false if there are no more shapes to wrap
@@ -1454,9 +1882,16 @@ bool Layout::Calculator::calculate()
     _y_offset = 0.0;
     _createFirstScanlineMaker();
 
+    if (_flow._paragraph_cache == NULL)
+        _flow._paragraph_cache = new ParagraphCache;
+    _flow._paragraph_cache->generation++;
+
     ParagraphInfo para;
     LineHeight line_height; // needs to be maintained across paragraphs to be able to deal with blank paras
-    for(para.first_input_index = 0 ; para.first_input_index < _flow._input_stream.size() ; ) {
+    line_height.setZero();
+    para.first_input_index = _restoreKeptOutput(&line_height);
+    unsigned signature_begin = para.first_input_index;   // shape breaks count towards the following paragraph
+    for( ; para.first_input_index < _flow._input_stream.size() ; ) {
         // jump to the next wrap shape if this is a SHAPE_BREAK control code
         if (_flow._input_stream[para.first_input_index]->Type() == CONTROL_CODE) {
             InputStreamControlCode const *control_code = static_cast<InputStreamControlCode const *>(_flow._input_stream[para.first_input_index]);
@@ -1551,10 +1986,12 @@ bool Layout::Calculator::calculate()
             }
         }
         para.free();
-        para.first_input_index = para_end_input_index + 1;
+        _addCheckpoint(signature_begin, para_end_input_index, para, line_height);
+        para.first_input_index = signature_begin = para_end_input_index + 1;
     }
 
     para.free();
+    _flow._paragraph_cache->removeUnused();
     if (_scanline_maker) {
         delete _scanline_maker;
         _flow._input_truncated = false;
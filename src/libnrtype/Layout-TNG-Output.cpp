@@ -597,6 +597,7 @@ void Layout::transform(Geom::Affine const &transform)
 {
     // this is all massively oversimplified
     // I can't actually think of anybody who'll want to use it at the moment, so it'll stay simple
+    _deleteParagraphCache();    // the transformed output can't be kept for the next flow
     for (unsigned glyph_index = 0 ; glyph_index < _glyphs.size() ; glyph_index++) {
         Geom::Point point(_glyphs[glyph_index].x, _glyphs[glyph_index].y);
         point *= transform;
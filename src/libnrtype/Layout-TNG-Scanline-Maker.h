@@ -72,6 +72,20 @@ public:
     used now, and hence is the line advance height used by completeLine().
     */
     virtual bool canExtendCurrentScanline(Layout::LineHeight const &line_height) =0;
+
+    /** The state that changes while lines are being made. See position(). */
+    struct Position {
+        double y;
+        Layout::LineHeight line_height;
+    };
+
+    /** Returns the current state of the object, so that a new object made
+    for the same shape can carry on from here with restorePosition(). */
+    virtual Position position() const =0;
+
+    /** Moves a newly created object to the state returned by position()
+    of an earlier one. */
+    virtual void restorePosition(Position const &position) =0;
 };
 
 /** \brief private to Layout. Generates infinite scanlines for when you don't want wrapping
@@ -104,6 +118,10 @@ public:
     /** Always true, but has to save the new height */
     virtual bool canExtendCurrentScanline(Layout::LineHeight const &line_height);
 
+    virtual Position position() const;
+
+    virtual void restorePosition(Position const &position);
+
 private:
     double _x, _y;
     Layout::LineHeight _current_line_height;
@@ -132,6 +150,12 @@ public:
 
     /** never true */
     virtual bool canExtendCurrentScanline(Layout::LineHeight const &line_height);
+
+    /** Only the total of the line height is stored */
+    virtual Position position() const;
+
+    /** The rasterizer catches up on the next call to makeScanline() */
+    virtual void restorePosition(Position const &position);
 private:
     /** To generate scanlines for top-to-bottom text it is easiest if we
     simply rotate the given shape by a multiple of 90 degrees. This stores
@@ -73,6 +73,20 @@ bool Layout::InfiniteScanlineMaker::canExtendCurrentScanline(Layout::LineHeight
     return true;
 }
 
+Layout::ScanlineMaker::Position Layout::InfiniteScanlineMaker::position() const
+{
+    Position result;
+    result.y = _y;
+    result.line_height = _current_line_height;
+    return result;
+}
+
+void Layout::InfiniteScanlineMaker::restorePosition(Position const &position)
+{
+    _y = position.y;
+    _current_line_height = position.line_height;
+}
+
 // *********************** real shapes version
 
 Layout::ShapeScanlineMaker::ShapeScanlineMaker(Shape const *shape, Layout::Direction block_progression)
@@ -185,5 +199,21 @@ bool Layout::ShapeScanlineMaker::canExtendCurrentScanline(Layout::LineHeight con
     return false;
 }
 
+Layout::ScanlineMaker::Position Layout::ShapeScanlineMaker::position() const
+{
+    Position result;
+    result.y = _y;
+    result.line_height.setZero();
+    result.line_height.ascent = _current_line_height;
+    return result;
+}
+
+void Layout::ShapeScanlineMaker::restorePosition(Position const &position)
+{
+    // Scan() only moves downwards, which is fine for a new object
+    _y = (float)position.y;
+    _current_line_height = (float)position.line_height.total();
+}
+
 }//namespace Text
 }//namespace Inkscape
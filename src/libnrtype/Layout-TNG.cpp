@@ -19,16 +19,19 @@ const double Layout::LINE_HEIGHT_NORMAL = 1.25;
 Layout::Layout()
 {
     _path_fitted = NULL;
+    _paragraph_cache = NULL;
 }
 
 Layout::~Layout()
 {
     clear();
+    _deleteParagraphCache();
 }
 
 void Layout::clear()
 {
     _clearInputObjects();
+    _keepOutputObjects();
     _clearOutputObjects();
 }
 
@@ -202,7 +202,8 @@ public:
     /** Empties everything stored in this class and resets it to its
     original state, like when it was created. All iterators on this
     object will be invalidated (but can be revalidated using
-    validateIterator(). */
+    validateIterator(). The shaped text and the output are kept internally
+    so that calculating the flow of mostly the same input again is quick. */
     void clear();
 
     /** Queries whether any calls have been made to appendText() or
@@ -302,7 +303,9 @@ public:
     this object will be invalidated (but can be fixed with validateIterator().
     The implementation just creates a new Layout::Calculator and calls its
     Calculator::Calculate() method, so if you want more details on the
-    internals, go there.
+    internals, go there. Paragraphs which are the same as in the last flow
+    are not shaped again, and the output before the first paragraph which
+    changed is taken over if clear() was called in between.
       \return  false on failure.
     */
     bool calculateFlow();
@@ -677,6 +680,25 @@ private:
     };
     std::vector<InputWrapShape> _input_wrap_shapes;
 
+    // ******************* kept between flows
+
+    class ParagraphCache;
+
+    /** Shaped paragraphs and, after clear(), the output of the last flow,
+    so that calculateFlow() only has to redo the paragraphs which changed.
+    Created by the first calculateFlow(). See Layout-TNG-Compute.cpp. */
+    ParagraphCache *_paragraph_cache;
+
+    /** Called by clear() to move the output into #_paragraph_cache for
+    the next calculateFlow(), if it can be taken over. */
+    void _keepOutputObjects();
+
+    void _deleteParagraphCache();
+
+    // not implemented: #_paragraph_cache is owned
+    Layout(Layout const &);
+    Layout &operator=(Layout const &);
+
     // ******************* output
 
     /** as passed to fitToPathAlign() */
@@ -37,6 +37,7 @@
 #include <ieeefp.h>
 #endif
 #include <cstring>
+#include <map>
 #include <string>
 #include <locale.h>
 #include <stdlib.h>
@@ -49,6 +50,7 @@
 #include <libxml/tree.h>
 #include <glib.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
@@ -169,7 +171,7 @@ enum {
 
 int sp_main_gui(int argc, char const **argv);
 int sp_main_console(int argc, char const **argv);
-static void sp_do_export_png(SPDocument *doc);
+static void sp_do_export_png(SPDocument *doc, SPExportDrawing *shown = NULL);
 static void do_export_ps_pdf(SPDocument* doc, gchar const* uri, char const *mime);
 #ifdef WIN32
 static void do_export_emf(SPDocument* doc, gchar const* uri, char const *mime);
@@ -1002,32 +1004,113 @@ sp_main_gui(int argc, char const **argv)
 }
 
 /**
- * Process file list
+ * Open a document with the extension matching the file, falling back to SVG.
  */
-static int sp_process_file_list(GSList *fl)
+static SPDocument *sp_open_document(gchar const *filename)
 {
-    int retVal = 0;
-    while (fl) {
-        const gchar *filename = (gchar *)fl->data;
+    SPDocument *doc = NULL;
+    try {
+        doc = Inkscape::Extension::open(NULL, filename);
+    } catch (Inkscape::Extension::Input::no_extension_found &e) {
+        doc = NULL;
+    } catch (Inkscape::Extension::Input::open_failed &e) {
+        doc = NULL;
+    }
 
-        SPDocument *doc = NULL;
+    if (doc == NULL) {
         try {
-            doc = Inkscape::Extension::open(NULL, filename);
+            doc = Inkscape::Extension::open(Inkscape::Extension::db.get(SP_MODULE_KEY_INPUT_SVG), filename);
         } catch (Inkscape::Extension::Input::no_extension_found &e) {
             doc = NULL;
         } catch (Inkscape::Extension::Input::open_failed &e) {
             doc = NULL;
         }
+    }
+    return doc;
+}
 
-        if (doc == NULL) {
-            try {
-                doc = Inkscape::Extension::open(Inkscape::Extension::db.get(SP_MODULE_KEY_INPUT_SVG), filename);
-            } catch (Inkscape::Extension::Input::no_extension_found &e) {
-                doc = NULL;
-            } catch (Inkscape::Extension::Input::open_failed &e) {
-                doc = NULL;
-            }
+/**
+ * A document kept loaded between the commands of an interactive shell session,
+ * so that further commands on the same file neither reload it nor rebuild
+ * the drawing used for PNG export.
+ */
+struct ShellDocument {
+    SPDocument *doc;
+    SPExportDrawing *drawing; // created on the first PNG export
+    time_t mtime;
+};
+
+typedef std::map<std::string, ShellDocument> ShellDocumentMap;
+static ShellDocumentMap sp_shell_documents;
+
+static void sp_shell_document_release(ShellDocument &kept)
+{
+    delete kept.drawing;
+    delete kept.doc;
+}
+
+/**
+ * Return the kept document for filename, loading it if necessary or if the file
+ * was changed on disk since it was loaded.
+ */
+static ShellDocument *sp_shell_document_get(gchar const *filename)
+{
+    struct stat st;
+    time_t mtime = (g_stat(filename, &st) == 0) ? st.st_mtime : 0;
+
+    ShellDocumentMap::iterator i = sp_shell_documents.find(filename);
+    if (i != sp_shell_documents.end()) {
+        if (i->second.mtime == mtime) {
+            return &i->second;
         }
+        sp_shell_document_release(i->second);
+        sp_shell_documents.erase(i);
+    }
+
+    SPDocument *doc = sp_open_document(filename);
+    if (doc == NULL) {
+        return NULL;
+    }
+
+    ShellDocument &kept = sp_shell_documents[filename];
+    kept.doc = doc;
+    kept.drawing = NULL;
+    kept.mtime = mtime;
+    return &kept;
+}
+
+/**
+ * Release all documents kept by the interactive shell.
+ */
+static void sp_shell_documents_clear()
+{
+    for (ShellDocumentMap::iterator i = sp_shell_documents.begin(); i != sp_shell_documents.end(); ++i) {
+        sp_shell_document_release(i->second);
+    }
+    sp_shell_documents.clear();
+}
+
+/**
+ * Process file list
+ */
+static int sp_process_file_list(GSList *fl)
+{
+    int retVal = 0;
+    while (fl) {
+        const gchar *filename = (gchar *)fl->data;
+
+        // In shell mode documents are kept loaded for the following commands,
+        // unless this command modifies the document
+        bool modifies = sp_vacuum_defs || (sp_export_svg && sp_export_text_to_path);
+        ShellDocument *kept = NULL;
+        SPDocument *doc = NULL;
+        if (sp_shell && !modifies) {
+            kept = sp_shell_document_get(filename);
+            doc = kept ? kept->doc : NULL;
+        } else {
+            doc = sp_open_document(filename);
+        }
+
         if (doc == NULL) {
             g_warning("Specified document %s cannot be opened (does not exist or not a valid SVG file)", filename);
             retVal++;
@@ -1043,7 +1126,10 @@ static int sp_process_file_list(GSList *fl)
                 sp_print_document_to_file(doc, sp_global_printer);
             }
             if (sp_export_png || (sp_export_id && sp_export_use_hints)) {
-                sp_do_export_png(doc);
+                if (kept && !kept->drawing) {
+                    kept->drawing = new SPExportDrawing(doc);
+                }
+                sp_do_export_png(doc, kept ? kept->drawing : NULL);
             }
             if (sp_export_svg) {
                 if (sp_export_text_to_path) {
@@ -1099,7 +1185,9 @@ static int sp_process_file_list(GSList *fl)
                 do_query_dimension (doc, false, sp_query_x? Geom::X : Geom::Y, sp_query_id);
             }
 
-            delete doc;
+            if (!kept) {
+                delete doc;
+            }
         }
         fl = g_slist_remove(fl, fl->data);
     }
@@ -1177,6 +1265,7 @@ static int sp_main_shell(char const* command_name)
         } // if (linedata...
     } while (linedata && (retval == 0));
 
+    sp_shell_documents_clear();
     g_free(command_line);
     return retval;
 }
@@ -1294,7 +1383,7 @@ do_query_all_recurse (SPObject *o)
 }
 
 
-static void sp_do_export_png(SPDocument *doc)
+static void sp_do_export_png(SPDocument *doc, SPExportDrawing *shown)
 {
     Glib::ustring filename;
     bool filename_from_hint = false;
@@ -1510,7 +1599,7 @@ static void sp_do_export_png(SPDocument *doc)
     g_print("Bitmap saved as: %s\n", filename.c_str());
 
     if ((width >= 1) && (height >= 1) && (width <= PNG_UINT_31_MAX) && (height <= PNG_UINT_31_MAX)) {
-        sp_export_png_file(doc, path.c_str(), area, width, height, dpi, dpi, bgcolor, NULL, NULL, true, sp_export_id_only ? items : NULL);
+        sp_export_png_file(doc, path.c_str(), area, width, height, dpi, dpi, bgcolor, NULL, NULL, true, sp_export_id_only ? items : NULL, shown);
     } else {
         g_warning("Calculated bitmap dimensions %lu %lu are out of range (1 - %lu). Nothing exported.", width, height, (unsigned long int)PNG_UINT_31_MAX);
     }
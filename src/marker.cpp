@@ -14,7 +14,9 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <cmath>
 #include <cstring>
+#include <map>
 #include <string>
 #include "config.h"
 
@@ -22,19 +24,55 @@
 #include <2geom/transforms.h>
 #include "svg/svg.h"
 #include "display/drawing-group.h"
+#include "display/drawing-stamps.h"
 #include "xml/repr.h"
 #include "attributes.h"
 #include "marker.h"
 #include "document.h"
 #include "document-private.h"
 #include "preferences.h"
+#include "sp-clippath.h"
+#include "sp-mask.h"
+#include "sp-pattern.h"
+#include "sp-shape.h"
+#include "style.h"
+
+/**
+ * Placements of a marker which are drawn by one shared display item.
+ * Placements with the same scale and nearly the same orientation share an item;
+ * when the content of the marker can't be moved by a fraction of a pixel,
+ * every position gets its own item.
+ */
+struct SPMarkerBucketKey {
+    long turn;  ///< Orientation, in steps of SP_MARKER_ORIENT_STEPS per turn
+    long scale; ///< Logarithm of the scale, in steps of 2^-16
+    int pos;    ///< Position for items which are not shared, otherwise -1
+
+    bool operator<(SPMarkerBucketKey const &other) const {
+        if (pos != other.pos) return pos < other.pos;
+        if (turn != other.turn) return turn < other.turn;
+        return scale < other.scale;
+    }
+};
+
+struct SPMarkerBucket {
+    unsigned slot; ///< Slot of the shared item in the stamps
+    unsigned key;  ///< Display key of the shared item
+};
 
 struct SPMarkerView {
-	SPMarkerView *next;
-	unsigned int key;
-  std::vector<Inkscape::DrawingItem *> items;
+    SPMarkerView *next;
+    unsigned int key;
+    unsigned size;
+    bool shared;
+    Inkscape::DrawingStamps *stamps;
+    std::map<SPMarkerBucketKey, SPMarkerBucket> buckets;
 };
 
+/* Markers are turned to the middle of their step, which is off by at most
+ * 1/8192 turn (0.04 degrees) from the exact orientation. */
+static long const SP_MARKER_ORIENT_STEPS = 4096;
+
 static void sp_marker_class_init (SPMarkerClass *klass);
 static void sp_marker_init (SPMarker *marker);
 
@@ -50,6 +88,7 @@ static Geom::OptRect sp_marker_bbox(SPItem const *item, Geom::Affine const &tran
 static void sp_marker_print (SPItem *item, SPPrintContext *ctx);
 
 static void sp_marker_view_remove (SPMarker *marker, SPMarkerView *view, unsigned int destroyitems);
+static void sp_marker_view_clear (SPMarker *marker, SPMarkerView *view, bool unused_only);
 
 static SPGroupClass *parent_class = 0;
 
@@ -155,8 +194,6 @@ static void sp_marker_release(SPObject *object)
 
     while (marker->views) {
         // Destroy all DrawingItems etc.
-        // Parent class ::hide method
-        reinterpret_cast<SPItemClass *>(parent_class)->hide(marker, marker->views->key);
         sp_marker_view_remove (marker, marker->views, TRUE);
     }
 
@@ -436,12 +473,13 @@ static void sp_marker_update(SPObject *object, SPCtx *ctx, guint flags)
 
     // As last step set additional transform of drawing group
     for (SPMarkerView *v = marker->views; v != NULL; v = v->next) {
-        for (unsigned i = 0 ; i < v->items.size() ; i++) {
-            if (v->items[i]) {
-                Inkscape::DrawingGroup *g = dynamic_cast<Inkscape::DrawingGroup *>(v->items[i]);
-                g->setChildTransform(marker->c2p);
-            }
+        if (!v->stamps) continue;
+        for (unsigned i = 0 ; i < v->stamps->itemSlots() ; i++) {
+            Inkscape::DrawingGroup *g = dynamic_cast<Inkscape::DrawingGroup *>(v->stamps->item(i));
+            if (g) g->setChildTransform(marker->c2p);
         }
+        // the shared items are orphans, so their changes do not reach the stamps
+        v->stamps->itemsChanged();
     }
 }
 
@@ -549,97 +587,178 @@ sp_marker_print (SPItem */*item*/, SPPrintContext */*ctx*/)
 
 /* fixme: Remove link if zero-sized (Lauris) */
 
+/**
+ * Whether the display of @a object looks the same when it is drawn a fraction
+ * of a pixel further. Clips, masks, filters, opacity and patterns are drawn
+ * through intermediate surfaces on the pixel grid, so they are not.
+ */
+static bool
+sp_marker_can_share (SPObject *object)
+{
+    if (SP_IS_ITEM(object)) {
+        SPItem *item = SP_ITEM(object);
+        if (item->clip_ref->getObject() || item->mask_ref->getObject()) {
+            return false;
+        }
+        SPStyle *style = object->style;
+        if (style) {
+            if (style->getFilter() || style->opacity.value != SP_SCALE24_MAX) {
+                return false;
+            }
+            if (SP_IS_PATTERN(style->getFillPaintServer()) || SP_IS_PATTERN(style->getStrokePaintServer())) {
+                return false;
+            }
+        }
+        if (SP_IS_SHAPE(object) && SP_SHAPE(object)->hasMarkers()) {
+            return false;
+        }
+    }
+    for (SPObject *child = object->firstChild(); child; child = child->getNext()) {
+        if (!sp_marker_can_share(child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Find the bucket of the placement with transform @a m and the transform
+ * of its shared item. Only rotations with a uniform scale are put in buckets.
+ */
+static bool
+sp_marker_bucket (Geom::Affine const &m, SPMarkerBucketKey &bucket, Geom::Affine &transform)
+{
+    double const scale = hypot(m[0], m[1]);
+    if (scale < 1e-18) return false;
+    if (!Geom::are_near(m[0], m[3], 1e-9 * scale) || !Geom::are_near(m[1], -m[2], 1e-9 * scale)) {
+        return false;
+    }
+
+    double const step = 2 * M_PI / SP_MARKER_ORIENT_STEPS;
+    bucket.turn = static_cast<long>(floor(atan2(m[1], m[0]) / step + 0.5));
+    bucket.turn = (bucket.turn + SP_MARKER_ORIENT_STEPS) % SP_MARKER_ORIENT_STEPS;
+    bucket.scale = static_cast<long>(floor(log(scale) * 65536 + 0.5));
+    bucket.pos = -1;
+    transform = Geom::Rotate(bucket.turn * step) * Geom::Scale(exp(bucket.scale / 65536.0));
+    return true;
+}
+
 /**
  * Removes any SPMarkerViews that a marker has with a specific key.
- * Set up the DrawingItem array's size in the specified SPMarker's SPMarkerView.
- * This is called from sp_shape_update() for shapes that have markers.  It
- * removes the old view of the marker and establishes a new one, registering
- * it with the marker's list of views for future updates.
+ * Set up the number of placements in the specified SPMarker's SPMarkerView.
+ * This is called from sp_shape_update() for shapes that have markers, before
+ * the placements are set by sp_marker_show_instance(). It creates the view
+ * if needed, registering it with the marker's list of views for future updates,
+ * and drops the shared items which are no longer drawn.
  *
  * \param marker Marker to create views in.
  * \param key Key to give each SPMarkerView.
- * \param size Number of DrawingItems to put in the SPMarkerView.
+ * \param size Number of placements in the SPMarkerView.
  */
 void
 sp_marker_show_dimension (SPMarker *marker, unsigned int key, unsigned int size)
 {
     SPMarkerView *view;
-    unsigned int i;
 
     for (view = marker->views; view != NULL; view = view->next) {
         if (view->key == key) break;
     }
-    if (view && (view->items.size() != size)) {
-        /* Free old view and allocate new */
-        /* Parent class ::hide method */
-        ((SPItemClass *) parent_class)->hide ((SPItem *) marker, key);
-        sp_marker_view_remove (marker, view, TRUE);
-        view = NULL;
-    }
     if (!view) {
         view = new SPMarkerView();
-        view->items.clear();
-        for (i = 0; i < size; i++) {
-            view->items.push_back(NULL);
-        }
         view->next = marker->views;
         marker->views = view;
         view->key = key;
+        view->shared = true;
+        view->stamps = NULL;
     }
+
+    view->size = size;
+    if (view->stamps) {
+        view->stamps->setStampCount(size);
+    }
+
+    bool const shared = sp_marker_can_share(marker);
+    sp_marker_view_clear(marker, view, shared == view->shared);
+    view->shared = shared;
 }
 
 /**
  * Shows an instance of a marker.  This is called during sp_shape_update_marker_view()
- * show and transform a child item in the drawing for all views with the given key.
+ * to place the marker at position @a pos of the view with the given key.
+ * The content is shown once per bucket of placements and drawn at every
+ * placement of the bucket by the stamps item of the view.
  */
 Inkscape::DrawingItem *
 sp_marker_show_instance ( SPMarker *marker, Inkscape::DrawingItem *parent,
                           unsigned int key, unsigned int pos,
                           Geom::Affine const &base, float linewidth)
 {
+    SPMarkerView *v;
+    for (v = marker->views; v != NULL; v = v->next) {
+        if (v->key == key) break;
+    }
+    if (!v || pos >= v->size) {
+        return NULL;
+    }
+
+    if (!v->stamps) {
+        v->stamps = new Inkscape::DrawingStamps(parent->drawing());
+        v->stamps->setStampCount(v->size);
+        /* fixme: Position (Lauris) */
+        parent->prependChild(v->stamps);
+    }
+
     // do not show marker if linewidth == 0 and markerUnits == strokeWidth
     // otherwise Cairo will fail to render anything on the tile
     // that contains the "degenerate" marker
     if (marker->markerUnits == SP_MARKER_UNITS_STROKEWIDTH && linewidth == 0) {
+        v->stamps->clearStamp(pos);
         return NULL;
     }
 
-    for (SPMarkerView *v = marker->views; v != NULL; v = v->next) {
-        if (v->key == key) {
-            if (pos >= v->items.size()) {
-                return NULL;
-            }
-            if (!v->items[pos]) {
-                /* Parent class ::show method */
-                v->items[pos] = ((SPItemClass *) parent_class)->show ((SPItem *) marker,
-                                                                      parent->drawing(), key,
-                                                                      SP_ITEM_REFERENCE_FLAGS);
-                if (v->items[pos]) {
-                    /* fixme: Position (Lauris) */
-                    parent->prependChild(v->items[pos]);
-                    Inkscape::DrawingGroup *g = dynamic_cast<Inkscape::DrawingGroup *>(v->items[pos]);
-                    if (g) g->setChildTransform(marker->c2p);
-                }
-            }
-            if (v->items[pos]) {
-                Geom::Affine m;
-                if (marker->orient_auto) {
-                    m = base;
-                } else {
-                    /* fixme: Orient units (Lauris) */
-                    m = Geom::Rotate::from_degrees(marker->orient);
-                    m *= Geom::Translate(base.translation());
-                }
-                if (marker->markerUnits == SP_MARKER_UNITS_STROKEWIDTH) {
-                    m = Geom::Scale(linewidth) * m;
-                }
-                v->items[pos]->setTransform(m);
-            }
-            return v->items[pos];
-        }
+    Geom::Affine m;
+    if (marker->orient_auto) {
+        m = base;
+    } else {
+        /* fixme: Orient units (Lauris) */
+        m = Geom::Rotate::from_degrees(marker->orient);
+        m *= Geom::Translate(base.translation());
+    }
+    if (marker->markerUnits == SP_MARKER_UNITS_STROKEWIDTH) {
+        m = Geom::Scale(linewidth) * m;
     }
 
-    return NULL;
+    SPMarkerBucketKey bk;
+    Geom::Affine transform;
+    Geom::Point origin;
+    if (v->shared && sp_marker_bucket(m, bk, transform)) {
+        origin = m.translation();
+    } else {
+        bk.turn = bk.scale = 0;
+        bk.pos = pos;
+        transform = m;
+    }
+
+    std::map<SPMarkerBucketKey, SPMarkerBucket>::iterator b = v->buckets.find(bk);
+    if (b == v->buckets.end()) {
+        SPMarkerBucket bucket;
+        bucket.key = SPItem::display_key_new(1);
+        /* Parent class ::show method */
+        Inkscape::DrawingItem *item = ((SPItemClass *) parent_class)->show ((SPItem *) marker,
+                                                                           parent->drawing(), bucket.key,
+                                                                           SP_ITEM_REFERENCE_FLAGS);
+        if (!item) {
+            v->stamps->clearStamp(pos);
+            return NULL;
+        }
+        Inkscape::DrawingGroup *g = dynamic_cast<Inkscape::DrawingGroup *>(item);
+        if (g) g->setChildTransform(marker->c2p);
+        bucket.slot = v->stamps->addItem(item);
+        b = v->buckets.insert(std::make_pair(bk, bucket)).first;
+    }
+    v->stamps->setItemTransform(b->second.slot, transform);
+    v->stamps->setStamp(pos, b->second.slot, origin);
+    return v->stamps;
 }
 
 /**
@@ -657,8 +776,6 @@ sp_marker_hide (SPMarker *marker, unsigned int key)
 		SPMarkerView *next;
 		next = v->next;
 		if (v->key == key) {
-			/* Parent class ::hide method */
-			((SPItemClass *) parent_class)->hide ((SPItem *) marker, key);
 			sp_marker_view_remove (marker, v, TRUE);
 			return;
 		}
@@ -667,13 +784,35 @@ sp_marker_hide (SPMarker *marker, unsigned int key)
 }
 
 /**
- * Removes a given view.  Also will destroy sub-items in the view if destroyitems
- * is set to a non-zero value.
+ * Hides and deletes the shared items of a view, or only those which
+ * no placement draws if unused_only is set.
+ */
+static void
+sp_marker_view_clear (SPMarker *marker, SPMarkerView *view, bool unused_only)
+{
+    std::map<SPMarkerBucketKey, SPMarkerBucket>::iterator i = view->buckets.begin();
+    while (i != view->buckets.end()) {
+        std::map<SPMarkerBucketKey, SPMarkerBucket>::iterator next = i;
+        ++next;
+        if (!unused_only || !view->stamps || !view->stamps->itemUses(i->second.slot)) {
+            /* Parent class ::hide method */
+            ((SPItemClass *) parent_class)->hide ((SPItem *) marker, i->second.key);
+            if (view->stamps) {
+                view->stamps->removeItem(i->second.slot);
+            }
+            view->buckets.erase(i);
+        }
+        i = next;
+    }
+}
+
+/**
+ * Removes a given view.  Also will hide and destroy the display items
+ * of the view if destroyitems is set to a non-zero value.
  */
 static void
 sp_marker_view_remove (SPMarker *marker, SPMarkerView *view, unsigned int destroyitems)
 {
-	unsigned int i;
 	if (view == marker->views) {
 		marker->views = view->next;
 	} else {
@@ -682,12 +821,9 @@ sp_marker_view_remove (SPMarker *marker, SPMarkerView *view, unsigned int destro
 		v->next = view->next;
 	}
 	if (destroyitems) {
-      for (i = 0; i < view->items.size(); i++) {
-			/* We have to walk through the whole array because there may be hidden items */
-			delete view->items[i];
-		}
+        sp_marker_view_clear(marker, view, false);
+        delete view->stamps;
 	}
-    view->items.clear();
     delete view;
 }
 
@@ -36,13 +36,15 @@
 #include "helper/geom-curves.h"
 #include "desktop.h"
 #include "sp-root.h"
+#include "snap-candidate-index.h"
 
 Inkscape::ObjectSnapper::ObjectSnapper(SnapManager *sm, Geom::Coord const d)
     : Snapper(sm, d)
 {
-    _candidates = new std::vector<SnapCandidateItem>;
+    _candidates = new std::vector<SnapCandidateIndex::Record *>;
     _points_to_snap_to = new std::vector<SnapCandidatePoint>;
     _paths_to_snap_to = new std::vector<SnapCandidatePath >;
+    _index = new SnapCandidateIndex;
 }
 
 Inkscape::ObjectSnapper::~ObjectSnapper()
@@ -55,6 +57,8 @@ Inkscape::ObjectSnapper::~ObjectSnapper()
 
     _clear_paths();
     delete _paths_to_snap_to;
+
+    delete _index;
 }
 
 Geom::Coord Inkscape::ObjectSnapper::getSnapperTolerance() const
@@ -69,90 +73,43 @@ bool Inkscape::ObjectSnapper::getSnapperAlwaysSnap() const
     return _snapmanager->snapprefs.getObjectTolerance() == 10000; //TODO: Replace this threshold of 10000 by a constant; see also tolerance-slider.cpp
 }
 
-void Inkscape::ObjectSnapper::_findCandidates(SPObject* parent,
-                                              std::vector<SPItem const *> const *it,
-                                              bool const &first_point,
-                                              Geom::Rect const &bbox_to_snap,
-                                              bool const clip_or_mask,
-                                              Geom::Affine const additional_affine) const // transformation of the item being clipped / masked
+void Inkscape::ObjectSnapper::_findCandidates(std::vector<SPItem const *> const *it,
+                                              Geom::Rect const &bbox_to_snap) const
 {
+    _candidates->clear();
+
     SPDesktop const *dt = _snapmanager->getDesktop();
     if (dt == NULL) {
         g_warning("desktop == NULL, so we cannot snap; please inform the developers of this bug");
         // Apparently the setup() method from the SnapManager class hasn't been called before trying to snap.
-    }
-
-    if (first_point) {
-        _candidates->clear();
+        return;
     }
 
     Geom::Rect bbox_to_snap_incl = bbox_to_snap; // _incl means: will include the snapper tolerance
     bbox_to_snap_incl.expandBy(getSnapperTolerance()); // see?
 
-    for ( SPObject *o = parent->firstChild(); o; o = o->getNext() ) {
-        g_assert(dt != NULL);
-        if (SP_IS_ITEM(o) && !(dt->itemIsHidden(SP_ITEM(o)) && !clip_or_mask)) {
-            // Snapping to items in a locked layer is allowed
-            // Don't snap to hidden objects, unless they're a clipped path or a mask
-            /* See if this item is on the ignore list */
-            std::vector<SPItem const *>::const_iterator i;
-            if (it != NULL) {
-                i = it->begin();
-                while (i != it->end() && *i != o) {
-                    ++i;
-                }
-            }
-
-            if (it == NULL || i == it->end()) {
-                SPItem *item = SP_ITEM(o);
-                if (item) {
-                    SPObject *obj = NULL;
-                    if (!clip_or_mask) { // cannot clip or mask more than once
-                        // The current item is not a clipping path or a mask, but might
-                        // still be the subject of clipping or masking itself ; if so, then
-                        // we should also consider that path or mask for snapping to
-                        obj = SP_OBJECT(item->clip_ref ? item->clip_ref->getObject() : NULL);
-                        if (obj && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH_CLIP)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
-                        }
-                        obj = SP_OBJECT(item->mask_ref ? item->mask_ref->getObject() : NULL);
-                        if (obj && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH_MASK)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
-                        }
-                    }
-                }
-
-                if (SP_IS_GROUP(o)) {
-                    _findCandidates(o, it, false, bbox_to_snap, clip_or_mask, additional_affine);
-                } else {
-                    Geom::OptRect bbox_of_item;
-                    Preferences *prefs = Preferences::get();
-                    int prefs_bbox = prefs->getBool("/tools/bounding_box", 0);
-                    // We'll only need to obtain the visual bounding box if the user preferences tell
-                    // us to, AND if we are snapping to the bounding box itself. If we're snapping to
-                    // paths only, then we can just as well use the geometric bounding box (which is faster)
-                    SPItem::BBoxType bbox_type = (!prefs_bbox && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CATEGORY)) ?
-                        SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
-                    if (clip_or_mask) {
-                        // Oh oh, this will get ugly. We cannot use sp_item_i2d_affine directly because we need to
-                        // insert an additional transformation in document coordinates (code copied from sp_item_i2d_affine)
-                        bbox_of_item = item->bounds(bbox_type, item->i2doc_affine() * additional_affine * dt->doc2dt());
-                    } else {
-                        bbox_of_item = item->desktopBounds(bbox_type);
-                    }
-                    if (bbox_of_item) {
-                        // See if the item is within range
-                        if (bbox_to_snap_incl.intersects(*bbox_of_item)
-                                || (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER) && bbox_to_snap_incl.contains(item->getCenter()))) { // rotation center might be outside of the bounding box
-                            // This item is within snapping range, so record it as a candidate
-                            _candidates->push_back(SnapCandidateItem(item, clip_or_mask, additional_affine));
-                            // For debugging: print the id of the candidate to the console
-                            // SPObject *obj = (SPObject*)item;
-                            // std::cout << "Snap candidate added: " << obj->getId() << std::endl;
-                        }
-                    }
-                }
-            }
+    Preferences *prefs = Preferences::get();
+    int prefs_bbox = prefs->getBool("/tools/bounding_box", 0);
+    // We'll only need to obtain the visual bounding box if the user preferences tell
+    // us to, AND if we are snapping to the bounding box itself. If we're snapping to
+    // paths only, then we can just as well use the geometric bounding box (which is faster)
+    SPItem::BBoxType bbox_type = (!prefs_bbox && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CATEGORY)) ?
+        SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
+
+    std::vector<SnapCandidateIndex::Record *> found;
+    _index->find(dt, _snapmanager->getDocument(), bbox_type,
+                 _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH_CLIP),
+                 _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH_MASK),
+                 bbox_to_snap_incl, it, found);
+
+    bool const centers = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER);
+    for (std::vector<SnapCandidateIndex::Record *>::const_iterator i = found.begin(); i != found.end(); ++i) {
+        SnapCandidateIndex::Record const &r = **i;
+        // See if the item is within range
+        if (bbox_to_snap_incl.intersects(*r.bbox)
+                || (centers && bbox_to_snap_incl.contains(r.center))) { // rotation center might be outside of the bounding box
+            // This item is within snapping range, so record it as a candidate
+            _candidates->push_back(*i);
         }
     }
 }
@@ -191,14 +148,7 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
             _getBorderNodes(_points_to_snap_to);
         }
 
-        for (std::vector<SnapCandidateItem>::const_iterator i = _candidates->begin(); i != _candidates->end(); ++i) {
-            //Geom::Affine i2doc(Geom::identity());
-            SPItem *root_item = (*i).item;
-            if (SP_IS_USE((*i).item)) {
-                root_item = sp_use_root(SP_USE((*i).item));
-            }
-            g_return_if_fail(root_item);
-
+        for (std::vector<SnapCandidateIndex::Record *>::const_iterator i = _candidates->begin(); i != _candidates->end(); ++i) {
             //Collect all nodes so we can snap to them
             if (p_is_a_node || p_is_other || (p_is_a_bbox && !_snapmanager->snapprefs.getStrictSnapping())) {
                 // Note: there are two ways in which intersections are considered:
@@ -224,36 +174,42 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
                 if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH)) {
                     // So if we snap to paths, then findBestSnap will find the intersections
                     // and therefore we temporarily disable SNAPTARGET_PATH_INTERSECTION, which will
-                    // avoid root_item->getSnappoints() below from returning intersections
+                    // keep the snap points collected below free of intersections
                     _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, false);
                 }
 
                 // We should not snap a transformation center to any of the centers of the items in the
-                // current selection (see the comment in SelTrans::centerRequest())
-                bool old_pref2 = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER);
-                if (old_pref2) {
+                // current selection (see the comment in SelTrans::centerRequest()). These are left out
+                // below rather than by changing the preferences, which would make the index collect
+                // the snap points of all other items again.
+                bool skip_center = false;
+                if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER)) {
                     for ( GSList const *itemlist = _snapmanager->getRotationCenterSource(); itemlist != NULL; itemlist = g_slist_next(itemlist) ) {
-                        if ((*i).item == reinterpret_cast<SPItem*>(itemlist->data)) {
+                        if ((*i)->item == reinterpret_cast<SPItem*>(itemlist->data)) {
                             // don't snap to this item's rotation center
-                            _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_ROTATION_CENTER, false);
+                            skip_center = true;
                             break;
                         }
                     }
                 }
 
-                root_item->getSnappoints(*_points_to_snap_to, &_snapmanager->snapprefs);
+                std::vector<SnapCandidatePoint> const &nodes = _index->nodes(**i, _snapmanager->snapprefs);
+                for (std::vector<SnapCandidatePoint>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+                    if (!skip_center || n->getTargetType() != SNAPTARGET_ROTATION_CENTER) {
+                        _points_to_snap_to->push_back(*n);
+                    }
+                }
 
                 // restore the original snap preferences
                 _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, old_pref);
-                _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_ROTATION_CENTER, old_pref2);
             }
 
             //Collect the bounding box's corners so we can snap to them
             if (p_is_a_bbox || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_node) || p_is_other) {
                 // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
                 // of the item AND the bbox of the clipping path at the same time
-                if (!(*i).clip_or_mask) {
-                    Geom::OptRect b = root_item->desktopBounds(bbox_type);
+                if ((*i)->owner == NULL) {
+                    Geom::OptRect const &b = _index->bounds(**i, bbox_type);
                     getBBoxPoints(b, _points_to_snap_to, true,
                             _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER),
                             _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE_MIDPOINT),
@@ -376,64 +332,20 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
             }
         }
 
-        for (std::vector<SnapCandidateItem>::const_iterator i = _candidates->begin(); i != _candidates->end(); ++i) {
-
-            /* Transform the requested snap point to this item's coordinates */
-            Geom::Affine i2doc(Geom::identity());
-            SPItem *root_item = NULL;
-            /* We might have a clone at hand, so make sure we get the root item */
-            if (SP_IS_USE((*i).item)) {
-                i2doc = sp_use_get_root_transform(SP_USE((*i).item));
-                root_item = sp_use_root(SP_USE((*i).item));
-                g_return_if_fail(root_item);
-            } else {
-                i2doc = (*i).item->i2doc_affine();
-                root_item = (*i).item;
-            }
+        for (std::vector<SnapCandidateIndex::Record *>::const_iterator i = _candidates->begin(); i != _candidates->end(); ++i) {
 
             //Build a list of all paths considered for snapping to
 
             //Add the item's path to snap to
             if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION, SNAPTARGET_TEXT_BASELINE)) {
                 if (p_is_other || p_is_a_node || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_bbox)) {
-                    if (SP_IS_TEXT(root_item) || SP_IS_FLOWTEXT(root_item)) {
-                        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE)) {
-                            // Snap to the text baseline
-                            Text::Layout const *layout = te_get_layout(static_cast<SPItem *>(root_item));
-                            if (layout != NULL && layout->outputExists()) {
-                                Geom::PathVector *pv = new Geom::PathVector();
-                                pv->push_back(layout->baseline() * root_item->i2dt_affine() * (*i).additional_affine * _snapmanager->getDesktop()->doc2dt());
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_TEXT_BASELINE, Geom::OptRect()));
-                            }
-                        }
-                    } else {
-                        // Snapping for example to a traced bitmap is very stressing for
-                        // the CPU, so we'll only snap to paths having no more than 500 nodes
-                        // This also leads to a lag of approx. 500 msec (in my lousy test set-up).
-                        bool very_complex_path = false;
-                        if (SP_IS_PATH(root_item)) {
-                            very_complex_path = SP_PATH(root_item)->nodesInPath() > 500;
-                        }
-
-                        if (!very_complex_path && root_item && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION)) {
-                            SPCurve *curve = NULL;
-                            if (SP_IS_SHAPE(root_item)) {
-                               curve = SP_SHAPE(root_item)->getCurve();
-                            }/* else if (SP_IS_TEXT(root_item) || SP_IS_FLOWTEXT(root_item)) {
-                               curve = te_get_layout(root_item)->convertToCurves();
-                            }*/
-                            if (curve) {
-                                // We will get our own copy of the pathvector, which must be freed at some point
-
-                                // Geom::PathVector *pv = pathvector_for_curve(root_item, curve, true, true, Geom::identity(), (*i).additional_affine);
-
-                                Geom::PathVector *pv = new Geom::PathVector(curve->get_pathvector());
-                                (*pv) *= root_item->i2dt_affine() * (*i).additional_affine * _snapmanager->getDesktop()->doc2dt(); // (_edit_transform * _i2d_transform);
-
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_PATH, Geom::OptRect())); // Perhaps for speed, get a reference to the Geom::pathvector, and store the transformation besides it.
-                                curve->unref();
-                            }
-                        }
+                    // The index keeps the path, so we don't have to fetch and transform it for every snap
+                    SnapTargetType target = SNAPTARGET_UNDEFINED;
+                    Geom::PathVector *pv = _index->path(**i, target);
+                    if (pv && (target == SNAPTARGET_TEXT_BASELINE ?
+                               _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE) :
+                               _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION))) {
+                        _paths_to_snap_to->push_back(SnapCandidatePath(pv, target, Geom::OptRect(), false, true));
                     }
                 }
             }
@@ -443,11 +355,11 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
                 if (p_is_other || p_is_a_bbox || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_node)) {
                     // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
                     // of the item AND the bbox of the clipping path at the same time
-                    if (!(*i).clip_or_mask) {
-                        Geom::OptRect rect = root_item->bounds(bbox_type, i2doc);
+                    if ((*i)->owner == NULL) {
+                        Geom::OptRect const &rect = _index->bounds(**i, bbox_type);
                         if (rect) {
-                            Geom::PathVector *path = _getPathvFromRect(*rect);
-                            rect = root_item->desktopBounds(bbox_type);
+                            // doc2dt() only flips and shifts, so the box in document coordinates is exact
+                            Geom::PathVector *path = _getPathvFromRect(*rect * _snapmanager->getDesktop()->dt2doc());
                             _paths_to_snap_to->push_back(SnapCandidatePath(path, SNAPTARGET_BBOX_EDGE, rect));
                         }
                     }
@@ -698,7 +610,7 @@ void Inkscape::ObjectSnapper::freeSnap(IntermSnapResults &isr,
     /* Get a list of all the SPItems that we will try to snap to */
     if (p.getSourceNum() <= 0) {
         Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(p.getPoint(), p.getPoint());
-        _findCandidates(_snapmanager->getDocument()->getRoot(), it, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _findCandidates(it, local_bbox_to_snap);
     }
 
     _snapNodes(isr, p, unselected_nodes);
@@ -742,7 +654,7 @@ void Inkscape::ObjectSnapper::constrainedSnap( IntermSnapResults &isr,
     /* Get a list of all the SPItems that we will try to snap to */
     if (p.getSourceNum() <= 0) {
         Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(pp, pp);
-        _findCandidates(_snapmanager->getDocument()->getRoot(), it, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _findCandidates(it, local_bbox_to_snap);
     }
 
     // A constrained snap, is a snap in only one degree of freedom (specified by the constraint line).
@@ -764,7 +676,9 @@ bool Inkscape::ObjectSnapper::ThisSnapperMightSnap() const
 void Inkscape::ObjectSnapper::_clear_paths() const
 {
     for (std::vector<SnapCandidatePath >::const_iterator k = _paths_to_snap_to->begin(); k != _paths_to_snap_to->end(); ++k) {
-        delete k->path_vector;
+        if (!k->borrowed) {
+            delete k->path_vector;
+        }
     }
     _paths_to_snap_to->clear();
 }
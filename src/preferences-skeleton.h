@@ -233,6 +233,7 @@ static char const preferences_skeleton[] =
 "\n"
 "  <group id=\"options\">\n"
 "    <group id=\"renderingcache\" size=\"64\" />"
+"    <group id=\"undo\" memory=\"128\" packafter=\"16\" />"
 "    <group id=\"useoldpdfexporter\" value=\"0\" />"
 "    <group id=\"highlightoriginal\" value=\"1\" />"
 "    <group id=\"relinkclonesonduplicate\" value=\"0\" />"
@@ -111,6 +111,14 @@ public:
         TS_ASSERT_EQUALS(obs.value, 10); // no notifications sent after removal
     }
     
+    void testObserverLeavesMissingGroups()
+    {
+        TestObserver obs("/test/observer/missing/path");
+        prefs->addObserver(obs);
+        TS_ASSERT(prefs->getAllDirs("/test/observer").empty());
+        prefs->removeObserver(obs);
+    }
+
     void testPreferencesEntryMethods()
     {
         prefs->setInt("/test/prefentry", 100);
@@ -120,6 +128,23 @@ public:
         TS_ASSERT_EQUALS(val.getEntryName(), "prefentry");
         TS_ASSERT_EQUALS(val.getInt(), 100);
     }
+
+    void testPrefHandle()
+    {
+        prefs->setInt("/test/handle/intvalue", 100);
+        Inkscape::PrefHandle<int> handle("/test/handle/intvalue", 1);
+        Inkscape::PrefHandle<int> limited("/test/handle/intvalue", 1, 0, 500);
+        Inkscape::PrefHandle<double> unset("/test/handle/notset/doublevalue", 0.5);
+        TS_ASSERT_EQUALS(handle.get(), 100);
+        TS_ASSERT_EQUALS(limited.get(), 100);
+        TS_ASSERT_EQUALS(unset.get(), 0.5);
+
+        prefs->setInt("/test/handle/intvalue", 1000);
+        TS_ASSERT_EQUALS(handle.get(), 1000);
+        TS_ASSERT_EQUALS(limited.get(), 1); // out of range
+        prefs->setDouble("/test/handle/notset/doublevalue", 2.0);
+        TS_ASSERT_EQUALS(unset.get(), 2.0); // notified although the directory did not exist
+    }
 private:
     Inkscape::Preferences *prefs;
 };
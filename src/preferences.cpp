@@ -102,8 +102,11 @@ Preferences::Preferences() :
 
 Preferences::~Preferences()
 {
-    // delete all PrefNodeObservers
+    // delete all PrefNodeObservers; observers which outlive the preferences,
+    // such as static PrefHandles, must not try to remove themselves later
     for (_ObsMap::iterator i = _observer_map.begin(); i != _observer_map.end(); ) {
+        delete i->first->_data;
+        i->first->_data = NULL;
         delete (*i++).second; // avoids reference to a deleted key
     }
     // unref XML document
@@ -525,9 +528,11 @@ Preferences::Observer::Observer(Glib::ustring const &path) :
 
 Preferences::Observer::~Observer()
 {
-    // on destruction remove observer to prevent invalid references
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    prefs->removeObserver(*this);
+    // on destruction remove observer to prevent invalid references;
+    // don't load the preferences again if they are already gone
+    if (_instance) {
+        _instance->removeObserver(*this);
+    }
 }
 
 void Preferences::PrefNodeObserver::notifyAttributeChanged(XML::Node &node, GQuark name, Util::ptr_shared<char>, Util::ptr_shared<char> new_value)
@@ -574,6 +579,9 @@ XML::Node *Preferences::_findObserverNode(Glib::ustring const &pref_path, Glib::
 
     // find the node corresponding to the "directory".
     Inkscape::XML::Node *node = _getNode(node_key, create), *child;
+    if (!node) {
+        return NULL;
+    }
     for (child = node->firstChild(); child; child = child->next()) {
         // If there is a node with id corresponding to the attr key,
         // this means that the last part of the path is actually a key (folder).
@@ -589,12 +597,23 @@ XML::Node *Preferences::_findObserverNode(Glib::ustring const &pref_path, Glib::
 }
 
 void Preferences::addObserver(Observer &o)
+{
+    _addObserver(o, false);
+}
+
+/**
+ * Register a preference observer.
+ *
+ * @param create Whether to create the missing groups on the observed path, so that
+ *               the observer is notified once a preference which is not set yet is set.
+ */
+void Preferences::_addObserver(Observer &o, bool create)
 {
     // prevent adding the same observer twice
     if ( _observer_map.find(&o) == _observer_map.end() ) {
         Glib::ustring node_key, attr_key;
         Inkscape::XML::Node *node;
-        node = _findObserverNode(o.observed_path, node_key, attr_key, false);
+        node = _findObserverNode(o.observed_path, node_key, attr_key, create);
         if (node) {
             // set additional data
             if (o._data) {
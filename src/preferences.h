@@ -51,6 +51,8 @@ public:
  * In future, this will be a virtual base from which specific backends
  * derive (e.g. GConf, flat XML file...)
  */
+template <typename T> class PrefHandle;
+
 class Preferences {
     class _ObserverData;
 
@@ -530,6 +532,7 @@ private:
     void _keySplit(Glib::ustring const &pref_path, Glib::ustring &node_key, Glib::ustring &attr_key);
     XML::Node *_getNode(Glib::ustring const &pref_path, bool create=false);
     XML::Node *_findObserverNode(Glib::ustring const &pref_path, Glib::ustring &node_key, Glib::ustring &attr_key, bool create);
+    void _addObserver(Observer &o, bool create);
 
     // disable copying
     Preferences(Preferences const &);
@@ -560,6 +563,7 @@ private:
 
 friend class PrefNodeObserver;
 friend class Entry;
+template <typename T> friend class PrefHandle;
 };
 
 /* Trivial inline Preferences::Entry functions.
@@ -674,6 +678,102 @@ inline Glib::ustring Preferences::Entry::getEntryName() const
     return path_base;
 }
 
+/**
+ * Cached value of a single preference.
+ *
+ * The preference is looked up and parsed when the handle is created; after that
+ * the handle follows changes of the preference as an observer, so reading it
+ * costs no more than reading a variable. This is meant for code which reads
+ * a preference very often, such as rendering.
+ *
+ * Creating a handle registers an observer, which is not thread safe. Handles
+ * must therefore be created on the main thread, and never lazily from code that
+ * may run on a rendering thread, such as a function-local static. Handles read
+ * while rendering are members of Inkscape::RenderPrefs (src/display/render-prefs.h),
+ * which creates them all on the main thread:
+ *
+ * @code
+ * int n = Inkscape::RenderPrefs::get().num_threads;
+ * @endcode
+ *
+ * Unlike other observers, a handle creates the preference groups on its path
+ * if they do not exist, so that it hears of the preference once it is set.
+ *
+ * Handles for bool, int and double values are available.
+ * The value is not updated anymore once the preferences are unloaded.
+ */
+template <typename T>
+class PrefHandle : public Preferences::Observer {
+public:
+    /**
+     * @param path Path of the preference.
+     * @param def Default value if the preference is not set.
+     */
+    PrefHandle(Glib::ustring const &path, T def = T())
+        : Preferences::Observer(path)
+        , _def(def)
+        , _min(def)
+        , _max(def)
+        , _limited(false)
+    {
+        _init();
+    }
+
+    /**
+     * Handle to a limited value; see Preferences::getIntLimited().
+     * @param min Minimum value; the default value is used for smaller values.
+     * @param max Maximum value; the default value is used for larger values.
+     */
+    PrefHandle(Glib::ustring const &path, T def, T min, T max)
+        : Preferences::Observer(path)
+        , _def(def)
+        , _min(min)
+        , _max(max)
+        , _limited(true)
+    {
+        _init();
+    }
+
+    T get() const { return _value; }
+    operator T() const { return _value; }
+
+    virtual void notify(Preferences::Entry const &new_val) {
+        _value = _read(new_val);
+    }
+
+private:
+    void _init() {
+        Preferences *prefs = Preferences::get();
+        _value = _read(prefs->getEntry(observed_path));
+        prefs->_addObserver(*this, true);
+    }
+    T _read(Preferences::Entry const &entry) const;
+
+    mutable T _value; // handles are usually const, but still follow the preference
+    T const _def;
+    T const _min;
+    T const _max;
+    bool const _limited;
+};
+
+template <>
+inline bool PrefHandle<bool>::_read(Preferences::Entry const &entry) const
+{
+    return entry.getBool(_def);
+}
+
+template <>
+inline int PrefHandle<int>::_read(Preferences::Entry const &entry) const
+{
+    return _limited ? entry.getIntLimited(_def, _min, _max) : entry.getInt(_def);
+}
+
+template <>
+inline double PrefHandle<double>::_read(Preferences::Entry const &entry) const
+{
+    return _limited ? entry.getDoubleLimited(_def, _min, _max) : entry.getDouble(_def);
+}
+
 } // namespace Inkscape
 
 #endif // INKSCAPE_PREFSTORE_H
@@ -0,0 +1,428 @@
+/**
+ * @file
+ * Spatial index of the items that can be snapped to.
+ */
+/*
+ * Copyright (C) 2012 Authors
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <iterator>
+#include <sigc++/functors/mem_fun.h>
+#include "snap-candidate-index.h"
+#include "desktop.h"
+#include "document.h"
+#include "display/curve.h"
+#include "sp-clippath.h"
+#include "sp-flowtext.h"
+#include "sp-item-group.h"
+#include "sp-mask.h"
+#include "sp-path.h"
+#include "sp-root.h"
+#include "sp-text.h"
+#include "sp-use.h"
+#include "text-editing.h"
+
+namespace Inkscape {
+
+namespace {
+
+/// Whether @a object or one of its ancestors is in @a set.
+template <typename Set>
+bool is_below(SPObject const *object, Set const &set)
+{
+    for (; object; object = object->parent) {
+        if (set.find(const_cast<typename Set::value_type>(object)) != set.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+SnapCandidateIndex::SnapCandidateIndex()
+    : _desktop(NULL)
+    , _document(NULL)
+    , _root(NULL)
+    , _bbox_type(SPItem::GEOMETRIC_BBOX)
+    , _clips(false)
+    , _masks(false)
+    , _valid(false)
+    , _dead(0)
+    , _nodes_generation(0)
+{
+}
+
+SnapCandidateIndex::~SnapCandidateIndex()
+{
+    _reset();
+}
+
+void SnapCandidateIndex::find(SPDesktop const *desktop, SPDocument *document, SPItem::BBoxType bbox_type,
+                              bool clips, bool masks, Geom::Rect const &area,
+                              std::vector<SPItem const *> const *ignore, std::vector<Record *> &found)
+{
+    found.clear();
+    if (!_valid || desktop != _desktop || document != _document || bbox_type != _bbox_type
+        || clips != _clips || masks != _masks)
+    {
+        _reset();
+        _desktop = desktop;
+        _document = document;
+        _bbox_type = bbox_type;
+        _clips = clips;
+        _masks = masks;
+        _root = document->getRoot();
+        _valid = true;
+        _watch(_root, false);
+        _scan(_root, NULL, Geom::identity());
+        _compact();
+    } else {
+        _refresh();
+    }
+
+    std::vector<size_t> hits;
+    _tree.query(area, std::back_inserter(hits));
+    for (std::vector<size_t>::const_iterator i = _pending.begin(); i != _pending.end(); ++i) {
+        Record const &r = _records[*i];
+        Geom::Rect box = *r.bbox;
+        box.expandTo(r.center);
+        if (box.intersects(area)) {
+            hits.push_back(*i);
+        }
+    }
+
+    std::set<SPObject const *> ignored;
+    if (ignore) {
+        ignored.insert(ignore->begin(), ignore->end());
+    }
+    for (std::vector<size_t>::const_iterator i = hits.begin(); i != hits.end(); ++i) {
+        Record &r = _records[*i];
+        if (r.dead) continue;
+        if (!ignored.empty() && (is_below(r.item, ignored) || (r.owner && is_below(r.owner, ignored)))) {
+            continue;
+        }
+        found.push_back(&r);
+    }
+}
+
+std::vector<SnapCandidatePoint> const &SnapCandidateIndex::nodes(Record &r, SnapPreferences const &snapprefs)
+{
+    if (!_nodes_generation || !_nodes_prefs.hasSameTargets(snapprefs)) {
+        _nodes_prefs = snapprefs;
+        ++_nodes_generation;
+    }
+    Targets &t = *r.targets;
+    if (t.nodes_generation != _nodes_generation) {
+        t.nodes.clear();
+        _rootItem(r.item)->getSnappoints(t.nodes, &snapprefs);
+        t.nodes_generation = _nodes_generation;
+    }
+    return t.nodes;
+}
+
+Geom::PathVector *SnapCandidateIndex::path(Record &r, SnapTargetType &target)
+{
+    Targets &t = *r.targets;
+    if (!t.have_path) {
+        t.have_path = true;
+        SPItem *root_item = _rootItem(r.item);
+        Geom::Affine const affine = root_item->i2dt_affine() * r.additional_affine * _desktop->doc2dt();
+        if (SP_IS_TEXT(root_item) || SP_IS_FLOWTEXT(root_item)) {
+            Text::Layout const *layout = te_get_layout(root_item);
+            if (layout != NULL && layout->outputExists()) {
+                t.path.push_back(layout->baseline() * affine);
+                t.path_target = SNAPTARGET_TEXT_BASELINE;
+            }
+        } else if (SP_IS_SHAPE(root_item)) {
+            // Snapping for example to a traced bitmap is very stressing for
+            // the CPU, so we'll only snap to paths having no more than 500 nodes
+            // This also leads to a lag of approx. 500 msec (in my lousy test set-up).
+            if (!SP_IS_PATH(root_item) || SP_PATH(root_item)->nodesInPath() <= 500) {
+                SPCurve *curve = SP_SHAPE(root_item)->getCurve();
+                if (curve) {
+                    t.path = curve->get_pathvector();
+                    t.path *= affine;
+                    t.path_target = SNAPTARGET_PATH;
+                    curve->unref();
+                }
+            }
+        }
+    }
+    target = t.path_target;
+    return target == SNAPTARGET_UNDEFINED ? NULL : &t.path;
+}
+
+Geom::OptRect const &SnapCandidateIndex::bounds(Record &r, SPItem::BBoxType bbox_type)
+{
+    Targets &t = *r.targets;
+    if (!t.have_bounds || t.bounds_type != bbox_type) {
+        if (SP_IS_USE(r.item) && sp_use_root(SP_USE(r.item))) {
+            // Measure the original where the clone puts it
+            SPItem *parent = SP_IS_ITEM(r.item->parent) ? SP_ITEM(r.item->parent) : NULL;
+            Geom::Affine i2dt = sp_use_get_root_transform(SP_USE(r.item));
+            if (parent) {
+                i2dt *= parent->i2doc_affine();
+            }
+            i2dt *= _desktop->doc2dt();
+            t.bounds = sp_use_root(SP_USE(r.item))->bounds(bbox_type, i2dt);
+        } else {
+            t.bounds = r.item->desktopBounds(bbox_type);
+        }
+        t.bounds_type = bbox_type;
+        t.have_bounds = true;
+    }
+    return t.bounds;
+}
+
+void SnapCandidateIndex::_reset()
+{
+    for (WatchMap::iterator i = _watched.begin(); i != _watched.end(); ++i) {
+        i->second.modified.disconnect();
+        i->second.release.disconnect();
+    }
+    _watched.clear();
+    _dirty.clear();
+    _released.clear();
+    _records.clear();
+    _pending.clear();
+    _by_item.clear();
+    _tree.clear();
+    _dead = 0;
+    _root = NULL;
+    _valid = false;
+}
+
+void SnapCandidateIndex::_scan(SPObject *parent, SPItem *owner, Geom::Affine const &additional_affine)
+{
+    for (SPObject *o = parent->firstChild(); o; o = o->getNext()) {
+        if (SP_IS_ITEM(o)) {
+            _scanItem(SP_ITEM(o), owner, additional_affine);
+        }
+    }
+}
+
+void SnapCandidateIndex::_scanItem(SPItem *item, SPItem *owner, Geom::Affine const &additional_affine)
+{
+    bool const clip_or_mask = owner != NULL;
+    _watch(item, clip_or_mask);
+
+    // Snapping to items in a locked layer is allowed.
+    // Don't snap to hidden objects, unless they're a clipped path or a mask;
+    // they are still watched so that showing them adds them to the index.
+    if (_desktop->itemIsHidden(item) && !clip_or_mask) {
+        return;
+    }
+
+    if (!clip_or_mask) { // cannot clip or mask more than once
+        // The item might be the subject of clipping or masking; if so, that path
+        // or mask is also considered for snapping to. Either way it is watched,
+        // because the snap points of the item include those of its clip and mask.
+        SPObject *obj = item->clip_ref ? item->clip_ref->getObject() : NULL;
+        if (obj) {
+            _watch(obj, true);
+            if (_clips) {
+                _scan(obj, item, item->i2doc_affine());
+            }
+        }
+        obj = item->mask_ref ? item->mask_ref->getObject() : NULL;
+        if (obj) {
+            _watch(obj, true);
+            if (_masks) {
+                _scan(obj, item, item->i2doc_affine());
+            }
+        }
+    }
+
+    if (SP_IS_GROUP(item)) {
+        _scan(item, owner, additional_affine);
+        return;
+    }
+
+    Record r;
+    r.item = item;
+    r.owner = owner;
+    r.additional_affine = additional_affine;
+    if (clip_or_mask) {
+        // We cannot use the desktop bounds directly because we need to insert
+        // an additional transformation in document coordinates
+        r.bbox = item->bounds(_bbox_type, item->i2doc_affine() * additional_affine * _desktop->doc2dt());
+    } else {
+        r.bbox = item->desktopBounds(_bbox_type);
+    }
+    if (!r.bbox) {
+        return;
+    }
+    r.center = item->getCenter();
+    r.dead = false;
+    r.targets.reset(new Targets);
+    _pending.push_back(_records.size());
+    _addRecord(r);
+}
+
+void SnapCandidateIndex::_addRecord(Record const &r)
+{
+    _by_item[r.item].push_back(_records.size());
+    if (r.owner) {
+        _by_item[r.owner].push_back(_records.size());
+    }
+    _records.push_back(r);
+}
+
+void SnapCandidateIndex::_watch(SPObject *object, bool in_clip_or_mask)
+{
+    if (_watched.find(object) != _watched.end()) {
+        return;
+    }
+    Watch &w = _watched[object];
+    w.modified = object->connectModified(sigc::mem_fun(*this, &SnapCandidateIndex::_itemModified));
+    w.release = object->connectRelease(sigc::mem_fun(*this, &SnapCandidateIndex::_itemReleased));
+    w.in_clip_or_mask = in_clip_or_mask;
+}
+
+void SnapCandidateIndex::_refresh()
+{
+    // Released objects must not be dereferenced; only look up the pointers
+    for (std::set<SPObject *>::iterator i = _released.begin(); i != _released.end(); ++i) {
+        _kill(*i);
+    }
+    _released.clear();
+
+    if (!_dirty.empty()) {
+        // Everything below a modified object is measured again
+        for (std::set<SPObject *>::iterator i = _dirty.begin(); i != _dirty.end(); ++i) {
+            _killBelow(*i);
+        }
+
+        std::set<SPObject *> dirty;
+        dirty.swap(_dirty);
+        for (std::set<SPObject *>::iterator i = dirty.begin(); i != dirty.end(); ++i) {
+            SPObject *object = *i;
+            if (is_below(object->parent, dirty)) continue; // rescanned with its ancestor
+
+            // Only rescan items which the document walk would reach
+            bool reachable = true;
+            SPObject *parent = object->parent;
+            for (; parent && parent != _root; parent = parent->parent) {
+                if (!SP_IS_GROUP(parent) || _desktop->itemIsHidden(SP_ITEM(parent))) {
+                    reachable = false;
+                    break;
+                }
+            }
+            if (reachable && parent == _root) {
+                _scanItem(SP_ITEM(object), NULL, Geom::identity());
+            }
+        }
+    }
+
+    if (_dead > _records.size() / 4 || _pending.size() > _records.size() / 8 + 64) {
+        _compact();
+    }
+}
+
+void SnapCandidateIndex::_compact()
+{
+    std::vector<Record> live;
+    live.reserve(_records.size() - _dead);
+    for (std::vector<Record>::iterator i = _records.begin(); i != _records.end(); ++i) {
+        if (!i->dead) {
+            live.push_back(*i);
+        }
+    }
+    _records.clear();
+    _by_item.clear();
+    for (std::vector<Record>::iterator i = live.begin(); i != live.end(); ++i) {
+        _addRecord(*i);
+    }
+    _dead = 0;
+    _pending.clear();
+
+    _tree.clear();
+    _tree.reserve(_records.size());
+    for (size_t i = 0; i < _records.size(); ++i) {
+        Geom::Rect box = *_records[i].bbox;
+        box.expandTo(_records[i].center); // rotation center might be outside of the bounding box
+        _tree.insert(box, i);
+    }
+}
+
+void SnapCandidateIndex::_kill(SPObject const *object)
+{
+    RecordMap::iterator m = _by_item.find(object);
+    if (m == _by_item.end()) {
+        return;
+    }
+    for (std::vector<size_t>::const_iterator i = m->second.begin(); i != m->second.end(); ++i) {
+        Record &r = _records[*i];
+        if (!r.dead) {
+            r.dead = true;
+            ++_dead;
+        }
+    }
+    _by_item.erase(m);
+}
+
+void SnapCandidateIndex::_killBelow(SPObject const *object)
+{
+    _kill(object);
+    for (SPObject const *o = object->firstChild(); o; o = o->getNext()) {
+        _killBelow(o);
+    }
+}
+
+SPItem *SnapCandidateIndex::_rootItem(SPItem *item) const
+{
+    // We might have a clone at hand, so make sure we get the root item
+    SPItem *root_item = SP_IS_USE(item) ? sp_use_root(SP_USE(item)) : NULL;
+    return root_item ? root_item : item;
+}
+
+void SnapCandidateIndex::_itemModified(SPObject *object, unsigned flags)
+{
+    // Groups hear about changes to their children from the children themselves,
+    // but the children of other items (clones, texts) are not watched
+    if (!(flags & ~SP_OBJECT_CHILD_MODIFIED_FLAG) && SP_IS_GROUP(object)) {
+        return;
+    }
+    WatchMap::iterator w = _watched.find(object);
+    if (w == _watched.end()) {
+        return;
+    }
+    if (w->second.in_clip_or_mask || object == _root) {
+        // rare enough to simply start over
+        _valid = false;
+    } else {
+        _dirty.insert(object);
+    }
+}
+
+void SnapCandidateIndex::_itemReleased(SPObject *object)
+{
+    WatchMap::iterator w = _watched.find(object);
+    if (w == _watched.end()) {
+        return;
+    }
+    w->second.modified.disconnect();
+    w->second.release.disconnect();
+    _watched.erase(w);
+    _dirty.erase(object);
+    _released.insert(object);
+    if (object == _root) {
+        _valid = false;
+    }
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
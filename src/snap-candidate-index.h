@@ -0,0 +1,171 @@
+#ifndef SEEN_SNAP_CANDIDATE_INDEX_H
+#define SEEN_SNAP_CANDIDATE_INDEX_H
+
+/**
+ * @file
+ * Spatial index of the items that can be snapped to.
+ */
+/*
+ * Copyright (C) 2012 Authors
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <map>
+#include <set>
+#include <vector>
+#include <sigc++/connection.h>
+#include <boost/shared_ptr.hpp>
+#include <sigc++/trackable.h>
+#include <2geom/affine.h>
+#include <2geom/pathvector.h>
+#include <2geom/rect.h>
+#include "snap-candidate.h"
+#include "snap-preferences.h"
+#include "sp-item.h"
+#include "util/rtree.h"
+
+class SPDesktop;
+class SPDocument;
+class SPObject;
+
+namespace Inkscape {
+
+/**
+ * Persistent index of the items an ObjectSnapper may snap to, keyed by their
+ * desktop bounding boxes.
+ *
+ * Besides the boxes, the index keeps what the snapper needs of the items found:
+ * their snap points, their paths and their bounding boxes. These are collected
+ * the first time they are asked for and stay with the entry until the item changes.
+ *
+ * The index is filled by walking the document once. From then on it watches the
+ * modified and release signals of the items it has seen: a modified item (or a
+ * group whose children were added, removed or reordered) is measured again
+ * together with its descendants on the next search, and released items are
+ * dropped. Entries added since the R-tree was last built are searched linearly
+ * until there are enough of them to make rebuilding the tree worthwhile.
+ */
+class SnapCandidateIndex : public sigc::trackable
+{
+public:
+    /// Snap targets of an item, see nodes(), path() and bounds()
+    struct Targets {
+        Targets()
+            : nodes_generation(0), path_target(SNAPTARGET_UNDEFINED), have_path(false)
+            , bounds_type(SPItem::GEOMETRIC_BBOX), have_bounds(false) {}
+
+        std::vector<SnapCandidatePoint> nodes;
+        unsigned nodes_generation; ///< Snap targets nodes was collected for, 0 if not yet collected
+        Geom::PathVector path;
+        SnapTargetType path_target;
+        bool have_path;
+        Geom::OptRect bounds;
+        SPItem::BBoxType bounds_type;
+        bool have_bounds;
+    };
+
+    struct Record {
+        SPItem *item;
+        SPItem *owner;  ///< For items in a clipping path or mask: the clipped or masked item
+        Geom::Affine additional_affine; ///< i2doc transform of owner, see SnapCandidateItem
+        Geom::OptRect bbox; ///< Desktop bounding box
+        Geom::Point center; ///< Rotation center
+        bool dead;
+        boost::shared_ptr<Targets> targets; ///< Shared by the copies made when compacting
+    };
+
+    SnapCandidateIndex();
+    ~SnapCandidateIndex();
+
+    /**
+     * Find the items whose bounding box or rotation center may lie within @a area.
+     * Items in @a ignore, and the descendants and clipping paths or masks of
+     * these items, are left out. The records found stay valid until the next call.
+     * @param clips Whether to include the contents of clipping paths.
+     * @param masks Whether to include the contents of masks.
+     */
+    void find(SPDesktop const *desktop, SPDocument *document, SPItem::BBoxType bbox_type,
+              bool clips, bool masks, Geom::Rect const &area,
+              std::vector<SPItem const *> const *ignore, std::vector<Record *> &found);
+
+    /**
+     * The snap points of the item of @a r (or of the original of a clone), as
+     * returned by SPItem::getSnappoints() for @a snapprefs.
+     */
+    std::vector<SnapCandidatePoint> const &nodes(Record &r, SnapPreferences const &snapprefs);
+
+    /**
+     * The path to snap to for the item of @a r, in document coordinates: the
+     * outline of a shape, or the baseline of a text.
+     * @param target Set to SNAPTARGET_PATH or SNAPTARGET_TEXT_BASELINE accordingly.
+     * @return The path, owned by the index, or NULL if there is none. Paths having
+     *         more than 500 nodes are not snapped to and give NULL too.
+     */
+    Geom::PathVector *path(Record &r, SnapTargetType &target);
+
+    /**
+     * The desktop bounding box of the item of @a r. For a clone, this is the box
+     * of the original, measured where the clone puts it.
+     */
+    Geom::OptRect const &bounds(Record &r, SPItem::BBoxType bbox_type);
+
+private:
+    struct Watch {
+        sigc::connection modified;
+        sigc::connection release;
+        bool in_clip_or_mask;
+    };
+    typedef std::map<SPObject *, Watch> WatchMap;
+    typedef std::map<SPObject const *, std::vector<size_t> > RecordMap;
+
+    void _reset();
+    void _scan(SPObject *parent, SPItem *owner, Geom::Affine const &additional_affine);
+    void _scanItem(SPItem *item, SPItem *owner, Geom::Affine const &additional_affine);
+    void _watch(SPObject *object, bool in_clip_or_mask);
+    void _refresh();
+    void _kill(SPObject const *object);
+    void _killBelow(SPObject const *object);
+    void _addRecord(Record const &r);
+    void _compact();
+    SPItem *_rootItem(SPItem *item) const;
+
+    void _itemModified(SPObject *object, unsigned flags);
+    void _itemReleased(SPObject *object);
+
+    SPDesktop const *_desktop;
+    SPDocument *_document;
+    SPObject *_root;
+    SPItem::BBoxType _bbox_type;
+    bool _clips;
+    bool _masks;
+    bool _valid;
+
+    std::vector<Record> _records;
+    std::vector<size_t> _pending; ///< Records not yet in _tree
+    RecordMap _by_item; ///< Records by item and by owner; may still list dead records
+    size_t _dead;
+    Util::RTree<size_t> _tree;
+
+    SnapPreferences _nodes_prefs; ///< Snap targets of the latest nodes() call
+    unsigned _nodes_generation; ///< Bumped whenever _nodes_prefs changes
+
+    WatchMap _watched;
+    std::set<SPObject *> _dirty;
+    std::set<SPObject *> _released;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_SNAP_CANDIDATE_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -125,14 +125,15 @@ class SnapCandidatePath
 {
 
 public:
-    SnapCandidatePath(Geom::PathVector* path, SnapTargetType target, Geom::OptRect bbox, bool edited = false)
-        : path_vector(path), target_type(target), target_bbox(bbox), currently_being_edited(edited) {};
+    SnapCandidatePath(Geom::PathVector* path, SnapTargetType target, Geom::OptRect bbox, bool edited = false, bool borrowed = false)
+        : path_vector(path), target_type(target), target_bbox(bbox), currently_being_edited(edited), borrowed(borrowed) {};
     ~SnapCandidatePath() {};
 
     Geom::PathVector* path_vector;
     SnapTargetType target_type;
     Geom::OptRect target_bbox;
     bool currently_being_edited; // true for the path that's currently being edited in the node tool (if any)
+    bool borrowed; // true if path_vector is owned by someone else (e.g. the SnapCandidateIndex) and must not be freed
 
 };
 } // end of namespace Inkscape
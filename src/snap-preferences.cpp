@@ -12,6 +12,7 @@
 #include "inkscape.h"
 #include "snap-preferences.h"
 #include <glib.h> // g_assert()
+#include <algorithm>
 
 Inkscape::SnapPreferences::SnapPreferences() :
     _snap_enabled_globally(true),
@@ -41,6 +42,11 @@ bool Inkscape::SnapPreferences::isAnyCategorySnappable() const
     return isTargetSnappable(SNAPTARGET_NODE_CATEGORY, SNAPTARGET_BBOX_CATEGORY, SNAPTARGET_OTHERS_CATEGORY) || isTargetSnappable(SNAPTARGET_GUIDE, SNAPTARGET_GRID, SNAPTARGET_PAGE_BORDER);
 }
 
+bool Inkscape::SnapPreferences::hasSameTargets(SnapPreferences const &other) const
+{
+    return std::equal(_active_snap_targets, _active_snap_targets + SNAPTARGET_MAX_ENUM_VALUE, other._active_snap_targets);
+}
+
 void Inkscape::SnapPreferences::_mapTargetToArrayIndex(Inkscape::SnapTargetType &target, bool &always_on, bool &group_on) const
 {
     if (target == SNAPTARGET_BBOX_CATEGORY ||
@@ -37,6 +37,9 @@ public:
     bool isAnyDatumSnappable() const; // Needed because we cannot toggle the datum snap targets as a group
     bool isAnyCategorySnappable() const;
 
+    /// Whether @a other has the same snap targets enabled, i.e. isTargetSnappable() gives the same answers.
+    bool hasSameTargets(SnapPreferences const &other) const;
+
     void setSnapEnabledGlobally(bool enabled) {_snap_enabled_globally = enabled;}
     bool getSnapEnabledGlobally() const {return _snap_enabled_globally;}
 
@@ -336,8 +336,9 @@ sp_flowtext_bbox(SPItem const *item, Geom::Affine const &transform, SPItem::BBox
     // Add stroke width
     // FIXME this code is incorrect
     if (bbox && type == SPItem::VISUAL_BBOX && !item->style->stroke.isNone()) {
-        double scale = transform.descrim();
-        bbox->expandBy(0.5 * item->style->stroke_width.computed * scale);
+        double const width = item->style->stroke_width.computed;
+        bbox->expandBy(0.5 * width * Geom::L2(Geom::Point(transform[0], transform[2])),
+                       0.5 * width * Geom::L2(Geom::Point(transform[1], transform[3])));
     }
     return bbox;
 }
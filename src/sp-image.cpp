@@ -22,6 +22,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <map>
 #include <string>
 #include <glib/gstdio.h>
 #include <2geom/rect.h>
@@ -97,6 +98,8 @@ static void sp_image_set_curve(SPImage *image);
 
 static GdkPixbuf *sp_image_repr_read_image( time_t& modTime, gchar*& pixPath, const gchar *href, const gchar *absref, const gchar *base );
 static GdkPixbuf *sp_image_pixbuf_force_rgba (GdkPixbuf * pixbuf);
+static GdkPixbuf *sp_image_acquire_pixbuf (SPImage *image, const gchar *href, const gchar *absref, const gchar *base);
+static void sp_image_release_pixbuf (SPImage *image);
 static void sp_image_update_arenaitem (SPImage *img, Inkscape::DrawingImage *ai);
 static void sp_image_update_canvas_image (SPImage *image);
 static GdkPixbuf * sp_image_repr_read_dataURI (const gchar * uri_data);
@@ -620,6 +623,7 @@ static void sp_image_init( SPImage *image )
     image->color_profile = 0;
 #endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
     image->pixbuf = 0;
+    image->cache_key = 0;
     image->pixPath = 0;
     image->lastMod = 0;
 }
@@ -656,10 +660,7 @@ static void sp_image_release( SPObject *object )
         image->href = NULL;
     }
 
-    if (image->pixbuf) {
-        g_object_unref (image->pixbuf);
-        image->pixbuf = NULL;
-    }
+    sp_image_release_pixbuf(image);
 
 #if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
     if (image->color_profile) {
@@ -814,20 +815,15 @@ static void sp_image_update( SPObject *object, SPCtx *ctx, unsigned int flags )
     }
 
     if (flags & SP_IMAGE_HREF_MODIFIED_FLAG) {
-        if (image->pixbuf) {
-            g_object_unref (image->pixbuf);
-            image->pixbuf = NULL;
-        }
+        sp_image_release_pixbuf(image);
         if ( image->pixPath ) {
             g_free(image->pixPath);
             image->pixPath = 0;
         }
         image->lastMod = 0;
         if (image->href) {
-            GdkPixbuf *pixbuf;
-            pixbuf = sp_image_repr_read_image (
-                image->lastMod,
-                image->pixPath,
+            image->pixbuf = sp_image_acquire_pixbuf (
+                image,
 
                 //XML Tree being used directly while it shouldn't be.
                 object->getRepr()->attribute("xlink:href"),
@@ -835,89 +831,6 @@ static void sp_image_update( SPObject *object, SPCtx *ctx, unsigned int flags )
                 //XML Tree being used directly while it shouldn't be.
                 object->getRepr()->attribute("sodipodi:absref"),
                 doc->getBase());
-            if (pixbuf) {
-                pixbuf = sp_image_pixbuf_force_rgba (pixbuf);
-// BLIP
-#if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
-                if ( image->color_profile )
-                {
-                    int imagewidth = gdk_pixbuf_get_width( pixbuf );
-                    int imageheight = gdk_pixbuf_get_height( pixbuf );
-                    int rowstride = gdk_pixbuf_get_rowstride( pixbuf );
-                    guchar* px = gdk_pixbuf_get_pixels( pixbuf );
-
-                    if ( px ) {
-#ifdef DEBUG_LCMS
-                        DEBUG_MESSAGE( lcmsFive, "in <image>'s sp_image_update. About to call colorprofile_get_handle()" );
-#endif // DEBUG_LCMS
-                        guint profIntent = Inkscape::RENDERING_INTENT_UNKNOWN;
-                        cmsHPROFILE prof = Inkscape::CMSSystem::getHandle( object->document,
-                                                                           &profIntent,
-                                                                           image->color_profile );
-                        if ( prof ) {
-                            cmsProfileClassSignature profileClass = cmsGetDeviceClass( prof );
-                            if ( profileClass != cmsSigNamedColorClass ) {
-                                int intent = INTENT_PERCEPTUAL;
-                                switch ( profIntent ) {
-                                    case Inkscape::RENDERING_INTENT_RELATIVE_COLORIMETRIC:
-                                        intent = INTENT_RELATIVE_COLORIMETRIC;
-                                        break;
-                                    case Inkscape::RENDERING_INTENT_SATURATION:
-                                        intent = INTENT_SATURATION;
-                                        break;
-                                    case Inkscape::RENDERING_INTENT_ABSOLUTE_COLORIMETRIC:
-                                        intent = INTENT_ABSOLUTE_COLORIMETRIC;
-                                        break;
-                                    case Inkscape::RENDERING_INTENT_PERCEPTUAL:
-                                    case Inkscape::RENDERING_INTENT_UNKNOWN:
-                                    case Inkscape::RENDERING_INTENT_AUTO:
-                                    default:
-                                        intent = INTENT_PERCEPTUAL;
-                                }
-                                cmsHPROFILE destProf = cmsCreate_sRGBProfile();
-                                cmsHTRANSFORM transf = cmsCreateTransform( prof,
-                                                                           TYPE_RGBA_8,
-                                                                           destProf,
-                                                                           TYPE_RGBA_8,
-                                                                           intent, 0 );
-                                if ( transf ) {
-                                    guchar* currLine = px;
-                                    for ( int y = 0; y < imageheight; y++ ) {
-                                        // Since the types are the same size, we can do the transformation in-place
-                                        cmsDoTransform( transf, currLine, currLine, imagewidth );
-                                        currLine += rowstride;
-                                    }
-
-                                    cmsDeleteTransform( transf );
-                                }
-#ifdef DEBUG_LCMS
-                                else
-                                {
-                                    DEBUG_MESSAGE( lcmsSix, "in <image>'s sp_image_update. Unable to create LCMS transform." );
-                                }
-#endif // DEBUG_LCMS
-                                cmsCloseProfile( destProf );
-                            }
-#ifdef DEBUG_LCMS
-                            else
-                            {
-                                DEBUG_MESSAGE( lcmsSeven, "in <image>'s sp_image_update. Profile type is named color. Can't transform." );
-                            }
-#endif // DEBUG_LCMS
-                        }
-#ifdef DEBUG_LCMS
-                        else
-                        {
-                            DEBUG_MESSAGE( lcmsEight, "in <image>'s sp_image_update. No profile found." );
-                        }
-#endif // DEBUG_LCMS
-                    }
-                }
-#endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
-                image->pixbuf = pixbuf;
-                // convert to premultiplied native-endian ARGB for display with Cairo
-                convert_pixbuf_normal_to_argb32(image->pixbuf);
-            }
         }
     }
 
@@ -1155,8 +1068,240 @@ static Inkscape::DrawingItem *sp_image_show( SPItem *item, Inkscape::Drawing &dr
     return ai;
 }
 
+#if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+/**
+ * Convert the pixels of a freshly decoded RGBA pixbuf from the color profile
+ * of the image to sRGB.
+ */
+static void sp_image_apply_color_profile( SPImage *image, GdkPixbuf *pixbuf )
+{
+    if ( image->color_profile )
+    {
+        int imagewidth = gdk_pixbuf_get_width( pixbuf );
+        int imageheight = gdk_pixbuf_get_height( pixbuf );
+        int rowstride = gdk_pixbuf_get_rowstride( pixbuf );
+        guchar* px = gdk_pixbuf_get_pixels( pixbuf );
+
+        if ( px ) {
+#ifdef DEBUG_LCMS
+            DEBUG_MESSAGE( lcmsFive, "in <image>'s sp_image_update. About to call colorprofile_get_handle()" );
+#endif // DEBUG_LCMS
+            guint profIntent = Inkscape::RENDERING_INTENT_UNKNOWN;
+            cmsHPROFILE prof = Inkscape::CMSSystem::getHandle( image->document,
+                                                               &profIntent,
+                                                               image->color_profile );
+            if ( prof ) {
+                cmsProfileClassSignature profileClass = cmsGetDeviceClass( prof );
+                if ( profileClass != cmsSigNamedColorClass ) {
+                    int intent = INTENT_PERCEPTUAL;
+                    switch ( profIntent ) {
+                        case Inkscape::RENDERING_INTENT_RELATIVE_COLORIMETRIC:
+                            intent = INTENT_RELATIVE_COLORIMETRIC;
+                            break;
+                        case Inkscape::RENDERING_INTENT_SATURATION:
+                            intent = INTENT_SATURATION;
+                            break;
+                        case Inkscape::RENDERING_INTENT_ABSOLUTE_COLORIMETRIC:
+                            intent = INTENT_ABSOLUTE_COLORIMETRIC;
+                            break;
+                        case Inkscape::RENDERING_INTENT_PERCEPTUAL:
+                        case Inkscape::RENDERING_INTENT_UNKNOWN:
+                        case Inkscape::RENDERING_INTENT_AUTO:
+                        default:
+                            intent = INTENT_PERCEPTUAL;
+                    }
+                    cmsHPROFILE destProf = cmsCreate_sRGBProfile();
+                    cmsHTRANSFORM transf = cmsCreateTransform( prof,
+                                                               TYPE_RGBA_8,
+                                                               destProf,
+                                                               TYPE_RGBA_8,
+                                                               intent, 0 );
+                    if ( transf ) {
+                        guchar* currLine = px;
+                        for ( int y = 0; y < imageheight; y++ ) {
+                            // Since the types are the same size, we can do the transformation in-place
+                            cmsDoTransform( transf, currLine, currLine, imagewidth );
+                            currLine += rowstride;
+                        }
+
+                        cmsDeleteTransform( transf );
+                    }
+#ifdef DEBUG_LCMS
+                    else
+                    {
+                        DEBUG_MESSAGE( lcmsSix, "in <image>'s sp_image_update. Unable to create LCMS transform." );
+                    }
+#endif // DEBUG_LCMS
+                    cmsCloseProfile( destProf );
+                }
+#ifdef DEBUG_LCMS
+                else
+                {
+                    DEBUG_MESSAGE( lcmsSeven, "in <image>'s sp_image_update. Profile type is named color. Can't transform." );
+                }
+#endif // DEBUG_LCMS
+            }
+#ifdef DEBUG_LCMS
+            else
+            {
+                DEBUG_MESSAGE( lcmsEight, "in <image>'s sp_image_update. No profile found." );
+            }
+#endif // DEBUG_LCMS
+        }
+    }
+}
+#endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+
+namespace {
+
+/**
+ * A decoded image shared by the <image> elements of a document which
+ * reference the same file or embed the same data, with the same color profile.
+ * The pixels are RGBA converted to sRGB and premultiplied ARGB32, and must
+ * not be changed.
+ */
+struct CachedImage {
+    GdkPixbuf *pixbuf;
+    time_t modTime;
+    std::string pixPath;
+    unsigned users;
+};
+
+typedef std::map<std::string, CachedImage> ImageCache;
+
+ImageCache &image_cache()
+{
+    static ImageCache cache;
+    return cache;
+}
+
+} // namespace
+
+static std::string sp_image_cache_key( SPImage *image, const gchar *href, const gchar *absref, const gchar *base )
+{
+    gchar *doc = g_strdup_printf("%p\n", image->document);
+    std::string key = doc;
+    g_free(doc);
+#if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+    if (image->color_profile) {
+        key += image->color_profile;
+    }
+#endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+    key += '\n';
+
+    if (href && strncmp(href, "data:", 5) == 0) {
+        // embedded images can be large; key them by a digest of their data
+        gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA1, href, -1);
+        key += "data:";
+        key += digest;
+        g_free(digest);
+    } else {
+        // relative references depend on the base, and a missing file on absref
+        key += href ? href : "";
+        key += '\n';
+        key += absref ? absref : "";
+        key += '\n';
+        key += base ? base : "";
+    }
+    return key;
+}
+
+/**
+ * Find the decoded pixels for an image, decoding them if no other image of
+ * the document uses them yet.  Fills in pixPath, lastMod and cache_key of the
+ * image and returns a new reference; release it with sp_image_release_pixbuf().
+ */
+static GdkPixbuf *sp_image_acquire_pixbuf( SPImage *image, const gchar *href, const gchar *absref, const gchar *base )
+{
+    ImageCache &cache = image_cache();
+    std::string key = sp_image_cache_key(image, href, absref, base);
+
+    ImageCache::iterator i = cache.find(key);
+    if (i != cache.end() && !i->second.pixPath.empty()) {
+        // the file might have changed since it was decoded
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        if (g_stat(i->second.pixPath.c_str(), &st) || st.st_mtime != i->second.modTime) {
+            // images still showing the old version keep their own references
+            g_object_unref(i->second.pixbuf);
+            cache.erase(i);
+            i = cache.end();
+        }
+    }
+
+    if (i == cache.end()) {
+        time_t modTime = 0;
+        gchar *pixPath = NULL;
+        GdkPixbuf *pixbuf = sp_image_repr_read_image(modTime, pixPath, href, absref, base);
+        if (!pixbuf) {
+            // the broken image placeholder is not shared, so that a later
+            // update tries to load the image again
+            pixbuf = gdk_pixbuf_new_from_xpm_data ((const gchar **) brokenimage_xpm);
+
+            /* It should be included xpm, so if it still does not does load, */
+            /* our libraries are broken */
+            g_assert (pixbuf != NULL);
+
+            pixbuf = sp_image_pixbuf_force_rgba(pixbuf);
+            convert_pixbuf_normal_to_argb32(pixbuf);
+            g_free(pixPath);
+            return pixbuf;
+        }
+
+        pixbuf = sp_image_pixbuf_force_rgba(pixbuf);
+#if defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+        sp_image_apply_color_profile(image, pixbuf);
+#endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
+        // convert to premultiplied native-endian ARGB for display with Cairo
+        convert_pixbuf_normal_to_argb32(pixbuf);
+
+        CachedImage entry;
+        entry.pixbuf = pixbuf;
+        entry.modTime = modTime;
+        entry.pixPath = pixPath ? pixPath : "";
+        entry.users = 0;
+        g_free(pixPath);
+        i = cache.insert(std::make_pair(key, entry)).first;
+    }
+
+    CachedImage &entry = i->second;
+    ++entry.users;
+    image->cache_key = g_strdup(key.c_str());
+    image->lastMod = entry.modTime;
+    image->pixPath = entry.pixPath.empty() ? NULL : g_strdup(entry.pixPath.c_str());
+    g_object_ref(entry.pixbuf);
+    return entry.pixbuf;
+}
+
+/**
+ * Drop the reference of an image to its pixels, and the decoded pixels
+ * themselves when no other image uses them.
+ */
+static void sp_image_release_pixbuf( SPImage *image )
+{
+    if (!image->pixbuf) {
+        return;
+    }
+
+    if (image->cache_key) {
+        // The entry might have been replaced by a newer version of the file since;
+        // then this image holds the only references to its pixels that are left.
+        ImageCache &cache = image_cache();
+        ImageCache::iterator i = cache.find(image->cache_key);
+        if (i != cache.end() && i->second.pixbuf == image->pixbuf && --i->second.users == 0) {
+            g_object_unref(i->second.pixbuf);
+            cache.erase(i);
+        }
+        g_free(image->cache_key);
+        image->cache_key = NULL;
+    }
+
+    g_object_unref(image->pixbuf);
+    image->pixbuf = NULL;
+}
+
 /*
- * utility function to try loading image from href
+ * utility function to try loading image from href; returns NULL if there is no valid image
  *
  * docbase/relative_src
  * absolute_src
@@ -1238,13 +1383,7 @@ GdkPixbuf *sp_image_repr_read_image( time_t& modTime, char*& pixPath, const gcha
         }
     }
     /* Nope: We do not find any valid pixmap file :-( */
-    pixbuf = gdk_pixbuf_new_from_xpm_data ((const gchar **) brokenimage_xpm);
-
-    /* It should be included xpm, so if it still does not does load, */
-    /* our libraries are broken */
-    g_assert (pixbuf != NULL);
-
-    return pixbuf;
+    return NULL;
 }
 
 static GdkPixbuf *sp_image_pixbuf_force_rgba( GdkPixbuf * pixbuf )
@@ -57,6 +57,7 @@ struct SPImage : public SPItem {
 #endif // defined(HAVE_LIBLCMS1) || defined(HAVE_LIBLCMS2)
 
     GdkPixbuf *pixbuf;
+    gchar *cache_key; // Key of pixbuf in the decoded image cache, NULL if it is not shared
     gchar *pixPath;
     time_t lastMod;
 };
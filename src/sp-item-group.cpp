@@ -628,10 +628,12 @@ void CGroup::onChildAdded(Inkscape::XML::Node *child) {
         }
     }
 
+    _group->invalidateBBox();
     _group->requestModified(SP_OBJECT_MODIFIED_FLAG);
 }
 
 void CGroup::onChildRemoved(Inkscape::XML::Node */*child*/) {
+    _group->invalidateBBox();
     _group->requestModified(SP_OBJECT_MODIFIED_FLAG);
 }
 
@@ -0,0 +1,123 @@
+#ifndef SEEN_SP_ITEM_TEST_H
+#define SEEN_SP_ITEM_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstring>
+
+#include "test-helpers.h"
+
+#include "sp-item.h"
+#include "xml/node.h"
+
+class SPItemTest : public CxxTest::TestSuite
+{
+public:
+    SPDocument* _doc;
+
+    SPItemTest() :
+        _doc(0)
+    {
+    }
+
+    virtual ~SPItemTest()
+    {
+        if ( _doc )
+        {
+            _doc->doUnref();
+        }
+    }
+
+    static void createSuiteSubclass( SPItemTest *& dst )
+    {
+        dst = new SPItemTest();
+    }
+
+    static SPItemTest *createSuite()
+    {
+        return Inkscape::createSuiteAndDocument<SPItemTest>( createSuiteSubclass );
+    }
+
+    static void destroySuite( SPItemTest *suite ) { delete suite; }
+
+    void setUp()
+    {
+        static gchar const svg[] =
+            "<svg xmlns='http://www.w3.org/2000/svg' width='200' height='200' viewBox='0 0 200 200'>"
+            "<defs>"
+            "<filter id='blur' x='0' y='0' width='1' height='1'>"
+            "<feGaussianBlur id='blur-primitive' stdDeviation='2'/>"
+            "</filter>"
+            "</defs>"
+            "<g id='layer'>"
+            "<g id='group' transform='translate(10,20)'>"
+            "<rect id='rect' x='0' y='0' width='100' height='50' style='fill:#000000;stroke:none;filter:url(#blur)'/>"
+            "<rect x='40' y='20' width='10' height='10' style='fill:#000000;stroke:none'/>"
+            "</g>"
+            "</g>"
+            "</svg>";
+
+        if ( _doc )
+        {
+            _doc->doUnref();
+        }
+        _doc = SPDocument::createNewDocFromMem( svg, strlen(svg), true );
+        _doc->ensureUpToDate();
+    }
+
+// -------------------------------------------------------------------------
+// -------------------------------------------------------------------------
+
+    void testFilterRegionReachesGroup()
+    {
+        SPItem *group = SP_ITEM(_doc->getObjectById("group"));
+        Geom::OptRect bbox = group->documentVisualBounds();
+        TS_ASSERT( bbox );
+        TS_ASSERT_EQUALS( *bbox, Geom::Rect(Geom::Point(10, 20), Geom::Point(110, 70)) );
+
+        // Only the filter changes; the blurred rect itself is not touched
+        Inkscape::XML::Node *filter = _doc->getObjectById("blur")->getRepr();
+        filter->setAttribute("x", "-0.5");
+        filter->setAttribute("width", "2");
+        _doc->ensureUpToDate();
+
+        bbox = group->documentVisualBounds();
+        TS_ASSERT( bbox );
+        TS_ASSERT_EQUALS( *bbox, Geom::Rect(Geom::Point(-40, 20), Geom::Point(160, 70)) );
+        TS_ASSERT_EQUALS( *group->visualBounds(), Geom::Rect(Geom::Point(-50, 0), Geom::Point(150, 50)) );
+    }
+
+    void testFilterRegionReachesAncestors()
+    {
+        SPItem *layer = SP_ITEM(_doc->getObjectById("layer"));
+        SPItem *root = SP_ITEM(_doc->getRoot());
+        TS_ASSERT_EQUALS( *layer->documentVisualBounds(), Geom::Rect(Geom::Point(10, 20), Geom::Point(110, 70)) );
+        TS_ASSERT_EQUALS( *root->documentVisualBounds(), Geom::Rect(Geom::Point(10, 20), Geom::Point(110, 70)) );
+
+        Inkscape::XML::Node *filter = _doc->getObjectById("blur")->getRepr();
+        filter->setAttribute("y", "-0.2");
+        filter->setAttribute("height", "1.4");
+        _doc->ensureUpToDate();
+
+        TS_ASSERT_EQUALS( *layer->documentVisualBounds(), Geom::Rect(Geom::Point(10, 10), Geom::Point(110, 80)) );
+        TS_ASSERT_EQUALS( *root->documentVisualBounds(), Geom::Rect(Geom::Point(10, 10), Geom::Point(110, 80)) );
+    }
+
+// -------------------------------------------------------------------------
+// -------------------------------------------------------------------------
+
+};
+
+
+#endif // SEEN_SP_ITEM_TEST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
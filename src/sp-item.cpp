@@ -75,6 +75,8 @@
 
 #define noSP_ITEM_DEBUG_IDLE
 
+extern guint update_in_progress;
+
 SPObjectClass * SPItemClass::static_parent_class=0;
 
 /**
@@ -129,6 +131,7 @@ void SPItem::sp_item_init(SPItem *item)
 void SPItem::init() {
     sensitive = TRUE;
     bbox_valid = FALSE;
+    local_bbox_valid = 0;
 
     transform_center_x = 0;
     transform_center_y = 0;
@@ -138,6 +141,8 @@ void SPItem::init() {
 
     transform = Geom::identity();
     doc_bbox = Geom::OptRect();
+    local_bbox[0] = Geom::OptRect();
+    local_bbox[1] = Geom::OptRect();
     freeze_stroke_width = false;
 
     display = NULL;
@@ -153,6 +158,7 @@ void SPItem::init() {
     new (&constraints) std::vector<SPGuideConstraint>();
 
     new (&_transformed_signal) sigc::signal<void, Geom::Affine const *, SPItem *>();
+    new (&_clip_modified_connection) sigc::connection();
 }
 
 bool SPItem::isVisibleAndUnlocked() const {
@@ -444,6 +450,7 @@ void SPItem::sp_item_release(SPObject *object)
     // which will cause the hide() function to be called.
     delete item->clip_ref;
     delete item->mask_ref;
+    item->_clip_modified_connection.disconnect();
 
     if ((SP_OBJECT_CLASS(SPItemClass::static_parent_class))->release) {
         (SP_OBJECT_CLASS(SPItemClass::static_parent_class))->release(object);
@@ -454,6 +461,7 @@ void SPItem::sp_item_release(SPObject *object)
     }
 
     item->_transformed_signal.~signal();
+    item->_clip_modified_connection.~connection();
 }
 
 void SPItem::sp_item_set(SPObject *object, unsigned key, gchar const *value)
@@ -552,6 +560,9 @@ void SPItem::sp_item_set(SPObject *object, unsigned key, gchar const *value)
 
 void SPItem::clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item)
 {
+    // the clipping path is part of the bounds which ancestors have cached
+    item->_clip_modified_connection.disconnect();
+    item->invalidateBBox();
     if (old_clip) {
         SPItemView *v;
         /* Hide clippath */
@@ -560,6 +571,7 @@ void SPItem::clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item)
         }
     }
     if (SP_IS_CLIPPATH(clip)) {
+        item->_clip_modified_connection = clip->connectModified(sigc::bind(sigc::ptr_fun(&SPItem::clip_modified), item));
         Geom::OptRect bbox = item->geometricBounds();
         for (SPItemView *v = item->display; v != NULL; v = v->next) {
             if (!v->arenaitem->key()) {
@@ -575,6 +587,11 @@ void SPItem::clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item)
     }
 }
 
+void SPItem::clip_modified(SPObject */*clip*/, guint /*flags*/, SPItem *item)
+{
+    item->invalidateBBox();
+}
+
 void SPItem::mask_ref_changed(SPObject *old_mask, SPObject *mask, SPItem *item)
 {
     if (old_mask) {
@@ -610,6 +627,13 @@ void SPItem::sp_item_update(SPObject *object, SPCtx *ctx, guint flags)
     // any of the modifications defined in sp-object.h might change bbox,
     // so we invalidate it unconditionally
     item->bbox_valid = FALSE;
+    // The bounds in item coordinates only change with the item's content or style;
+    // moving an ancestor leaves them alone. Ancestors of a changed item get
+    // SP_OBJECT_CHILD_MODIFIED_FLAG, so the invalidation reaches them too.
+    if (flags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG |
+                 SP_OBJECT_STYLE_MODIFIED_FLAG | SP_OBJECT_VIEWPORT_MODIFIED_FLAG)) {
+        item->local_bbox_valid = 0;
+    }
 
     if (flags & (SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG)) {
         if (flags & SP_OBJECT_MODIFIED_FLAG) {
@@ -733,12 +757,7 @@ Inkscape::XML::Node *SPItem::sp_item_write(SPObject *const object, Inkscape::XML
  */
 Geom::OptRect SPItem::geometricBounds(Geom::Affine const &transform) const
 {
-    Geom::OptRect bbox;
-    // call the subclass method
-    if ((SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox) {
-        bbox = (SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox(this, transform, SPItem::GEOMETRIC_BBOX);
-    }
-    return bbox;
+    return classBounds(transform, SPItem::GEOMETRIC_BBOX);
 }
 
 /**
@@ -754,10 +773,7 @@ Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform) const
     Geom::OptRect bbox;
 
     if ( style && style->filter.href && style->getFilter() && SP_IS_FILTER(style->getFilter())) {
-         // call the subclass method
-        if ((SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox) {
-            bbox = (SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox(this, Geom::identity(), SPItem::VISUAL_BBOX);
-        }
+        bbox = classBounds(Geom::identity(), SPItem::VISUAL_BBOX);
 
         SPFilter *filter = SP_FILTER(style->getFilter());
         // default filer area per the SVG spec:
@@ -800,10 +816,7 @@ Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform) const
         bbox = Geom::OptRect(minp, maxp);
         *bbox *= transform;
     } else {
-         // call the subclass method
-        if ((SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox) {
-            bbox = (SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this)))->bbox(this, transform, SPItem::VISUAL_BBOX);
-        }
+        bbox = classBounds(transform, SPItem::VISUAL_BBOX);
     }
     if (clip_ref->getObject()) {
         bbox.intersectWith(SP_CLIPPATH(clip_ref->getObject())->geometricBounds(transform));
@@ -811,6 +824,59 @@ Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform) const
 
     return bbox;
 }
+/**
+ * Calls the subclass bbox method, or takes its result from the bounds cached in item
+ * coordinates if the transform maps axis-aligned rectangles to axis-aligned rectangles.
+ * Under other transforms the bounding box of the transformed item is generally smaller
+ * than the transformed bounding box, so it has to be computed anew. Groups pass their
+ * children's transforms down here, so a group only walks the children it cannot take
+ * from their caches.
+ */
+Geom::OptRect SPItem::classBounds(Geom::Affine const &transform, BBoxType type) const
+{
+    Geom::OptRect bbox;
+    SPItemClass const *klass = SP_ITEM_CLASS(G_OBJECT_GET_CLASS(this));
+    if (!klass->bbox) {
+        return bbox;
+    }
+
+    bool const axis_aligned = (transform[1] == 0 && transform[2] == 0) || (transform[0] == 0 && transform[3] == 0);
+    if (!axis_aligned) {
+        return klass->bbox(this, transform, type);
+    }
+
+    unsigned const index = (type == GEOMETRIC_BBOX) ? 0 : 1;
+    if (local_bbox_valid & (1 << index)) {
+        bbox = local_bbox[index];
+    } else {
+        bbox = klass->bbox(this, Geom::identity(), type);
+        // The content might still change later in the same update, and the item
+        // would not be told again, so only keep results from outside of updates.
+        if (!update_in_progress) {
+            local_bbox[index] = bbox;
+            local_bbox_valid |= (1 << index);
+        }
+    }
+    if (bbox) {
+        *bbox *= transform;
+    }
+    return bbox;
+}
+
+/**
+ * Forgets the cached bounds of this item and of its ancestors. The update which
+ * follows a modification does this as well; call it when the geometry changes and
+ * its bounds might be needed before the next update.
+ */
+void SPItem::invalidateBBox()
+{
+    for (SPObject *object = this; object && SP_IS_ITEM(object); object = object->parent) {
+        SPItem *item = SP_ITEM(object);
+        item->local_bbox_valid = 0;
+        item->bbox_valid = FALSE;
+    }
+}
+
 Geom::OptRect SPItem::bounds(BBoxType type, Geom::Affine const &transform) const
 {
     if (type == GEOMETRIC_BBOX) {
@@ -1440,6 +1506,7 @@ void SPItem::set_item_transform(Geom::Affine const &transform_matrix)
 {
     if (!Geom::are_near(transform_matrix, transform, 1e-18)) {
         transform = transform_matrix;
+        invalidateBBox(); // the bounds of ancestors include this transform
         /* The SP_OBJECT_USER_MODIFIED_FLAG_B is used to mark the fact that it's only a
            transformation.  It's apparently not used anywhere else. */
         requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_USER_MODIFIED_FLAG_B);
@@ -123,12 +123,15 @@ public:
     unsigned int sensitive : 1;
     unsigned int stop_paint: 1;
     mutable unsigned bbox_valid : 1;
+    mutable unsigned local_bbox_valid : 2; ///< One bit per entry of local_bbox
     double transform_center_x;
     double transform_center_y;
     bool freeze_stroke_width;
 
     Geom::Affine transform;
     mutable Geom::OptRect doc_bbox;
+    /// Geometric and visual bounds returned by the class bbox method in item coordinates
+    mutable Geom::OptRect local_bbox[2];
 
     SPClipPathReference *clip_ref;
     SPMaskReference *mask_ref;
@@ -190,6 +193,7 @@ public:
     Geom::OptRect desktopVisualBounds() const;
     Geom::OptRect desktopPreferredBounds() const;
     Geom::OptRect desktopBounds(BBoxType type) const;
+    void invalidateBBox();
 
     unsigned pos_in_parent();
     gchar *description();
@@ -227,6 +231,10 @@ private:
     mutable bool _is_evaluated;
     mutable EvaluatedStatus _evaluated_status;
 
+    sigc::connection _clip_modified_connection;
+
+    Geom::OptRect classBounds(Geom::Affine const &transform, BBoxType type) const;
+
     static void sp_item_init(SPItem *item);
 
     static void sp_item_build(SPObject *object, SPDocument *document, Inkscape::XML::Node *repr);
@@ -242,6 +250,7 @@ private:
     static SPItemView *sp_item_view_list_remove(SPItemView *list, SPItemView *view);
     static void clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item);
     static void mask_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item);
+    static void clip_modified(SPObject *clip, guint flags, SPItem *item);
 
     friend class SPItemClass;
 };
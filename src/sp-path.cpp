@@ -385,6 +385,8 @@ sp_path_set_transform(SPItem *item, Geom::Affine const &xform)
         }
     } else {
         path->_curve->transform(xform);
+        path->invalidateStrokeBBox();
+        path->invalidateBBox();
     }
 
     // Adjust stroke
@@ -54,6 +54,10 @@ static void pattern_ref_changed(SPObject *old_ref, SPObject *ref, SPPattern *pat
 static void pattern_ref_modified (SPObject *ref, guint flags, SPPattern *pattern);
 
 static cairo_pattern_t *sp_pattern_create_pattern(SPPaintServer *ps, cairo_t *ct, Geom::OptRect const &bbox, double opacity);
+static void sp_pattern_clear_tiles(SPPattern *pat);
+
+// Number of differently scaled tiles kept per pattern
+static size_t const MAX_CACHED_TILES = 8;
 
 static SPPaintServerClass * pattern_parent_class;
 
@@ -124,6 +128,7 @@ sp_pattern_init (SPPattern *pat)
 	pat->viewBox_set = FALSE;
 
 	new (&pat->modified_connection) sigc::connection();
+	new (&pat->tiles) std::vector<SPPatternTile>();
 }
 
 static void
@@ -164,6 +169,9 @@ static void sp_pattern_release(SPObject *object)
 
     pat->modified_connection.~connection();
 
+    sp_pattern_clear_tiles(pat);
+    pat->tiles.~vector();
+
     if (((SPObjectClass *) pattern_parent_class)->release) {
         ((SPObjectClass *) pattern_parent_class)->release (object);
     }
@@ -333,6 +341,9 @@ sp_pattern_modified (SPObject *object, guint flags)
 {
 	SPPattern *pat = SP_PATTERN (object);
 
+	// the pattern, its children or the pattern it references changed
+	sp_pattern_clear_tiles(pat);
+
 	if (flags & SP_OBJECT_MODIFIED_FLAG) flags |= SP_OBJECT_PARENT_MODIFIED_FLAG;
 	flags &= SP_OBJECT_MODIFIED_CASCADE;
 
@@ -601,6 +612,15 @@ static bool pattern_hasItemChildren (SPPattern *pat)
     return hasChildren;
 }
 
+static void
+sp_pattern_clear_tiles(SPPattern *pat)
+{
+    for (std::vector<SPPatternTile>::iterator i = pat->tiles.begin(); i != pat->tiles.end(); ++i) {
+        cairo_surface_destroy(i->surface);
+    }
+    pat->tiles.clear();
+}
+
 static cairo_pattern_t *
 sp_pattern_create_pattern(SPPaintServer *ps,
                           cairo_t *base_ct,
@@ -630,22 +650,6 @@ sp_pattern_create_pattern(SPPaintServer *ps,
         return cairo_pattern_create_rgba(0,0,0,0);
     }
 
-    /* Create drawing for rendering */
-    Inkscape::Drawing drawing;
-    unsigned int dkey = SPItem::display_key_new (1);
-    Inkscape::DrawingGroup *root = new Inkscape::DrawingGroup(drawing);
-    drawing.setRoot(root);
-
-    for (SPObject *child = shown->firstChild(); child != NULL; child = child->getNext() ) {
-        if (SP_IS_ITEM (child)) {
-            // for each item in pattern, show it on our drawing, add to the group,
-            // and connect to the release signal in case the item gets deleted
-            Inkscape::DrawingItem *cai;
-            cai = SP_ITEM(child)->invoke_show (drawing, dkey, SP_ITEM_SHOW_DISPLAY);
-            root->appendChild(cai);
-        }
-    }
-
     if (pat->viewBox_set) {
         Geom::Rect vb = *pattern_viewBox(pat);
         gdouble tmp_x = pattern_width (pat) / vb.width();
@@ -685,35 +689,79 @@ sp_pattern_create_pattern(SPPaintServer *ps,
     c[Geom::X] = ceil(c[Geom::X]);
     c[Geom::Y] = ceil(c[Geom::Y]);
     
-    Geom::IntRect one_tile = pattern_tile.roundOutwards();
-    Inkscape::DrawingSurface temp(pattern_tile, c.ceil());
-    Inkscape::DrawingContext ct(temp);
-
-    // render pattern.
-    if (needs_opacity) {
-        ct.pushGroup(); // this group is for pattern + opacity
+    Geom::IntPoint tile_size = c.ceil();
+
+    // Users at the same scale share the rendered tile
+    SPPatternTile tile;
+    tile.surface = NULL;
+    for (std::vector<SPPatternTile>::iterator i = pat->tiles.begin(); i != pat->tiles.end(); ++i) {
+        if (i->area == pattern_tile && i->size == tile_size && i->opacity == opacity) {
+            tile = *i;
+            pat->tiles.erase(i);
+            pat->tiles.push_back(tile);
+            break;
+        }
     }
 
-    // TODO: make sure there are no leaks.
-    Inkscape::UpdateContext ctx;
-    ctx.ctm = vb2ps;
-    drawing.update(Geom::IntRect::infinite(), ctx);
-    drawing.render(ct, one_tile);
-    for (SPObject *child = shown->firstChild() ; child != NULL; child = child->getNext() ) {
-        if (SP_IS_ITEM (child)) {
-            SP_ITEM(child)->invoke_hide(dkey);
+    if (!tile.surface) {
+        /* Create drawing for rendering */
+        Inkscape::Drawing drawing;
+        unsigned int dkey = SPItem::display_key_new (1);
+        Inkscape::DrawingGroup *root = new Inkscape::DrawingGroup(drawing);
+        drawing.setRoot(root);
+
+        for (SPObject *child = shown->firstChild(); child != NULL; child = child->getNext() ) {
+            if (SP_IS_ITEM (child)) {
+                // for each item in pattern, show it on our drawing, add to the group,
+                // and connect to the release signal in case the item gets deleted
+                Inkscape::DrawingItem *cai;
+                cai = SP_ITEM(child)->invoke_show (drawing, dkey, SP_ITEM_SHOW_DISPLAY);
+                root->appendChild(cai);
+            }
+        }
+
+        Geom::IntRect one_tile = pattern_tile.roundOutwards();
+        Inkscape::DrawingSurface temp(pattern_tile, tile_size);
+        Inkscape::DrawingContext ct(temp);
+
+        // render pattern.
+        if (needs_opacity) {
+            ct.pushGroup(); // this group is for pattern + opacity
         }
-    }
 
-    if (needs_opacity) {
-        ct.popGroupToSource(); // pop raw pattern
-        ct.paint(opacity); // apply opacity
+        // TODO: make sure there are no leaks.
+        Inkscape::UpdateContext ctx;
+        ctx.ctm = vb2ps;
+        drawing.update(Geom::IntRect::infinite(), ctx);
+        drawing.render(ct, one_tile);
+        for (SPObject *child = shown->firstChild() ; child != NULL; child = child->getNext() ) {
+            if (SP_IS_ITEM (child)) {
+                SP_ITEM(child)->invoke_hide(dkey);
+            }
+        }
+
+        if (needs_opacity) {
+            ct.popGroupToSource(); // pop raw pattern
+            ct.paint(opacity); // apply opacity
+        }
+
+        tile.area = pattern_tile;
+        tile.size = tile_size;
+        tile.opacity = opacity;
+        tile.transform = temp.drawingTransform();
+        tile.surface = cairo_surface_reference(temp.raw());
+
+        if (pat->tiles.size() >= MAX_CACHED_TILES) {
+            cairo_surface_destroy(pat->tiles.front().surface);
+            pat->tiles.erase(pat->tiles.begin());
+        }
+        pat->tiles.push_back(tile);
     }
 
-    cairo_pattern_t *cp = cairo_pattern_create_for_surface(temp.raw());
+    cairo_pattern_t *cp = cairo_pattern_create_for_surface(tile.surface);
 
     // Apply transformation to user space. Also compensate for oversampling.
-    ink_cairo_pattern_set_matrix(cp, ps2user.inverse() * temp.drawingTransform());
+    ink_cairo_pattern_set_matrix(cp, ps2user.inverse() * tile.transform);
     cairo_pattern_set_extend(cp, CAIRO_EXTEND_REPEAT);
 
     return cp;
@@ -32,6 +32,7 @@ class SPPatternClass;
 #include "uri-references.h"
 
 #include <stddef.h>
+#include <vector>
 #include <sigc++/connection.h>
 
 
@@ -53,6 +54,18 @@ enum {
     SP_PATTERN_UNITS_OBJECTBOUNDINGBOX
 };
 
+/**
+ * A rendered pattern tile, shared by all users of the pattern
+ * that paint it at the same scale and opacity.
+ */
+struct SPPatternTile {
+    Geom::Rect area;       ///< tile rectangle in pattern space
+    Geom::IntPoint size;   ///< tile size in pixels
+    double opacity;
+    Geom::Affine transform; ///< pixel to pattern space transform
+    cairo_surface_t *surface;
+};
+
 struct SPPattern : public SPPaintServer {
     /* Reference (href) */
     gchar *href;
@@ -76,6 +89,9 @@ struct SPPattern : public SPPaintServer {
     guint viewBox_set : 1;
 
     sigc::connection modified_connection;
+
+    /* Rendered tiles, most recently used last; dropped when the pattern or its children change */
+    std::vector<SPPatternTile> tiles;
 };
 
 struct SPPatternClass {
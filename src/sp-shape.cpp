@@ -26,6 +26,7 @@
 #include "helper/geom.h"
 #include "helper/geom-nodetype.h"
 
+#include <algorithm>
 #include <sigc++/functors/ptr_fun.h>
 #include <sigc++/adaptors/bind.h>
 
@@ -49,7 +50,7 @@
 
 #include "util/mathfns.h" // for triangle_area()
 
-#include "splivarot.h" // for bounding box calculation
+#include "display/canvas-bpath.h" // for the stroke join and cap types
 
 #define noSHAPE_VERBOSE
 
@@ -123,6 +124,11 @@ void SPShape::sp_shape_init(SPShape *shape)
     }
     shape->_curve = NULL;
     shape->_curve_before_lpe = NULL;
+    for (int i = 0; i < 2; i++) {
+        shape->_stroke_bbox[i].valid = false;
+        shape->_stroke_bbox[i].bbox = Geom::OptRect();
+    }
+    shape->_stroke_bbox_next = 0;
 }
 
 void SPShape::sp_shape_finalize(GObject *object)
@@ -512,14 +518,10 @@ Geom::OptRect SPShape::sp_shape_bbox(SPItem const *item, Geom::Affine const &tra
     if (!bbox) return bbox;
 
     if (bboxtype == SPItem::VISUAL_BBOX) {
-        // convert the stroke to a path and calculate that path's geometric bbox
+        // union with the area covered by the stroke
         SPStyle* style = item->style;
         if (!style->stroke.isNone()) {
-            Geom::PathVector *pathv = item_outline(item, true);  // calculate bbox_only
-            if (pathv) {
-                bbox |= bounds_exact_transformed(*pathv, transform);
-                delete pathv;
-            }
+            bbox |= shape->strokeBounds(transform);
         }
         // Union with bboxes of the markers, if any
         if ( shape->hasMarkers()  && !shape->_curve->get_pathvector().empty() ) {
@@ -964,10 +966,13 @@ sp_shape_marker_release (SPObject *marker, SPShape *shape)
  * No-op.  Exists for handling 'modified' messages
  */
 static void
-sp_shape_marker_modified (SPObject */*marker*/, guint /*flags*/, SPItem */*item*/)
+sp_shape_marker_modified (SPObject */*marker*/, guint /*flags*/, SPItem *item)
 {
     /* I think mask does update automagically */
     /* g_warning ("Item %s mask %s modified", item->getId(), mask->getId()); */
+
+    // the markers are part of the visual bounds
+    item->invalidateBBox();
 }
 
 /**
@@ -1027,6 +1032,96 @@ void SPShape::setShape()
     }
 }
 
+/**
+ * Calculates the bounds of the area covered by the stroke. The result only depends on
+ * the linear part of the transform, so it is cached for the most recent linear parts
+ * and stroke styles until the curve changes.
+ */
+Geom::OptRect SPShape::strokeBounds(Geom::Affine const &transform) const
+{
+    SPStyle const *style = this->style;
+    // same minimum width as item_outline() uses
+    double const width = std::max(style->stroke_width.computed, 0.1f);
+    double const miter_limit = style->stroke_miterlimit.value;
+    unsigned const join = style->stroke_linejoin.computed;
+    unsigned const cap = style->stroke_linecap.computed;
+    Geom::Affine linear = transform.withoutTranslation();
+
+    Geom::OptRect bbox;
+    bool found = false;
+    for (int i = 0; i < 2 && !found; i++) {
+        StrokeBBox const &cached = _stroke_bbox[i];
+        if (cached.valid && cached.linear == linear && cached.width == width
+            && cached.miter_limit == miter_limit && cached.join == join && cached.cap == cap)
+        {
+            bbox = cached.bbox;
+            found = true;
+        }
+    }
+    if (!found) {
+        bbox = computeStrokeBounds(linear, width, miter_limit, join, cap);
+    }
+    if (bbox) {
+        *bbox += transform.translation();
+    }
+    return bbox;
+}
+
+/**
+ * Calculates the stroke bounds for a transform without translation and stores them
+ * in the oldest slot of the cache.
+ */
+Geom::OptRect SPShape::computeStrokeBounds(Geom::Affine const &linear, double width, double miter_limit,
+                                           unsigned join, unsigned cap) const
+{
+    StrokeJoin stroke_join;
+    switch (join) {
+        case SP_STROKE_LINEJOIN_MITER:
+            stroke_join = STROKE_JOIN_MITER;
+            break;
+        case SP_STROKE_LINEJOIN_ROUND:
+            stroke_join = STROKE_JOIN_ROUND;
+            break;
+        default:
+            stroke_join = STROKE_JOIN_BEVEL;
+            break;
+    }
+    StrokeCap stroke_cap;
+    switch (cap) {
+        case SP_STROKE_LINECAP_SQUARE:
+            stroke_cap = STROKE_CAP_SQUARE;
+            break;
+        case SP_STROKE_LINECAP_ROUND:
+            stroke_cap = STROKE_CAP_ROUND;
+            break;
+        default:
+            stroke_cap = STROKE_CAP_BUTT;
+            break;
+    }
+
+    StrokeBBox &entry = _stroke_bbox[_stroke_bbox_next];
+    _stroke_bbox_next = (_stroke_bbox_next + 1) % 2;
+    entry.valid = true;
+    entry.linear = linear;
+    entry.width = width;
+    entry.miter_limit = miter_limit;
+    entry.join = join;
+    entry.cap = cap;
+    entry.bbox = bounds_stroke_transformed(_curve->get_pathvector(), linear, width, stroke_join, stroke_cap, miter_limit);
+    return entry.bbox;
+}
+
+/**
+ * Forgets the cached stroke bounds. Needs to be called when the curve
+ * is modified in place.
+ */
+void SPShape::invalidateStrokeBBox()
+{
+    for (int i = 0; i < 2; i++) {
+        _stroke_bbox[i].valid = false;
+    }
+}
+
 /**
  * Adds a curve to the shape.  If owner is specified, a reference
  * will be made, otherwise the curve will be copied into the shape.
@@ -1035,6 +1130,8 @@ void SPShape::setShape()
  */
 void SPShape::setCurve(SPCurve *new_curve, unsigned int owner)
 {
+    invalidateStrokeBBox();
+    invalidateBBox();
     if (_curve) {
         _curve = _curve->unref();
     }
@@ -1095,6 +1192,8 @@ SPCurve * SPShape::getCurveBeforeLPE() const
  */
 void SPShape::setCurveInsync(SPCurve *new_curve, unsigned int owner)
 {
+    invalidateStrokeBBox();
+    invalidateBBox();
     if (_curve) {
         _curve = _curve->unref();
     }
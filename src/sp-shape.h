@@ -18,6 +18,8 @@
 #include "sp-lpe-item.h"
 #include "sp-marker-loc.h"
 #include <2geom/forward.h>
+#include <2geom/affine.h>
+#include <2geom/rect.h>
 
 #include <stddef.h>
 #include <sigc++/connection.h>
@@ -47,6 +49,7 @@ public:
     void setCurveBeforeLPE (SPCurve *curve);
     int hasMarkers () const;
     int numberOfMarkers (int type);
+    void invalidateStrokeBBox ();
 
 public: // temporarily public, until SPPath is properly classed, etc.
     SPCurve *_curve_before_lpe;
@@ -58,6 +61,25 @@ public:
     sigc::connection _modified_connect [SP_MARKER_LOC_QTY];
 
 private:
+    /// Stroke bounds computed for one linear transform and stroke style
+    struct StrokeBBox {
+        bool valid;
+        Geom::Affine linear; ///< Transform without its translation
+        double width;
+        double miter_limit;
+        unsigned join;
+        unsigned cap;
+        Geom::OptRect bbox;
+    };
+    // Typically bounds are asked for in document and in desktop coordinates,
+    // so keep the two most recent results.
+    mutable StrokeBBox _stroke_bbox[2];
+    mutable unsigned _stroke_bbox_next;
+
+    Geom::OptRect strokeBounds (Geom::Affine const &transform) const;
+    Geom::OptRect computeStrokeBounds (Geom::Affine const &linear, double width, double miter_limit,
+                                       unsigned join, unsigned cap) const;
+
     static void sp_shape_init (SPShape *shape);
     static void sp_shape_finalize (GObject *object);
 
@@ -6,6 +6,7 @@
 #include "test-helpers.h"
 
 #include "sp-style-elem.h"
+#include "style.h"
 #include "xml/repr.h"
 
 class SPStyleElemTest : public CxxTest::TestSuite
@@ -148,6 +149,44 @@ public:
         Inkscape::GC::release(repr);
     }
 
+    void testMatchSelectors()
+    {
+        TS_ASSERT( _doc );
+        TS_ASSERT( _doc->getReprDoc() );
+        if ( !_doc->getReprDoc() ) {
+            return; // evil early return
+        }
+
+        SPStyleElem &style_elem = *SP_STYLE_ELEM(g_object_new(SP_TYPE_STYLE_ELEM, NULL));
+        Inkscape::XML::Node *const repr = _doc->getReprDoc()->createElement("svg:style");
+        repr->setAttribute("type", "text/css");
+        Inkscape::XML::Node *const content_repr = _doc->getReprDoc()->createTextNode(
+            "rect { opacity: 0.5 } .a { stroke-width: 3 } #b { stroke-miterlimit: 7 } .x { stroke-opacity: 0.25 }");
+        repr->addChild(content_repr, NULL);
+        (&style_elem)->invoke_build(_doc, repr, false);
+
+        Inkscape::XML::Node *const rect = _doc->getReprDoc()->createElement("svg:rect");
+        rect->setAttribute("id", "bb");
+        rect->setAttribute("class", "xa  a");
+        _doc->getReprRoot()->appendChild(rect);
+        SPObject *const object = _doc->getObjectByRepr(rect);
+        TS_ASSERT( object && object->style );
+        if ( object && object->style ) {
+            SPStyle const *const style = object->style;
+            TS_ASSERT_DELTA( SP_SCALE24_TO_FLOAT(style->opacity.value), 0.5, 0.01 );
+            TS_ASSERT( style->stroke_width.set );
+            TS_ASSERT_DELTA( style->stroke_width.computed, 3.0, 1e-6 );
+            // ids and class names have to match completely
+            TS_ASSERT( !style->stroke_miterlimit.set );
+            TS_ASSERT( !style->stroke_opacity.set );
+        }
+
+        _doc->getReprRoot()->removeChild(rect);
+        Inkscape::GC::release(rect);
+        g_object_unref(&style_elem);
+        Inkscape::GC::release(repr);
+    }
+
 };
 
 
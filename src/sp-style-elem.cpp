@@ -348,6 +348,7 @@ sp_style_elem_read_content(SPObject *const object)
     g_assert(sac_handler->app_data == &parse_tmp);
     if (parse_status == CR_OK) {
         cr_cascade_set_sheet(style_elem.document->style_cascade, stylesheet, ORIGIN_AUTHOR);
+        sp_style_sheet_changed(style_elem.document);
     } else {
         if (parse_status != CR_PARSING_ERROR) {
             g_printerr("parsing error code=%u\n", unsigned(parse_status));
@@ -247,6 +247,9 @@ sp_tref_update(SPObject *object, SPCtx *ctx, guint flags)
         ((SPObjectClass *) tref_parent_class)->update(object, ctx, flags);
     }
 
+    // positioned by the layout of the ancestor text, like a tspan
+    SP_ITEM(object)->invalidateBBox();
+
     if (flags & SP_OBJECT_MODIFIED_FLAG) {
         flags |= SP_OBJECT_PARENT_MODIFIED_FLAG;
     }
@@ -337,8 +340,9 @@ sp_tref_bbox(SPItem const *item, Geom::Affine const &transform, SPItem::BBoxType
     // Add stroke width
     // FIXME this code is incorrect
     if (bbox && type == SPItem::VISUAL_BBOX && !item->style->stroke.isNone()) {
-        double scale = transform.descrim();
-        bbox->expandBy(0.5 * item->style->stroke_width.computed * scale);
+        double const width = item->style->stroke_width.computed;
+        bbox->expandBy(0.5 * width * Geom::L2(Geom::Point(transform[0], transform[2])),
+                       0.5 * width * Geom::L2(Geom::Point(transform[1], transform[3])));
     }
     return bbox;
 }
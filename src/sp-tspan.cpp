@@ -173,6 +173,10 @@ static void sp_tspan_update(SPObject *object, SPCtx *ctx, guint flags)
         ((SPObjectClass *) tspan_parent_class)->update(object, ctx, flags);
     }
 
+    // the bounds come from the layout of the ancestor text, which may have been
+    // rebuilt without this object being modified
+    SP_ITEM(object)->invalidateBBox();
+
     if (flags & SP_OBJECT_MODIFIED_FLAG) {
         flags |= SP_OBJECT_PARENT_MODIFIED_FLAG;
     }
@@ -223,8 +227,9 @@ sp_tspan_bbox(SPItem const *item, Geom::Affine const &transform, SPItem::BBoxTyp
     // Add stroke width
     // FIXME this code is incorrect
     if (type == SPItem::VISUAL_BBOX && !item->style->stroke.isNone()) {
-        double scale = transform.descrim();
-        bbox->expandBy(0.5 * item->style->stroke_width.computed * scale);
+        double const width = item->style->stroke_width.computed;
+        bbox->expandBy(0.5 * width * Geom::L2(Geom::Point(transform[0], transform[2])),
+                       0.5 * width * Geom::L2(Geom::Point(transform[1], transform[3])));
     }
     return bbox;
 }
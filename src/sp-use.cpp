@@ -18,14 +18,23 @@
 #endif
 
 #include <cstring>
+#include <map>
 #include <string>
 
 #include <2geom/transforms.h>
 #include <glibmm/i18n.h>
 #include "display/drawing-group.h"
+#include "display/drawing-instance.h"
 #include "attributes.h"
 #include "document.h"
 #include "sp-object-repr.h"
+#include "sp-clippath.h"
+#include "sp-item-group.h"
+#include "sp-mask.h"
+#include "sp-pattern.h"
+#include "sp-root.h"
+#include "sp-shape.h"
+#include "marker.h"
 #include "sp-flowregion.h"
 #include "uri.h"
 #include "print.h"
@@ -56,6 +65,10 @@ static gchar *sp_use_description(SPItem *item);
 static Inkscape::DrawingItem *sp_use_show(SPItem *item, Inkscape::Drawing &drawing, unsigned key, unsigned flags);
 static void sp_use_hide(SPItem *item, unsigned key);
 
+static void sp_use_show_child(SPUse *use, Inkscape::DrawingInstance *ai, unsigned key, unsigned flags);
+static void sp_use_hide_child(SPUse *use, Inkscape::DrawingInstance *ai, unsigned key);
+static void sp_use_update_sharing(SPUse *use);
+
 static void sp_use_href_changed(SPObject *old_ref, SPObject *ref, SPUse *use);
 
 static void sp_use_delete_self(SPObject *deleted, SPUse *self);
@@ -176,6 +189,10 @@ sp_use_release(SPObject *object)
     SPUse *use = SP_USE(object);
 
     if (use->child) {
+        // the child is released with its displays, including shared ones
+        for (SPItemView *v = use->display; v != NULL; v = v->next) {
+            sp_use_hide_child(use, dynamic_cast<Inkscape::DrawingInstance *>(v->arenaitem), v->key);
+        }
         object->detach(use->child);
         use->child = NULL;
     }
@@ -349,20 +366,221 @@ sp_use_description(SPItem *item)
     }
 }
 
+namespace {
+
+/**
+ * Display of a clone child which is shared by clones of the same original.
+ * The display is shown from the child of one of these clones, the owner.
+ */
+class UsePrototype
+    : public Inkscape::DrawingPrototype
+{
+public:
+    std::string id;
+    SPUse *owner;
+    unsigned key;
+    unsigned flags;
+};
+typedef std::map<std::string, UsePrototype *> UsePrototypeMap;
+
+UsePrototypeMap &use_prototypes()
+{
+    static UsePrototypeMap prototypes;
+    return prototypes;
+}
+
+} // anonymous namespace
+
+/**
+ * Whether the display of @a object can be drawn at another place by translating it.
+ * Clips, masks, filters, opacity and patterns are rendered to intermediate surfaces,
+ * which would be resampled when moved by a fraction of a pixel.
+ */
+static bool
+sp_use_can_share(SPObject *object)
+{
+    if (SP_IS_USE(object) || SP_IS_ROOT(object)) {
+        return false;
+    }
+    if (SP_IS_ITEM(object)) {
+        SPItem *item = SP_ITEM(object);
+        if (item->clip_ref->getObject() || item->mask_ref->getObject()) {
+            return false;
+        }
+        SPStyle *style = object->style;
+        if (style) {
+            if (style->getFilter() || style->opacity.value != SP_SCALE24_MAX) {
+                return false;
+            }
+            if (SP_IS_PATTERN(style->getFillPaintServer()) || SP_IS_PATTERN(style->getStrokePaintServer())) {
+                return false;
+            }
+        }
+        if (SP_IS_SHAPE(object) && SP_SHAPE(object)->hasMarkers()) {
+            return false;
+        }
+    }
+    for (SPObject *child = object->firstChild(); child; child = child->getNext()) {
+        if (!sp_use_can_share(child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compute the key under which the display of the child of @a use is shared.
+ * Clones in the same drawing whose children have the same original, computed style
+ * and linear transform look the same up to a translation.
+ * @return False if the display of the child can't be shared.
+ */
+static bool
+sp_use_prototype_id(SPUse *use, Inkscape::Drawing &drawing, std::string &id)
+{
+    if (!use->child || !SP_IS_ITEM(use->child)) {
+        return false;
+    }
+    // Inside of clipping paths, masks, markers, patterns and symbols the display
+    // transform of an item does not follow from its document transform
+    for (SPObject *o = use->parent; o; o = o->parent) {
+        if (!SP_IS_GROUP(o) || SP_IS_MARKER(o) || SP_IS_SYMBOL(o)) {
+            return false;
+        }
+    }
+    if (!sp_use_can_share(use->child)) {
+        return false;
+    }
+
+    Geom::Affine linear = use->i2doc_affine();
+    gchar *style = sp_style_write_string(use->child->style, SP_STYLE_FLAG_ALWAYS);
+    gchar *str = g_strdup_printf("%p %p %.17g %.17g %.17g %.17g %.17g %.17g\n%s",
+                                 static_cast<void *>(&drawing), static_cast<void *>(use->child->getRepr()),
+                                 linear[0], linear[1], linear[2], linear[3],
+                                 use->width.computed, use->height.computed, style);
+    id = str;
+    g_free(str);
+    g_free(style);
+    return true;
+}
+
+/**
+ * Draw the child of @a use in @a ai through the prototype registered under @a id,
+ * creating it if necessary.
+ */
+static bool
+sp_use_share_child(SPUse *use, Inkscape::DrawingInstance *ai, std::string const &id, unsigned flags)
+{
+    UsePrototypeMap &prototypes = use_prototypes();
+    UsePrototypeMap::iterator found = prototypes.find(id);
+    UsePrototype *proto;
+    if (found != prototypes.end()) {
+        proto = found->second;
+    } else {
+        unsigned key = SPItem::display_key_new(1);
+        Inkscape::DrawingItem *item = SP_ITEM(use->child)->invoke_show(ai->drawing(), key, flags);
+        if (!item) {
+            return false;
+        }
+        proto = new UsePrototype();
+        proto->id = id;
+        proto->owner = use;
+        proto->key = key;
+        proto->flags = flags;
+        proto->setItem(item);
+        prototypes[id] = proto;
+    }
+    ai->setPrototype(proto);
+    return true;
+}
+
+/**
+ * Stop drawing a shared display in @a ai. If the child of @a use showed it,
+ * the child of another clone takes over.
+ */
+static void
+sp_use_unshare_child(SPUse *use, Inkscape::DrawingInstance *ai)
+{
+    UsePrototype *proto = static_cast<UsePrototype *>(ai->prototype());
+    ai->setPrototype(NULL);
+
+    if (proto->owner == use) {
+        proto->setItem(NULL);
+        SP_ITEM(use->child)->invoke_hide(proto->key);
+        proto->owner = NULL;
+        if (!proto->instances().empty()) {
+            Inkscape::DrawingInstance *next = proto->instances().front();
+            proto->owner = SP_USE(next->data());
+            proto->key = SPItem::display_key_new(1);
+            proto->setItem(SP_ITEM(proto->owner->child)->invoke_show(next->drawing(), proto->key, proto->flags));
+        }
+    }
+    if (proto->instances().empty()) {
+        use_prototypes().erase(proto->id);
+        delete proto;
+    }
+}
+
+/**
+ * Show the child of @a use in @a ai, sharing the display with other clones if possible.
+ */
+static void
+sp_use_show_child(SPUse *use, Inkscape::DrawingInstance *ai, unsigned key, unsigned flags)
+{
+    std::string id;
+    if (sp_use_prototype_id(use, ai->drawing(), id) && sp_use_share_child(use, ai, id, flags)) {
+        return;
+    }
+    Inkscape::DrawingItem *ac = SP_ITEM(use->child)->invoke_show(ai->drawing(), key, flags);
+    if (ac) {
+        ai->prependChild(ac);
+    }
+}
+
+static void
+sp_use_hide_child(SPUse *use, Inkscape::DrawingInstance *ai, unsigned key)
+{
+    if (ai->prototype()) {
+        sp_use_unshare_child(use, ai);
+    } else {
+        SP_ITEM(use->child)->invoke_hide(key);
+    }
+}
+
+/**
+ * Move the displays of @a use to another shared display, or stop sharing them,
+ * after the child or its placement changed.
+ */
+static void
+sp_use_update_sharing(SPUse *use)
+{
+    for (SPItemView *v = use->display; v != NULL; v = v->next) {
+        Inkscape::DrawingInstance *ai = dynamic_cast<Inkscape::DrawingInstance *>(v->arenaitem);
+        UsePrototype *proto = static_cast<UsePrototype *>(ai->prototype());
+        std::string id;
+        bool shareable = sp_use_prototype_id(use, ai->drawing(), id);
+        if (proto ? (shareable && proto->id == id) : !shareable) {
+            if (proto) {
+                // the items of the prototype may have changed together with the child
+                ai->prototypeChanged();
+            }
+            continue;
+        }
+        sp_use_hide_child(use, ai, v->key);
+        sp_use_show_child(use, ai, v->key, v->flags);
+    }
+}
+
 static Inkscape::DrawingItem *
 sp_use_show(SPItem *item, Inkscape::Drawing &drawing, unsigned key, unsigned flags)
 {
     SPUse *use = SP_USE(item);
 
-    Inkscape::DrawingGroup *ai = new Inkscape::DrawingGroup(drawing);
+    Inkscape::DrawingInstance *ai = new Inkscape::DrawingInstance(drawing);
     ai->setPickChildren(false);
     ai->setStyle(item->style);
 
     if (use->child) {
-        Inkscape::DrawingItem *ac = SP_ITEM(use->child)->invoke_show(drawing, key, flags);
-        if (ac) {
-            ai->prependChild(ac);
-        }
+        sp_use_show_child(use, ai, key, flags);
         Geom::Translate t(use->x.computed,
                         use->y.computed);
         ai->setChildTransform(t);
@@ -377,7 +595,11 @@ sp_use_hide(SPItem *item, unsigned key)
     SPUse *use = SP_USE(item);
 
     if (use->child) {
-        SP_ITEM(use->child)->invoke_hide(key);
+        for (SPItemView *v = item->display; v != NULL; v = v->next) {
+            if (v->key == key) {
+                sp_use_hide_child(use, dynamic_cast<Inkscape::DrawingInstance *>(v->arenaitem), key);
+            }
+        }
     }
 
     if (((SPItemClass *) parent_class)->hide) {
@@ -526,6 +748,9 @@ sp_use_href_changed(SPObject */*old_ref*/, SPObject */*ref*/, SPUse *use)
     use->_transformed_connection.disconnect();
 
     if (use->child) {
+        for (SPItemView *v = item->display; v != NULL; v = v->next) {
+            sp_use_hide_child(use, dynamic_cast<Inkscape::DrawingInstance *>(v->arenaitem), v->key);
+        }
         use->detach(use->child);
         use->child = NULL;
     }
@@ -543,11 +768,7 @@ sp_use_href_changed(SPObject */*old_ref*/, SPObject */*ref*/, SPUse *use)
                 (use->child)->invoke_build(use->document, childrepr, TRUE);
 
                 for (SPItemView *v = item->display; v != NULL; v = v->next) {
-                    Inkscape::DrawingItem *ai;
-                    ai = SP_ITEM(use->child)->invoke_show(v->arenaitem->drawing(), v->key, v->flags);
-                    if (ai) {
-                        v->arenaitem->prependChild(ai);
-                    }
+                    sp_use_show_child(use, dynamic_cast<Inkscape::DrawingInstance *>(v->arenaitem), v->key, v->flags);
                 }
 
             }
@@ -628,6 +849,7 @@ sp_use_update(SPObject *object, SPCtx *ctx, unsigned flags)
             } else {
                 use->child->updateDisplay(ctx, flags);
             }
+            sp_use_update_sharing(use);
         }
         g_object_unref(G_OBJECT(use->child));
     }
@@ -20,6 +20,9 @@
 #include <string>
 #include <vector>
 #include <glib.h>
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "xml/repr.h"
 #include "svg/svg.h"
 #include "sp-path.h"
@@ -109,6 +112,59 @@ sp_selected_path_slice(SPDesktop *desktop)
 }
 
 
+/**
+ * Unites the polygons of many paths by merging them pairwise in a balanced tree.
+ *
+ * Folding the paths into the result one at a time sweeps the growing result
+ * again for every path; here each edge is swept once per level of the tree,
+ * and the merges on one level are independent, so they run in parallel.
+ * Returns a shape with back data for ConvertToForme() with the same paths.
+ */
+static Shape *
+sp_union_shapes_pairwise(std::vector<Path *> const &originaux, std::vector<FillRule> const &origWind)
+{
+    int const n = originaux.size();
+    std::vector<Shape *> level(n);
+
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#endif
+
+    // get the polygon of each path, with its own winding rule
+#if HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(numOfThreads)
+#endif
+    for (int i = 0; i < n; i++) {
+        Shape *polygon = new Shape;
+        originaux[i]->ConvertWithBackData(0.1);
+        originaux[i]->Fill(polygon, i);
+        level[i] = new Shape;
+        level[i]->ConvertToShape(polygon, origWind[i]);
+        delete polygon;
+    }
+
+    while (level.size() > 1) {
+        int const pairs = level.size() / 2;
+        std::vector<Shape *> next((level.size() + 1) / 2);
+#if HAVE_OPENMP
+        #pragma omp parallel for schedule(dynamic) num_threads(numOfThreads)
+#endif
+        for (int i = 0; i < pairs; i++) {
+            next[i] = new Shape;
+            next[i]->Booleen(level[2 * i + 1], level[2 * i], bool_op_union);
+            delete level[2 * i];
+            delete level[2 * i + 1];
+        }
+        if (level.size() % 2) {
+            next.back() = level.back();
+        }
+        level.swap(next);
+    }
+
+    return level[0];
+}
+
 // boolean operations
 // take the source paths from the file, do the operation, delete the originals and add the results
 void
@@ -244,7 +300,12 @@ sp_selected_path_boolop(SPDesktop *desktop, bool_op bop, const unsigned int verb
     Path::cut_position  *toCut=NULL;
     int                  nbToCut=0;
 
-    if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_diff || bop == bool_op_symdiff ) {
+    if ( bop == bool_op_union && nbOriginaux > 2 ) {
+        // union is associative, so many objects can be merged in any grouping
+        delete theShape;
+        theShape = sp_union_shapes_pairwise(originaux, origWind);
+
+    } else if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_diff || bop == bool_op_symdiff ) {
         // true boolean op
         // get the polygons of each path, with the winding rule specified, and apply the operation iteratively
         originaux[0]->ConvertWithBackData(0.1);
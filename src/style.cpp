@@ -22,8 +22,12 @@
 # include "config.h"
 #endif
 
+#include <algorithm>
 #include <cstring>
+#include <map>
 #include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 
 #include "libcroco/cr-sel-eng.h"
 #include "xml/croco-node-iface.h"
@@ -50,6 +54,7 @@
 #include "preferences.h"
 
 #include "sp-filter-reference.h"
+#include "sp-item.h"
 
 #include <sigc++/functors/ptr_fun.h>
 #include <sigc++/adaptors/bind.h>
@@ -377,6 +382,11 @@ sp_style_filter_ref_modified(SPObject *obj, guint flags, SPStyle *style)
     if (style->getFilter() == filter)
     {
         if (style->object) {
+            // The filter region is part of the visual bounds of the item and its ancestors,
+            // and the item is not updated for this
+            if (SP_IS_ITEM(style->object)) {
+                SP_ITEM(style->object)->invalidateBBox();
+            }
             style->object->requestModified(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
         }
     }
@@ -1408,21 +1418,6 @@ sp_style_merge_from_props(SPStyle *const style, CRPropList *const props)
 #endif
 }
 
-/**
- * \pre decl_list != NULL
- */
-static void
-sp_style_merge_from_decl_list(SPStyle *const style, CRDeclaration const *const decl_list)
-{
-    // read the decls from end to start, using head recursion, so that latter declarations override
-    // (Ref: http://www.w3.org/TR/REC-CSS2/cascade.html#cascading-order point 4.)
-    // because sp_style_merge_style_from_decl only sets properties that are unset
-    if (decl_list->next) {
-        sp_style_merge_from_decl_list(style, decl_list->next);
-    }
-    sp_style_merge_style_from_decl(style, decl_list);
-}
-
 static CRSelEng *
 sp_repr_sel_eng()
 {
@@ -1446,21 +1441,174 @@ sp_repr_sel_eng()
     return ret;
 }
 
+/**
+ * The rules of the stylesheets of a document, filed under the id, class or element name
+ * which the last simple selector of each of their selectors requires, so that only
+ * the rules which can match an object are tested against it.
+ */
+struct SPStyleSheetIndex {
+    struct Rule {
+        CRSelector *sel;
+        CRStatement *stmt;
+        gulong specificity;
+    };
+    typedef std::map<std::string, std::vector<unsigned> > RuleMap;
+
+    std::vector<Rule> rules; ///< In the order of the cascade
+    RuleMap by_id;
+    RuleMap by_class;
+    RuleMap by_name;
+    std::vector<unsigned> universal; ///< Rules which are tested against every object
+};
+
+static SPStyleSheetIndex *
+sp_style_sheet_index_new(CRCascade *const cascade)
+{
+    SPStyleSheetIndex *const index = new SPStyleSheetIndex();
+
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; ++origin) {
+        CRStyleSheet *const sheet = cr_cascade_get_sheet(cascade, CRStyleOrigin(origin));
+        if (!sheet) {
+            continue;
+        }
+        // libcroco only takes properties from plain rulesets
+        for (CRStatement *stmt = sheet->statements; stmt; stmt = stmt->next) {
+            if (stmt->type != RULESET_STMT || !stmt->kind.ruleset || !stmt->parent_sheet) {
+                continue;
+            }
+            for (CRSelector *sel = stmt->kind.ruleset->sel_list; sel; sel = sel->next) {
+                if (!sel->simple_sel || cr_simple_sel_compute_specificity(sel->simple_sel) != CR_OK) {
+                    continue;
+                }
+                unsigned const pos = index->rules.size();
+                SPStyleSheetIndex::Rule rule;
+                rule.sel = sel;
+                rule.stmt = stmt;
+                rule.specificity = sel->simple_sel->specificity;
+                index->rules.push_back(rule);
+
+                // All additional selectors of the simple selector which is matched
+                // against the object itself have to match
+                CRSimpleSel *last = sel->simple_sel;
+                while (last->next) {
+                    last = last->next;
+                }
+                gchar const *id = NULL;
+                gchar const *klass = NULL;
+                for (CRAdditionalSel *add = last->add_sel; add; add = add->next) {
+                    if (add->type == ID_ADD_SELECTOR && add->content.id_name
+                        && add->content.id_name->stryng && add->content.id_name->stryng->str) {
+                        id = add->content.id_name->stryng->str;
+                    } else if (add->type == CLASS_ADD_SELECTOR && add->content.class_name
+                               && add->content.class_name->stryng && add->content.class_name->stryng->str) {
+                        klass = add->content.class_name->stryng->str;
+                    }
+                }
+                if (id) {
+                    index->by_id[id].push_back(pos);
+                } else if (klass) {
+                    index->by_class[klass].push_back(pos);
+                } else if ((last->type_mask & TYPE_SELECTOR) && !(last->type_mask & UNIVERSAL_SELECTOR)
+                           && last->name && last->name->stryng && last->name->stryng->str) {
+                    index->by_name[last->name->stryng->str].push_back(pos);
+                } else {
+                    index->universal.push_back(pos);
+                }
+            }
+        }
+    }
+    return index;
+}
+
+static void
+sp_style_sheet_index_find(SPStyleSheetIndex::RuleMap const &map, std::string const &key,
+                          std::vector<unsigned> &found)
+{
+    SPStyleSheetIndex::RuleMap::const_iterator const i = map.find(key);
+    if (i != map.end()) {
+        found.insert(found.end(), i->second.begin(), i->second.end());
+    }
+}
+
+/**
+ * Drops the index of the document's stylesheets after they have been replaced.
+ */
+void
+sp_style_sheet_changed(SPDocument *document)
+{
+    delete document->style_index;
+    document->style_index = NULL;
+}
+
 static void
 sp_style_merge_from_object_stylesheet(SPStyle *const style, SPObject const *const object)
 {
+    SPDocument *const document = object->document;
+    if (!document->style_index) {
+        document->style_index = sp_style_sheet_index_new(document->style_cascade);
+    }
+    SPStyleSheetIndex const &index = *document->style_index;
+    if (index.rules.empty()) {
+        // the usual case of a document without a stylesheet
+        return;
+    }
+
+    //XML Tree being directly used here while it shouldn't be.
+    Inkscape::XML::Node const *const repr = object->getRepr();
+    if (repr->type() != Inkscape::XML::ELEMENT_NODE) {
+        return;
+    }
+
+    std::vector<unsigned> candidates(index.universal);
+    if (gchar const *id = repr->attribute("id")) {
+        sp_style_sheet_index_find(index.by_id, id, candidates);
+    }
+    if (gchar const *classes = repr->attribute("class")) {
+        gchar const *cur = classes;
+        while (*cur) {
+            while (*cur && cr_utils_is_white_space(*cur)) {
+                ++cur;
+            }
+            gchar const *end = cur;
+            while (*end && !cr_utils_is_white_space(*end)) {
+                ++end;
+            }
+            if (end != cur) {
+                sp_style_sheet_index_find(index.by_class, std::string(cur, end), candidates);
+            }
+            cur = end;
+        }
+    }
+    sp_style_sheet_index_find(index.by_name, Inkscape::XML::croco_node_iface.getLocalName(repr), candidates);
+    if (candidates.empty()) {
+        return;
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
     static CRSelEng *sel_eng = NULL;
     if (!sel_eng) {
         sel_eng = sp_repr_sel_eng();
     }
 
-    CRPropList *props = NULL;
+    // As in cr_sel_eng_get_matched_properties_from_cascade, a ruleset takes the
+    // specificity of the last of its selectors which matched
+    std::vector<CRStatement *> matched;
+    for (std::vector<unsigned>::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+        SPStyleSheetIndex::Rule const &rule = index.rules[*i];
+        gboolean matches = FALSE;
+        CRStatus const status = cr_sel_eng_matches_node(sel_eng, rule.sel->simple_sel, repr, &matches);
+        if (status == CR_OK && matches) {
+            rule.stmt->specificity = rule.specificity;
+            matched.push_back(rule.stmt);
+        }
+    }
+    if (matched.empty()) {
+        return;
+    }
 
-    //XML Tree being directly used here while it shouldn't be.
-    CRStatus status = cr_sel_eng_get_matched_properties_from_cascade(sel_eng,
-                                                                     object->document->style_cascade,
-                                                                     object->getRepr(),
-                                                                     &props);
+    CRPropList *props = NULL;
+    CRStatus status = cr_sel_eng_get_properties_from_rulesets(&matched[0], matched.size(), &props);
     g_return_if_fail(status == CR_OK);
     /// \todo Check what errors can occur, and handle them properly.
     if (props) {
@@ -1469,6 +1617,54 @@ sp_style_merge_from_object_stylesheet(SPStyle *const style, SPObject const *cons
     }
 }
 
+/**
+ * The properties set by a style="..." string, in the order in which they are merged:
+ * latter declarations first, because merging only sets properties that are unset.
+ */
+typedef std::vector<std::pair<unsigned, std::string> > SPStyleDeclarations;
+
+/**
+ * Parses a style="..." string, or finds it among the strings parsed recently.
+ * Documents tend to repeat a few style strings many times.
+ */
+static boost::shared_ptr<SPStyleDeclarations const>
+sp_style_parse_declarations(gchar const *const p)
+{
+    typedef std::map<std::string, boost::shared_ptr<SPStyleDeclarations const> > DeclarationCache;
+    static DeclarationCache cache;
+    static size_t const CACHE_SIZE = 1024;
+
+    std::string const key(p);
+    DeclarationCache::iterator const found = cache.find(key);
+    if (found != cache.end()) {
+        return found->second;
+    }
+
+    SPStyleDeclarations *const decls = new SPStyleDeclarations();
+    CRDeclaration *const decl_list
+        = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(p), CR_UTF_8);
+    for (CRDeclaration const *decl = decl_list; decl; decl = decl->next) {
+        unsigned const prop_idx = sp_attribute_lookup(decl->property->stryng->str);
+        if (prop_idx != SP_ATTR_INVALID) {
+            guchar *const str_value = cr_term_to_string(decl->value);
+            decls->push_back(std::make_pair(prop_idx, std::string(reinterpret_cast<gchar *>(str_value))));
+            g_free(str_value);
+        }
+    }
+    if (decl_list) {
+        cr_declaration_destroy(decl_list);
+    }
+    // (Ref: http://www.w3.org/TR/REC-CSS2/cascade.html#cascading-order point 4.)
+    std::reverse(decls->begin(), decls->end());
+
+    if (cache.size() >= CACHE_SIZE) {
+        cache.clear();
+    }
+    boost::shared_ptr<SPStyleDeclarations const> result(decls);
+    cache[key] = result;
+    return result;
+}
+
 /**
  * Parses a style="..." string and merges it with an existing SPStyle.
  */
@@ -1486,11 +1682,9 @@ sp_style_merge_from_style_string(SPStyle *const style, gchar const *const p)
      * attribute value?
      */
 
-    CRDeclaration *const decl_list
-        = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(p), CR_UTF_8);
-    if (decl_list) {
-        sp_style_merge_from_decl_list(style, decl_list);
-        cr_declaration_destroy(decl_list);
+    boost::shared_ptr<SPStyleDeclarations const> const decls = sp_style_parse_declarations(p);
+    for (SPStyleDeclarations::const_iterator i = decls->begin(); i != decls->end(); ++i) {
+        sp_style_merge_property(style, i->first, i->second.c_str());
     }
 }
 
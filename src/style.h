@@ -431,6 +431,9 @@ void sp_style_read_from_prefs(SPStyle *style, Glib::ustring const &path);
 
 void sp_style_merge_from_style_string(SPStyle *style, gchar const *p);
 
+struct SPStyleSheetIndex;
+void sp_style_sheet_changed(SPDocument *document);
+
 void sp_style_merge_from_parent(SPStyle *style, SPStyle const *parent);
 
 void sp_style_merge_from_dying_parent(SPStyle *style, SPStyle const *parent);
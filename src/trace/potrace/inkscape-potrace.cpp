@@ -14,8 +14,16 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include "inkscape-potrace.h"
 
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include <glibmm/i18n.h>
 #include <gtkmm/main.h>
 #include <iomanip>
@@ -27,8 +35,9 @@
 #include <inkscape.h>
 #include <desktop-handles.h>
 #include "message-stack.h"
+#include "preferences.h"
 #include <sp-path.h>
-#include <svg/path-string.h>
+#include <2geom/svg-path.h>
 #include "curve.h"
 #include "bitmap.h"
 
@@ -63,6 +72,17 @@ ustring twohex( int value )
 {
     return ustring::format(std::hex, std::setfill(L'0'), std::setw(2), value);
 }
+
+#if HAVE_OPENMP
+/**
+ * Number of threads for tracing the passes of a multiple scan.
+ */
+int tracingThreads()
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+}
+#endif
 } // namespace
 
 
@@ -128,12 +148,12 @@ static bool hasPoint(std::vector<Point> &points, double x, double y)
 
 
 /**
- *  Recursively descend the path_t node tree, writing paths in SVG
- *  format into the output stream.  The Point vector is used to prevent
+ *  Recursively descend the path_t node tree, appending the paths
+ *  to the builder.  The Point vector is used to prevent
  *  redundant paths.  Returns number of paths processed.
  */
 static long writePaths(PotraceTracingEngine *engine, potrace_path_t *plist,
-           Inkscape::SVG::PathString& data, std::vector<Point> &points)
+           Geom::PathBuilder &builder, std::vector<Point> &points)
 {
     long nodeCount = 0L;
 
@@ -163,7 +183,7 @@ static long writePaths(PotraceTracingEngine *engine, potrace_path_t *plist,
             p.x = x2; p.y = y2;
             points.push_back(p);
             }
-        data.moveTo(x2, y2);
+        builder.moveTo(Geom::Point(x2, y2));
         nodeCount++;
 
         for (int i=0 ; i<curve->n ; i++)
@@ -180,21 +200,22 @@ static long writePaths(PotraceTracingEngine *engine, potrace_path_t *plist,
             switch (curve->tag[i])
                 {
                 case POTRACE_CORNER:
-                    data.lineTo(x1, y1).lineTo(x2, y2);
+                    builder.lineTo(Geom::Point(x1, y1));
+                    builder.lineTo(Geom::Point(x2, y2));
                 break;
                 case POTRACE_CURVETO:
-                    data.curveTo(x0, y0, x1, y1, x2, y2);
+                    builder.curveTo(Geom::Point(x0, y0), Geom::Point(x1, y1), Geom::Point(x2, y2));
                 break;
                 default:
                 break;
                 }
             nodeCount++;
             }
-        data.closePath();
+        builder.closePath();
 
         for (path_t *child=node->childlist; child ; child=child->sibling)
             {
-            nodeCount += writePaths(engine, child, data, points);
+            nodeCount += writePaths(engine, child, builder, points);
             }
         }
 
@@ -351,12 +372,12 @@ PotraceTracingEngine::preview(Glib::RefPtr<Gdk::Pixbuf> thePixbuf)
 
 
 //*This is the core inkscape-to-potrace binding
-std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCount)
+Geom::PathVector PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCount)
 {
     if (!keepGoing)
     {
         g_warning("aborted");
-        return "";
+        return Geom::PathVector();
     }
 
     potrace_bitmap_t *potraceBitmap = bm_new(grayMap->width, grayMap->height);
@@ -379,36 +400,90 @@ std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCoun
     fclose(f);
     */
 
-    /* trace a bitmap*/
-    potrace_state_t *potraceState = potrace_trace(potraceParams,
-                                                  potraceBitmap);
+    Geom::PathVector pathv = bitmapToPath(potraceBitmap, nodeCount);
 
     //## Free the Potrace bitmap
     bm_free(potraceBitmap);
 
+    return pathv;
+}
+
+
+Geom::PathVector PotraceTracingEngine::bitmapToPath(potrace_bitmap_t const *potraceBitmap, long *nodeCount)
+{
+    if (!keepGoing)
+    {
+        g_warning("aborted");
+        return Geom::PathVector();
+    }
+
+    potrace_param_t const *params = potraceParams;
+#if HAVE_OPENMP
+    // The progress callback updates the GUI, so only the thread which
+    // runs the GUI may report progress
+    potrace_param_t workerParams;
+    if (omp_get_thread_num() != 0) {
+        workerParams = *potraceParams;
+        workerParams.progress.callback = NULL;
+        params = &workerParams;
+    }
+#endif
+
+    /* trace a bitmap*/
+    potrace_state_t *potraceState = potrace_trace(params,
+                                                  potraceBitmap);
+
     if (!keepGoing)
         {
         g_warning("aborted");
         potrace_state_free(potraceState);
-        return "";
+        return Geom::PathVector();
         }
 
-    Inkscape::SVG::PathString data;
+    Geom::PathBuilder builder;
 
-    //## copy the path information into our d="" attribute string
+    //## copy the path information into our path vector
     std::vector<Point> points;
-    long thisNodeCount = writePaths(this, potraceState->plist, data, points);
+    long thisNodeCount = writePaths(this, potraceState->plist, builder, points);
+    builder.finish();
 
     /* free a potrace items */
     potrace_state_free(potraceState);
 
     if (!keepGoing)
-        return "";
+        return Geom::PathVector();
 
     if ( nodeCount)
         *nodeCount = thisNodeCount;
 
-    return data.string();
+    return builder.peek();
+}
+
+
+Geom::PathVector PotraceTracingEngine::brightnessToPath(GrayMap *gm, double floor, double cutoff, long *nodeCount)
+{
+    potrace_bitmap_t *potraceBitmap = bm_new(gm->width, gm->height);
+    if (!potraceBitmap)
+        return Geom::PathVector();
+    bm_clear(potraceBitmap, 0);
+
+    floor  = 3.0 * ( floor * 256.0 );
+    cutoff = 3.0 * ( cutoff * 256.0 );
+    for (int y=0 ; y<gm->height ; y++)
+        {
+        for (int x=0 ; x<gm->width ; x++)
+            {
+            double brightness = (double)gm->getPixel(gm, x, y);
+            bool black = (brightness >= floor && brightness < cutoff);
+            BM_UPUT(potraceBitmap, x, y, black != invert);
+            }
+        }
+
+    Geom::PathVector pathv = bitmapToPath(potraceBitmap, nodeCount);
+
+    bm_free(potraceBitmap);
+
+    return pathv;
 }
 
 
@@ -431,14 +506,13 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceSingle(GdkPixbuf * t
         return results;
 
     long nodeCount;
-    std::string d = grayMapToPath(grayMap, &nodeCount);
+    Geom::PathVector pathv = grayMapToPath(grayMap, &nodeCount);
 
     grayMap->destroy(grayMap);
 
     char const *style = "fill:#000000";
 
-    //g_message("### GOT '%s' \n", d);
-    TracingEngineResult result(style, d, nodeCount);
+    TracingEngineResult result(style, pathv, nodeCount);
     results.push_back(result);
 
     return results;
@@ -457,12 +531,11 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceGrayMap(GrayMap *gra
     brightnessFloor = 0.0; //important to set this
 
     long nodeCount;
-    std::string d = grayMapToPath(grayMap, &nodeCount);
+    Geom::PathVector pathv = grayMapToPath(grayMap, &nodeCount);
 
     char const *style = "fill:#000000";
 
-    //g_message("### GOT '%s' \n", d);
-    TracingEngineResult result(style, d, nodeCount);
+    TracingEngineResult result(style, pathv, nodeCount);
     results.push_back(result);
 
     return results;
@@ -470,6 +543,9 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceGrayMap(GrayMap *gra
 
 /**
  *  Called for multiple-scanning algorithms
+ *
+ *  The passes are traced in parallel, and the results are collected in
+ *  the order of the passes.
  */
 std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkPixbuf * thePixbuf)
 {
@@ -480,42 +556,68 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkP
         double high    = 0.9; //top of range
         double delta   = (high - low ) / ((double)multiScanNrColors);
 
-        brightnessFloor = 0.0; //Set bottom to black
+        std::vector<double> thresholds;
+        for (double threshold = low ; threshold <= high ; threshold += delta) {
+            thresholds.push_back(threshold);
+        }
+        int const nrPasses = thresholds.size();
 
-        int traceCount = 0;
+        // all passes threshold the same brightness values
+        GrayMap *gm = gdkPixbufToGrayMap(thePixbuf);
+        if ( !gm ) {
+            return results;
+        }
 
-        for ( brightnessThreshold = low ;
-              brightnessThreshold <= high ;
-              brightnessThreshold += delta) {
-            GrayMap *grayMap = filter(*this, thePixbuf);
-            if ( grayMap ) {
-                long nodeCount;
-                std::string d = grayMapToPath(grayMap, &nodeCount);
+        // Without stacking, a pass starts at the threshold of the last pass
+        // which traced something.  Assume here that all of them do; the
+        // passes for which this is wrong are traced again below.
+        std::vector<double> floors(nrPasses, 0.0);
+        if (!multiScanStack) {
+            for (int i = 1 ; i < nrPasses ; i++) {
+                floors[i] = thresholds[i - 1];
+            }
+        }
 
-                grayMap->destroy(grayMap);
+        std::vector<Geom::PathVector> paths(nrPasses);
+        std::vector<long> nodeCounts(nrPasses, 0);
+#if HAVE_OPENMP
+        int const nrThreads = tracingThreads();
+#pragma omp parallel for schedule(dynamic) num_threads(nrThreads)
+#endif
+        for (int i = 0 ; i < nrPasses ; i++) {
+            paths[i] = brightnessToPath(gm, floors[i], thresholds[i], &nodeCounts[i]);
+        }
 
-                if ( !d.empty() ) {
-                    //### get style info
-                    int grayVal = (int)(256.0 * brightnessThreshold);
-                    ustring style = ustring::compose("fill-opacity:1.0;fill:%1%2%3", twohex(grayVal), twohex(grayVal), twohex(grayVal) );
+        double floor = 0.0; //Set bottom to black
+        int traceCount = 0;
+        for (int i = 0 ; i < nrPasses ; i++) {
+            if ( floors[i] != floor ) {
+                paths[i] = brightnessToPath(gm, floor, thresholds[i], &nodeCounts[i]);
+            }
 
-                    //g_message("### GOT '%s' \n", style.c_str());
-                    TracingEngineResult result(style, d, nodeCount);
-                    results.push_back(result);
+            if ( !paths[i].empty() ) {
+                //### get style info
+                int grayVal = (int)(256.0 * thresholds[i]);
+                ustring style = ustring::compose("fill-opacity:1.0;fill:%1%2%3", twohex(grayVal), twohex(grayVal), twohex(grayVal) );
 
-                    if (!multiScanStack) {
-                        brightnessFloor = brightnessThreshold;
-                    }
+                //g_message("### GOT '%s' \n", style.c_str());
+                TracingEngineResult result(style, paths[i], nodeCounts[i]);
+                results.push_back(result);
 
-                    SPDesktop *desktop = SP_ACTIVE_DESKTOP;
-                    if (desktop) {
-                        ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), traceCount++, nodeCount);
-                        sp_desktop_message_stack(desktop)->flash(Inkscape::NORMAL_MESSAGE, msg);
-                    }
+                if (!multiScanStack) {
+                    floor = thresholds[i];
+                }
+
+                SPDesktop *desktop = SP_ACTIVE_DESKTOP;
+                if (desktop) {
+                    ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), traceCount++, nodeCounts[i]);
+                    sp_desktop_message_stack(desktop)->flash(Inkscape::NORMAL_MESSAGE, msg);
                 }
             }
         }
 
+        gm->destroy(gm);
+
         //# Remove the bottom-most scan, if requested
         if (results.size() > 1 && multiScanRemoveBackground) {
             results.erase(results.end() - 1);
@@ -528,6 +630,9 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkP
 
 /**
  *  Quantization
+ *
+ *  The bitmaps of all color indices are made in one scan of the indexed
+ *  map, then traced in parallel.
  */
 std::vector<TracingEngineResult> PotraceTracingEngine::traceQuant(GdkPixbuf * thePixbuf)
 {
@@ -536,49 +641,76 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceQuant(GdkPixbuf * th
     if (thePixbuf) {
         IndexedMap *iMap = filterIndexed(*this, thePixbuf);
         if ( iMap ) {
-            //Create and clear a gray map
-            GrayMap *gm = GrayMapCreate(iMap->width, iMap->height);
-            for (int row=0 ; row<gm->height ; row++) {
-                for (int col=0 ; col<gm->width ; col++) {
-                    gm->setPixel(gm, col, row, GRAYMAP_WHITE);
+            int const nrColors = iMap->nrColors;
+
+            // Make a bitmap for each color index
+            std::vector<potrace_bitmap_t *> bitmaps(nrColors, (potrace_bitmap_t *) NULL);
+            bool ok = true;
+            for (int colorIndex=0 ; colorIndex<nrColors && ok ; colorIndex++) {
+                bitmaps[colorIndex] = bm_new(iMap->width, iMap->height);
+                if (bitmaps[colorIndex]) {
+                    bm_clear(bitmaps[colorIndex], 0);
+                } else {
+                    ok = false;
                 }
             }
 
-            for (int colorIndex=0 ; colorIndex<iMap->nrColors ; colorIndex++) {
-                // Make a gray map for each color index
+            if (ok) {
                 for (int row=0 ; row<iMap->height ; row++) {
                     for (int col=0 ; col<iMap->width ; col++) {
                         int indx = (int) iMap->getPixel(iMap, col, row);
-                        if (indx == colorIndex) {
-                            gm->setPixel(gm, col, row, GRAYMAP_BLACK); //black
-                        } else if (!multiScanStack) {
-                            gm->setPixel(gm, col, row, GRAYMAP_WHITE); //white
+                        if (indx >= 0 && indx < nrColors) {
+                            BM_USET(bitmaps[indx], col, row); //black
                         }
                     }
                 }
 
-                //## Now we have a traceable graymap
-                long nodeCount;
-                std::string d = grayMapToPath(gm, &nodeCount);
+                if (multiScanStack) {
+                    // each scan also covers the colors before it
+                    for (int colorIndex=1 ; colorIndex<nrColors ; colorIndex++) {
+                        potrace_word *dest = bitmaps[colorIndex]->map;
+                        potrace_word const *src = bitmaps[colorIndex - 1]->map;
+                        long const words = (long) bitmaps[colorIndex]->dy * bitmaps[colorIndex]->h;
+                        for (long i = 0 ; i < words ; i++) {
+                            dest[i] |= src[i];
+                        }
+                    }
+                }
 
-                if ( !d.empty() ) {
-                    //### get style info
-                    RGB rgb = iMap->clut[colorIndex];
-                    ustring style = ustring::compose("fill:#%1%2%3", twohex(rgb.r), twohex(rgb.g), twohex(rgb.b) );
+                std::vector<Geom::PathVector> paths(nrColors);
+                std::vector<long> nodeCounts(nrColors, 0);
+#if HAVE_OPENMP
+                int const nrThreads = tracingThreads();
+#pragma omp parallel for schedule(dynamic) num_threads(nrThreads)
+#endif
+                for (int colorIndex=0 ; colorIndex<nrColors ; colorIndex++) {
+                    paths[colorIndex] = bitmapToPath(bitmaps[colorIndex], &nodeCounts[colorIndex]);
+                }
+
+                for (int colorIndex=0 ; colorIndex<nrColors ; colorIndex++) {
+                    if ( !paths[colorIndex].empty() ) {
+                        //### get style info
+                        RGB rgb = iMap->clut[colorIndex];
+                        ustring style = ustring::compose("fill:#%1%2%3", twohex(rgb.r), twohex(rgb.g), twohex(rgb.b) );
 
-                    //g_message("### GOT '%s' \n", style.c_str());
-                    TracingEngineResult result(style, d, nodeCount);
-                    results.push_back(result);
+                        //g_message("### GOT '%s' \n", style.c_str());
+                        TracingEngineResult result(style, paths[colorIndex], nodeCounts[colorIndex]);
+                        results.push_back(result);
 
-                    SPDesktop *desktop = SP_ACTIVE_DESKTOP;
-                    if (desktop) {
-                        ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), colorIndex, nodeCount);
-                        sp_desktop_message_stack(desktop)->flash(Inkscape::NORMAL_MESSAGE, msg);
+                        SPDesktop *desktop = SP_ACTIVE_DESKTOP;
+                        if (desktop) {
+                            ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), colorIndex, nodeCounts[colorIndex]);
+                            sp_desktop_message_stack(desktop)->flash(Inkscape::NORMAL_MESSAGE, msg);
+                        }
                     }
-                }
-            }// for colorIndex
+                }// for colorIndex
+            }
 
-            gm->destroy(gm);
+            for (int colorIndex=0 ; colorIndex<nrColors ; colorIndex++) {
+                if (bitmaps[colorIndex]) {
+                    bm_free(bitmaps[colorIndex]);
+                }
+            }
             iMap->destroy(iMap);
         }
 
@@ -595,8 +727,7 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceQuant(GdkPixbuf * th
 /**
  *  This is the working method of this interface, and all
  *  implementing classes.  Take a GdkPixbuf, trace it, and
- *  return the path data that is compatible with the d="" attribute
- *  of an SVG <path> element.
+ *  return the paths for each SVG <path> element to create.
  */
 std::vector<TracingEngineResult>
 PotraceTracingEngine::trace(Glib::RefPtr<Gdk::Pixbuf> pixbuf)
@@ -216,8 +216,7 @@ class PotraceTracingEngine : public TracingEngine
     /**
      *  This is the working method of this implementing class, and all
      *  implementing classes.  Take a GdkPixbuf, trace it, and
-     *  return the path data that is compatible with the d="" attribute
-     *  of an SVG <path> element.
+     *  return the paths for each SVG <path> element to create.
      */
     virtual std::vector<TracingEngineResult> trace(
                         Glib::RefPtr<Gdk::Pixbuf> pixbuf);
@@ -267,7 +266,19 @@ class PotraceTracingEngine : public TracingEngine
      * This is the actual wrapper of the call to Potrace.  nodeCount
      * returns the count of nodes created.  May be NULL if ignored.
      */
-    std::string grayMapToPath(GrayMap *gm, long *nodeCount);
+    Geom::PathVector grayMapToPath(GrayMap *gm, long *nodeCount);
+
+    /**
+     * Traces a Potrace bitmap, where set bits are black.  Several passes
+     * may call this at the same time.
+     */
+    Geom::PathVector bitmapToPath(potrace_bitmap_t const *bitmap, long *nodeCount);
+
+    /**
+     * Traces the pixels of gm with a brightness in [floor, cutoff), like
+     * filter() followed by grayMapToPath() for a brightness scan.
+     */
+    Geom::PathVector brightnessToPath(GrayMap *gm, double floor, double cutoff, long *nodeCount);
 
     std::vector<TracingEngineResult>traceBrightnessMulti(GdkPixbuf *pixbuf);
     std::vector<TracingEngineResult>traceQuant(GdkPixbuf *pixbuf);
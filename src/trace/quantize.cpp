@@ -9,10 +9,12 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <stdlib.h>
 #include <new>
+#include <vector>
 
 #include "pool.h"
 #include "imagemap.h"
@@ -517,20 +519,93 @@ static int distRGB(RGB rgb1, RGB rgb2)
 }
 
 /**
- * find the index of closest color in a palette
+ * find the index of closest color in a palette; on ties, the first one
+ *
+ * Colors are sorted into cells of 8x8x8 colors.  The first time a cell is
+ * used, the palette colors which may be closest to some color of the cell
+ * are listed.  Some palette color lies within distance D of every color of
+ * the cell, where D is the smallest, over the palette, of the distance to
+ * the farthest corner of the cell; colors farther than D from the whole cell
+ * are never closest.  Few colors remain, so finding the closest color of a
+ * pixel takes nearly constant time instead of a scan of the palette.
  */
-static int findRGB(RGB *rgbpal, int ncolor, RGB rgb)
+class RGBLookup
 {
-    //assert(ncolor > 0);
-    //assert(rgbpal);
-    int index = -1, dist = 0;
-    for (int k = 0; k < ncolor; k++)
-        {
-        int d = distRGB(rgbpal[k], rgb);
-        if (index == -1 || d < dist) { dist = d; index = k; }
+public:
+    RGBLookup(RGB const *rgbpal, int ncolor)
+        : rgbpal(rgbpal),
+          ncolor(ncolor),
+          cells(CELLS * CELLS * CELLS)
+    {
+    }
+
+    int find(RGB rgb)
+    {
+        Cell &cell = cells[((rgb.r >> CELL_SHIFT) * CELLS + (rgb.g >> CELL_SHIFT)) * CELLS + (rgb.b >> CELL_SHIFT)];
+        if (cell.first < 0) {
+            fill(cell, rgb);
         }
-    return index;
-}
+        // candidates are in palette order, so ties go to the first color
+        int index = -1, dist = 0;
+        for (int i = cell.first; i < cell.first + cell.count; i++) {
+            int d = distRGB(rgbpal[candidates[i]], rgb);
+            if (index == -1 || d < dist) { dist = d; index = candidates[i]; }
+        }
+        return index;
+    }
+
+private:
+    static int const CELL_SHIFT = 3;
+    static int const CELLS = 256 >> CELL_SHIFT;
+
+    struct Cell {
+        Cell() : first(-1), count(0) {}
+        int first; // in candidates
+        int count;
+    };
+
+    /** squared distance from a value to the nearest and farthest values of [lo, hi] */
+    static void span(int v, int lo, int hi, int &dmin, int &dmax)
+    {
+        int inner = v < lo ? lo - v : (v > hi ? v - hi : 0);
+        int outer = std::max(std::abs(v - lo), std::abs(v - hi));
+        dmin += inner * inner;
+        dmax += outer * outer;
+    }
+
+    void fill(Cell &cell, RGB rgb)
+    {
+        int const r0 = rgb.r & ~((1 << CELL_SHIFT) - 1);
+        int const g0 = rgb.g & ~((1 << CELL_SHIFT) - 1);
+        int const b0 = rgb.b & ~((1 << CELL_SHIFT) - 1);
+        int const d = (1 << CELL_SHIFT) - 1;
+
+        std::vector<int> dmin(ncolor, 0);
+        int bound = -1; // every color of the cell has a palette color within this distance
+        for (int k = 0; k < ncolor; k++) {
+            int dmax = 0;
+            span(rgbpal[k].r, r0, r0 + d, dmin[k], dmax);
+            span(rgbpal[k].g, g0, g0 + d, dmin[k], dmax);
+            span(rgbpal[k].b, b0, b0 + d, dmin[k], dmax);
+            if (bound < 0 || dmax < bound) {
+                bound = dmax;
+            }
+        }
+
+        cell.first = candidates.size();
+        for (int k = 0; k < ncolor; k++) {
+            if (dmin[k] <= bound) {
+                candidates.push_back(k);
+            }
+        }
+        cell.count = candidates.size() - cell.first;
+    }
+
+    RGB const *rgbpal;
+    int ncolor;
+    std::vector<Cell> cells;
+    std::vector<int> candidates;
+};
 
 /**
  * (qsort) compare two colors for brightness
@@ -581,10 +656,11 @@ IndexedMap *rgbMapQuantize(RgbMap *rgbmap, int ncolor)
             newmap->nrColors = indexes;
 
             // fill in new map pixels
+            RGBLookup lookup(rgbpal, indexes);
             for (int y = 0; y < rgbmap->height; y++) {
                 for (int x = 0; x < rgbmap->width; x++) {
                     RGB rgb = rgbmap->getPixel(rgbmap, x, y);
-                    int index = findRGB(rgbpal, ncolor, rgb);
+                    int index = lookup.find(rgb);
                     newmap->setPixel(newmap, x, y, index);
                 }
             }
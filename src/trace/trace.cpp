@@ -28,6 +28,7 @@
 #include "sp-item.h"
 #include "sp-shape.h"
 #include "sp-image.h"
+#include "svg/svg.h"
 #include <2geom/transforms.h>
 #include "verbs.h"
 
@@ -40,6 +41,14 @@
 namespace Inkscape {
 namespace Trace {
 
+std::string TracingEngineResult::getPathData() const
+{
+    gchar *str = sp_svg_write_path(pathVector);
+    std::string d = str;
+    g_free(str);
+    return d;
+}
+
 SPImage *Tracer::getSelectedSPImage()
 {
 
@@ -490,7 +499,7 @@ void Tracer::traceThread()
 
     for (unsigned int i=0 ; i<results.size() ; i++)
         {
-        TracingEngineResult result = results[i];
+        TracingEngineResult const &result = results[i];
         totalNodeCount += result.getNodeCount();
 
         Inkscape::XML::Node *pathRepr = xml_doc->createElement("svg:path");
@@ -24,6 +24,7 @@
 #include <glibmm/refptr.h>
 #include <gdkmm/pixbuf.h>
 #include <vector>
+#include <2geom/pathvector.h>
 #include <sp-shape.h>
 
 struct SPImage;
@@ -47,12 +48,12 @@ public:
      *
      */
     TracingEngineResult(const std::string &theStyle,
-                        const std::string &thePathData,
+                        const Geom::PathVector &thePathVector,
                         long theNodeCount)
         {
-        style     = theStyle;
-        pathData  = thePathData;
-        nodeCount = theNodeCount;
+        style      = theStyle;
+        pathVector = thePathVector;
+        nodeCount  = theNodeCount;
         }
 
     TracingEngineResult(const TracingEngineResult &other)
@@ -72,19 +73,25 @@ public:
     /**
      *
      */
-    std::string getStyle()
+    std::string getStyle() const
         { return style; }
 
     /**
-     *
+     *  The traced geometry, in pixel coordinates of the traced image
+     */
+    const Geom::PathVector &getPathVector() const
+        { return pathVector; }
+
+    /**
+     *  The traced geometry serialized for the d="" attribute of an
+     *  SVG <path> element
      */
-    std::string getPathData()
-        { return pathData; }
+    std::string getPathData() const;
 
     /**
      *
      */
-    long getNodeCount()
+    long getNodeCount() const
         { return nodeCount; }
 
 private:
@@ -92,13 +99,13 @@ private:
     void assign(const TracingEngineResult &other)
         {
         style = other.style;
-        pathData = other.pathData;
+        pathVector = other.pathVector;
         nodeCount = other.nodeCount;
         }
 
     std::string style;
 
-    std::string pathData;
+    Geom::PathVector pathVector;
 
     long nodeCount;
 
@@ -130,9 +137,8 @@ class TracingEngine
     /**
      *  This is the working method of this interface, and all
      *  implementing classes.  Take a GdkPixbuf, trace it, and
-     *  return a style attribute and the path data that is
-     *  compatible with the d="" attribute
-     *  of an SVG <path> element.
+     *  return a style attribute and the traced paths for each
+     *  SVG <path> element to create.
      */
     virtual  std::vector<TracingEngineResult> trace(
                            Glib::RefPtr<Gdk::Pixbuf> /*pixbuf*/)
@@ -25,6 +25,7 @@ class Event;
  * 	<li>A change is committed to the undo stack.</li>
  * 	<li>An undo action is made.</li>
  * 	<li>A redo action is made.</li>
+ * 	<li>The oldest change is dropped from the undo stack.</li>
  * </ul>
  *
  * UndoStackObservers should not be used on their own.  Instead, they should be registered
@@ -66,6 +67,14 @@ public:
 	 */
 	virtual void notifyClearRedoEvent() = 0;
 
+	/**
+	 * Triggered when the oldest event of the undo log is dropped to keep the
+	 * undo history within its memory budget.
+	 *
+	 * \param log Pointer to the dropped Event; it is deleted after the notification.
+	 */
+	virtual void notifyUndoExpiredEvent(Event* log) = 0;
+
 };
 
 }
@@ -0,0 +1,101 @@
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+#include "util/rtree.h"
+
+class RTreeTest : public CxxTest::TestSuite {
+public:
+    RTreeTest()
+    {
+        srand(7);
+        for (int i = 0; i < 2000; ++i) {
+            Geom::Point p(rand() % 10000, rand() % 10000);
+            Geom::Point d(rand() % 200, rand() % 200);
+            boxes.push_back(Geom::Rect(p, p + d));
+            tree.insert(boxes.back(), i);
+        }
+    }
+    virtual ~RTreeTest() {}
+
+// createSuite and destroySuite get us per-suite setup and teardown
+// without us having to worry about static initialization order, etc.
+    static RTreeTest *createSuite() { return new RTreeTest(); }
+    static void destroySuite( RTreeTest *suite ) { delete suite; }
+
+    void testEmpty()
+    {
+        Inkscape::Util::RTree<int> empty;
+        std::vector<int> found;
+        empty.query(Geom::Rect(0, 0, 100, 100), std::back_inserter(found));
+        TS_ASSERT(found.empty());
+    }
+
+    void testAreaQuery()
+    {
+        for (int i = 0; i < 50; ++i) {
+            Geom::Point p(rand() % 10000, rand() % 10000);
+            Geom::Point d(rand() % 1000, rand() % 1000);
+            checkQuery(Geom::Rect(p, p + d));
+        }
+        // everything
+        checkQuery(Geom::Rect(-1, -1, 20000, 20000));
+    }
+
+    void testPointQuery()
+    {
+        for (int i = 0; i < 50; ++i) {
+            Geom::Point p(rand() % 10000, rand() % 10000);
+            checkQuery(Geom::Rect(p, p));
+        }
+        // corners of an indexed box count as inside
+        checkQuery(Geom::Rect(boxes[10].corner(2), boxes[10].corner(2)));
+    }
+
+    void testInsertAfterQuery()
+    {
+        Inkscape::Util::RTree<int> t;
+        std::vector<int> found;
+        t.insert(Geom::Rect(0, 0, 10, 10), 1);
+        t.query(Geom::Point(5, 5), std::back_inserter(found));
+        TS_ASSERT_EQUALS(found.size(), 1u);
+
+        t.insert(Geom::Rect(4, 4, 6, 6), 2);
+        found.clear();
+        t.query(Geom::Point(5, 5), std::back_inserter(found));
+        TS_ASSERT_EQUALS(found.size(), 2u);
+
+        t.clear();
+        found.clear();
+        t.query(Geom::Point(5, 5), std::back_inserter(found));
+        TS_ASSERT(found.empty());
+    }
+
+private:
+    void checkQuery(Geom::Rect const &area)
+    {
+        std::vector<int> expected, found;
+        for (unsigned i = 0; i < boxes.size(); ++i) {
+            if (boxes[i].intersects(area)) expected.push_back(i);
+        }
+        tree.query(area, std::back_inserter(found));
+        std::sort(found.begin(), found.end());
+        TS_ASSERT_EQUALS(found, expected);
+    }
+
+    std::vector<Geom::Rect> boxes;
+    Inkscape::Util::RTree<int> tree;
+};
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
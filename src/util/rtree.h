@@ -0,0 +1,168 @@
+/**
+ * @file
+ * Bounding box tree for spatial queries.
+ *//*
+ * Copyright (C) 2012 Authors
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef SEEN_INKSCAPE_UTIL_RTREE_H
+#define SEEN_INKSCAPE_UTIL_RTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+namespace Util {
+
+/**
+ * Packed R-tree of values with rectangular bounds.
+ *
+ * Values are collected with insert() and the tree is bulk-loaded with the
+ * Sort-Tile-Recursive method the next time it is queried, so building an index
+ * of n values costs O(n log n) and a query which finds k values costs
+ * roughly O(log n + k). Modifications after a query make the next query
+ * rebuild the tree; this suits indexes which change rarely compared to how
+ * often they are searched. Queries report values in no particular order.
+ */
+template <typename T>
+class RTree {
+public:
+    RTree() : _built(true) {}
+
+    void clear() {
+        _entries.clear();
+        _levels.clear();
+        _built = true;
+    }
+    void insert(Geom::Rect const &box, T const &value) {
+        Entry e;
+        e.box = box;
+        e.value = value;
+        _entries.push_back(e);
+        _built = false;
+    }
+    void reserve(size_t n) { _entries.reserve(n); }
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+
+    /// Write the values whose bounding boxes intersect @a area to @a out.
+    template <typename OutputIterator>
+    OutputIterator query(Geom::Rect const &area, OutputIterator out) const {
+        if (_entries.empty()) return out;
+        if (!_built) _build();
+
+        // depth-first search; stack holds (level, node) pairs
+        std::vector<std::pair<size_t, size_t> > stack;
+        stack.push_back(std::make_pair(_levels.size() - 1, size_t(0)));
+        while (!stack.empty()) {
+            size_t level = stack.back().first;
+            Node const &node = _levels[level][stack.back().second];
+            stack.pop_back();
+            if (!node.box.intersects(area)) continue;
+            if (level == 0) {
+                for (size_t i = node.first; i < node.last; ++i) {
+                    if (_entries[i].box.intersects(area)) {
+                        *out++ = _entries[i].value;
+                    }
+                }
+            } else {
+                for (size_t i = node.first; i < node.last; ++i) {
+                    stack.push_back(std::make_pair(level - 1, i));
+                }
+            }
+        }
+        return out;
+    }
+
+    /// Write the values whose bounding boxes contain @a p to @a out.
+    template <typename OutputIterator>
+    OutputIterator query(Geom::Point const &p, OutputIterator out) const {
+        return query(Geom::Rect(p, p), out);
+    }
+
+private:
+    static unsigned const NODE_SIZE = 16;
+
+    struct Entry {
+        Geom::Rect box;
+        T value;
+    };
+    /// Internal node; covers the items [first, last) of the level below
+    struct Node {
+        Geom::Rect box;
+        size_t first;
+        size_t last;
+    };
+
+    template <typename Item>
+    struct CompareCenter {
+        CompareCenter(Geom::Dim2 d) : dim(d) {}
+        bool operator()(Item const &a, Item const &b) const {
+            return a.box[dim].middle() < b.box[dim].middle();
+        }
+        Geom::Dim2 dim;
+    };
+
+    /// Order the items in tiles of NODE_SIZE neighbours and write one node per tile.
+    template <typename Item>
+    static void _pack(std::vector<Item> &items, std::vector<Node> &nodes) {
+        size_t const n = items.size();
+        size_t const tiles = (n + NODE_SIZE - 1) / NODE_SIZE;
+        size_t const slices = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::sqrt(double(tiles)))));
+        size_t const slice_size = slices * NODE_SIZE;
+
+        std::sort(items.begin(), items.end(), CompareCenter<Item>(Geom::X));
+        for (size_t s = 0; s < n; s += slice_size) {
+            typename std::vector<Item>::iterator end = items.begin() + std::min(n, s + slice_size);
+            std::sort(items.begin() + s, end, CompareCenter<Item>(Geom::Y));
+        }
+
+        nodes.clear();
+        nodes.reserve(tiles);
+        for (size_t i = 0; i < n; i += NODE_SIZE) {
+            Node node;
+            node.first = i;
+            node.last = std::min(n, i + NODE_SIZE);
+            node.box = items[i].box;
+            for (size_t j = i + 1; j < node.last; ++j) {
+                node.box.unionWith(items[j].box);
+            }
+            nodes.push_back(node);
+        }
+    }
+
+    void _build() const {
+        _levels.clear();
+        _levels.push_back(std::vector<Node>());
+        _pack(_entries, _levels.back());
+        while (_levels.back().size() > 1) {
+            std::vector<Node> upper;
+            _pack(_levels.back(), upper);
+            _levels.push_back(upper);
+        }
+        _built = true;
+    }
+
+    mutable std::vector<Entry> _entries;
+    mutable std::vector<std::vector<Node> > _levels;
+    mutable bool _built;
+};
+
+} // namespace Util
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_UTIL_RTREE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -1,6 +1,9 @@
 #ifndef SEEN_INKSCAPE_XML_SP_REPR_ACTION_FNS_H
 #define SEEN_INKSCAPE_XML_SP_REPR_ACTION_FNS_H
 
+#include <cstddef>
+#include <string>
+
 namespace Inkscape {
 namespace XML {
 
@@ -23,6 +26,9 @@ void sp_repr_undo_log (Inkscape::XML::Event *log);
 void sp_repr_replay_log (Inkscape::XML::Event *log);
 Inkscape::XML::Event *sp_repr_coalesce_log (Inkscape::XML::Event *a, Inkscape::XML::Event *b);
 void sp_repr_free_log (Inkscape::XML::Event *log);
+std::size_t sp_repr_log_size (Inkscape::XML::Event const *log, Inkscape::XML::Event const *end=NULL);
+bool sp_repr_pack_log (Inkscape::XML::Event *log, std::string &packed);
+bool sp_repr_unpack_log (Inkscape::XML::Event *log, std::string const &packed);
 void sp_repr_debug_print_log(Inkscape::XML::Event const *log);
 
 #endif
@@ -14,7 +14,11 @@
  */
 
 #include <glib.h> // g_assert()
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
 
 #include "event.h"
 #include "event-fns.h"
@@ -275,6 +279,224 @@ sp_repr_free_log (Inkscape::XML::Event *log)
     }
 }
 
+/**
+ * Approximate memory used by a log, in bytes: the events and the attribute
+ * and content values they refer to. Values shared with other logs are counted
+ * in full; nodes kept alive by the log are not counted.
+ * @param end Event at which to stop counting, or NULL to count the whole log.
+ */
+std::size_t
+sp_repr_log_size (Inkscape::XML::Event const *log, Inkscape::XML::Event const *end)
+{
+    std::size_t size = 0;
+    for ( Inkscape::XML::Event const *action = log ; action && action != end ; action = action->next ) {
+        size += sizeof(Inkscape::XML::EventChgAttr);
+        Inkscape::Util::ptr_shared<char> oldval, newval;
+        if (Inkscape::XML::EventChgAttr const *chg_attr = dynamic_cast<Inkscape::XML::EventChgAttr const *>(action)) {
+            oldval = chg_attr->oldval;
+            newval = chg_attr->newval;
+        } else if (Inkscape::XML::EventChgContent const *chg_content = dynamic_cast<Inkscape::XML::EventChgContent const *>(action)) {
+            oldval = chg_content->oldval;
+            newval = chg_content->newval;
+        }
+        if (oldval) size += std::strlen(oldval) + 1;
+        if (newval) size += std::strlen(newval) + 1;
+    }
+    return size;
+}
+
+namespace {
+
+typedef Inkscape::Util::ptr_shared<char> SharedString;
+
+/// Calls @a f with the old and new value of each attribute or content change in @a log.
+template <typename F>
+void for_each_value_pair(Inkscape::XML::Event *log, F &f)
+{
+    for ( Inkscape::XML::Event *action = log ; action ; action = action->next ) {
+        if (Inkscape::XML::EventChgAttr *chg_attr = dynamic_cast<Inkscape::XML::EventChgAttr *>(action)) {
+            f(chg_attr->oldval, chg_attr->newval);
+        } else if (Inkscape::XML::EventChgContent *chg_content = dynamic_cast<Inkscape::XML::EventChgContent *>(action)) {
+            f(chg_content->oldval, chg_content->newval);
+        }
+    }
+}
+
+void put_size(std::string &buf, std::size_t n)
+{
+    while (n >= 0x80) {
+        buf += static_cast<char>((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    buf += static_cast<char>(n);
+}
+
+bool get_size(std::string const &buf, std::size_t &pos, std::size_t &n)
+{
+    n = 0;
+    for (unsigned shift = 0; pos < buf.size() && shift < 8 * sizeof(std::size_t); shift += 7) {
+        unsigned char c = buf[pos++];
+        n |= static_cast<std::size_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+ * Writes the values of a change. The new value
+ * is written in full; the old one only where it differs from the new one,
+ * since successive values of an attribute tend to differ in a small part.
+ */
+struct ValuePacker {
+    std::string buf;
+
+    void operator()(SharedString &oldval, SharedString &newval) {
+        buf += static_cast<char>((oldval ? 1 : 0) | (newval ? 2 : 0));
+        char const *nv = newval ? newval.pointer() : "";
+        std::size_t const new_len = std::strlen(nv);
+        if (newval) {
+            put_size(buf, new_len);
+            buf.append(nv, new_len);
+        }
+        if (oldval) {
+            char const *ov = oldval.pointer();
+            std::size_t const old_len = std::strlen(ov);
+            std::size_t const common = std::min(old_len, new_len);
+            std::size_t prefix = 0;
+            while (prefix < common && ov[prefix] == nv[prefix]) {
+                ++prefix;
+            }
+            std::size_t suffix = 0;
+            while (suffix < common - prefix && ov[old_len - 1 - suffix] == nv[new_len - 1 - suffix]) {
+                ++suffix;
+            }
+            put_size(buf, prefix);
+            put_size(buf, suffix);
+            put_size(buf, old_len - prefix - suffix);
+            buf.append(ov + prefix, old_len - prefix - suffix);
+        }
+    }
+};
+
+struct ValueDropper {
+    void operator()(SharedString &oldval, SharedString &newval) {
+        oldval = SharedString();
+        newval = SharedString();
+    }
+};
+
+/// Reads the values written by ValuePacker back into the events.
+struct ValueUnpacker {
+    ValueUnpacker(std::string const &b) : buf(b), pos(0), ok(true) {}
+
+    std::string const &buf;
+    std::size_t pos;
+    bool ok;
+
+    void operator()(SharedString &oldval, SharedString &newval) {
+        if (!ok || pos >= buf.size()) {
+            ok = false;
+            return;
+        }
+        unsigned char const flags = buf[pos++];
+        std::size_t new_start = pos;
+        std::size_t new_len = 0;
+        if (flags & 2) {
+            ok = get_size(buf, pos, new_len) && new_len <= buf.size() - pos;
+            if (!ok) return;
+            new_start = pos;
+            newval = Inkscape::Util::share_string(buf.data() + pos, new_len);
+            pos += new_len;
+        }
+        if (flags & 1) {
+            std::size_t prefix, suffix, middle;
+            ok = get_size(buf, pos, prefix) && get_size(buf, pos, suffix) && get_size(buf, pos, middle)
+                && prefix + suffix <= new_len && middle <= buf.size() - pos;
+            if (!ok) return;
+            std::string old;
+            old.reserve(prefix + middle + suffix);
+            old.append(buf, new_start, prefix);
+            old.append(buf, pos, middle);
+            old.append(buf, new_start + new_len - suffix, suffix);
+            oldval = Inkscape::Util::share_string(old.data(), old.size());
+            pos += middle;
+        }
+    }
+};
+
+}
+
+/**
+ * Moves the attribute and content values of the changes in a log into a
+ * compressed buffer, so that the memory of values no longer used elsewhere
+ * can be reclaimed. The log must not be undone or replayed before
+ * sp_repr_unpack_log() has restored the values.
+ * @return False if packing would not save memory; the log is unchanged then.
+ */
+bool
+sp_repr_pack_log (Inkscape::XML::Event *log, std::string &packed)
+{
+    ValuePacker packer;
+    for_each_value_pair(log, packer);
+    if (packer.buf.empty()) {
+        return false;
+    }
+
+    uLongf zsize = compressBound(packer.buf.size());
+    std::vector<Bytef> zbuf(zsize);
+    if (compress2(&zbuf[0], &zsize, reinterpret_cast<Bytef const *>(packer.buf.data()),
+                  packer.buf.size(), Z_BEST_SPEED) != Z_OK)
+    {
+        return false;
+    }
+
+    std::string result;
+    put_size(result, packer.buf.size());
+    result.append(reinterpret_cast<char const *>(&zbuf[0]), zsize);
+    if (result.size() >= packer.buf.size()) {
+        return false;
+    }
+
+    ValueDropper dropper;
+    for_each_value_pair(log, dropper);
+    packed.swap(result);
+    return true;
+}
+
+/**
+ * Restores the values moved out of a log by sp_repr_pack_log().
+ * @return False if @a packed does not match the log; values may be missing then.
+ */
+bool
+sp_repr_unpack_log (Inkscape::XML::Event *log, std::string const &packed)
+{
+    std::size_t pos = 0;
+    std::size_t raw_size = 0;
+    if (!get_size(packed, pos, raw_size)) {
+        g_warning("Undo history step is damaged");
+        return false;
+    }
+
+    std::string raw(raw_size, '\0');
+    uLongf size = raw_size;
+    if (raw_size && uncompress(reinterpret_cast<Bytef *>(&raw[0]), &size,
+                               reinterpret_cast<Bytef const *>(packed.data() + pos),
+                               packed.size() - pos) != Z_OK)
+    {
+        g_warning("Undo history step is damaged");
+        return false;
+    }
+    raw.resize(size);
+
+    ValueUnpacker unpacker(raw);
+    for_each_value_pair(log, unpacker);
+    if (!unpacker.ok || unpacker.pos != raw.size()) {
+        g_warning("Undo history step is damaged");
+        return false;
+    }
+    return true;
+}
+
 namespace {
 
 template <typename T> struct ActionRelations;
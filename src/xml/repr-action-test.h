@@ -1,6 +1,8 @@
 #include <cxxtest/TestSuite.h>
 
 #include <cstdlib>
+#include <cstring>
+#include <string>
 #include <glib.h>
 
 #include "repr.h"
@@ -87,6 +89,39 @@ public:
         sp_repr_unparent(c);
     }
 
+    void testPackedLogUndoAndReplay()
+    {
+        root->appendChild(a);
+        a->setAttribute("d", "M 0,0 L 10,10 L 20,20 z");
+
+        sp_repr_begin_transaction(document);
+        a->setAttribute("d", "M 0,0 L 10,11 L 20,20 z");
+        a->setAttribute("id", "path1");
+        a->setAttribute("d", "M 0,0 L 10,12 L 20,20 z");
+        Inkscape::XML::Event *log = sp_repr_commit_undoable(document);
+        TS_ASSERT(sp_repr_log_size(log) > 0);
+
+        std::string packed;
+        TS_ASSERT(sp_repr_pack_log(log, packed));
+        TS_ASSERT(!packed.empty());
+        TS_ASSERT(sp_repr_unpack_log(log, packed));
+
+        sp_repr_begin_transaction(document);
+        sp_repr_undo_log(log);
+        TS_ASSERT_EQUALS(std::strcmp(a->attribute("d"), "M 0,0 L 10,10 L 20,20 z"), 0);
+        TS_ASSERT_EQUALS(a->attribute("id"), static_cast<gchar const *>(0));
+
+        sp_repr_replay_log(log);
+        TS_ASSERT_EQUALS(std::strcmp(a->attribute("d"), "M 0,0 L 10,12 L 20,20 z"), 0);
+        TS_ASSERT_EQUALS(std::strcmp(a->attribute("id"), "path1"), 0);
+        sp_repr_rollback(document);
+
+        sp_repr_free_log(log);
+        a->setAttribute("d", NULL);
+        a->setAttribute("id", NULL);
+        sp_repr_unparent(a);
+    }
+
     /* lots more tests needed ... */
 };
 
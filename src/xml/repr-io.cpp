@@ -138,17 +138,7 @@ int XmlSource::setFile(char const *filename)
                 gzin = new Inkscape::IO::GzipInputStream(*instr);
 
                 memset( firstFew, 0, sizeof(firstFew) );
-                some = 0;
-                int single = 0;
-                while ( some < 4 && single >= 0 )
-                {
-                    single = gzin->get();
-                    if ( single >= 0 ) {
-                        firstFew[some++] = 0x0ff & single;
-                    } else {
-                        break;
-                    }
-                }
+                some = gzin->read( firstFew, 4 );
             }
 
             int encSkip = 0;
@@ -210,16 +200,8 @@ int XmlSource::read( char *buffer, int len )
         firstFewLen -= some;
         got = some;
     } else if ( gzin ) {
-        int single = 0;
-        while ( (static_cast<int>(got) < len) && (single >= 0) )
-        {
-            single = gzin->get();
-            if ( single >= 0 ) {
-                buffer[got++] = 0x0ff & single;
-            } else {
-                break;
-            }
-        }
+        // inflated in blocks, straight into libxml2's buffer
+        got = gzin->read( reinterpret_cast<unsigned char *>(buffer), len );
     } else {
         got = fread( buffer, 1, len, fp );
     }
@@ -692,18 +674,42 @@ bool sp_repr_save_file(Document *doc, gchar const *const filename, gchar const *
 }
 
 
+/// Write the bytes of str; unlike Writer::writeString(), this keeps non-ASCII text intact.
+static inline void repr_write (Writer &out, const gchar * str)
+{
+    out.write( str, strlen(str) );
+}
+
+static void repr_write_indent (Writer &out, gint indent_level, int indent)
+{
+    static gchar const spaces[] = "                                ";
+    gint count = indent_level * indent;
+    while (count > 0) {
+        gint some = MIN(count, (gint) sizeof(spaces) - 1);
+        out.write( spaces, some );
+        count -= some;
+    }
+}
+
 /* (No doubt this function already exists elsewhere.) */
 static void repr_quote_write (Writer &out, const gchar * val)
 {
     if (val) {
-        for (; *val != '\0'; val++) {
+        // pass the runs between characters which need escaping on in one go
+        for (;;) {
+            size_t run = strcspn( val, "\"&<>" );
+            if (run) {
+                out.write( val, run );
+                val += run;
+            }
             switch (*val) {
-                case '"': out.writeString( "&quot;" ); break;
-                case '&': out.writeString( "&amp;" ); break;
-                case '<': out.writeString( "&lt;" ); break;
-                case '>': out.writeString( "&gt;" ); break;
-                default: out.writeChar( *val ); break;
+                case '"': repr_write( out, "&quot;" ); break;
+                case '&': repr_write( out, "&amp;" ); break;
+                case '<': repr_write( out, "&lt;" ); break;
+                case '>': repr_write( out, "&gt;" ); break;
+                default: return; // end of string
             }
+            val++;
         }
     }
 }
@@ -714,26 +720,19 @@ static void repr_write_comment( Writer &out, const gchar * val, bool addWhitespa
         indentLevel = 16;
     }
     if (addWhitespace && indent) {
-        for (gint i = 0; i < indentLevel; i++) {
-            for (gint j = 0; j < indent; j++) {
-                out.writeString(" ");
-            }
-        }
+        repr_write_indent( out, indentLevel, indent );
     }
 
-    out.writeString("<!--");
-    // WARNING out.printf() and out.writeString() are *NOT* non-ASCII friendly.
+    repr_write( out, "<!--" );
     if (val) {
-        for (const gchar* cur = val; *cur; cur++ ) {
-            out.writeChar(*cur);
-        }
+        repr_write( out, val );
     } else {
-        out.writeString(" ");
+        repr_write( out, " " );
     }
-    out.writeString("-->");
+    repr_write( out, "-->" );
 
     if (addWhitespace) {
-        out.writeString("\n");
+        repr_write( out, "\n" );
     }
 }
 
@@ -863,7 +862,11 @@ void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
         case Inkscape::XML::TEXT_NODE: {
             if( dynamic_cast<const Inkscape::XML::TextNode *>(repr)->is_CData() ) {
                 // Preserve CDATA sections, not converting '&' to &amp;, etc.
-                out.printf( "<![CDATA[%s]]>", repr->content() );
+                repr_write( out, "<![CDATA[" );
+                if (repr->content()) {
+                    repr_write( out, repr->content() );
+                }
+                repr_write( out, "]]>" );
             } else {
                 repr_quote_write( out, repr->content() );
             }
@@ -874,7 +877,13 @@ void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
             break;
         }
         case Inkscape::XML::PI_NODE: {
-            out.printf( "<?%s %s?>", repr->name(), repr->content() );
+            repr_write( out, "<?" );
+            repr_write( out, repr->name() );
+            repr_write( out, " " );
+            if (repr->content()) {
+                repr_write( out, repr->content() );
+            }
+            repr_write( out, "?>" );
             break;
         }
         case Inkscape::XML::ELEMENT_NODE: {
@@ -914,11 +923,7 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
     }
 
     if (add_whitespace && indent) {
-        for (gint i = 0; i < indent_level; i++) {
-            for (gint j = 0; j < indent; j++) {
-                out.writeString(" ");
-            }
-        }
+        repr_write_indent( out, indent_level, indent );
     }
 
     GQuark code = repr->code();
@@ -928,7 +933,8 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
     } else {
         element_name = g_quark_to_string(code);
     }
-    out.printf( "<%s", element_name );
+    repr_write( out, "<" );
+    repr_write( out, element_name );
 
     // if this is a <text> element, suppress formatting whitespace
     // for its content and children:
@@ -964,18 +970,16 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
           iter ; ++iter )
     {
         if (!inlineattrs) {
-            out.writeString("\n");
+            repr_write( out, "\n" );
             if (indent) {
-                for ( gint i = 0 ; i < indent_level + 1 ; i++ ) {
-                    for ( gint j = 0 ; j < indent ; j++ ) {
-                        out.writeString(" ");
-                    }
-                }
+                repr_write_indent( out, indent_level + 1, indent );
             }
         }
-        out.printf(" %s=\"", g_quark_to_string(iter->key));
+        repr_write( out, " " );
+        repr_write( out, g_quark_to_string(iter->key) );
+        repr_write( out, "=\"" );
         repr_quote_write(out, iter->value);
-        out.writeChar('"');
+        repr_write( out, "\"" );
     }
 
     loose = TRUE;
@@ -986,9 +990,9 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
     }
     if (repr->firstChild()) {
-        out.writeString( ">" );
+        repr_write( out, ">" );
         if (loose && add_whitespace) {
-            out.writeString( "\n" );
+            repr_write( out, "\n" );
         }
         for (child = repr->firstChild(); child != NULL; child = child->next()) {
             sp_repr_write_stream(child, out, ( loose ? indent_level + 1 : 0 ),
@@ -997,22 +1001,20 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
 
         if (loose && add_whitespace && indent) {
-            for (gint i = 0; i < indent_level; i++) {
-                for ( gint j = 0 ; j < indent ; j++ ) {
-                    out.writeString(" ");
-                }
-            }
+            repr_write_indent( out, indent_level, indent );
         }
-        out.printf( "</%s>", element_name );
+        repr_write( out, "</" );
+        repr_write( out, element_name );
+        repr_write( out, ">" );
     } else {
-        out.writeString( " />" );
+        repr_write( out, " />" );
     }
 
     // text elements cannot nest, so we can output newline
     // after closing text
 
     if (add_whitespace || !strcmp (repr->name(), "svg:text")) {
-        out.writeString( "\n" );
+        repr_write( out, "\n" );
     }
 }
 